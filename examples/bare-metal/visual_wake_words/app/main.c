@@ -29,11 +29,9 @@ void print_output()
 
 void app_main()
 {
-  // initialize model runner global state
-  model_runner_init(tensor_arena, TENSOR_ARENA_SIZE);
-
   // setup model runner
   vww_model_runner_create(model_runner_ctx, NULL);
+  model_runner_init(model_runner_ctx, tensor_arena, TENSOR_ARENA_SIZE);
   model_runner_allocate(model_runner_ctx, vww_model_data);
   input_buffer = model_runner_input_buffer_get(model_runner_ctx);
   input_size = model_runner_input_size_get(model_runner_ctx);
@@ -49,7 +47,9 @@ void app_data(void *data, size_t size)
   {
     model_runner_invoke(model_runner_ctx);
 
+#if MODEL_RUNNER_PROFILER_ENABLED
     model_runner_profiler_summary_print(model_runner_ctx);
+#endif
     print_output();
     input_bytes = 0;
   }
@@ -3,6 +3,9 @@
 
 #include "vww_model_runner.h"
 
+#include <cstdlib>
+#include <new>
+
 #include "model_runner_profiler.h"
 #include "tensorflow/lite/micro/kernels/xcore/xcore_interpreter.h"
 #include "tensorflow/lite/micro/kernels/xcore/xcore_ops.h"
@@ -13,8 +16,6 @@ typedef xcore::ModelRunnerProfiler<31> profiler_t;
 static resolver_t resolver_s;
 static resolver_t *resolver = nullptr;
 
-static profiler_t *profiler = nullptr;
-
 __attribute__((fptrgroup("model_runner_resolver_get_fptr_grp")))
 void vww_resolver_get(void **v_resolver)
 {
@@ -34,46 +35,39 @@ void vww_resolver_get(void **v_resolver)
   *v_resolver = static_cast<void *>(resolver);
 }
 
-#ifndef NDEBUG
+#if MODEL_RUNNER_PROFILER_ENABLED
 
-__attribute__((fptrgroup("model_runner_profiler_get_fptr_grp")))
-void vww_profiler_get(void **v_profiler) {
-  if (profiler == nullptr) {
-    // Set up profiling
-    static profiler_t profiler_s;
-
-    profiler = &profiler_s;
-  }
+// The profiler follows the context state in the buffer, so that every context
+// has its own
+static size_t vww_profiler_offset_get() {
+  size_t align = alignof(profiler_t);
 
-  *v_profiler = static_cast<void *>(profiler);
-}
-
-__attribute__((fptrgroup("model_runner_profiler_reset_fptr_grp")))
-void vww_profiler_reset() {
-  if (profiler) {
-    profiler->ClearEvents();
-  }
+  return (model_runner_buffer_size_get() + align - 1) / align * align;
 }
 
-__attribute__((fptrgroup("model_runner_profiler_durations_get_fptr_grp")))
-void vww_profiler_durations_get(uint32_t *count, const uint32_t **durations) {
-  if (profiler) {
-    *count = profiler->GetNumEvents();
-    *durations = profiler->GetEventDurations();
-  }
-}
+#endif
 
+size_t vww_model_runner_buffer_size_get() {
+#if MODEL_RUNNER_PROFILER_ENABLED
+  return vww_profiler_offset_get() + sizeof(profiler_t);
+#else
+  return model_runner_buffer_size_get();
 #endif
+}
 
 //********************************
 // Create a vww model runner.
 //********************************
 void vww_model_runner_create(model_runner_t *ctx, void *buffer) {
-  ctx->hInterpreter = buffer;  // NOTE: buffer can be NULL
+  if (buffer == nullptr) {
+    buffer = malloc(vww_model_runner_buffer_size_get());
+  }
+  ctx->hInterpreter = buffer;
   ctx->resolver_get_fun = &vww_resolver_get;
-#ifndef NDEBUG
-  ctx->profiler_get_fun = &vww_profiler_get;
-  ctx->profiler_reset_fun = &vww_profiler_reset;
-  ctx->profiler_durations_get_fun = &vww_profiler_durations_get;
+#if MODEL_RUNNER_PROFILER_ENABLED
+  ctx->hProfiler = new (static_cast<uint8_t *>(buffer) +
+                        vww_profiler_offset_get()) profiler_t();
+#else
+  ctx->hProfiler = nullptr;
 #endif
-}
\ No newline at end of file
+}
@@ -10,14 +10,24 @@
 extern "C" {
 #endif
 
+/** Get size of buffer needed for call to vww_model_runner_create.
+ *
+ * The buffer holds the context's interpreter and allocator state, and its
+ * profiler if profiling is enabled.
+ *
+ * @return   The size (in bytes)
+ */
+size_t vww_model_runner_buffer_size_get();
+
 /** Create a vww model runner.
  *
  * @param[out] ctx      Model runner context
- * @param[in]  buffer   Buffer for interpreter.  If NULL, will be allocated with
- *                      malloc.  The caller is responsible for freeing the memory
- *                      if needed.  To determine the size at run time call:
+ * @param[in]  buffer   Buffer for interpreter, context and profiler state.
+ *                      If NULL, will be allocated with malloc.  The caller is
+ *                      responsible for freeing the memory if needed.  To
+ *                      determine the size at run time call:
  *
- *       size_t size = model_runner_buffer_size_get();
+ *       size_t size = vww_model_runner_buffer_size_get();
  */
 void vww_model_runner_create(model_runner_t *ctx, void *buffer);
 
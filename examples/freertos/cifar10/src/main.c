@@ -40,6 +40,10 @@ void startup_task(void *arg)
     cifar10_addr->intertile_ctx = intertile_ctx;
     cifar10_addr->port = CIFAR10_PORT;
 
+    /* Send the tensors in fragments so they don't hold up the RPC ports */
+    rtos_intertile_port_config(intertile_ctx, CIFAR10_PORT, 0,
+                               RTOS_INTERTILE_PORT_FRAGMENT);
+
 #if ON_TILE(0)
     cifar10_app_task_create(cifar10_addr, appconfCIFAR10_TASK_PRIORITY);
 #endif
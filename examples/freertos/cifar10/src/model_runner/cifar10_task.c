@@ -19,6 +19,10 @@
 #include "cifar10_model_runner.h"
 #include "model_runner.h"
 
+#if USE_SWMEM
+#include "rtos/drivers/swmem/api/rtos_swmem.h"
+#endif
+
 typedef struct model_runner_args {
   QueueHandle_t input_queue;
   rtos_intertile_address_t *intertile_addr;
@@ -26,6 +30,15 @@ typedef struct model_runner_args {
 
 #define TENSOR_ARENA_SIZE 58000
 
+#define INPUT_TENSOR_SIZE (32 * 32 * 3)
+#define OUTPUT_TENSOR_SIZE 10
+
+/* One tensor being received, one queued and one being copied by the runner */
+#define INPUT_POOL_BUFFER_COUNT 3
+
+static rtos_intertile_rx_pool_t input_pool;
+static uint8_t input_pool_buffers[INPUT_POOL_BUFFER_COUNT][INPUT_TENSOR_SIZE];
+
 static int argmax(const int8_t *A, const int N) {
   int m = 0;
 
@@ -49,8 +62,8 @@ static void cifar10_task_app(void *args) {
   uint8_t *data = NULL;
   FRESULT result;
   unsigned int bytes_read = 0;
-  uint8_t *output_tensor;
-  int output_tensor_len;
+  int8_t output_tensor[OUTPUT_TENSOR_SIZE];
+  size_t output_tensor_len;
   char classification[12] = {0};
 
   while (1) {
@@ -73,10 +86,11 @@ static void cifar10_task_app(void *args) {
       vPortFree(data);
 
       output_tensor_len =
-          rtos_intertile_rx(adr->intertile_ctx, adr->port,
-                            (void **)&output_tensor, portMAX_DELAY);
+          rtos_intertile_rx_buf(adr->intertile_ctx, adr->port, output_tensor,
+                                sizeof(output_tensor), portMAX_DELAY);
+      configASSERT(output_tensor_len == sizeof(output_tensor));
 
-      switch (argmax((int8_t *)output_tensor, 10)) {
+      switch (argmax(output_tensor, OUTPUT_TENSOR_SIZE)) {
       case 0:
         rtos_snprintf(classification, 9, "Airplane");
         break;
@@ -112,7 +126,6 @@ static void cifar10_task_app(void *args) {
       }
       rtos_printf("Classification of file %s is %s\n", test_input_files[i],
                   classification);
-      vPortFree(output_tensor);
     }
     rtos_printf("All files complete.  Repeating in 5 seconds...\n");
     vTaskDelay(pdMS_TO_TICKS(5000));
@@ -124,12 +137,16 @@ static void cifar10_runner_rx(void *args) {
   QueueHandle_t q = targs->input_queue;
   rtos_intertile_address_t *adr = targs->intertile_addr;
   uint8_t *input_tensor;
-  int input_tensor_len;
+  size_t len;
 
   while (1) {
-    input_tensor_len = rtos_intertile_rx(adr->intertile_ctx, adr->port,
-                                         (void **)&input_tensor, portMAX_DELAY);
-    xQueueSend(q, &input_tensor, portMAX_DELAY);
+    len = rtos_intertile_rx(adr->intertile_ctx, adr->port,
+                            (void **)&input_tensor, portMAX_DELAY);
+    // The tensor is dropped when every pool buffer is still queued, and the
+    // runner reports it from the pool's drop count
+    if (len != RTOS_INTERTILE_RX_DROPPED) {
+      xQueueSend(q, &input_tensor, portMAX_DELAY);
+    }
   }
 }
 
@@ -147,6 +164,14 @@ static void cifar10_task_runner(void *args) {
   uint8_t *tensor_arena = NULL;
   uint8_t *input_tensor;
   dispatcher_t *dispatcher;
+  model_runner_dispatcher_stats_t dispatcher_stats;
+  model_runner_arena_usage_t arena_usage;
+  rtos_intertile_rx_pool_stats_t pool_stats;
+  unsigned pool_drop_count = 0;
+#if USE_SWMEM
+  int swmem_model_region;
+  rtos_swmem_stats_t swmem_stats;
+#endif
 
   tensor_arena = pvPortMalloc(TENSOR_ARENA_SIZE);
 
@@ -155,13 +180,12 @@ static void cifar10_task_runner(void *args) {
                          appconfDISPATCHER_THREAD_COUNT,
                          appconfDISPATCHER_THREAD_PRIORITY);
 
-  model_runner_init(tensor_arena, TENSOR_ARENA_SIZE);
-
-  req_size = model_runner_buffer_size_get();
+  req_size = cifar10_model_runner_buffer_size_get();
   interpreter_buf = pvPortMalloc(req_size);
   model_runner_ctx = pvPortMalloc(sizeof(model_runner_t));
 
   cifar10_model_runner_create(model_runner_ctx, interpreter_buf);
+  model_runner_init(model_runner_ctx, tensor_arena, TENSOR_ARENA_SIZE);
   model_runner_dispatcher_create(model_runner_ctx, dispatcher);
   if (model_runner_allocate(model_runner_ctx, cifar10_model_data) != 0) {
     rtos_printf("Invalid model provided!\n");
@@ -173,6 +197,16 @@ static void cifar10_task_runner(void *args) {
     vTaskDelete(NULL);
   }
 
+  model_runner_arena_usage_get(model_runner_ctx, &arena_usage);
+  rtos_printf("Tensor arena uses %u of %u bytes (%u persistent, %u scratch)\n",
+              arena_usage.total_bytes, TENSOR_ARENA_SIZE,
+              arena_usage.persistent_bytes, arena_usage.scratch_bytes);
+
+#if USE_SWMEM
+  swmem_model_region = rtos_swmem_stats_region_add(cifar10_model_data,
+                                                   cifar10_model_data_len);
+#endif
+
   input_buffer = model_runner_input_buffer_get(model_runner_ctx);
   input_size = model_runner_input_size_get(model_runner_ctx);
   output_buffer = model_runner_output_buffer_get(model_runner_ctx);
@@ -183,11 +217,47 @@ static void cifar10_task_runner(void *args) {
     xQueueReceive(q, &input_tensor, portMAX_DELAY);
 
     memcpy(input_buffer, input_tensor, input_size);
-    vPortFree(input_tensor);
+    rtos_intertile_rx_release(adr->intertile_ctx, adr->port, input_tensor);
+
+    rtos_intertile_rx_pool_stats_get(adr->intertile_ctx, adr->port,
+                                     &pool_stats);
+    if (pool_stats.drop_count != pool_drop_count) {
+      pool_drop_count = pool_stats.drop_count;
+      rtos_printf("Input tensors are arriving faster than inference runs "
+                  "(%u dropped)\n",
+                  pool_drop_count);
+    }
 
     rtos_printf("Running inference...\n");
+    model_runner_dispatcher_stats_reset(model_runner_ctx);
+#if USE_SWMEM
+    rtos_swmem_stats_reset();
+#endif
     model_runner_invoke(model_runner_ctx);
+#if MODEL_RUNNER_PROFILER_ENABLED
     model_runner_profiler_summary_print(model_runner_ctx);
+#endif
+
+    model_runner_dispatcher_stats_get(model_runner_ctx, &dispatcher_stats);
+    if (dispatcher_stats.worker_ticks > 0) {
+      rtos_printf("Dispatcher ran %u jobs in %u microseconds, %u%% worker "
+                  "utilisation\n",
+                  dispatcher_stats.job_count,
+                  (uint32_t)(dispatcher_stats.elapsed_ticks /
+                             PLATFORM_REFERENCE_MHZ),
+                  (uint32_t)((dispatcher_stats.busy_ticks * 100) /
+                             dispatcher_stats.worker_ticks));
+    }
+
+#if USE_SWMEM
+    if (swmem_model_region >= 0) {
+      rtos_swmem_stats_get(swmem_model_region, &swmem_stats);
+      rtos_printf("Model weights took %u flash line fills, %u from prefetched "
+                  "lines, %u microseconds stalled\n",
+                  swmem_stats.fill_count, swmem_stats.prefetch_hit_count,
+                  swmem_stats.stall_ticks / PLATFORM_REFERENCE_MHZ);
+    }
+#endif
 
     rtos_intertile_tx(adr->intertile_ctx, adr->port, output_buffer,
                       output_size);
@@ -212,6 +282,11 @@ void cifar10_model_runner_task_create(rtos_intertile_address_t *intertile_addr,
   args->input_queue = input_queue;
   args->intertile_addr = intertile_addr;
 
+  rtos_intertile_rx_pool_init(intertile_addr->intertile_ctx,
+                              intertile_addr->port, &input_pool,
+                              input_pool_buffers, INPUT_TENSOR_SIZE,
+                              INPUT_POOL_BUFFER_COUNT);
+
   xTaskCreate((TaskFunction_t)cifar10_task_runner, "cifar10", 500, args,
               priority, NULL);
 
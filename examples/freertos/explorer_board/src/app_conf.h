@@ -28,6 +28,7 @@
 #define appconfPIPELINE_AUDIO_SAMPLE_RATE       16000
 #define appconfAUDIO_PIPELINE_STAGE_ONE_GAIN    42
 #define appconfAUDIO_FRAME_LENGTH            	256
+#define appconfAUDIO_PIPELINE_FRAME_COUNT       8
 #define appconfPRINT_AUDIO_FRAME_POWER          0
 
 /* GPIO Configuration */
@@ -1,6 +1,8 @@
 // Copyright 2020-2022 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
+#include <platform.h>
+
 /* FreeRTOS headers */
 #include "FreeRTOS.h"
 #include "task.h"
@@ -12,12 +14,19 @@
 
 /* App headers */
 #include "app_conf.h"
-#include "audio_pipeline/audio_pipeline.h"
+#include "audio_pipeline.h"
 #include "example_pipeline/example_pipeline.h"
 #include "platform/driver_instances.h"
 
 #define FRAME_NUM_CHANS 2
 
+#ifndef appconfAUDIO_PIPELINE_FRAME_COUNT
+#define appconfAUDIO_PIPELINE_FRAME_COUNT 8
+#endif
+
+/* Latency histogram bins of 4 ms */
+#define HISTOGRAM_BIN_TICKS (4000 * PLATFORM_REFERENCE_MHZ)
+
 #ifndef appconfPRINT_AUDIO_FRAME_POWER
 #define appconfPRINT_AUDIO_FRAME_POWER 1
 #endif
@@ -85,74 +94,86 @@ void frame_power(int32_t (*audio_frame)[FRAME_NUM_CHANS])
                  MIN(frame_power0, (uint64_t) Q31(F31(INT32_MAX))));
 }
 
-void *example_pipeline_input(void *data)
-{
-    (void) data;
-
-    int32_t (*audio_frame)[FRAME_NUM_CHANS];
+static audio_pipeline_t example_pipeline;
 
-    audio_frame = pvPortMalloc(appconfAUDIO_FRAME_LENGTH * sizeof(audio_frame[0]));
+AUDIO_PIPELINE_STAGE_ATTR
+int example_pipeline_input(audio_pipeline_frame_t *frames[], size_t count, void *arg)
+{
+    (void) count;
+    (void) arg;
 
     rtos_mic_array_rx(
             mic_array_ctx,
-            audio_frame,
+            frames[0]->data,
             appconfAUDIO_FRAME_LENGTH,
             portMAX_DELAY);
 
-    return audio_frame;
+    return 0;
 }
 
-int example_pipeline_output(void *audio_frame, void *data)
+AUDIO_PIPELINE_STAGE_ATTR
+int example_pipeline_output(audio_pipeline_frame_t *frames[], size_t count, void *arg)
 {
-    (void) data;
+    (void) count;
+    (void) arg;
 
     rtos_i2s_tx(
             i2s_ctx,
-            audio_frame,
+            frames[0]->data,
             appconfAUDIO_FRAME_LENGTH,
             portMAX_DELAY);
 
-    vPortFree(audio_frame);
-
     return 0;
 }
 
-void stage0(int32_t (*audio_frame)[FRAME_NUM_CHANS])
+AUDIO_PIPELINE_STAGE_ATTR
+int stage0(audio_pipeline_frame_t *frames[], size_t count, void *arg)
 {
 #if appconfPRINT_AUDIO_FRAME_POWER
-    frame_power(audio_frame);
+    frame_power(frames[0]->data);
 #endif
+
+    return 0;
 }
 
-void stage1(int32_t (*audio_frame)[FRAME_NUM_CHANS])
+AUDIO_PIPELINE_STAGE_ATTR
+int stage1(audio_pipeline_frame_t *frames[], size_t count, void *arg)
 {
+    int32_t (*audio_frame)[FRAME_NUM_CHANS] = frames[0]->data;
+
 	for (int i = 0; i < appconfAUDIO_FRAME_LENGTH; i++)  {
         audio_frame[i][0] *= xStage1_Gain;
         audio_frame[i][1] *= xStage1_Gain;
 	}
+
+    return 0;
 }
 
 void example_pipeline_init(UBaseType_t priority)
 {
-	const int stage_count = 2;
+	const int stage_count = 4;
 
-	const audio_pipeline_stage_t stages[stage_count] = {
-			(audio_pipeline_stage_t) stage0,
-			(audio_pipeline_stage_t) stage1
-	};
-
-	const configSTACK_DEPTH_TYPE stage_stack_sizes[stage_count] = {
-			configMINIMAL_STACK_SIZE,
-			configMINIMAL_STACK_SIZE
+	const audio_pipeline_stage_config_t stages[stage_count] = {
+			{ .name = "ap_input", .function = example_pipeline_input, .priority = priority },
+			{ .name = "ap_stage0", .function = stage0, .priority = priority },
+			{ .name = "ap_stage1", .function = stage1, .priority = priority, .modifies_frame = true },
+			{ .name = "ap_output", .function = example_pipeline_output, .priority = priority },
 	};
 
 	audio_pipeline_init(
-			example_pipeline_input,
-			example_pipeline_output,
-            NULL,
-            NULL,
-			stages,
-			stage_stack_sizes,
-			priority,
-			stage_count);
+			&example_pipeline,
+			appconfAUDIO_FRAME_LENGTH * FRAME_NUM_CHANS * sizeof(int32_t),
+			appconfAUDIO_PIPELINE_FRAME_COUNT,
+			HISTOGRAM_BIN_TICKS);
+
+	for (int i = 0; i < stage_count; i++) {
+		audio_pipeline_stage_add(&example_pipeline, &stages[i]);
+		if (i > 0) {
+			audio_pipeline_connect(&example_pipeline, i - 1, i);
+		}
+	}
+
+	if (audio_pipeline_start(&example_pipeline) != RTOS_OSAL_SUCCESS) {
+		rtos_printf("Audio pipeline failed to start\n");
+	}
 }
@@ -7,6 +7,7 @@
 /* Enable trace system */
 #define xcoretraceconfigSYSVIEW 					0
 #define xcoretraceconfigASCII 						1
+#define xcoretraceconfigBINARY 						0
 
 /* Setup xScope trace Macros */
 #define xcoretraceconfigXSCOPE_TRACE_BUFFER         2000
@@ -8,6 +8,7 @@
 
 #include "rtos/drivers/qspi_flash/api/rtos_qspi_flash.h"
 #include "rtos/drivers/l2_cache/api/rtos_l2_cache.h"
+#include "rtos/drivers/swmem/api/rtos_swmem.h"
 
 #include "l2_cache.h"
 
@@ -19,18 +20,30 @@
 static rtos_qspi_flash_t qspi_flash_ctx_s;
 rtos_qspi_flash_t *qspi_flash_ctx = &qspi_flash_ctx_s;
 
+#if USE_L2_CACHE
 static rtos_l2_cache_t l2_cache_ctx_s;
 rtos_l2_cache_t *l2_cache_ctx = &l2_cache_ctx_s;
+#endif
 
 /* 1 for direct, 0 for two way associative */
 #define DIRECT_MAP 0
 
+/* The geometry of the cache when L2_CACHE_CONFIGURED is set */
+#define L2_CACHE_WAYS       4
+#define L2_CACHE_LINE_SIZE  256
+#define L2_CACHE_LINES      32
+
 void vApplicationMallocFailedHook(void)
 {
     debug_printf("Malloc failed!\n");
 }
 
-#if DIRECT_MAP
+#if USE_L2_CACHE
+
+#if L2_CACHE_CONFIGURED
+__attribute__((aligned(
+        8))) static int l2_cache_buffer[RTOS_L2_CACHE_BUFFER_WORDS(L2_CACHE_LINES, L2_CACHE_LINE_SIZE)];
+#elif DIRECT_MAP
 __attribute__((aligned(
         8))) static int l2_cache_buffer[RTOS_L2_CACHE_BUFFER_WORDS_DIRECT_MAP];
 #else
@@ -51,10 +64,36 @@ void rtos_flash_read_wrapper(void *dst_address, const void *src_address,
     } while (ret != 0);
 }
 
+#else /* USE_L2_CACHE */
+
+bool rtos_swmem_read_request_isr(unsigned offset, uint32_t *buf)
+{
+    return rtos_qspi_flash_read_ll(qspi_flash_ctx, (uint8_t *)buf, offset,
+                                   SWMEM_FILL_SIZE_WORDS * sizeof(uint32_t)) == 0;
+}
+
+bool rtos_swmem_prefetch_request_isr(unsigned offset, uint32_t *buf, size_t lines)
+{
+    return rtos_qspi_flash_read_ll(qspi_flash_ctx, (uint8_t *)buf, offset,
+                                   lines * SWMEM_FILL_SIZE_WORDS * sizeof(uint32_t)) == 0;
+}
+
+void rtos_swmem_read_request(unsigned offset, uint32_t *buf)
+{
+    rtos_qspi_flash_read(qspi_flash_ctx, (uint8_t *)buf, offset,
+                         SWMEM_FILL_SIZE_WORDS * sizeof(uint32_t));
+}
+
+#endif /* USE_L2_CACHE */
+
 void app(void *args)
 {
     rtos_qspi_flash_start(qspi_flash_ctx, configMAX_PRIORITIES - 1);
+#if USE_L2_CACHE
     rtos_l2_cache_start(l2_cache_ctx);
+#else
+    rtos_swmem_start(configMAX_PRIORITIES - 1);
+#endif
 
     while (1) {
         rtos_printf("Run examples\n");
@@ -92,6 +131,17 @@ void main_tile0(chanend_t c0, chanend_t c1, chanend_t c2, chanend_t c3)
 
                          qspi_flash_page_program_1_4_4);
 
+#if USE_L2_CACHE && L2_CACHE_CONFIGURED
+    const rtos_l2_cache_config_t l2_cache_config = {
+        .ways = L2_CACHE_WAYS,
+        .line_size = L2_CACHE_LINE_SIZE,
+        .line_count = L2_CACHE_LINES,
+    };
+
+    rtos_l2_cache_configured_init(l2_cache_ctx, &l2_cache_config,
+                                  rtos_flash_read_wrapper, 1 << 1, /* Place on core 1 */
+                                  l2_cache_buffer);
+#elif USE_L2_CACHE
     rtos_l2_cache_init(l2_cache_ctx,
 #if DIRECT_MAP
                        RTOS_L2_CACHE_DIRECT_MAP,
@@ -100,6 +150,9 @@ void main_tile0(chanend_t c0, chanend_t c1, chanend_t c2, chanend_t c3)
 #endif /* DIRECT_MAP */
                        rtos_flash_read_wrapper, 1 << 1, /* Place on core 1 */
                        l2_cache_buffer);
+#else
+    rtos_swmem_init(RTOS_SWMEM_READ_FLAG);
+#endif
 
     xTaskCreate((TaskFunction_t)app, "app", RTOS_THREAD_STACK_SIZE(app), NULL,
                 configMAX_PRIORITIES - 1, NULL);
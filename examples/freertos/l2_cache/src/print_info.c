@@ -6,6 +6,8 @@
 #include <stdlib.h>
 
 #include "l2_cache.h"
+#include "rtos/drivers/swmem/api/rtos_swmem.h"
+#include "rtos/drivers/l2_cache/api/rtos_l2_cache.h"
 #include "print_info.h"
 #include "xcore_utils.h"
 
@@ -14,9 +16,9 @@ void print_info(uint32_t timer_ticks)
 #if PRINT_TIMING_INFO
 #if L2_CACHE_DEBUG_FLOAT_ON
     // NOTE: This is invalid if L2 Cache debug is enabled, so don't print it.
-    printf("  Timing:   %0.01f us\n", timer_ticks / 100.0f);
+    printf("  Timing:   %0.01f us\n", timer_ticks / (float) PLATFORM_REFERENCE_MHZ);
 #else
-    debug_printf("  Timing:   %lu us\n", timer_ticks / 100);
+    debug_printf("  Timing:   %u us\n", timer_ticks / PLATFORM_REFERENCE_MHZ);
 #endif
 #endif // PRINT_TIMING_INFO
 
@@ -32,4 +34,29 @@ void print_info(uint32_t timer_ticks)
 
     l2_cache_debug_stats_reset();
 #endif // L2_CACHE_DEBUG_ON
+
+#if USE_L2_CACHE && L2_CACHE_CONFIGURED
+    extern rtos_l2_cache_t *l2_cache_ctx;
+    rtos_l2_cache_stats_t stats;
+    rtos_l2_cache_stats_get(l2_cache_ctx, &stats);
+    debug_printf("  L2 Cache Hit Count: %u\n", stats.hit_count);
+    debug_printf("    Miss Count: %u\n", stats.miss_count);
+    debug_printf("    Eviction Count: %u\n", stats.eviction_count);
+    debug_printf("    Miss Time: %u us\n", stats.miss_ticks / PLATFORM_REFERENCE_MHZ);
+
+    rtos_l2_cache_stats_reset(l2_cache_ctx);
+#endif // USE_L2_CACHE && L2_CACHE_CONFIGURED
+
+#if !USE_L2_CACHE
+    rtos_swmem_stats_t stats;
+    rtos_swmem_stats_get(0, &stats);
+    debug_printf("  SwMem Fill Count: %u\n", stats.fill_count);
+    debug_printf("    Prefetch Hit Count: %u\n", stats.prefetch_hit_count);
+    debug_printf("    Stall Count: %u\n", stats.stall_count);
+    debug_printf("    Stall Time: %u us\n", stats.stall_ticks / PLATFORM_REFERENCE_MHZ);
+    debug_printf("    Prefetched Lines: %u\n", stats.prefetch_line_count);
+    debug_printf("    Prefetch Time: %u us\n", stats.prefetch_ticks / PLATFORM_REFERENCE_MHZ);
+
+    rtos_swmem_stats_reset();
+#endif // !USE_L2_CACHE
 }
@@ -12,8 +12,14 @@
 
 #define appconfGPIO_RPC_HOST_TASK_PRIORITY      ( configMAX_PRIORITIES - 1 )
 #define appconfMIC_ARRAY_RPC_HOST_TASK_PRIORITY ( configMAX_PRIORITIES - 1 )
+#define appconfMIC_ARRAY_STREAM_TASK_PRIORITY   ( configMAX_PRIORITIES - 1 )
 
 #define appconfGPIO_RPC_PORT                    5
 #define appconfMIC_ARRAY_RPC_PORT               6
+#define appconfMIC_ARRAY_STREAM_PORT            7
+
+/* Mic frames are pushed to tile 0 in blocks, into a ring of this many blocks */
+#define appconfMIC_ARRAY_STREAM_BLOCK_FRAMES    64
+#define appconfMIC_ARRAY_STREAM_BLOCK_COUNT     6
 
 #endif /* APP_CONF_H_ */
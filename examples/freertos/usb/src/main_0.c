@@ -31,6 +31,7 @@
 static rtos_qspi_flash_t qspi_flash_ctx_s;
 static rtos_gpio_t gpio_ctx_s;
 static rtos_mic_array_t mic_array_ctx_s;
+static rtos_driver_stream_t mic_array_stream_s;
 static rtos_intertile_t intertile_ctx_s;
 
 static rtos_qspi_flash_t *qspi_flash_ctx = &qspi_flash_ctx_s;
@@ -147,6 +148,9 @@ void vApplicationDaemonTaskStartup(void *arg)
     rtos_gpio_rpc_config(gpio_ctx, appconfGPIO_RPC_PORT, appconfGPIO_RPC_HOST_TASK_PRIORITY);
 #if OSPREY_BOARD || XCOREAI_EXPLORER
     rtos_mic_array_rpc_config(mic_array_ctx, appconfMIC_ARRAY_RPC_PORT, appconfMIC_ARRAY_RPC_HOST_TASK_PRIORITY);
+    rtos_mic_array_rpc_stream_config(mic_array_ctx, &mic_array_stream_s, appconfMIC_ARRAY_STREAM_PORT,
+                                     appconfMIC_ARRAY_STREAM_BLOCK_FRAMES, appconfMIC_ARRAY_STREAM_BLOCK_COUNT,
+                                     appconfMIC_ARRAY_STREAM_TASK_PRIORITY);
 #endif
 
     /* Initialize drivers  */
@@ -0,0 +1,204 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <platform.h>
+
+#include "FreeRTOS.h"
+#include "timers.h"
+#include "rtos/drivers/gpio/api/rtos_gpio.h"
+#include "rtos/drivers/qspi_flash/api/rtos_qspi_flash.h"
+#include "demo_main.h"
+#include "msc_disk_manager.h"
+#include "tusb.h"
+
+/* The disk starts after the boot image, in the same place as the FatFS filesystem */
+#ifndef MSC_FLASH_DISK_START_ADDRESS
+#define MSC_FLASH_DISK_START_ADDRESS 0x100000
+#endif
+
+/* Hosts mostly write in 512 byte blocks, several to each flash sector */
+#ifndef MSC_FLASH_DISK_BLOCK_SIZE
+#define MSC_FLASH_DISK_BLOCK_SIZE 512
+#endif
+
+#define WRITE_STATS_PERIOD_MS 1000
+
+/* Blink pattern
+ * - 250 ms  : device not mounted
+ * - 1000 ms : device mounted
+ * - 2500 ms : device is suspended
+ */
+enum  {
+    BLINK_NOT_MOUNTED = 250,
+    BLINK_MOUNTED = 1000,
+    BLINK_SUSPENDED = 2500,
+};
+
+static TimerHandle_t blinky_timer_ctx = NULL;
+static rtos_gpio_t *gpio_ctx = NULL;
+static rtos_gpio_port_id_t led_port = 0;
+static uint32_t led_val = 0;
+static uint32_t blink_interval_ms = BLINK_NOT_MOUNTED;
+
+static TimerHandle_t write_stats_timer_ctx = NULL;
+static flash_disk_stats_t last_write_stats;
+
+//--------------------------------------------------------------------+
+// Device callbacks
+//--------------------------------------------------------------------+
+
+// Invoked when device is mounted
+void tud_mount_cb(void)
+{
+    xTimerChangePeriod(blinky_timer_ctx, pdMS_TO_TICKS(BLINK_MOUNTED), 0);
+}
+
+// Invoked when device is unmounted
+void tud_umount_cb(void)
+{
+    xTimerChangePeriod(blinky_timer_ctx, pdMS_TO_TICKS(BLINK_NOT_MOUNTED), 0);
+}
+
+// Invoked when usb bus is suspended
+// remote_wakeup_en : if host allow us  to perform remote wakeup
+// Within 7ms, device must draw an average of current less than 2.5 mA from bus
+void tud_suspend_cb(bool remote_wakeup_en)
+{
+    (void) remote_wakeup_en;
+    xTimerChangePeriod(blinky_timer_ctx, pdMS_TO_TICKS(BLINK_SUSPENDED), 0);
+}
+
+// Invoked when usb bus is resumed
+void tud_resume_cb(void)
+{
+    xTimerChangePeriod(blinky_timer_ctx, pdMS_TO_TICKS(BLINK_MOUNTED), 0);
+}
+
+//--------------------------------------------------------------------+
+// BLINKING TASK
+//--------------------------------------------------------------------+
+
+void led_blinky_cb(TimerHandle_t xTimer)
+{
+    (void) xTimer;
+    led_val ^= 1;
+
+#if OSPREY_BOARD
+#define RED         ~(1<<6)
+#define GREEN       ~(1<<7)
+    if(led_val) {
+        rtos_gpio_port_out(gpio_ctx, led_port, RED);
+    } else {
+        rtos_gpio_port_out(gpio_ctx, led_port, GREEN);
+    }
+#elif XCOREAI_EXPLORER
+    rtos_gpio_port_out(gpio_ctx, led_port, led_val);
+#else
+#error No valid board was specified
+#endif
+}
+
+void create_tinyusb_demo(rtos_gpio_t *ctx, unsigned priority)
+{
+    if (gpio_ctx == NULL) {
+        gpio_ctx = ctx;
+
+        led_port = rtos_gpio_port(PORT_LEDS);
+        rtos_gpio_port_enable(gpio_ctx, led_port);
+        rtos_gpio_port_out(gpio_ctx, led_port, led_val);
+
+        blinky_timer_ctx = xTimerCreate("blinky",
+                                        pdMS_TO_TICKS(blink_interval_ms),
+                                        pdTRUE,
+                                        NULL,
+                                        led_blinky_cb);
+        xTimerStart(blinky_timer_ctx, 0);
+    }
+}
+
+//--------------------------------------------------------------------+
+// FLASH DISK
+//--------------------------------------------------------------------+
+
+/*
+ * Prints the write throughput of the flash disk for each period in which
+ * the host wrote to it. The time is that spent in the write callbacks, so
+ * the throughput seen by the host is a little lower.
+ */
+static void write_stats_cb(TimerHandle_t xTimer)
+{
+    flash_disk_stats_t stats;
+    uint32_t bytes;
+    uint32_t us;
+
+    (void) xTimer;
+
+    flash_disk_stats_get(&stats);
+    bytes = stats.write_bytes - last_write_stats.write_bytes;
+
+    if (bytes > 0) {
+        us = (stats.write_ticks - last_write_stats.write_ticks) / PLATFORM_REFERENCE_MHZ;
+        rtos_printf("MSC wrote %u bytes in %u us (%u KiB/s), %u sectors programmed, %u erased, %u filled from flash\n",
+                    bytes,
+                    us,
+                    us > 0 ? (uint32_t) (((uint64_t) bytes * 1000000 / 1024) / us) : 0,
+                    stats.sector_programs - last_write_stats.sector_programs,
+                    stats.sector_erases - last_write_stats.sector_erases,
+                    stats.sector_fills - last_write_stats.sector_fills);
+    }
+
+    last_write_stats = stats;
+}
+
+void create_tinyusb_disks(rtos_qspi_flash_t *qspi_flash_ctx)
+{
+    uint32_t block_count = (rtos_qspi_flash_size_get(qspi_flash_ctx) - MSC_FLASH_DISK_START_ADDRESS) / MSC_FLASH_DISK_BLOCK_SIZE;
+
+    add_disk(0,
+             (uint8_t *) MSC_FLASH_DISK_START_ADDRESS,
+             block_count,
+             MSC_FLASH_DISK_BLOCK_SIZE,
+             "XMOS",
+             "Flash Disk",
+             "1.0",
+             qspi_flash_disk_init,
+             qspi_flash_disk_ready,
+             qspi_flash_disk_start_stop,
+             qspi_flash_disk_read,
+             qspi_flash_disk_write,
+             qspi_flash_disk_scsi_command,
+             qspi_flash_ctx);
+
+    write_stats_timer_ctx = xTimerCreate("write_stats",
+                                         pdMS_TO_TICKS(WRITE_STATS_PERIOD_MS),
+                                         pdTRUE,
+                                         NULL,
+                                         write_stats_cb);
+    xTimerStart(write_stats_timer_ctx, 0);
+}
@@ -0,0 +1,13 @@
+// Copyright 2022 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef DEMO_MAIN_H_
+#define DEMO_MAIN_H_
+
+#include "rtos/drivers/gpio/api/rtos_gpio.h"
+#include "rtos/drivers/qspi_flash/api/rtos_qspi_flash.h"
+
+void create_tinyusb_demo(rtos_gpio_t *ctx, unsigned priority);
+void create_tinyusb_disks(rtos_qspi_flash_t *qspi_flash_ctx);
+
+#endif /* DEMO_MAIN_H_ */
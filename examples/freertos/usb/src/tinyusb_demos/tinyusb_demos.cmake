@@ -14,6 +14,7 @@ set(HID_GENERIC_INOUT_TEST_PATH "${TINYUSB_DEMO_PATH}/hid_generic_inout/src")
 set(HID_MULTIPLE_INTERFACE_TEST_PATH "${TINYUSB_DEMO_PATH}/hid_multiple_interface/src")
 set(MIDI_TEST_PATH "${TINYUSB_DEMO_PATH}/midi_test/src")
 set(MSC_DUAL_LUN_PATH "${TINYUSB_DEMO_PATH}/msc_dual_lun/src")
+set(MSC_FLASH_PATH "${TINYUSB_DEMO_PATH}/msc_flash/src")
 set(UAC2_HEADSET_PATH "${TINYUSB_DEMO_PATH}/uac2_headset/src")
 set(USBTMC_PATH "${TINYUSB_DEMO_PATH}/usbtmc/src")
 set(WEBUSB_SERIAL "${TINYUSB_DEMO_PATH}/webusb_serial/src")
@@ -30,6 +31,7 @@ option(USE_TINYUSB_DEMO_HID_GENERIC_INOUT_TEST      "Enable to use TinyUSB demo"
 option(USE_TINYUSB_DEMO_HID_MULTIPLE_INTERFACE_TEST "Enable to use TinyUSB demo" FALSE)
 option(USE_TINYUSB_DEMO_MIDI_TEST                   "Enable to use TinyUSB demo" FALSE)
 option(USE_TINYUSB_DEMO_MSC_DUAL_LUN                "Enable to use TinyUSB demo" FALSE)
+option(USE_TINYUSB_DEMO_MSC_FLASH                   "Enable to use TinyUSB demo" FALSE)
 option(USE_TINYUSB_DEMO_UAC2_HEADSET                "Enable to use TinyUSB demo" FALSE)
 option(USE_TINYUSB_DEMO_USBTMC                      "Enable to use TinyUSB demo" FALSE)
 option(USE_TINYUSB_DEMO_WEBUSB_SERIAL               "Enable to use TinyUSB demo" FALSE)
@@ -156,6 +158,20 @@ if(USE_TINYUSB_DEMO_MSC_DUAL_LUN)
     )
 endif()
 
+if(USE_TINYUSB_DEMO_MSC_FLASH)
+    set(DEMO_PATH ${MSC_FLASH_PATH})
+
+    set(TINYUSB_DEMO_SOURCES
+        "${DEMO_PATH}/demo_main.c"
+        "${DEMO_PATH}/usb_descriptors.c"
+    )
+
+    set(TINYUSB_DEMO_INCLUDES
+        ${DEMO_PATH}
+    )
+    add_compile_definitions(MSC_MAX_DISKS=1)
+endif()
+
 if(USE_TINYUSB_DEMO_UAC2_HEADSET)
     set(DEMO_PATH ${UAC2_HEADSET_PATH})
 
@@ -207,6 +207,7 @@ if (DEFINED RTOS_CMAKE_RTOS)
     set(MODEL_RUNNER_SOURCES
       ${MODEL_RUNNER_SOURCES}
       "${MODEL_RUNNER_DIR}/src/rtos_dispatcher.cc"
+      "${MODEL_RUNNER_DIR}/src/model_memory_prefetch_loader.cc"
     )
   endif ()
 endif ()
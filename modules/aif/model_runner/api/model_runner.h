@@ -13,43 +13,149 @@
 
 struct model_runner_struct {
   void *hInterpreter;
+  void *hProfiler; // in the buffer passed to <name>_model_runner_create, or
+                   // NULL if profiling is disabled
   __attribute__((fptrgroup("model_runner_resolver_get_fptr_grp"))) void (
       *resolver_get_fun)(void **);
-  __attribute__((fptrgroup("model_runner_profiler_get_fptr_grp"))) void (
-      *profiler_get_fun)(void **);
-  __attribute__((fptrgroup("model_runner_profiler_reset_fptr_grp"))) void (
-      *profiler_reset_fun)(void);
-  __attribute__((
-      fptrgroup("model_runner_profiler_durations_get_fptr_"
-                "grp"))) void (*profiler_durations_get_fun)(uint32_t *,
-                                                            const uint32_t **);
 };
 
 typedef struct model_runner_struct model_runner_t;
 
+#if RTOS_FREERTOS
+typedef struct model_runner_dispatcher_stats {
+  uint32_t invoke_count;  // number of parallel kernel invocations
+  uint32_t job_count;     // number of jobs run by the workers
+  uint64_t elapsed_ticks; // wall time spent in parallel kernel invocations
+  uint64_t busy_ticks;    // time the workers spent running jobs
+  uint64_t worker_ticks;  // time the workers were available
+} model_runner_dispatcher_stats_t;
+
+typedef struct model_runner_prefetch_stats {
+  uint32_t load_count;     // number of loads from flash or external memory
+  uint32_t prefetch_count; // number of loads that had been prefetched
+  uint64_t bytes;          // bytes loaded
+  uint64_t fetch_ticks;    // time spent fetching, inline or in the background
+  uint64_t stall_ticks;    // time inference spent waiting for loads
+} model_runner_prefetch_stats_t;
+#endif
+
+// Profiling is independent of NDEBUG so it is available in release builds.
+// Define MODEL_RUNNER_PROFILER_ENABLED to 1 to include it.
+#ifndef MODEL_RUNNER_PROFILER_ENABLED
+#define MODEL_RUNNER_PROFILER_ENABLED 0
+#endif
+
+#define MODEL_RUNNER_PROFILER_RECORD_MAGIC 0x4650524D // "MRPF"
+#define MODEL_RUNNER_PROFILER_RECORD_VERSION 1
+#define MODEL_RUNNER_PROFILER_TAG_LENGTH 16
+
+#ifndef MODEL_RUNNER_PROFILER_XSCOPE_CHUNK_SIZE
+#define MODEL_RUNNER_PROFILER_XSCOPE_CHUNK_SIZE 64
+#endif
+
+// Binary profiler record, all fields are little-endian.  Times are in
+// reference clock ticks.
+typedef struct model_runner_profiler_record_header {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t event_count;
+  uint32_t reference_mhz;
+  uint32_t arena_persistent_bytes;
+  uint32_t arena_scratch_bytes;
+} model_runner_profiler_record_header_t;
+
+typedef struct model_runner_profiler_record_event {
+  char tag[MODEL_RUNNER_PROFILER_TAG_LENGTH]; // operator name, NUL padded
+  uint32_t start_ticks;  // relative to the start of the last inference
+  uint32_t end_ticks;    // relative to the start of the last inference
+  uint32_t sample_count; // number of inferences aggregated
+  uint32_t min_ticks;
+  uint32_t mean_ticks;
+  uint32_t max_ticks;
+  uint32_t load_bytes;   // weights loaded
+  uint32_t fetch_ticks;  // time spent fetching the weights
+  uint32_t stall_ticks;  // time spent waiting for the weights
+  uint32_t job_count;    // jobs run by the dispatcher workers
+  uint32_t busy_ticks;   // time the workers spent running jobs
+  uint32_t worker_ticks; // time the workers were available
+} model_runner_profiler_record_event_t;
+
+typedef struct model_runner_arena_usage {
+  size_t persistent_bytes; // allocator, tensor metadata and persistent buffers
+  size_t scratch_bytes;    // activations and kernel scratch memory
+  size_t total_bytes;      // minimum arena size for the model
+} model_runner_arena_usage_t;
+
 typedef enum ModelRunnerStatus {
   Ok = 0,
   ModelVersionError = 1,
   AllocateTensorsError = 2,
-  InvokeError = 3
+  InvokeError = 3,
+  ArenaOverflowError = 4
 } ModelRunnerStatus;
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/** Get size of buffer needed for call to model_runner_create.
+/** Get size of the context's interpreter and allocator state.
+ *
+ * The buffer passed to the generated <name>_model_runner_create function also
+ * holds the model's profiler, so size it with the generated
+ * <name>_model_runner_buffer_size_get function instead.
  *
  * @return   The size (in bytes)
  */
 size_t model_runner_buffer_size_get();
 
-/** Initialize the model runner global state.
+/** Initialize a model runner context.
  *
+ * Each context has its own arena, allocator, dispatcher and interpreter, so
+ * several models can be run side by side.  Model data and op resolvers are
+ * read-only and may be shared between contexts.
+ * Must be called after the generated <name>_model_runner_create function and
+ * before model_runner_dispatcher_create.
+ *
+ * @param[in] ctx          Model runner context
  * @param[in] arena        Array for scratch and activations.
  * @param[in] arena_size   Size (in bytes) of arena array
  */
-void model_runner_init(uint8_t *arena, size_t arena_size);
+void model_runner_init(model_runner_t *ctx, uint8_t *arena, size_t arena_size);
+
+/** Initialize a model runner context that shares its scratch memory with
+ *  other contexts.
+ *
+ * The shared arena is laid out as one scratch region, big enough for the
+ * largest scratch usage of all the contexts, followed by a persistent region
+ * for each context:
+ *
+ *   | scratch (shared) | persistent 0 | persistent 1 | ... |
+ *
+ * Use model_runner_arena_plan to find each context's scratch and persistent
+ * usage.  Contexts sharing scratch memory must never be invoked concurrently,
+ * and their input and output tensors also live in the scratch region, so
+ * inputs must be written after, and outputs read before, another context
+ * sharing the region is invoked.
+ *
+ * The context's allocator refuses any scratch allocation beyond scratch_size
+ * and any persistent allocation beyond persistent_size before it is written,
+ * so model_runner_allocate (or model_runner_dispatcher_create and
+ * model_runner_prefetch_create) returns ArenaOverflowError for a context that
+ * does not fit and leaves the other contexts' regions untouched.
+ *
+ * @param[in] ctx                Model runner context
+ * @param[in] arena              Start of the shared arena
+ * @param[in] scratch_size       Size (in bytes) of the shared scratch region
+ * @param[in] persistent_offset  Offset (in bytes) of this context's
+ *                               persistent region from the end of the
+ *                               scratch region
+ * @param[in] persistent_size    Size (in bytes) of this context's persistent
+ *                               region
+ */
+void model_runner_shared_arena_init(model_runner_t *ctx, uint8_t *arena,
+                                    size_t scratch_size,
+                                    size_t persistent_offset,
+                                    size_t persistent_size);
 
 /** Create a Dispatcher.
  *  Must be called before model_runner_allocate
@@ -64,6 +170,74 @@ ModelRunnerStatus model_runner_dispatcher_create(model_runner_t *ctx,
 ModelRunnerStatus model_runner_dispatcher_create(model_runner_t *ctx);
 #endif
 
+#if RTOS_FREERTOS
+/** Get the dispatcher's accumulated timing.
+ *
+ * Worker utilisation is busy_ticks / worker_ticks. Times are in reference
+ * clock ticks.
+ *
+ * @param[in]  ctx    Model runner context
+ * @param[out] stats  Dispatcher timing
+ */
+void model_runner_dispatcher_stats_get(model_runner_t *ctx,
+                                       model_runner_dispatcher_stats_t *stats);
+
+/** Reset the dispatcher's accumulated timing.
+ *
+ * @param[in] ctx    Model runner context
+ */
+void model_runner_dispatcher_stats_reset(model_runner_t *ctx);
+
+/** Create a weight prefetcher.
+ *  Must be called before model_runner_allocate
+ *
+ * The first inference records the sequence of weight loads. Later inferences
+ * fetch the next loads in the background, into two staging buffers carved
+ * from the buffer, while the current layer computes. Loads larger than half
+ * the buffer are copied synchronously, as are any loads after the first
+ * MODEL_RUNNER_PREFETCH_MAX_LOADS (default 64) of an inference.  Define
+ * MODEL_RUNNER_PREFETCH_MAX_LOADS to record longer sequences, at a cost of 8
+ * bytes each.
+ *
+ * @param[in] ctx          Model runner context
+ * @param[in] buffer       Staging buffer
+ * @param[in] buffer_size  Size (in bytes) of the staging buffer
+ * @param[in] priority     Priority of the prefetch thread
+ */
+ModelRunnerStatus model_runner_prefetch_create(model_runner_t *ctx,
+                                               uint8_t *buffer,
+                                               size_t buffer_size,
+                                               unsigned priority);
+
+/** Delete a weight prefetcher.
+ *
+ * Stops the prefetch thread and frees its RTOS objects, after which the
+ * staging buffer may be reused.  The context must not be invoked again until
+ * model_runner_allocate has been called, which then loads weights
+ * synchronously.
+ *
+ * @param[in] ctx    Model runner context
+ */
+void model_runner_prefetch_delete(model_runner_t *ctx);
+
+/** Get the prefetcher's accumulated statistics.
+ *
+ * The time overlapped with compute is fetch_ticks - stall_ticks. Times are in
+ * reference clock ticks.
+ *
+ * @param[in]  ctx    Model runner context
+ * @param[out] stats  Prefetch statistics
+ */
+void model_runner_prefetch_stats_get(model_runner_t *ctx,
+                                     model_runner_prefetch_stats_t *stats);
+
+/** Reset the prefetcher's accumulated statistics.
+ *
+ * @param[in] ctx    Model runner context
+ */
+void model_runner_prefetch_stats_reset(model_runner_t *ctx);
+#endif
+
 /** Allocate the model runner with the specified model content.
  *
  * @param[in] ctx                Model runner context
@@ -72,6 +246,29 @@ ModelRunnerStatus model_runner_dispatcher_create(model_runner_t *ctx);
 ModelRunnerStatus model_runner_allocate(model_runner_t *ctx,
                                         const uint8_t *model_content);
 
+/** Plan the model's arena without running inference.
+ *
+ * Allocates the model's tensors, as model_runner_allocate does, and reports
+ * the exact arena usage.  Use a generously sized arena for planning, the
+ * reported total is the minimum arena size for the model.
+ *
+ * @param[in]  ctx              Model runner context
+ * @param[in]  model_content    Array containing model content
+ * @param[out] usage            Arena usage
+ */
+ModelRunnerStatus model_runner_arena_plan(model_runner_t *ctx,
+                                          const uint8_t *model_content,
+                                          model_runner_arena_usage_t *usage);
+
+/** Get the arena usage.
+ *  Must be called after model_runner_allocate
+ *
+ * @param[in]  ctx     Model runner context
+ * @param[out] usage   Arena usage
+ */
+void model_runner_arena_usage_get(model_runner_t *ctx,
+                                  model_runner_arena_usage_t *usage);
+
 /** Get the model input buffer.
  *
  * @param[in] ctx                Model runner context
@@ -129,7 +326,7 @@ size_t model_runner_output_size_get(model_runner_t *ctx);
 void model_runner_ouput_quant_get(model_runner_t *ctx, float *scale,
                                   int *zero_point);
 
-#ifndef NDEBUG
+#if MODEL_RUNNER_PROFILER_ENABLED
 /** Get the profiler inference durations.
  *
  * @param[in]  ctx        Model runner context
@@ -139,13 +336,63 @@ void model_runner_ouput_quant_get(model_runner_t *ctx, float *scale,
 void model_runner_profiler_durations_get(model_runner_t *ctx, uint32_t *count,
                                          const uint32_t **durations);
 
-/** Print a summary report of profiler inference durations.
+/** Reset the profiler's min/mean/max aggregates.
+ *
+ * @param[in] ctx     Model runner context
+ */
+void model_runner_profiler_stats_reset(model_runner_t *ctx);
+
+/** Get the profiler record for one operator.
+ *
+ * @param[in]  ctx      Model runner context
+ * @param[in]  index    Operator index
+ * @param[out] record   Operator record
+ */
+void model_runner_profiler_record_event_get(
+    model_runner_t *ctx, size_t index,
+    model_runner_profiler_record_event_t *record);
+
+/** Get the size of the profiler's binary record.
+ *
+ * The record is a model_runner_profiler_record_header_t followed by a
+ * model_runner_profiler_record_event_t for each operator.
+ *
+ * @param[in] ctx     Model runner context
+ *
+ * @return    Record size (in bytes)
+ */
+size_t model_runner_profiler_record_size_get(model_runner_t *ctx);
+
+/** Read part of the profiler's binary record.
+ *
+ * Lets the record be exported in small pieces, for example one
+ * device_control read command payload at a time.
+ *
+ * @param[in]  ctx      Model runner context
+ * @param[in]  offset   Offset (in bytes) into the record
+ * @param[out] buffer   Buffer to copy the record into
+ * @param[in]  size     Size (in bytes) of the buffer
+ *
+ * @return    Number of bytes copied, 0 at the end of the record
+ */
+size_t model_runner_profiler_record_read(model_runner_t *ctx, size_t offset,
+                                         uint8_t *buffer, size_t size);
+
+/** Send the profiler's binary record over xscope.
+ *
+ * @param[in] ctx     Model runner context
+ * @param[in] probe   xscope probe to send the record on
+ */
+void model_runner_profiler_xscope_send(model_runner_t *ctx, unsigned probe);
+
+/** Print a summary report of profiler inference durations, weight loads,
+ *  worker utilisation and arena usage.
  *
  * @param[in] ctx     Model runner context
  */
 void model_runner_profiler_summary_print(model_runner_t *ctx);
 
-#endif
+#endif // MODEL_RUNNER_PROFILER_ENABLED
 
 #ifdef __cplusplus
 };
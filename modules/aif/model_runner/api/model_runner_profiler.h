@@ -11,34 +11,144 @@
 
 namespace xcore {
 
-template <unsigned int tMaxEventCount>
-class ModelRunnerProfiler : public tflite::MicroProfiler {
+/**
+ * ModelRunnerProfilerBase class
+ *
+ * Records one event per operator.  Each event keeps the operator's tag and
+ * timestamps from the last inference, the weights it loaded and the
+ * dispatcher parallelism it used, and the min, total and max duration over
+ * all the inferences since the last ResetStats.
+ *
+ * The memory loader and dispatcher attribute their work to the event that is
+ * currently running with RecordLoad and RecordDispatch.
+ */
+class ModelRunnerProfilerBase : public tflite::MicroProfiler {
  public:
-  explicit ModelRunnerProfiler() : event_count_(0) {}
-  ~ModelRunnerProfiler() override = default;
+  struct Event {
+    const char* tag;
+    uint32_t start_time;    // from the last inference
+    uint32_t end_time;      // from the last inference
+    uint32_t load_bytes;    // weights loaded
+    uint32_t fetch_ticks;   // time spent fetching the weights
+    uint32_t stall_ticks;   // time spent waiting for the weights
+    uint32_t job_count;     // jobs run by the dispatcher workers
+    uint32_t busy_ticks;    // time the workers spent running jobs
+    uint32_t worker_ticks;  // time the workers were available
+    uint32_t sample_count;  // number of inferences aggregated
+    uint32_t min_ticks;
+    uint32_t max_ticks;
+    uint64_t total_ticks;
+  };
+
+  ModelRunnerProfilerBase(Event* events, uint32_t* durations,
+                          uint32_t max_event_count)
+      : events_(events),
+        durations_(durations),
+        max_event_count_(max_event_count),
+        event_count_(0),
+        current_event_(max_event_count) {}
 
   uint32_t BeginEvent(const char* tag) {
-    event_start_time_ = tflite::GetCurrentTimeTicks();
-    return 0;
+    uint32_t event_handle = event_count_;
+
+    if (event_handle < max_event_count_) {
+      Event* event = &events_[event_handle];
+      event->tag = tag;
+      event->load_bytes = 0;
+      event->fetch_ticks = 0;
+      event->stall_ticks = 0;
+      event->job_count = 0;
+      event->busy_ticks = 0;
+      event->worker_ticks = 0;
+      event_count_++;
+      current_event_ = event_handle;
+      event->start_time = tflite::GetCurrentTimeTicks();
+    }
+    return event_handle;
   }
 
   void EndEvent(uint32_t event_handle) {
-    uint32_t event_duration;
     int32_t event_end_time = tflite::GetCurrentTimeTicks();
-    event_duration = (event_end_time - event_start_time_);
 
-    if (event_count_ < tMaxEventCount) {
-      event_durations_[event_count_] = event_duration;
-      event_count_++;
+    if (event_handle < max_event_count_) {
+      Event* event = &events_[event_handle];
+      uint32_t event_duration = event_end_time - event->start_time;
+
+      event->end_time = event_end_time;
+      durations_[event_handle] = event_duration;
+      if (event->sample_count == 0 || event_duration < event->min_ticks)
+        event->min_ticks = event_duration;
+      if (event_duration > event->max_ticks)
+        event->max_ticks = event_duration;
+      event->total_ticks += event_duration;
+      event->sample_count++;
+      current_event_ = max_event_count_;
+    }
+  }
+
+  // Record weights loaded by the current event
+  void RecordLoad(uint32_t bytes, uint32_t fetch_ticks, uint32_t stall_ticks) {
+    if (current_event_ < max_event_count_) {
+      Event* event = &events_[current_event_];
+      event->load_bytes += bytes;
+      event->fetch_ticks += fetch_ticks;
+      event->stall_ticks += stall_ticks;
+    }
+  }
+
+  // Record a parallel invocation made by the current event
+  void RecordDispatch(uint32_t job_count, uint32_t busy_ticks,
+                      uint32_t worker_ticks) {
+    if (current_event_ < max_event_count_) {
+      Event* event = &events_[current_event_];
+      event->job_count += job_count;
+      event->busy_ticks += busy_ticks;
+      event->worker_ticks += worker_ticks;
     }
   }
 
-  uint32_t const* GetEventDurations() {return event_durations_;}
+  // Called at the start of each inference, the aggregates are kept
+  void ClearEvents() {
+    event_count_ = 0;
+    current_event_ = max_event_count_;
+  }
+
+  // Clear the aggregates
+  void ResetStats() {
+    for (uint32_t i = 0; i < max_event_count_; i++) {
+      events_[i].sample_count = 0;
+      events_[i].min_ticks = 0;
+      events_[i].max_ticks = 0;
+      events_[i].total_ticks = 0;
+    }
+  }
+
+  uint32_t const* GetEventDurations() {return durations_;}
+  Event const* GetEvents() {return events_;}
   uint32_t GetNumEvents() {return event_count_;}
 
  private:
-  uint32_t event_start_time_;
+  Event* events_;
+  uint32_t* durations_;
+  uint32_t max_event_count_;
   uint32_t event_count_;
+  uint32_t current_event_;
+  TF_LITE_REMOVE_VIRTUAL_DELETE
+};
+
+template <unsigned int tMaxEventCount>
+class ModelRunnerProfiler : public ModelRunnerProfilerBase {
+ public:
+  // The arrays are members of this class, so the base class must not touch
+  // them until they have been constructed
+  explicit ModelRunnerProfiler()
+      : ModelRunnerProfilerBase(events_, event_durations_, tMaxEventCount) {
+    ResetStats();
+  }
+  ~ModelRunnerProfiler() override = default;
+
+ private:
+  Event events_[tMaxEventCount];
   uint32_t event_durations_[tMaxEventCount];
   TF_LITE_REMOVE_VIRTUAL_DELETE
 };
@@ -4,6 +4,7 @@
 #define RTOS_DISPATCHER_H_
 
 #include "dispatcher.h"
+#include "model_runner_profiler.h"
 #include "tensorflow/lite/micro/kernels/xcore/xcore_dispatcher.h"
 
 namespace tflite {
@@ -14,21 +15,61 @@ namespace xcore {
  * RTOSDispatcher class
  *
  * RTOS implementation of the Dispatcher abstract base class.
+ *
+ * Invoke keeps every worker busy until all the arguments have been consumed.
+ * Each worker runs a job that repeatedly claims the next unclaimed argument,
+ * so there is a single barrier at the end of Invoke rather than one for every
+ * num_threads_ arguments.
  */
 class RTOSDispatcher : public Dispatcher {
 public:
+  /**
+   * Accumulated Invoke timing, in reference clock ticks
+   */
+  struct InvokeStats {
+    uint32_t invoke_count;  // number of calls to Invoke
+    uint32_t job_count;     // number of arguments processed
+    uint64_t elapsed_ticks; // wall time spent in Invoke
+    uint64_t busy_ticks;    // time workers spent running the function
+    uint64_t worker_ticks;  // time workers were available, elapsed * workers
+  };
+
   RTOSDispatcher(dispatcher_t *dispatcher);
   ~RTOSDispatcher();
 
   TfLiteStatus Invoke(void **arguments, size_t size) const override;
 
+  void GetInvokeStats(InvokeStats *stats) const;
+  void ResetInvokeStats();
+
+  // Attribute each Invoke to the profiler's current event
+  void SetProfiler(::xcore::ModelRunnerProfilerBase *profiler);
+
 private:
+  struct InvokeState {
+    DISPATCHER_JOB_ATTRIBUTE dispatch_function_t function;
+    void **arguments;
+    size_t size;
+    volatile size_t next;
+  };
+
+  struct Runner {
+    InvokeState *state;
+    uint32_t busy_ticks;
+  };
+
+  DISPATCHER_JOB_ATTRIBUTE static void RunArguments(void *p);
+
   dispatcher_t *dispatcher_;
   dispatch_group_t *group_;
+  mutable InvokeState state_;
+  mutable Runner runners_[kMaxThreads];
+  mutable InvokeStats stats_;
+  ::xcore::ModelRunnerProfilerBase *profiler_;
 };
 
 } // namespace xcore
 } // namespace micro
 } // namespace tflite
 
-#endif // RTOS_DISPATCHER_H_
\ No newline at end of file
+#endif // RTOS_DISPATCHER_H_
@@ -0,0 +1,85 @@
+// Copyright 2021 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+#ifndef MODEL_MEMORY_BOUNDED_ALLOCATOR_H_
+#define MODEL_MEMORY_BOUNDED_ALLOCATOR_H_
+
+#include <cstdint>
+
+#include "tensorflow/lite/core/api/error_reporter.h"
+#include "tensorflow/lite/micro/memory_helpers.h"
+#include "tensorflow/lite/micro/simple_memory_allocator.h"
+
+namespace tflite {
+namespace micro {
+namespace xcore {
+
+// A SimpleMemoryAllocator that keeps head (scratch and temporary) allocations
+// within the first head_size bytes of the arena and tail (persistent)
+// allocations within the last tail_size bytes.  An allocation that would
+// cross either bound is refused before anything is written to it, so a
+// context sharing its arena with others can't overwrite their regions.
+class ModelMemoryBoundedAllocator : public SimpleMemoryAllocator {
+ public:
+  ModelMemoryBoundedAllocator(ErrorReporter *error_reporter, uint8_t *buffer,
+                              size_t buffer_size, size_t head_size,
+                              size_t tail_size)
+      : SimpleMemoryAllocator(error_reporter, buffer, buffer_size),
+        error_reporter_(error_reporter),
+        buffer_head_(buffer),
+        head_limit_(buffer + head_size),
+        tail_limit_(buffer + buffer_size - tail_size),
+        overflowed_(false) {}
+
+  TfLiteStatus SetHeadBufferSize(size_t size, size_t alignment) override {
+    if (AlignPointerUp(buffer_head_, alignment) + size > head_limit_) {
+      TF_LITE_REPORT_ERROR(error_reporter_,
+                           "Head buffer of %d bytes exceeds its region",
+                           size);
+      overflowed_ = true;
+      return kTfLiteError;
+    }
+    return SimpleMemoryAllocator::SetHeadBufferSize(size, alignment);
+  }
+
+  // The base allocators only move their pointers, so an allocation that
+  // crosses its bound is refused after the fact but before it is used
+  uint8_t *AllocateFromTail(size_t size, size_t alignment) override {
+    uint8_t *result = SimpleMemoryAllocator::AllocateFromTail(size, alignment);
+    if (result != nullptr && result < tail_limit_) {
+      TF_LITE_REPORT_ERROR(error_reporter_,
+                           "Tail allocation of %d bytes exceeds its region",
+                           size);
+      overflowed_ = true;
+      return nullptr;
+    }
+    return result;
+  }
+
+  uint8_t *AllocateTemp(size_t size, size_t alignment) override {
+    uint8_t *result = SimpleMemoryAllocator::AllocateTemp(size, alignment);
+    if (result != nullptr && result + size > head_limit_) {
+      TF_LITE_REPORT_ERROR(error_reporter_,
+                           "Temp allocation of %d bytes exceeds its region",
+                           size);
+      overflowed_ = true;
+      return nullptr;
+    }
+    return result;
+  }
+
+  // Whether an allocation has been refused for crossing a bound
+  bool Overflowed() const { return overflowed_; }
+
+ private:
+  ErrorReporter *error_reporter_;
+  uint8_t *buffer_head_;
+  uint8_t *head_limit_;
+  uint8_t *tail_limit_;
+  bool overflowed_;
+};
+
+}  // namespace xcore
+}  // namespace micro
+}  // namespace tflite
+
+#endif  // MODEL_MEMORY_BOUNDED_ALLOCATOR_H_
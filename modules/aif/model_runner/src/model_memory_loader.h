@@ -32,19 +32,25 @@ class ModelMemoryLoader : public MemoryLoader {
   ModelMemoryLoader() {}
 
   size_t Load(void **dest, const void *src, size_t size) {
+    if (IS_RAM(src)) {
+      *dest = const_cast<void *>(src);
+      return 0;
+    }
+    return Copy(*dest, src, size);
+  }
+
+  // Copy from flash, SwMem or external memory into RAM
+  static size_t Copy(void *dest, const void *src, size_t size) {
 #ifdef USE_SWMEM
     if (IS_SWMEM(src)) {
-      return swmem_load(*dest, src, size);
+      return swmem_load(dest, src, size);
     } else
 #endif /* USE_SWMEM */
     {
-      if (IS_RAM(src)) {
-        *dest = const_cast<void *>(src);
-        return 0;
-      } else if (size >= 128) {
-        vpu_memcpy_ext(*dest, src, size);
+      if (size >= 128) {
+        vpu_memcpy_ext(dest, src, size);
       } else {
-        memcpy(*dest, src, size);
+        memcpy(dest, src, size);
       }
       return size;
     }
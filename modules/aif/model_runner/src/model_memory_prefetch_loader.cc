@@ -0,0 +1,171 @@
+// Copyright 2021 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include "model_memory_prefetch_loader.h"
+
+#include <xcore/assert.h>
+#include <xcore/hwtimer.h>
+
+#include "rtos_support.h"
+
+extern "C" {
+static void model_memory_prefetch_worker(void *arg) {
+  static_cast<tflite::micro::xcore::ModelMemoryPrefetchLoader *>(arg)->Run();
+}
+}
+
+namespace tflite {
+namespace micro {
+namespace xcore {
+
+ModelMemoryPrefetchLoader::ModelMemoryPrefetchLoader(uint8_t *buffer,
+                                                     size_t buffer_size,
+                                                     unsigned priority)
+    : schedule_length_(0), load_index_(0), profiler_(nullptr) {
+  xassert(buffer);
+
+  // keep each staging buffer word aligned for the VPU copies
+  slot_size_ = (buffer_size / kSlotCount) & ~0x3;
+  for (size_t i = 0; i < kSlotCount; i++) {
+    slots_[i].src = nullptr;
+    slots_[i].size = 0;
+    slots_[i].buffer = buffer + i * slot_size_;
+    slots_[i].fetch_ticks = 0;
+    slots_[i].pending = false;
+    rtos_osal_semaphore_create(&slots_[i].done, "prefetch_done", 1, 0);
+  }
+  ResetLoadStats();
+
+  rtos_osal_queue_create(&requests_, "prefetch_requests", kSlotCount,
+                         sizeof(Slot *));
+  rtos_osal_thread_create(&thread_, "prefetch", model_memory_prefetch_worker,
+                          this,
+                          RTOS_THREAD_STACK_SIZE(model_memory_prefetch_worker),
+                          priority);
+}
+
+ModelMemoryPrefetchLoader::~ModelMemoryPrefetchLoader() {
+  // with no fetch outstanding the worker holds nothing, it is either waiting
+  // for a request or about to, so it can be deleted
+  for (size_t i = 0; i < kSlotCount; i++) {
+    Wait(&slots_[i]);
+  }
+  rtos_osal_thread_delete(&thread_);
+
+  rtos_osal_queue_delete(&requests_);
+  for (size_t i = 0; i < kSlotCount; i++) {
+    rtos_osal_semaphore_delete(&slots_[i].done);
+  }
+}
+
+void ModelMemoryPrefetchLoader::Run() {
+  Slot *slot;
+
+  for (;;) {
+    rtos_osal_queue_receive(&requests_, &slot, RTOS_OSAL_WAIT_FOREVER);
+    uint32_t start = get_reference_time();
+    Copy(slot->buffer, slot->src, slot->size);
+    slot->fetch_ticks = get_reference_time() - start;
+    rtos_osal_semaphore_put(&slot->done);
+  }
+}
+
+void ModelMemoryPrefetchLoader::Prefetch(size_t index) {
+  if (index >= schedule_length_ || schedule_[index].size > slot_size_)
+    return;
+
+  Slot *slot = &slots_[index % kSlotCount];
+  xassert(!slot->pending);
+  slot->src = schedule_[index].src;
+  slot->size = schedule_[index].size;
+  slot->pending = true;
+  rtos_osal_queue_send(&requests_, &slot, RTOS_OSAL_WAIT_FOREVER);
+}
+
+void ModelMemoryPrefetchLoader::Wait(Slot *slot) {
+  if (slot->pending) {
+    rtos_osal_semaphore_get(&slot->done, RTOS_OSAL_WAIT_FOREVER);
+    slot->pending = false;
+  }
+}
+
+void ModelMemoryPrefetchLoader::Reset() {
+  // the previous inference may have stopped short of the recorded sequence
+  for (size_t i = 0; i < kSlotCount; i++) {
+    Wait(&slots_[i]);
+    slots_[i].src = nullptr;
+  }
+
+  load_index_ = 0;
+  for (size_t i = 0; i < kSlotCount; i++) {
+    Prefetch(i);
+  }
+}
+
+size_t ModelMemoryPrefetchLoader::Load(void **dest, const void *src,
+                                       size_t size) {
+  if (IS_RAM(src)) {
+    *dest = const_cast<void *>(src);
+    return 0;
+  }
+
+  uint32_t start = get_reference_time();
+  uint32_t fetch_ticks;
+  uint32_t stall_ticks;
+  size_t index = load_index_++;
+  Slot *slot = &slots_[index % kSlotCount];
+  bool hit = slot->pending && (slot->src == src) && (slot->size == size);
+
+  // a mismatched prefetch must still finish before its slot is reused
+  Wait(slot);
+
+  if (hit) {
+    stall_ticks = get_reference_time() - start;
+    fetch_ticks = slot->fetch_ticks;
+    std::memcpy(*dest, slot->buffer, size);
+    stats_.prefetch_count++;
+  } else {
+    Copy(*dest, src, size);
+    fetch_ticks = stall_ticks = get_reference_time() - start;
+  }
+
+  if (index < MODEL_RUNNER_PREFETCH_MAX_LOADS) {
+    schedule_[index].src = src;
+    schedule_[index].size = size;
+    if (index >= schedule_length_)
+      schedule_length_ = index + 1;
+  }
+
+  // the slot just consumed takes the load after the one already in flight
+  Prefetch(index + kSlotCount);
+
+  stats_.load_count++;
+  stats_.bytes += size;
+  stats_.fetch_ticks += fetch_ticks;
+  stats_.stall_ticks += stall_ticks;
+  if (profiler_)
+    profiler_->RecordLoad(size, fetch_ticks, stall_ticks);
+
+  return size;
+}
+
+void ModelMemoryPrefetchLoader::SetProfiler(
+    ::xcore::ModelRunnerProfilerBase *profiler) {
+  profiler_ = profiler;
+}
+
+void ModelMemoryPrefetchLoader::GetLoadStats(LoadStats *stats) const {
+  *stats = stats_;
+}
+
+void ModelMemoryPrefetchLoader::ResetLoadStats() {
+  stats_.load_count = 0;
+  stats_.prefetch_count = 0;
+  stats_.bytes = 0;
+  stats_.fetch_ticks = 0;
+  stats_.stall_ticks = 0;
+}
+
+} // namespace xcore
+} // namespace micro
+} // namespace tflite
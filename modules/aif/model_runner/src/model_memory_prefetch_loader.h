@@ -0,0 +1,96 @@
+// Copyright 2021 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+#ifndef MODEL_MEMORY_PREFETCH_LOADER_H_
+#define MODEL_MEMORY_PREFETCH_LOADER_H_
+
+#include "model_memory_loader.h"
+#include "model_runner_profiler.h"
+#include "rtos_osal.h"
+
+// Loads past this many in an inference are not recorded, so are always copied
+// synchronously
+#ifndef MODEL_RUNNER_PREFETCH_MAX_LOADS
+#define MODEL_RUNNER_PREFETCH_MAX_LOADS (64)
+#endif
+
+namespace tflite {
+namespace micro {
+namespace xcore {
+
+/**
+ * ModelMemoryPrefetchLoader class
+ *
+ * Double-buffered memory loader. The sequence of loads made by an inference
+ * is recorded and, on later inferences, a worker thread fetches the next
+ * loads into two staging buffers while the current layer computes. A load
+ * that was prefetched only waits for whatever part of the fetch is still
+ * outstanding, then copies from the staging buffer at RAM speed.
+ *
+ * Loads that are larger than a staging buffer, or that no longer match the
+ * recorded sequence, fall back to a synchronous copy.
+ */
+class ModelMemoryPrefetchLoader : public ModelMemoryLoader {
+public:
+  static constexpr size_t kSlotCount = 2;
+
+  /**
+   * Accumulated load statistics, in reference clock ticks
+   */
+  struct LoadStats {
+    uint32_t load_count;     // number of loads from flash or external memory
+    uint32_t prefetch_count; // number of loads served from a staging buffer
+    uint64_t bytes;          // bytes loaded
+    uint64_t fetch_ticks;    // time spent fetching, inline or in the worker
+    uint64_t stall_ticks;    // time the inference spent waiting for loads
+  };
+
+  ModelMemoryPrefetchLoader(uint8_t *buffer, size_t buffer_size,
+                            unsigned priority);
+  ~ModelMemoryPrefetchLoader();
+
+  size_t Load(void **dest, const void *src, size_t size);
+
+  // Called before each inference, starts fetching the first loads
+  void Reset();
+
+  void SetProfiler(::xcore::ModelRunnerProfilerBase *profiler);
+  void GetLoadStats(LoadStats *stats) const;
+  void ResetLoadStats();
+
+  // Worker thread entry point
+  void Run();
+
+private:
+  struct ScheduleEntry {
+    const void *src;
+    size_t size;
+  };
+
+  struct Slot {
+    const void *src;
+    size_t size;
+    uint8_t *buffer;
+    volatile uint32_t fetch_ticks;
+    bool pending;
+    rtos_osal_semaphore_t done;
+  };
+
+  void Prefetch(size_t index);
+  void Wait(Slot *slot);
+
+  ScheduleEntry schedule_[MODEL_RUNNER_PREFETCH_MAX_LOADS];
+  size_t schedule_length_;
+  size_t load_index_;
+  size_t slot_size_;
+  Slot slots_[kSlotCount];
+  rtos_osal_queue_t requests_;
+  rtos_osal_thread_t thread_;
+  ::xcore::ModelRunnerProfilerBase *profiler_;
+  LoadStats stats_;
+};
+
+} // namespace xcore
+} // namespace micro
+} // namespace tflite
+
+#endif // MODEL_MEMORY_PREFETCH_LOADER_H_
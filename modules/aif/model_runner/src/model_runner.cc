@@ -3,60 +3,135 @@
 
 #include "model_runner.h"
 
+#include <cinttypes>
+#include <cstring>
 #include <ctime>
 
 #include <platform.h> // for PLATFORM_REFERENCE_MHZ
 #include <xcore/assert.h>
+#include <xscope.h>
 
+#include "model_memory_bounded_allocator.h"
 #include "model_memory_loader.h"
+#include "model_runner_profiler.h"
 #include "tensorflow/lite/micro/kernels/xcore/xcore_interpreter.h"
 #include "tensorflow/lite/micro/micro_error_reporter.h"
 #include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
 #include "tensorflow/lite/micro/micro_op_resolver.h"
 
 #if RTOS_FREERTOS
+#include "model_memory_prefetch_loader.h"
 #include "rtos_dispatcher.h"
 #endif
 
 // typedefs
 typedef tflite::Model model_t;
 typedef tflite::MicroAllocator micro_allocator_t;
-typedef tflite::SimpleMemoryAllocator simple_allocator_t;
+typedef tflite::micro::xcore::ModelMemoryBoundedAllocator simple_allocator_t;
 typedef tflite::MicroErrorReporter error_reporter_t;
 typedef tflite::MicroOpResolver micro_op_resolver_t;
-typedef tflite::MicroProfiler tflite_profiler_t;
+typedef xcore::ModelRunnerProfilerBase tflite_profiler_t;
 typedef tflite::micro::xcore::ModelMemoryLoader memory_loader_t;
+#if RTOS_FREERTOS
+typedef tflite::micro::xcore::ModelMemoryPrefetchLoader prefetch_loader_t;
+#endif
 typedef tflite::micro::xcore::XCoreInterpreter interpreter_t;
 typedef tflite::micro::xcore::Dispatcher tflite_dispatcher_t;
 
+// Per-context state, stored in the buffer passed to the generated
+// <name>_model_runner_create function.  Nothing in here is shared between
+// contexts, so any number of models and arenas can be used side by side.
+typedef struct model_runner_state
+{
+  const model_t *model;
+  micro_allocator_t *allocator;
+  tflite_dispatcher_t *dispatcher;
+  memory_loader_t *memory_loader;
+#if RTOS_FREERTOS
+  prefetch_loader_t *prefetch_loader;
+#endif
+  alignas(simple_allocator_t) uint8_t
+      simple_allocator_buf[sizeof(simple_allocator_t)];
+  alignas(interpreter_t) uint8_t interpreter_buf[sizeof(interpreter_t)];
+} model_runner_state_t;
+
 // static variables
+//   The error reporter and memory loader are stateless so they are safely
+//   shared by all contexts.
 static error_reporter_t error_reporter_s;
 static memory_loader_t memory_loader_s;
 
-static const model_t *model = nullptr;
-static error_reporter_t *reporter = nullptr;
-static micro_allocator_t *allocator = nullptr;
-static tflite_dispatcher_t *tflite_dispatcher = nullptr;
+static error_reporter_t *reporter = &error_reporter_s;
+
+static inline model_runner_state_t *model_runner_state_get(model_runner_t *ctx)
+{
+  xassert(ctx);
+  xassert(ctx->hInterpreter);
+  return static_cast<model_runner_state_t *>(ctx->hInterpreter);
+}
+
+static inline tflite_profiler_t *model_runner_profiler_get(model_runner_t *ctx)
+{
+  return static_cast<tflite_profiler_t *>(ctx->hProfiler);
+}
+
+static inline interpreter_t *model_runner_interpreter_get(model_runner_t *ctx)
+{
+  return reinterpret_cast<interpreter_t *>(
+      model_runner_state_get(ctx)->interpreter_buf);
+}
 
-size_t model_runner_buffer_size_get() { return sizeof(interpreter_t); }
+size_t model_runner_buffer_size_get() { return sizeof(model_runner_state_t); }
 
-void model_runner_init(uint8_t *arena, size_t arena_size)
+// Scratch memory is allocated from the head of the arena and persistent
+// memory from the tail.  The allocator refuses scratch allocations past the
+// first scratch_size bytes and persistent allocations before the last
+// persistent_size bytes.
+static void model_runner_arena_init(model_runner_t *ctx, uint8_t *arena,
+                                    size_t arena_size, size_t scratch_size,
+                                    size_t persistent_size)
 {
+  xassert(ctx);
   xassert(arena);
   xassert(arena_size > 0);
 
-  // Set up error reporting
-  if (reporter == nullptr)
+  // Allocate buffer for the context state (if not already allocated)
+  if (ctx->hInterpreter == nullptr)
   {
-    reporter = &error_reporter_s;
+    ctx->hInterpreter = malloc(model_runner_buffer_size_get());
   }
+  model_runner_state_t *state = model_runner_state_get(ctx);
+
+  state->model = nullptr;
+  state->dispatcher = nullptr;
+  state->memory_loader = &memory_loader_s;
+#if RTOS_FREERTOS
+  state->prefetch_loader = nullptr;
+#endif
 
   // Set up allocator
-  static simple_allocator_t simple_allocator_s(reporter, arena, arena_size);
-  if (allocator == nullptr)
-  {
-    allocator = micro_allocator_t::Create(&simple_allocator_s, reporter);
-  }
+  simple_allocator_t *simple_allocator =
+      new (state->simple_allocator_buf) simple_allocator_t(
+          reporter, arena, arena_size, scratch_size, persistent_size);
+  state->allocator = micro_allocator_t::Create(simple_allocator, reporter);
+}
+
+void model_runner_init(model_runner_t *ctx, uint8_t *arena, size_t arena_size)
+{
+  model_runner_arena_init(ctx, arena, arena_size, arena_size, arena_size);
+}
+
+void model_runner_shared_arena_init(model_runner_t *ctx, uint8_t *arena,
+                                    size_t scratch_size,
+                                    size_t persistent_offset,
+                                    size_t persistent_size)
+{
+  // Ending this context's arena at the end of its persistent region keeps
+  // the persistent regions of the contexts apart while they all share the
+  // head
+  model_runner_arena_init(ctx, arena,
+                          scratch_size + persistent_offset + persistent_size,
+                          scratch_size, persistent_size);
 }
 
 #if RTOS_FREERTOS
@@ -64,19 +139,113 @@ ModelRunnerStatus model_runner_dispatcher_create(model_runner_t *ctx,
                                                  dispatcher_t *dispatcher)
 {
   xassert(dispatcher);
-  void *tflite_dispatcher_buf = allocator->AllocatePersistentBuffer(
+  model_runner_state_t *state = model_runner_state_get(ctx);
+  xassert(state->allocator);
+
+  void *tflite_dispatcher_buf = state->allocator->AllocatePersistentBuffer(
       sizeof(tflite::micro::xcore::RTOSDispatcher));
-  tflite_dispatcher = new (tflite_dispatcher_buf)
+  if (tflite_dispatcher_buf == nullptr)
+    return ArenaOverflowError;
+  state->dispatcher = new (tflite_dispatcher_buf)
       tflite::micro::xcore::RTOSDispatcher(dispatcher);
 
   return Ok;
 }
+
+void model_runner_dispatcher_stats_get(model_runner_t *ctx,
+                                       model_runner_dispatcher_stats_t *stats)
+{
+  model_runner_state_t *state = model_runner_state_get(ctx);
+  xassert(state->dispatcher);
+  xassert(stats);
+
+  tflite::micro::xcore::RTOSDispatcher::InvokeStats invoke_stats;
+  static_cast<tflite::micro::xcore::RTOSDispatcher *>(state->dispatcher)
+      ->GetInvokeStats(&invoke_stats);
+
+  stats->invoke_count = invoke_stats.invoke_count;
+  stats->job_count = invoke_stats.job_count;
+  stats->elapsed_ticks = invoke_stats.elapsed_ticks;
+  stats->busy_ticks = invoke_stats.busy_ticks;
+  stats->worker_ticks = invoke_stats.worker_ticks;
+}
+
+void model_runner_dispatcher_stats_reset(model_runner_t *ctx)
+{
+  model_runner_state_t *state = model_runner_state_get(ctx);
+  xassert(state->dispatcher);
+
+  static_cast<tflite::micro::xcore::RTOSDispatcher *>(state->dispatcher)
+      ->ResetInvokeStats();
+}
+
+ModelRunnerStatus model_runner_prefetch_create(model_runner_t *ctx,
+                                               uint8_t *buffer,
+                                               size_t buffer_size,
+                                               unsigned priority)
+{
+  xassert(buffer);
+  model_runner_state_t *state = model_runner_state_get(ctx);
+  xassert(state->allocator);
+
+  void *prefetch_loader_buf =
+      state->allocator->AllocatePersistentBuffer(sizeof(prefetch_loader_t));
+  if (prefetch_loader_buf == nullptr)
+    return ArenaOverflowError;
+  state->prefetch_loader = new (prefetch_loader_buf)
+      prefetch_loader_t(buffer, buffer_size, priority);
+  state->memory_loader = state->prefetch_loader;
+
+  return Ok;
+}
+
+void model_runner_prefetch_delete(model_runner_t *ctx)
+{
+  model_runner_state_t *state = model_runner_state_get(ctx);
+  xassert(state->prefetch_loader);
+
+  // The loader lives in the arena's persistent memory, which is only
+  // reclaimed when the context is initialized again
+  state->prefetch_loader->~prefetch_loader_t();
+  state->prefetch_loader = nullptr;
+  state->memory_loader = &memory_loader_s;
+}
+
+void model_runner_prefetch_stats_get(model_runner_t *ctx,
+                                     model_runner_prefetch_stats_t *stats)
+{
+  model_runner_state_t *state = model_runner_state_get(ctx);
+  xassert(state->prefetch_loader);
+  xassert(stats);
+
+  prefetch_loader_t::LoadStats load_stats;
+  state->prefetch_loader->GetLoadStats(&load_stats);
+
+  stats->load_count = load_stats.load_count;
+  stats->prefetch_count = load_stats.prefetch_count;
+  stats->bytes = load_stats.bytes;
+  stats->fetch_ticks = load_stats.fetch_ticks;
+  stats->stall_ticks = load_stats.stall_ticks;
+}
+
+void model_runner_prefetch_stats_reset(model_runner_t *ctx)
+{
+  model_runner_state_t *state = model_runner_state_get(ctx);
+  xassert(state->prefetch_loader);
+
+  state->prefetch_loader->ResetLoadStats();
+}
 #else
 ModelRunnerStatus model_runner_dispatcher_create(model_runner_t *ctx)
 {
-  void *tflite_dispatcher_buf = allocator->AllocatePersistentBuffer(
+  model_runner_state_t *state = model_runner_state_get(ctx);
+  xassert(state->allocator);
+
+  void *tflite_dispatcher_buf = state->allocator->AllocatePersistentBuffer(
       sizeof(tflite::micro::xcore::GenericDispatcher));
-  tflite_dispatcher =
+  if (tflite_dispatcher_buf == nullptr)
+    return ArenaOverflowError;
+  state->dispatcher =
       new (tflite_dispatcher_buf) tflite::micro::xcore::GenericDispatcher();
 
   return Ok;
@@ -87,10 +256,13 @@ ModelRunnerStatus model_runner_allocate(model_runner_t *ctx,
                                         const uint8_t *model_content)
 {
   xassert(model_content);
+  model_runner_state_t *state = model_runner_state_get(ctx);
+  xassert(state->allocator);
 
   // Map the model into a usable data structure. This doesn't involve any
   // copying or parsing, it's a very lightweight operation.
-  model = tflite::GetModel(model_content);
+  const model_t *model = tflite::GetModel(model_content);
+  state->model = model;
   if (model->version() != TFLITE_SCHEMA_VERSION)
   {
     return ModelVersionError;
@@ -102,52 +274,89 @@ ModelRunnerStatus model_runner_allocate(model_runner_t *ctx,
   micro_op_resolver_t *resolver =
       static_cast<micro_op_resolver_t *>(v_resolver);
 
-  // Get model specific profiler
-  void *v_profiler = nullptr;
-  ctx->profiler_get_fun(&v_profiler);
-  tflite_profiler_t *profiler = static_cast<tflite_profiler_t *>(v_profiler);
+  // Get model specific profiler (NULL if profiling is disabled)
+  tflite_profiler_t *profiler = model_runner_profiler_get(ctx);
 
   // Ensure dispatcher created
 #if RTOS_FREERTOS
   // RTOS applications must create the dispatcher before calling
   // model_runner_allocate
-  xassert(tflite_dispatcher);
+  xassert(state->dispatcher);
 #else
   // Bare-metal applications are allowed to not create the dispatcher before
   // calling model_runner_allocate.  A default one will be created for them.
-  if (tflite_dispatcher == nullptr)
-    model_runner_dispatcher_create(ctx);
-#endif
-
-  // Allocate buffer for interpreter (if not already allocated)
-  if (ctx->hInterpreter == nullptr)
+  if (state->dispatcher == nullptr)
   {
-    ctx->hInterpreter = malloc(model_runner_buffer_size_get());
+    ModelRunnerStatus dispatcher_status = model_runner_dispatcher_create(ctx);
+    if (dispatcher_status != Ok)
+      return dispatcher_status;
   }
+#endif
+
+#if RTOS_FREERTOS
+  // Attribute parallel invocations and prefetched weight loads to the
+  // profiler's events
+  static_cast<tflite::micro::xcore::RTOSDispatcher *>(state->dispatcher)
+      ->SetProfiler(profiler);
+  if (state->prefetch_loader)
+    state->prefetch_loader->SetProfiler(profiler);
+#endif
+
   // Build an interpreter to run the model with
-  interpreter_t *interpreter = new (ctx->hInterpreter)
-      interpreter_t(model, *resolver, allocator, reporter, *tflite_dispatcher,
-                    memory_loader_s, profiler);
+  interpreter_t *interpreter = new (state->interpreter_buf)
+      interpreter_t(model, *resolver, state->allocator, reporter,
+                    *state->dispatcher, *state->memory_loader, profiler);
 
   // Allocate memory from the tensor_arena for the model's tensors.
   TfLiteStatus allocate_tensors_status = interpreter->AllocateTensors();
   if (allocate_tensors_status != kTfLiteOk)
   {
-    return AllocateTensorsError;
+    simple_allocator_t *simple_allocator =
+        reinterpret_cast<simple_allocator_t *>(state->simple_allocator_buf);
+    return simple_allocator->Overflowed() ? ArenaOverflowError
+                                          : AllocateTensorsError;
   }
 
   return Ok;
 }
 
+ModelRunnerStatus model_runner_arena_plan(model_runner_t *ctx,
+                                          const uint8_t *model_content,
+                                          model_runner_arena_usage_t *usage)
+{
+  xassert(usage);
+
+  ModelRunnerStatus status = model_runner_allocate(ctx, model_content);
+  if (status == Ok)
+  {
+    model_runner_arena_usage_get(ctx, usage);
+  }
+
+  return status;
+}
+
+void model_runner_arena_usage_get(model_runner_t *ctx,
+                                  model_runner_arena_usage_t *usage)
+{
+  xassert(usage);
+  model_runner_state_t *state = model_runner_state_get(ctx);
+  simple_allocator_t *simple_allocator =
+      reinterpret_cast<simple_allocator_t *>(state->simple_allocator_buf);
+
+  usage->persistent_bytes = simple_allocator->GetTailUsedBytes();
+  usage->scratch_bytes = simple_allocator->GetHeadUsedBytes();
+  usage->total_bytes = usage->persistent_bytes + usage->scratch_bytes;
+}
+
 int8_t *model_runner_input_buffer_get(model_runner_t *ctx)
 {
-  interpreter_t *interpreter = static_cast<interpreter_t *>(ctx->hInterpreter);
+  interpreter_t *interpreter = model_runner_interpreter_get(ctx);
   return interpreter->input(0)->data.int8;
 }
 
 size_t model_runner_input_size_get(model_runner_t *ctx)
 {
-  interpreter_t *interpreter = static_cast<interpreter_t *>(ctx->hInterpreter);
+  interpreter_t *interpreter = model_runner_interpreter_get(ctx);
   return interpreter->input(0)->bytes;
 }
 
@@ -157,17 +366,26 @@ void model_runner_input_quant_get(model_runner_t *ctx, float *scale,
   xassert(scale);
   xassert(zero_point);
 
-  interpreter_t *interpreter = static_cast<interpreter_t *>(ctx->hInterpreter);
+  interpreter_t *interpreter = model_runner_interpreter_get(ctx);
   *scale = interpreter->input(0)->params.scale;
   *zero_point = interpreter->input(0)->params.zero_point;
 }
 
 ModelRunnerStatus model_runner_invoke(model_runner_t *ctx)
 {
-  interpreter_t *interpreter = static_cast<interpreter_t *>(ctx->hInterpreter);
+  interpreter_t *interpreter = model_runner_interpreter_get(ctx);
 
-  // Rset the profiler
-  ctx->profiler_reset_fun();
+  // Reset the profiler
+  tflite_profiler_t *profiler = model_runner_profiler_get(ctx);
+  if (profiler)
+    profiler->ClearEvents();
+
+#if RTOS_FREERTOS
+  // Start fetching the first weights
+  model_runner_state_t *state = model_runner_state_get(ctx);
+  if (state->prefetch_loader)
+    state->prefetch_loader->Reset();
+#endif
 
   // Run inference, and report any error
   TfLiteStatus invoke_status = interpreter->Invoke();
@@ -182,13 +400,13 @@ ModelRunnerStatus model_runner_invoke(model_runner_t *ctx)
 
 int8_t *model_runner_output_buffer_get(model_runner_t *ctx)
 {
-  interpreter_t *interpreter = static_cast<interpreter_t *>(ctx->hInterpreter);
+  interpreter_t *interpreter = model_runner_interpreter_get(ctx);
   return interpreter->output(0)->data.int8;
 }
 
 size_t model_runner_output_size_get(model_runner_t *ctx)
 {
-  interpreter_t *interpreter = static_cast<interpreter_t *>(ctx->hInterpreter);
+  interpreter_t *interpreter = model_runner_interpreter_get(ctx);
   return interpreter->output(0)->bytes;
 }
 
@@ -198,67 +416,192 @@ void model_runner_output_quant_get(model_runner_t *ctx, float *scale,
   xassert(scale);
   xassert(zero_point);
 
-  interpreter_t *interpreter = static_cast<interpreter_t *>(ctx->hInterpreter);
+  interpreter_t *interpreter = model_runner_interpreter_get(ctx);
   *scale = interpreter->output(0)->params.scale;
   *zero_point = interpreter->output(0)->params.zero_point;
 }
 
-#ifndef NDEBUG
+#if MODEL_RUNNER_PROFILER_ENABLED
 
 void model_runner_profiler_durations_get(model_runner_t *ctx, uint32_t *count,
                                          const uint32_t **durations)
 {
+  tflite_profiler_t *profiler = model_runner_profiler_get(ctx);
+  xassert(profiler);
   xassert(count);
   xassert(durations);
 
-  ctx->profiler_durations_get_fun(count, durations);
+  *count = profiler->GetNumEvents();
+  *durations = profiler->GetEventDurations();
+}
+
+void model_runner_profiler_stats_reset(model_runner_t *ctx)
+{
+  tflite_profiler_t *profiler = model_runner_profiler_get(ctx);
+  xassert(profiler);
+
+  profiler->ResetStats();
+}
+
+static void model_runner_profiler_record_header_get(
+    model_runner_t *ctx, model_runner_profiler_record_header_t *header)
+{
+  tflite_profiler_t *profiler = model_runner_profiler_get(ctx);
+  model_runner_arena_usage_t arena_usage;
+
+  model_runner_arena_usage_get(ctx, &arena_usage);
+
+  header->magic = MODEL_RUNNER_PROFILER_RECORD_MAGIC;
+  header->version = MODEL_RUNNER_PROFILER_RECORD_VERSION;
+  header->event_count = profiler->GetNumEvents();
+  header->reference_mhz = PLATFORM_REFERENCE_MHZ;
+  header->arena_persistent_bytes = arena_usage.persistent_bytes;
+  header->arena_scratch_bytes = arena_usage.scratch_bytes;
+}
+
+void model_runner_profiler_record_event_get(
+    model_runner_t *ctx, size_t index,
+    model_runner_profiler_record_event_t *record)
+{
+  tflite_profiler_t *profiler = model_runner_profiler_get(ctx);
+  xassert(profiler);
+  xassert(record);
+  xassert(index < profiler->GetNumEvents());
+
+  const tflite_profiler_t::Event *events = profiler->GetEvents();
+  const tflite_profiler_t::Event *event = &events[index];
+
+  std::memset(record->tag, 0, sizeof(record->tag));
+  if (event->tag)
+    std::strncpy(record->tag, event->tag, sizeof(record->tag));
+  // timestamps are relative to the start of the inference
+  record->start_ticks = event->start_time - events[0].start_time;
+  record->end_ticks = event->end_time - events[0].start_time;
+  record->sample_count = event->sample_count;
+  record->min_ticks = event->min_ticks;
+  record->mean_ticks = event->sample_count
+                           ? event->total_ticks / event->sample_count
+                           : 0;
+  record->max_ticks = event->max_ticks;
+  record->load_bytes = event->load_bytes;
+  record->fetch_ticks = event->fetch_ticks;
+  record->stall_ticks = event->stall_ticks;
+  record->job_count = event->job_count;
+  record->busy_ticks = event->busy_ticks;
+  record->worker_ticks = event->worker_ticks;
+}
+
+size_t model_runner_profiler_record_size_get(model_runner_t *ctx)
+{
+  tflite_profiler_t *profiler = model_runner_profiler_get(ctx);
+  xassert(profiler);
+
+  return sizeof(model_runner_profiler_record_header_t) +
+         profiler->GetNumEvents() *
+             sizeof(model_runner_profiler_record_event_t);
+}
+
+size_t model_runner_profiler_record_read(model_runner_t *ctx, size_t offset,
+                                         uint8_t *buffer, size_t size)
+{
+  xassert(buffer);
+  size_t record_size = model_runner_profiler_record_size_get(ctx);
+  size_t copied = 0;
+
+  // The record is built a header or event at a time so that it can be read
+  // in small pieces, eg a device_control payload at a time.
+  while (copied < size && offset < record_size)
+  {
+    union {
+      model_runner_profiler_record_header_t header;
+      model_runner_profiler_record_event_t event;
+    } part;
+    size_t part_offset;
+    size_t part_size;
+
+    if (offset < sizeof(part.header))
+    {
+      model_runner_profiler_record_header_get(ctx, &part.header);
+      part_offset = 0;
+      part_size = sizeof(part.header);
+    }
+    else
+    {
+      size_t index = (offset - sizeof(part.header)) / sizeof(part.event);
+      model_runner_profiler_record_event_get(ctx, index, &part.event);
+      part_offset = sizeof(part.header) + index * sizeof(part.event);
+      part_size = sizeof(part.event);
+    }
+
+    size_t n = part_offset + part_size - offset;
+    if (n > size - copied)
+      n = size - copied;
+    std::memcpy(buffer + copied,
+                reinterpret_cast<uint8_t *>(&part) + (offset - part_offset), n);
+    copied += n;
+    offset += n;
+  }
+
+  return copied;
+}
+
+void model_runner_profiler_xscope_send(model_runner_t *ctx, unsigned probe)
+{
+  uint8_t chunk[MODEL_RUNNER_PROFILER_XSCOPE_CHUNK_SIZE];
+  size_t offset = 0;
+  size_t n;
+
+  while ((n = model_runner_profiler_record_read(ctx, offset, chunk,
+                                                sizeof(chunk))) > 0)
+  {
+    xscope_bytes(probe, n, chunk);
+    offset += n;
+  }
 }
 
 void model_runner_profiler_summary_print(model_runner_t *ctx)
 {
+  tflite_profiler_t *profiler = model_runner_profiler_get(ctx);
+  model_runner_profiler_record_event_t record;
+  model_runner_arena_usage_t arena_usage;
   uint32_t count = 0;
   uint32_t total = 0;
   uint32_t time_us = 0;
-  const uint32_t *durations = nullptr;
-  void *v_resolver = nullptr;
-  const char *op_name;
-
-  ctx->profiler_durations_get_fun(&count, &durations);
-  ctx->resolver_get_fun(&v_resolver);
 
-  size_t subgraph_idx = 0;
-  const tflite::SubGraph *subgraph = model->subgraphs()->Get(subgraph_idx);
-  auto *opcodes = model->operator_codes();
-  uint32_t operators_size = NumSubgraphOperators(subgraph);
-  const tflite::OpResolver *c_resolver = static_cast<const tflite::OpResolver *>(v_resolver);
+  xassert(profiler);
+  count = profiler->GetNumEvents();
 
-  for (size_t i = 0; i < operators_size; ++i)
+  for (size_t i = 0; i < count; ++i)
   {
-    if (i < count)
+    model_runner_profiler_record_event_get(ctx, i, &record);
+
+    time_us = profiler->GetEventDurations()[i] / PLATFORM_REFERENCE_MHZ;
+    total += time_us;
+    printf("Operator %d, %s took %" PRIu32 " microseconds (min %" PRIu32
+           ", mean %" PRIu32 ", max %" PRIu32 " over %" PRIu32 ")\n",
+           (int)i, profiler->GetEvents()[i].tag, time_us,
+           record.min_ticks / PLATFORM_REFERENCE_MHZ,
+           record.mean_ticks / PLATFORM_REFERENCE_MHZ,
+           record.max_ticks / PLATFORM_REFERENCE_MHZ, record.sample_count);
+    if (record.load_bytes > 0)
     {
-      const auto *op = subgraph->operators()->Get(i);
-      const size_t index = op->opcode_index();
-      const auto *opcode = opcodes->Get(index);
-      const TfLiteRegistration *registration = nullptr;
-
-      GetRegistrationFromOpCode(opcode, *c_resolver, reporter,
-                                &registration);
-
-      if (registration->builtin_code == tflite::BuiltinOperator_CUSTOM)
-      {
-        op_name = registration->custom_name;
-      }
-      else
-      {
-        op_name = tflite::EnumNameBuiltinOperator(
-            tflite::BuiltinOperator(registration->builtin_code));
-      }
-      time_us = durations[i] / PLATFORM_REFERENCE_MHZ;
-      total += time_us;
-      printf("Operator %d, %s took %lu microseconds\n", i, op_name, time_us);
+      printf("  loaded %" PRIu32 " bytes, fetch %" PRIu32
+             " microseconds, stall %" PRIu32 " microseconds\n",
+             record.load_bytes, record.fetch_ticks / PLATFORM_REFERENCE_MHZ,
+             record.stall_ticks / PLATFORM_REFERENCE_MHZ);
+    }
+    if (record.worker_ticks > 0)
+    {
+      printf("  %" PRIu32 " jobs, worker utilisation %" PRIu32 "%%\n",
+             record.job_count,
+             (uint32_t)((100ULL * record.busy_ticks) / record.worker_ticks));
     }
   }
-  printf("TOTAL %lu microseconds\n", total);
+  printf("TOTAL %" PRIu32 " microseconds\n", total);
+
+  model_runner_arena_usage_get(ctx, &arena_usage);
+  printf("ARENA %u persistent bytes, %u scratch bytes\n",
+         arena_usage.persistent_bytes, arena_usage.scratch_bytes);
 }
 
-#endif
+#endif // MODEL_RUNNER_PROFILER_ENABLED
@@ -3,16 +3,21 @@
 
 #include "rtos_dispatcher.h"
 
+#include <xcore/hwtimer.h>
+
+#include "rtos_support.h"
+
 namespace tflite {
 namespace micro {
 namespace xcore {
 
 RTOSDispatcher::RTOSDispatcher(dispatcher_t *dispatcher)
-    : dispatcher_(dispatcher) {
+    : dispatcher_(dispatcher), profiler_(nullptr) {
   group_ = dispatch_group_create(kMaxThreads);
   for (size_t i = 0; i < kMaxThreads; i++) {
     dispatch_group_job_add(group_, dispatch_job_create(nullptr, nullptr));
   }
+  ResetInvokeStats();
 }
 
 RTOSDispatcher::~RTOSDispatcher() {
@@ -23,36 +28,94 @@ RTOSDispatcher::~RTOSDispatcher() {
   dispatch_group_delete(group_);
 }
 
+void RTOSDispatcher::RunArguments(void *p) {
+  Runner *runner = static_cast<Runner *>(p);
+  InvokeState *state = runner->state;
+  uint32_t start = get_reference_time();
+
+  for (;;) {
+    size_t index;
+
+    // claim the next argument, this runs in both thread and ISR workers so
+    // mask interrupts and take the ISR lock rather than a critical section
+    uint32_t mask = rtos_interrupt_mask_all();
+    rtos_lock_acquire(0);
+    index = state->next++;
+    rtos_lock_release(0);
+    rtos_interrupt_mask_set(mask);
+
+    if (index >= state->size)
+      break;
+
+    state->function(state->arguments[index]);
+  }
+
+  runner->busy_ticks = get_reference_time() - start;
+}
+
 TfLiteStatus RTOSDispatcher::Invoke(void **arguments, size_t size) const {
-  size_t num_threads_added = 0;
   dispatch_job_t **jobs = dispatch_group_jobs_get(group_);
+  size_t num_runners = num_threads_ < size ? num_threads_ : size;
+  uint32_t start;
 
-  // reset the group for first iteration
-  dispatch_group_init(group_);
-  // printf("Invoke  size=%d      %u\n", size, (size_t)function_);
+  if (num_runners == 0)
+    return kTfLiteOk;
+  if (num_runners > kMaxThreads)
+    num_runners = kMaxThreads;
 
-  for (int i = 0; i < size; i++) {
-    dispatch_job_init(jobs[i], function_, arguments[i]);
-    dispatch_group_job_add(group_, jobs[i]);
+  state_.function = function_;
+  state_.arguments = arguments;
+  state_.size = size;
+  state_.next = 0;
 
-    num_threads_added++;
-    if (num_threads_added == num_threads_) {
-      dispatcher_group_add(dispatcher_, group_);
-      dispatcher_group_wait(dispatcher_, group_);
-      // reset the group for next iteration
-      dispatch_group_init(group_);
-      num_threads_added = 0;
-    }
+  // one job per worker, each one keeps claiming arguments until there are
+  // none left
+  dispatch_group_init(group_);
+  for (size_t i = 0; i < num_runners; i++) {
+    runners_[i].state = &state_;
+    runners_[i].busy_ticks = 0;
+    dispatch_job_init(jobs[i], RunArguments, &runners_[i]);
+    dispatch_group_job_add(group_, jobs[i]);
   }
 
-  if (num_threads_added > 0) {
-    dispatcher_group_add(dispatcher_, group_);
-    dispatcher_group_wait(dispatcher_, group_);
+  start = get_reference_time();
+  dispatcher_group_add(dispatcher_, group_);
+  dispatcher_group_wait(dispatcher_, group_);
+  uint32_t elapsed = get_reference_time() - start;
+
+  uint32_t busy_ticks = 0;
+  for (size_t i = 0; i < num_runners; i++) {
+    busy_ticks += runners_[i].busy_ticks;
   }
 
+  stats_.invoke_count++;
+  stats_.job_count += size;
+  stats_.elapsed_ticks += elapsed;
+  stats_.busy_ticks += busy_ticks;
+  stats_.worker_ticks += (uint64_t)elapsed * num_threads_;
+
+  if (profiler_)
+    profiler_->RecordDispatch(size, busy_ticks, elapsed * num_threads_);
+
   return kTfLiteOk;
 }
 
+void RTOSDispatcher::GetInvokeStats(InvokeStats *stats) const {
+  *stats = stats_;
+}
+
+void RTOSDispatcher::SetProfiler(::xcore::ModelRunnerProfilerBase *profiler) {
+  profiler_ = profiler;
+}
+
+void RTOSDispatcher::ResetInvokeStats() {
+  stats_.invoke_count = 0;
+  stats_.job_count = 0;
+  stats_.elapsed_ticks = 0;
+  stats_.busy_ticks = 0;
+  stats_.worker_ticks = 0;
+}
+
 } // namespace xcore
 } // namespace micro
-} // namespace tflite
\ No newline at end of file
+} // namespace tflite
@@ -199,7 +199,7 @@ def generate_project(inputs, runner_basename, output, *, do_analyze=False):
         operator_registrations["unknown_operators"].update(unknown_operators)
 
     generate_model_runner(
-        model_layer_count, operator_registrations, output_path, runner_basename
+        layer_count, operator_registrations, output_path, runner_basename
     )
 
 
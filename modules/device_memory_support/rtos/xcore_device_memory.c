@@ -46,6 +46,18 @@ bool rtos_swmem_read_request_isr(unsigned offset, uint32_t *buf)
     return ret;
 }
 
+bool rtos_swmem_prefetch_request_isr(unsigned offset, uint32_t *buf, size_t lines)
+{
+    /*
+     * Read all the lines in one flash transaction. If the flash is busy then
+     * the lines are simply not prefetched.
+     */
+    return qspi_flash_ctx != NULL &&
+           rtos_qspi_flash_read_ll(
+                   qspi_flash_ctx, (uint8_t *)buf, (unsigned)offset,
+                   WORDS_TO_BYTES(SWMEM_FILL_SIZE_WORDS * lines)) == 0;
+}
+
 void rtos_swmem_read_request(unsigned offset, uint32_t *buf)
 {
     if (qspi_flash_ctx != NULL) {
@@ -19,6 +19,17 @@
 #define I2S_MAX_DATALINES 8
 #define I2S_CHANS_PER_FRAME 2
 
+/**
+ * The most samples that may be passed to a send or receive callback at once.
+ * This is the number of data lines, times the number of slots in each frame,
+ * times the number of frames in each block. The I2S task keeps two buffers of
+ * this size on its stack, so it should be raised only by applications that use
+ * TDM or block callbacks.
+ */
+#ifndef I2S_MAX_BLOCK_SAMPLES
+#define I2S_MAX_BLOCK_SAMPLES (I2S_MAX_DATALINES * I2S_CHANS_PER_FRAME)
+#endif
+
 /**
  * I2S mode.
  *
@@ -45,11 +56,19 @@ typedef enum i2s_slave_bclk_polarity {
  * I2S configuration structure.
  *
  * This structure describes the configuration of an I2S bus.
+ *
+ * When \c tdm_slots is non-zero the bus carries TDM rather than I2S. Each frame
+ * then holds \c tdm_slots 32-bit slots on every data line, and the word clock
+ * line carries a frame sync pulse, one bit clock wide, at the start of each
+ * frame in place of the LR clock. The mode sets where the pulse falls relative
+ * to the first bit of slot 0 in the same way that it sets the LR clock edge.
  */
 typedef struct i2s_config {
   unsigned mclk_bclk_ratio;                       /**< The ratio between the master clock and bit clock signals. */
   i2s_mode_t mode;                                /**< The mode of the LR clock. */
   i2s_slave_bclk_polarity_t slave_bclk_polarity;  /**< Slave bit clock polarity. */
+  unsigned tdm_slots;                             /**< 0 for I2S, otherwise the number of TDM slots in each frame. This must be at least 2. */
+  unsigned frames_per_block;                      /**< The number of frames passed to each send and receive callback. 0 is treated as 1. */
 } i2s_config_t;
 
 /**
@@ -76,15 +95,17 @@ typedef enum i2s_restart {
  * \param i2s_config  This structure is provided if the connected
  *                    component drives an I2S bus. The members
  *                    of the structure should be set to the
- *                    required configuration.
+ *                    required configuration. Any members that
+ *                    are not set are zero.
  */
 typedef void (*i2s_init_t)(void *app_data, i2s_config_t *i2s_config);
 
 /**
  * I2S restart check callback.
  *
- * This callback is called once per frame. The application must return the
- * required restart behavior.
+ * This callback is called once per block of frames, which is once per frame
+ * unless \c frames_per_block is set in the configuration. The application
+ * must return the required restart behavior.
  *
  * \param app_data  Points to application specific data supplied
  *                  by the application. May be used for context
@@ -100,13 +121,25 @@ typedef i2s_restart_t (*i2s_restart_check_t)(void *app_data);
  * Receive an incoming frame of samples.
  *
  * This callback will be called when a new frame of samples is read in by the I2S
- * task.
+ * task, or when a new block of frames has been read in if \c frames_per_block
+ * is set in the configuration.
+ *
+ * Within each frame the samples from each data line are together, in slot
+ * order, with the left channel in slot 0 and the right in slot 1 for I2S. A
+ * block holds its frames one after another.
+ *
+ * In block mode the callback is called once for every \c frames_per_block
+ * frames, but it has no more time to return than a callback made for every
+ * frame. This lowers the fixed cost of each frame, such as the call itself and
+ * any signalling that the callback does, rather than adding time for
+ * processing. The same applies to the send callback. The time a callback has is
+ * about one slot, so with TDM it is a smaller part of each frame.
  *
  * \param app_data  Points to application specific data supplied
  *                  by the application. May be used for context
  *                  data specific to each I2S task instance.
  *
- * \param num_in    The number of input channels contained within the array.
+ * \param num_in    The number of samples contained within the array.
  *
  * \param samples   The samples data array as signed 32-bit values.  The component
  *                  may not have 32-bits of accuracy (for example, many
@@ -118,13 +151,15 @@ typedef void (*i2s_receive_t)(void *app_data, size_t num_in, const int32_t *samp
 /**
  * Request an outgoing frame of samples.
  *
- * This callback will be called when the I2S task needs a new frame of samples.
+ * This callback will be called when the I2S task needs a new frame of samples,
+ * or a new block of frames if \c frames_per_block is set in the configuration.
+ * The samples are laid out as they are for i2s_receive_t.
  *
  * \param app_data  Points to application specific data supplied
  *                  by the application. May be used for context
  *                  data specific to each I2S task instance.
  *
- * \param num_out   The number of output channels contained within the array.
+ * \param num_out   The number of samples contained within the array.
  *
  * \param samples   The samples data array as signed 32-bit values.  The component
  *                  may not have 32-bits of accuracy (for example, many
@@ -73,6 +73,40 @@ static void i2s_deinit_ports(
     }
 }
 
+/*
+ * Moves on to the next word of a block. index is the position in the
+ * sample buffer of the first data line's sample for that word.
+ */
+static inline void i2s_word_next(
+        size_t *slot,
+        size_t *frame,
+        size_t *index,
+        const size_t slots,
+        const size_t frames,
+        const size_t frame_samples)
+{
+    if (++*slot == slots) {
+        *slot = 0;
+        if (++*frame == frames) {
+            *frame = 0;
+        }
+    }
+    *index = *frame * frame_samples + *slot;
+}
+
+static inline uint32_t i2s_lrclk_word(
+        const unsigned tdm,
+        const size_t slots,
+        const size_t slot)
+{
+    if (tdm) {
+        /* A frame sync pulse one bit clock wide */
+        return slot == 0 ? 1 : 0;
+    } else {
+        return slot < (slots >> 1) ? 0 : ~0;
+    }
+}
+
 static i2s_restart_t i2s_ratio_n(
         const i2s_callback_group_t *const i2s_cbg,
         const port_t p_dout[],
@@ -82,20 +116,32 @@ static i2s_restart_t i2s_ratio_n(
         const port_t p_bclk,
         const xclock_t bclk,
         const port_t p_lrclk,
-        const i2s_mode_t mode)
+        const i2s_config_t *const config)
 {
     size_t i;
-    size_t idx;
     int offset;
+    i2s_restart_t restart = I2S_NO_RESTART;
+
+    const unsigned tdm = config->tdm_slots != 0;
+    const size_t slots = tdm ? config->tdm_slots : I2S_CHANS_PER_FRAME;
+    const size_t frames = config->frames_per_block > 0 ? config->frames_per_block : 1;
+
+    /* slots samples per data line in each frame */
+    int32_t in_samps[I2S_MAX_BLOCK_SAMPLES];
+    int32_t out_samps[I2S_MAX_BLOCK_SAMPLES];
 
-    /* two samples per data line, left and right */
-    int32_t in_samps[I2S_CHANS_PER_FRAME * I2S_MAX_DATALINES];
-    int32_t out_samps[I2S_CHANS_PER_FRAME * I2S_MAX_DATALINES];
+    /*
+     * The position within the block of the next word to output and to
+     * input. Outputs run two words ahead of inputs.
+     */
+    size_t out_slot = 1, out_frame = 0, out_idx;
+    size_t in_slot = 0, in_frame = 0, in_idx = 0;
 
     xassert(num_in <= I2S_MAX_DATALINES);
     xassert(num_out <= I2S_MAX_DATALINES);
-
-    unsigned lr_mask = 0;
+    xassert(slots >= 2);
+    xassert(num_in * slots * frames <= I2S_MAX_BLOCK_SAMPLES);
+    xassert(num_out * slots * frames <= I2S_MAX_BLOCK_SAMPLES);
 
     for (i = 0; i < num_out; i++) {
         port_clear_buffer(p_dout[i]);
@@ -106,99 +152,92 @@ static i2s_restart_t i2s_ratio_n(
     port_clear_buffer(p_lrclk);
 
     if (num_out > 0) {
-        i2s_cbg->send(i2s_cbg->app_data, num_out << 1, out_samps);
+        i2s_cbg->send(i2s_cbg->app_data, num_out * slots * frames, out_samps);
     }
 
-    //Start outputting evens (0,2,4..) data at correct point relative to the clock
-    if (mode == I2S_MODE_I2S) {
+    //Start outputting slot 0 data at correct point relative to the clock
+    if (config->mode == I2S_MODE_I2S) {
         offset = 1;
     } else {
         offset = 0;
     }
 
 //#pragma unroll(I2S_MAX_DATALINES)
-    for (i = 0, idx = 0; i < num_out; i++, idx += I2S_CHANS_PER_FRAME) {
+    for (i = 0; i < num_out; i++) {
         port_set_trigger_time(p_dout[i], 1 + offset);
-        port_out(p_dout[i], bitrev(out_samps[idx]));
+        port_out(p_dout[i], bitrev(out_samps[i * slots]));
     }
 
     port_set_trigger_time(p_lrclk, 1);
-    port_out(p_lrclk, lr_mask);
+    port_out(p_lrclk, i2s_lrclk_word(tdm, slots, 0));
 
     clock_start(bclk);
 
-    //And pre-load the odds (1,3,5..)
+    //And pre-load slot 1
 //#pragma unroll(I2S_MAX_DATALINES)
-    for (i = 0, idx = 1; i < num_out; i++, idx += I2S_CHANS_PER_FRAME) {
-        port_out(p_dout[i], bitrev(out_samps[idx]));
+    for (i = 0; i < num_out; i++) {
+        port_out(p_dout[i], bitrev(out_samps[i * slots + 1]));
     }
 
-    lr_mask = ~lr_mask;
-    port_out(p_lrclk, lr_mask);
+    port_out(p_lrclk, i2s_lrclk_word(tdm, slots, 1));
 
     for (i = 0; i < num_in; i++) {
         port_set_trigger_time(p_din[i], 32 + offset);
     }
 
-    for (;;) {
-        // Check for restart
-        i2s_restart_t restart = i2s_cbg->restart_check(i2s_cbg->app_data);
+    i2s_word_next(&out_slot, &out_frame, &out_idx, slots, frames, num_out * slots);
 
-        if (restart == I2S_NO_RESTART) {
-            if (num_out > 0) {
-                i2s_cbg->send(i2s_cbg->app_data, num_out << 1, out_samps);
-            }
+    for (;;) {
+        if (restart == I2S_NO_RESTART && out_slot == 0 && out_frame == 0) {
+            // Check for restart
+            restart = i2s_cbg->restart_check(i2s_cbg->app_data);
 
-            //Output i2s evens (0,2,4..)
-//#pragma unroll(I2S_MAX_DATALINES)
-            for (i = 0, idx = 0; i < num_out; i++, idx += I2S_CHANS_PER_FRAME) {
-                port_out(p_dout[i], bitrev(out_samps[idx]));
+            if (restart == I2S_NO_RESTART && num_out > 0) {
+                i2s_cbg->send(i2s_cbg->app_data, num_out * slots * frames, out_samps);
             }
         }
 
-        //Input i2s evens (0,2,4..)
-//#pragma unroll(I2S_MAX_DATALINES)
-        for (i = 0, idx = 0; i < num_in; i++, idx += I2S_CHANS_PER_FRAME) {
-            int32_t data;
-            data = port_in(p_din[i]);
-            in_samps[idx] = bitrev(data);
-        }
-
-        lr_mask = ~lr_mask;
-        port_out(p_lrclk, lr_mask);
-
         if (restart == I2S_NO_RESTART) {
-            //Output i2s odds (1,3,5..)
+            //Output the next slot, two ahead of the input
 //#pragma unroll(I2S_MAX_DATALINES)
-            for (i = 0, idx = 1; i < num_out; i++, idx += I2S_CHANS_PER_FRAME) {
-                port_out(p_dout[i], bitrev(out_samps[idx]));
+            for (i = 0; i < num_out; i++) {
+                port_out(p_dout[i], bitrev(out_samps[out_idx + i * slots]));
             }
 
-            lr_mask = ~lr_mask;
-            port_out(p_lrclk, lr_mask);
+            port_out(p_lrclk, i2s_lrclk_word(tdm, slots, out_slot));
+
+            i2s_word_next(&out_slot, &out_frame, &out_idx, slots, frames, num_out * slots);
         }
 
-        //Input i2s odds (1,3,5..)
+        //Input the next slot
 //#pragma unroll(I2S_MAX_DATALINES)
-        for (i = 0, idx = 1; i < num_in; i++, idx += I2S_CHANS_PER_FRAME) {
+        for (i = 0; i < num_in; i++) {
             int32_t data;
             data = port_in(p_din[i]);
-            in_samps[idx] = bitrev(data);
+            in_samps[in_idx + i * slots] = bitrev(data);
         }
 
-        if (num_in > 0) {
-            i2s_cbg->receive(i2s_cbg->app_data, num_in << 1, in_samps);
-        }
+        if (in_slot == slots - 1 && in_frame == frames - 1) {
+            if (num_in > 0) {
+                i2s_cbg->receive(i2s_cbg->app_data, num_in * slots * frames, in_samps);
+            }
 
-        if (restart != I2S_NO_RESTART) {
-            if (num_in == 0) {
-                // Prevent the clock from being stopped before the last word
-                // has been sent if there are no RX ports.
-                asm volatile("syncr res[%0]" : : "r" (p_dout[0]));
+            /*
+             * The outputs stop at the end of the block that the restart was
+             * found at the start of, which is also the end of this block.
+             */
+            if (restart != I2S_NO_RESTART) {
+                if (num_in == 0) {
+                    // Prevent the clock from being stopped before the last word
+                    // has been sent if there are no RX ports.
+                    asm volatile("syncr res[%0]" : : "r" (p_dout[0]));
+                }
+                clock_stop(bclk);
+                return restart;
             }
-            clock_stop(bclk);
-            return restart;
         }
+
+        i2s_word_next(&in_slot, &in_frame, &in_idx, slots, frames, num_in * slots);
     }
     return I2S_RESTART;
 }
@@ -215,7 +254,7 @@ void i2s_master(
         const xclock_t bclk)
 {
     for (;;) {
-        i2s_config_t config;
+        i2s_config_t config = {0};
         i2s_cbg->init(i2s_cbg->app_data, &config);
 
         if (!p_dout && !p_din) {
@@ -230,7 +269,7 @@ void i2s_master(
         i2s_restart_t restart = i2s_ratio_n(i2s_cbg, p_dout, num_out, p_din,
                                              num_in,
                                              p_bclk, bclk, p_lrclk,
-                                             config.mode);
+                                             &config);
 
         if (restart == I2S_SHUTDOWN) {
             i2s_deinit_ports(p_dout, num_out, p_din, num_in, p_bclk, p_lrclk);
@@ -251,7 +290,7 @@ void i2s_master_external_clock(
         const xclock_t bclk)
 {
     while (1) {
-        i2s_config_t config;
+        i2s_config_t config = {0};
         i2s_cbg->init(i2s_cbg->app_data, &config);
 
         if (!p_dout && !p_din) {
@@ -264,7 +303,7 @@ void i2s_master_external_clock(
         i2s_restart_t restart = i2s_ratio_n(i2s_cbg, p_dout, num_out, p_din,
                                             num_in,
                                             p_bclk, bclk, p_lrclk,
-                                            config.mode);
+                                            &config);
 
         if (restart == I2S_SHUTDOWN) {
             i2s_deinit_ports(p_dout, num_out, p_din, num_in, p_bclk, p_lrclk);
@@ -39,6 +39,27 @@ static void i2s_slave_init_ports(
     clock_start(bclk);
 }
 
+/*
+ * Moves on to the next word of a block. index is the position in the
+ * sample buffer of the first data line's sample for that word.
+ */
+static inline void i2s_word_next(
+        size_t *slot,
+        size_t *frame,
+        size_t *index,
+        const size_t slots,
+        const size_t frames,
+        const size_t frame_samples)
+{
+    if (++*slot == slots) {
+        *slot = 0;
+        if (++*frame == frames) {
+            *frame = 0;
+        }
+    }
+    *index = *frame * frame_samples + *slot;
+}
+
 void i2s_slave(
         const i2s_callback_group_t *const i2s_cbg,
         /*out buffered*/port_t /*:32*/p_dout[],
@@ -52,11 +73,10 @@ void i2s_slave(
 
     port_timestamp_t port_time;
     size_t i;
-    size_t idx;
 
-    /* two samples per data line, left and right */
-    int32_t in_samps[I2S_CHANS_PER_FRAME * I2S_MAX_DATALINES];
-    int32_t out_samps[I2S_CHANS_PER_FRAME * I2S_MAX_DATALINES];
+    /* slots samples per data line in each frame */
+    int32_t in_samps[I2S_MAX_BLOCK_SAMPLES];
+    int32_t out_samps[I2S_MAX_BLOCK_SAMPLES];
 
     xassert(num_in <= I2S_MAX_DATALINES);
     xassert(num_out <= I2S_MAX_DATALINES);
@@ -64,13 +84,28 @@ void i2s_slave(
     for (;;) {
         i2s_slave_init_ports(p_dout, num_out, p_din, num_in, p_bclk, p_lrclk, bclk);
 
-        i2s_config_t config;
+        i2s_config_t config = {0};
         i2s_restart_t restart = I2S_NO_RESTART;
         i2s_cbg->init(i2s_cbg->app_data, &config);
 
+        const unsigned tdm = config.tdm_slots != 0;
+        const size_t slots = tdm ? config.tdm_slots : I2S_CHANS_PER_FRAME;
+        const size_t frames = config.frames_per_block > 0 ? config.frames_per_block : 1;
+
+        xassert(slots >= 2);
+        xassert(num_in * slots * frames <= I2S_MAX_BLOCK_SAMPLES);
+        xassert(num_out * slots * frames <= I2S_MAX_BLOCK_SAMPLES);
+
+        /*
+         * The position within the block of the next word to output and to
+         * input. Outputs run two words ahead of inputs.
+         */
+        size_t out_slot = 1, out_frame = 0, out_idx;
+        size_t in_slot = 0, in_frame = 0, in_idx = 0;
+
         //Get initial send data if output enabled
         if (num_out > 0) {
-            i2s_cbg->send(i2s_cbg->app_data, num_out << 1, out_samps);
+            i2s_cbg->send(i2s_cbg->app_data, num_out * slots * frames, out_samps);
         }
 
         unsigned mode = config.mode;
@@ -86,6 +121,7 @@ void i2s_slave(
 
         unsigned syncerror = 0;
         unsigned lrval;
+        unsigned lrval_prev = 0;
 
         for (i = 0; i < num_out; i++) {
             port_clear_buffer(p_dout[i]);
@@ -101,19 +137,26 @@ void i2s_slave(
         }
 
         // Wait for LRCLK edge (in I2S LRCLK = 0 is left, TDM rising edge is start of frame)
-        port_set_trigger_in_equal(p_lrclk, 1);
-        (void) port_in(p_lrclk);
-        port_set_trigger_in_equal(p_lrclk, 0);
-        (void) port_in(p_lrclk);
+        if (tdm) {
+            port_set_trigger_in_equal(p_lrclk, 0);
+            (void) port_in(p_lrclk);
+            port_set_trigger_in_equal(p_lrclk, 1);
+            (void) port_in(p_lrclk);
+        } else {
+            port_set_trigger_in_equal(p_lrclk, 1);
+            (void) port_in(p_lrclk);
+            port_set_trigger_in_equal(p_lrclk, 0);
+            (void) port_in(p_lrclk);
+        }
         port_time = port_get_trigger_time(p_lrclk);
 
-        unsigned initial_out_port_time = port_time + offset + (I2S_CHANS_PER_FRAME * 32);
-        unsigned initial_in_port_time  = port_time + offset + ((I2S_CHANS_PER_FRAME * 32) + 32) - 1;
+        unsigned initial_out_port_time = port_time + offset + (slots * 32);
+        unsigned initial_in_port_time  = port_time + offset + ((slots * 32) + 32) - 1;
 
-        //Start outputting evens (0,2,4..) data at correct point relative to the clock
-        for (i = 0, idx = 0; i < num_out; i++, idx += I2S_CHANS_PER_FRAME) {
+        //Start outputting slot 0 data at correct point relative to the clock
+        for (i = 0; i < num_out; i++) {
             port_set_trigger_time(p_dout[i], initial_out_port_time);
-            port_out(p_dout[i], bitrev(out_samps[idx]));
+            port_out(p_dout[i], bitrev(out_samps[i * slots]));
         }
 
         port_set_trigger_time(p_lrclk, initial_in_port_time);
@@ -121,61 +164,79 @@ void i2s_slave(
             port_set_trigger_time(p_din[i], initial_in_port_time);
         }
 
-        //And pre-load the odds (1,3,5..) to follow immediately afterwards
-        for (i = 0, idx = 1; i < num_out; i++, idx += I2S_CHANS_PER_FRAME) {
-            port_out(p_dout[i], bitrev(out_samps[idx]));
+        //And pre-load slot 1 to follow immediately afterwards
+        for (i = 0; i < num_out; i++) {
+            port_out(p_dout[i], bitrev(out_samps[i * slots + 1]));
         }
 
-        //Main loop
-        while (!syncerror && (restart == I2S_NO_RESTART)) {
-            restart = i2s_cbg->restart_check(i2s_cbg->app_data);
+        i2s_word_next(&out_slot, &out_frame, &out_idx, slots, frames, num_out * slots);
 
-            if (num_out > 0 && (restart == I2S_NO_RESTART)) {
-                i2s_cbg->send(i2s_cbg->app_data, num_out << 1, out_samps);
+        //Main loop, runs until user restart or synch error
+        for (;;) {
+            if (restart == I2S_NO_RESTART && out_slot == 0 && out_frame == 0) {
+                restart = i2s_cbg->restart_check(i2s_cbg->app_data);
+
+                if (num_out > 0 && (restart == I2S_NO_RESTART)) {
+                    i2s_cbg->send(i2s_cbg->app_data, num_out * slots * frames, out_samps);
+                }
+            }
 
-                //Output i2s evens (0,2,4..)
+            if (restart == I2S_NO_RESTART) {
+                //Output the next slot, two ahead of the input
+                if (num_out > 0) {
 //#pragma unroll(I2S_MAX_DATALINES)
-                for (size_t i = 0, idx = 0; i < num_out; i++, idx += I2S_CHANS_PER_FRAME) {
-                    port_out(p_dout[i], bitrev(out_samps[idx]));
+                    for (i = 0; i < num_out; i++) {
+                        port_out(p_dout[i], bitrev(out_samps[out_idx + i * slots]));
+                    }
                 }
+
+                //Keep counting slots without outputs, as they pace the restart check
+                i2s_word_next(&out_slot, &out_frame, &out_idx, slots, frames, num_out * slots);
             }
 
             //Read lrclk value
             lrval = port_in(p_lrclk);
 
-            //Input i2s evens (0,2,4..)
+            //Input the next slot
 //#pragma unroll(I2S_MAX_DATALINES)
-            for (size_t i = 0, idx = 0; i < num_in; i++, idx += I2S_CHANS_PER_FRAME) {
+            for (i = 0; i < num_in; i++) {
                 int32_t data;
                 data = port_in(p_din[i]);
-                in_samps[idx] = bitrev(data);
+                in_samps[in_idx + i * slots] = bitrev(data);
             }
 
-            syncerror += (lrval != expected_low);
+            if (!tdm) {
+                syncerror += (lrval != (in_slot < (slots >> 1) ? expected_low : expected_high));
+            } else if (offset) {
+                // The frame sync rises on the last bit of the previous frame
+                if (in_slot == slots - 1) {
+                    syncerror += ((lrval & 0xC0000000) != 0x80000000);
+                }
+            } else {
+                // The frame sync rises on the first bit of the frame
+                if (in_slot == 0) {
+                    syncerror += (!(lrval & 0x00000001) || (lrval_prev & 0x80000000));
+                }
+            }
+            lrval_prev = lrval;
 
-            //Read lrclk value
-            lrval = port_in(p_lrclk);
+            if (in_slot == slots - 1) {
+                if (in_frame == frames - 1) {
+                    if (num_in > 0)
+                        i2s_cbg->receive(i2s_cbg->app_data, num_in * slots * frames, in_samps);
 
-            //Output i2s odds (1,3,5..)
-//#pragma unroll(I2S_MAX_DATALINES)
-            if (num_out && (restart == I2S_NO_RESTART)) {
-                for (size_t i = 0, idx = 1; i < num_out; i++, idx += I2S_CHANS_PER_FRAME) {
-                    port_out(p_dout[i], bitrev(out_samps[idx]));
+                    if (restart != I2S_NO_RESTART) {
+                        break;
+                    }
                 }
-            }
 
-            //Input i2s odds (1,3,5..)
-//#pragma unroll(I2S_MAX_DATALINES)
-            for (size_t i = 0, idx = 1; i < num_in; i++, idx += I2S_CHANS_PER_FRAME) {
-                int32_t data;
-                data = port_in(p_din[i]);
-                in_samps[idx] = bitrev(data);
+                // Resynchronise at the end of the frame, dropping the rest of the block
+                if (syncerror) {
+                    break;
+                }
             }
 
-            syncerror += (lrval != expected_high);
-
-            if (num_in > 0)
-                i2s_cbg->receive(i2s_cbg->app_data, num_in << 1, in_samps);
-        } //main loop, runs until user restart or synch error
+            i2s_word_next(&in_slot, &in_frame, &in_idx, slots, frames, num_in * slots);
+        }
     }
 }
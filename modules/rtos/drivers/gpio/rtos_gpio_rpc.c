@@ -235,10 +235,8 @@ static void gpio_remote_interrupt_disable(
     rtos_osal_mutex_put(&gpio_ctx->lock);
 }
 
-static int gpio_port_enable_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void gpio_port_enable_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_gpio_t *gpio_ctx;
     rtos_gpio_port_id_t port_id;
 
@@ -248,17 +246,13 @@ static int gpio_port_enable_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
 
     rtos_gpio_port_enable(gpio_ctx, port_id);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             gpio_ctx, port_id);
-
-    return msg_length;
 }
 
-static int gpio_port_in_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void gpio_port_in_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_gpio_t *gpio_ctx;
     rtos_gpio_port_id_t port_id;
     uint32_t ret;
@@ -269,17 +263,13 @@ static int gpio_port_in_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
 
     ret = rtos_gpio_port_in(gpio_ctx, port_id);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             gpio_ctx, port_id, ret);
-
-    return msg_length;
 }
 
-static int gpio_port_out_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void gpio_port_out_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_gpio_t *gpio_ctx;
     rtos_gpio_port_id_t port_id;
     uint32_t value;
@@ -290,17 +280,13 @@ static int gpio_port_out_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
 
     rtos_gpio_port_out(gpio_ctx, port_id, value);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             gpio_ctx, port_id, value);
-
-    return msg_length;
 }
 
-static int gpio_port_write_control_word_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void gpio_port_write_control_word_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_gpio_t *gpio_ctx;
     rtos_gpio_port_id_t port_id;
     uint32_t value;
@@ -311,17 +297,13 @@ static int gpio_port_write_control_word_rpc_host(rpc_msg_t *rpc_msg, uint8_t **r
 
     rtos_gpio_write_control_word(gpio_ctx, port_id, value);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             gpio_ctx, port_id, value);
-
-    return msg_length;
 }
 
-static int gpio_isr_callback_set_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void gpio_isr_callback_set_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_gpio_t *gpio_ctx;
     rtos_gpio_port_id_t port_id;
     chanend_t host_rpc_interrupt_c;
@@ -332,17 +314,13 @@ static int gpio_isr_callback_set_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg
 
     rtos_gpio_isr_callback_set(gpio_ctx, port_id, rtos_gpio_rpc_host_isr, (void *) host_rpc_interrupt_c);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             gpio_ctx, port_id, host_rpc_interrupt_c);
-
-    return msg_length;
 }
 
-static int gpio_interrupt_enable_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void gpio_interrupt_enable_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_gpio_t *gpio_ctx;
     rtos_gpio_port_id_t port_id;
 
@@ -352,17 +330,13 @@ static int gpio_interrupt_enable_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg
 
     rtos_gpio_interrupt_enable(gpio_ctx, port_id);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             gpio_ctx, port_id);
-
-    return msg_length;
 }
 
-static int gpio_interrupt_disable_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void gpio_interrupt_disable_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_gpio_t *gpio_ctx;
     rtos_gpio_port_id_t port_id;
 
@@ -372,57 +346,50 @@ static int gpio_interrupt_disable_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_ms
 
     rtos_gpio_interrupt_disable(gpio_ctx, port_id);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             gpio_ctx, port_id);
-
-    return msg_length;
 }
 
 static void gpio_rpc_thread(rtos_intertile_address_t *client_address)
 {
-    int msg_length;
     uint8_t *req_msg;
-    uint8_t *resp_msg;
     rpc_msg_t rpc_msg;
     rtos_intertile_t *intertile_ctx = client_address->intertile_ctx;
     uint8_t intertile_port = client_address->port;
 
     for (;;) {
         /* receive RPC request message from client */
-        msg_length = rtos_intertile_rx(intertile_ctx, intertile_port, (void **) &req_msg, RTOS_OSAL_WAIT_FOREVER);
+        rtos_intertile_rx(intertile_ctx, intertile_port, (void **) &req_msg, RTOS_OSAL_WAIT_FOREVER);
 
         rpc_request_parse(&rpc_msg, req_msg);
 
         switch (rpc_msg.fcode) {
         case fcode_port_enable:
-            msg_length = gpio_port_enable_rpc_host(&rpc_msg, &resp_msg);
+            gpio_port_enable_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_port_in:
-            msg_length = gpio_port_in_rpc_host(&rpc_msg, &resp_msg);
+            gpio_port_in_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_port_out:
-            msg_length = gpio_port_out_rpc_host(&rpc_msg, &resp_msg);
+            gpio_port_out_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_port_write_control_word:
-            msg_length = gpio_port_write_control_word_rpc_host(&rpc_msg, &resp_msg);
+            gpio_port_write_control_word_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_isr_callback_set:
-            msg_length = gpio_isr_callback_set_rpc_host(&rpc_msg, &resp_msg);
+            gpio_isr_callback_set_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_interrupt_enable:
-            msg_length = gpio_interrupt_enable_rpc_host(&rpc_msg, &resp_msg);
+            gpio_interrupt_enable_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_interrupt_disable:
-            msg_length = gpio_interrupt_disable_rpc_host(&rpc_msg, &resp_msg);
+            gpio_interrupt_disable_rpc_host(&rpc_msg, client_address);
             break;
         }
 
+        /* the RPC response message has been sent to the client */
         rtos_osal_free(req_msg);
-
-        /* send RPC response message to client */
-        rtos_intertile_tx(intertile_ctx, intertile_port, resp_msg, msg_length);
-        rtos_osal_free(resp_msg);
     }
 }
 
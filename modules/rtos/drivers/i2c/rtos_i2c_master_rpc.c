@@ -154,10 +154,8 @@ static i2c_regop_res_t  i2c_master_remote_reg_read(
     return ret;
 }
 
-static int i2c_master_write_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void i2c_master_write_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_i2c_master_t *i2c_master_ctx;
     uint8_t device_addr;
     uint8_t *buf;
@@ -172,17 +170,13 @@ static int i2c_master_write_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
 
     ret = rtos_i2c_master_write(i2c_master_ctx, device_addr, buf, n, &num_bytes_sent, send_stop_bit);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             i2c_master_ctx, device_addr, buf, n, num_bytes_sent, send_stop_bit, ret);
-
-    return msg_length;
 }
 
-static int i2c_master_read_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void i2c_master_read_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_i2c_master_t *i2c_master_ctx;
     uint8_t device_addr;
     uint8_t *buf;
@@ -198,19 +192,15 @@ static int i2c_master_read_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
 
     ret = rtos_i2c_master_read(i2c_master_ctx, device_addr, buf, n, send_stop_bit);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             i2c_master_ctx, device_addr, buf, n, send_stop_bit, ret);
 
     rtos_osal_free(buf);
-
-    return msg_length;
 }
 
-static int i2c_master_stop_bit_send_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void i2c_master_stop_bit_send_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_i2c_master_t *i2c_master_ctx;
 
     rpc_request_unmarshall(
@@ -219,17 +209,13 @@ static int i2c_master_stop_bit_send_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_
 
     rtos_i2c_master_stop_bit_send(i2c_master_ctx);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             i2c_master_ctx);
-
-    return msg_length;
 }
 
-static int i2c_master_reg_write_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void i2c_master_reg_write_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_i2c_master_t *i2c_master_ctx;
     uint8_t device_addr;
     uint8_t reg_addr;
@@ -242,17 +228,13 @@ static int i2c_master_reg_write_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
 
     ret = rtos_i2c_master_reg_write(i2c_master_ctx, device_addr, reg_addr, data);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             i2c_master_ctx, device_addr, reg_addr, data, ret);
-
-    return msg_length;
 }
 
-static int i2c_master_reg_read_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void i2c_master_reg_read_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_i2c_master_t *i2c_master_ctx;
     uint8_t device_addr;
     uint8_t reg_addr;
@@ -265,51 +247,44 @@ static int i2c_master_reg_read_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
 
     ret = rtos_i2c_master_reg_read(i2c_master_ctx, device_addr, reg_addr, &data);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             i2c_master_ctx, device_addr, reg_addr, data, ret);
-
-    return msg_length;
 }
 
 static void i2c_master_rpc_thread(rtos_intertile_address_t *client_address)
 {
-    int msg_length;
     uint8_t *req_msg;
-    uint8_t *resp_msg;
     rpc_msg_t rpc_msg;
     rtos_intertile_t *intertile_ctx = client_address->intertile_ctx;
     uint8_t intertile_port = client_address->port;
 
     for (;;) {
         /* receive RPC request message from client */
-        msg_length = rtos_intertile_rx(intertile_ctx, intertile_port, (void **) &req_msg, RTOS_OSAL_WAIT_FOREVER);
+        rtos_intertile_rx(intertile_ctx, intertile_port, (void **) &req_msg, RTOS_OSAL_WAIT_FOREVER);
 
         rpc_request_parse(&rpc_msg, req_msg);
 
         switch (rpc_msg.fcode) {
         case fcode_write:
-            msg_length = i2c_master_write_rpc_host(&rpc_msg, &resp_msg);
+            i2c_master_write_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_read:
-            msg_length = i2c_master_read_rpc_host(&rpc_msg, &resp_msg);
+            i2c_master_read_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_stop_bit_send:
-            msg_length = i2c_master_stop_bit_send_rpc_host(&rpc_msg, &resp_msg);
+            i2c_master_stop_bit_send_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_reg_write:
-            msg_length = i2c_master_reg_write_rpc_host(&rpc_msg, &resp_msg);
+            i2c_master_reg_write_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_reg_read:
-            msg_length = i2c_master_reg_read_rpc_host(&rpc_msg, &resp_msg);
+            i2c_master_reg_read_rpc_host(&rpc_msg, client_address);
             break;
         }
 
+        /* the RPC response message has been sent to the client */
         rtos_osal_free(req_msg);
-
-        /* send RPC response message to client */
-        rtos_intertile_tx(intertile_ctx, intertile_port, resp_msg, msg_length);
-        rtos_osal_free(resp_msg);
     }
 }
 
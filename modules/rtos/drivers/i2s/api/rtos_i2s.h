@@ -17,6 +17,7 @@
 
 #include "rtos/osal/api/rtos_osal.h"
 #include "rtos/drivers/rpc/api/rtos_driver_rpc.h"
+#include "rtos/drivers/rpc/api/rtos_driver_stream.h"
 
 /**
  * This attribute must be specified on all RTOS I2S send filter callback functions
@@ -35,6 +36,15 @@
  */
 typedef struct rtos_i2s_struct rtos_i2s_t;
 
+/**
+ * Statistics kept by the I2S driver on the tile that owns it.
+ */
+typedef struct {
+    uint32_t rx_overrun_count;  /**< Frames dropped by the driver because the receive buffer was full */
+    uint32_t rx_underrun_count; /**< Receives that timed out before the requested frames arrived */
+    uint32_t tx_underrun_count; /**< Frames for which the send buffer was empty */
+} rtos_i2s_stats_t;
+
 /**
  * Function pointer type for application provided RTOS I2S send filter callback functions.
  *
@@ -97,6 +107,7 @@ typedef size_t (*rtos_i2s_receive_filter_cb_t)(rtos_i2s_t *ctx, void *app_data,
  */
 struct rtos_i2s_struct{
     rtos_driver_rpc_t *rpc_config;
+    rtos_driver_stream_t *stream;
 
     __attribute__((fptrgroup("rtos_i2s_rx_fptr_grp")))
     size_t (*rx)(rtos_i2s_t *, int32_t *, size_t, unsigned);
@@ -106,6 +117,7 @@ struct rtos_i2s_struct{
 
     unsigned mclk_bclk_ratio;
     i2s_mode_t mode;
+    size_t frames_per_block;
     port_t p_dout[I2S_MAX_DATALINES];
     size_t num_out;
     port_t p_din[I2S_MAX_DATALINES];
@@ -129,6 +141,10 @@ struct rtos_i2s_struct{
     rtos_osal_semaphore_t recv_sem;
     int send_blocked;
     int recv_blocked;
+    size_t recv_watermark;
+    volatile uint32_t rx_overrun_count;
+    uint32_t rx_underrun_count;
+    volatile uint32_t tx_underrun_count;
     struct {
         int32_t *buf;
         size_t buf_size;
@@ -187,6 +203,26 @@ inline void rtos_i2s_receive_filter_cb_set(
     ctx->receive_filter_cb = receive_filter_cb;
 }
 
+/**
+ * Sets the number of frames that the I2S I/O thread passes to the driver at
+ * once, which is one by default. Larger blocks mean fewer calls into the driver
+ * and fewer interrupts, at the cost of latency. This must be called before
+ * rtos_i2s_start(), and the sizes of its buffers must be multiples of it.
+ *
+ * The I2S I/O thread keeps a block for each direction on its stack, so
+ * I2S_MAX_BLOCK_SAMPLES must be defined large enough to hold one. Any filter
+ * callbacks are given a whole block at a time.
+ *
+ * \param ctx              A pointer to the I2S driver instance.
+ * \param frames_per_block The number of frames in each block.
+ */
+inline void rtos_i2s_frames_per_block_set(
+        rtos_i2s_t *ctx,
+        size_t frames_per_block)
+{
+    ctx->frames_per_block = frames_per_block;
+}
+
 /**
  * Starts an RTOS I2S driver instance. This must only be called by the tile that
  * owns the driver instance. It must be called after starting the RTOS from an RTOS thread,
@@ -283,6 +319,80 @@ inline size_t rtos_i2s_tx(
 
 /**@}*/
 
+/**
+ * \addtogroup rtos_i2s_driver_local rtos_i2s_driver_local
+ *
+ * Functions for receiving frames directly out of the receive buffer of an
+ * RTOS I2S driver instance, without copying them. These may only be called
+ * on the tile that owns the driver instance, after it has been started, and
+ * by the same single thread that calls rtos_i2s_rx().
+ * @{
+ */
+
+/**
+ * Waits for frames to arrive in the receive buffer and returns a pointer
+ * directly to the oldest of them. Each frame is two samples (left and right
+ * channels) per input port. The frames remain in the buffer, and the same
+ * frames are returned by the next call, until they are released with
+ * rtos_i2s_rx_release().
+ *
+ * This waits until at least the number of frames set by
+ * rtos_i2s_rx_watermark_set() are available. Only the frames that are
+ * contiguous in the buffer are returned, so fewer than this may be returned
+ * when the buffer wraps. The remainder are returned by the next call once
+ * these have been released.
+ *
+ * \param ctx            A pointer to the I2S driver instance to use.
+ * \param i2s_sample_buf Set to point to the first sample of the first
+ *                       available frame.
+ * \param timeout        The amount of time to wait for the frames to arrive.
+ *
+ * \returns              The number of frames at \p i2s_sample_buf, or 0 if
+ *                       the frames did not arrive in time.
+ */
+size_t rtos_i2s_rx_acquire(
+        rtos_i2s_t *ctx,
+        int32_t **i2s_sample_buf,
+        unsigned timeout);
+
+/**
+ * Releases frames returned by rtos_i2s_rx_acquire(), freeing their space in
+ * the receive buffer for the driver to write new frames into.
+ *
+ * \param ctx            A pointer to the I2S driver instance to use.
+ * \param frame_count    The number of frames to release. This may be fewer
+ *                       than were acquired, in which case the rest are
+ *                       returned again by the next acquire.
+ */
+void rtos_i2s_rx_release(
+        rtos_i2s_t *ctx,
+        size_t frame_count);
+
+/**
+ * Sets the number of frames that must be available in the receive buffer
+ * before rtos_i2s_rx_acquire() returns. This defaults to one.
+ *
+ * \param ctx            A pointer to the I2S driver instance to use.
+ * \param frame_count    The watermark in frames. This must be at least one.
+ *                       A watermark larger than the receive buffer is
+ *                       treated as its size.
+ */
+void rtos_i2s_rx_watermark_set(
+        rtos_i2s_t *ctx,
+        size_t frame_count);
+
+/**
+ * Gets the overrun and underrun counts of an I2S driver instance.
+ *
+ * \param ctx            A pointer to the I2S driver instance to use.
+ * \param stats          The statistics are written here.
+ */
+void rtos_i2s_stats_get(
+        rtos_i2s_t *ctx,
+        rtos_i2s_stats_t *stats);
+
+/**@}*/
+
 /**
  * \addtogroup rtos_i2s_master_driver rtos_i2s_master_driver
  *
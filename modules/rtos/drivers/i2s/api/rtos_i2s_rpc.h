@@ -82,6 +82,54 @@ void rtos_i2s_rpc_config(
         unsigned intertile_port,
         unsigned host_task_priority);
 
+/**
+ * Sets up a stream that pushes received frames from an I2S driver instance on
+ * the host tile to a client tile, instead of the client requesting each read
+ * over RPC. Sending frames with rtos_i2s_tx() still uses RPC. This must be
+ * called by both the host tile and the client tile, after rtos_i2s_rpc_config(),
+ * and on the host before rtos_i2s_start().
+ *
+ * This works in the same way as rtos_mic_array_rpc_stream_config(), and has the
+ * same restrictions: only the first client tile may be streamed to, and nothing
+ * else may receive from the I2S instance once it streams.
+ *
+ * \param i2s_ctx        A pointer to the I2S driver instance to stream.
+ * \param stream         A pointer to a stream struct. This must have the same
+ *                       scope as \p i2s_ctx.
+ * \param intertile_port The port number on the intertile channel to use for the
+ *                       stream. This must be different from the RPC port, must
+ *                       not be shared by any other functions, and must be the
+ *                       same on the host and the client.
+ * \param block_frames   The number of frames in each block sent by the host.
+ *                       This must be the same on the host and the client.
+ * \param block_count    The number of blocks in the client's ring. At least 2.
+ *                       Reads on the client may be up to one block less than the
+ *                       ring holds. Ignored by the host.
+ * \param task_priority  The priority of the stream's threads.
+ */
+void rtos_i2s_rpc_stream_config(
+        rtos_i2s_t *i2s_ctx,
+        rtos_driver_stream_t *stream,
+        unsigned intertile_port,
+        size_t block_frames,
+        size_t block_count,
+        unsigned task_priority);
+
+/**
+ * Gets the statistics of an I2S receive stream on a client tile. A non-zero
+ * overrun count shows that the client is not reading frames as fast as they
+ * are received.
+ *
+ * \param i2s_ctx A pointer to the I2S driver instance on the client.
+ * \param stats   The statistics are written here.
+ */
+inline void rtos_i2s_rpc_stream_stats_get(
+        rtos_i2s_t *i2s_ctx,
+        rtos_driver_stream_stats_t *stats)
+{
+    rtos_driver_stream_stats_get(i2s_ctx->stream, stats);
+}
+
 /**@}*/
 /**@}*/
 
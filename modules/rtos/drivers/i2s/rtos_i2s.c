@@ -41,6 +41,7 @@ static void i2s_init(rtos_i2s_t *ctx, i2s_config_t *i2s_config)
 {
     i2s_config->mode = ctx->mode;
     i2s_config->mclk_bclk_ratio = ctx->mclk_bclk_ratio;
+    i2s_config->frames_per_block = ctx->frames_per_block;
 }
 
 I2S_CALLBACK_ATTR
@@ -61,7 +62,7 @@ static void i2s_receive(rtos_i2s_t *ctx, size_t num_in, const int32_t *i2s_sampl
             memcpy(&ctx->recv_buffer.buf[ctx->recv_buffer.write_index], i2s_sample_buf, num_in * sizeof(int32_t));
             buffer_words_written = num_in;
         } else {
-            // rtos_printf("i2s rx overrun\n");
+            ctx->rx_overrun_count += num_in / (2 * ctx->num_in);
         }
     } else {
         /*
@@ -107,7 +108,7 @@ static void i2s_send(rtos_i2s_t *ctx, size_t num_out, int32_t *i2s_sample_buf)
             memcpy(i2s_sample_buf, &ctx->send_buffer.buf[ctx->send_buffer.read_index], num_out * sizeof(int32_t));
             buffer_words_read = num_out;
         } else {
-            // rtos_printf("i2s tx underrun\n");
+            ctx->tx_underrun_count += num_out / (2 * ctx->num_out);
         }
     } else {
         /*
@@ -215,6 +216,34 @@ static void i2s_slave_thread(rtos_i2s_t *ctx)
             ctx->bclk);
 }
 
+/*
+ * Waits until at least the given number of words are available in the
+ * receive buffer. Returns non-zero if they are.
+ */
+static int i2s_recv_wait(
+        rtos_i2s_t *ctx,
+        size_t words,
+        unsigned timeout)
+{
+    if (!ctx->recv_blocked) {
+        size_t words_available = ctx->recv_buffer.total_written - ctx->recv_buffer.total_read;
+        if (words > words_available) {
+            ctx->recv_buffer.required_available_count = words;
+            ctx->recv_blocked = 1;
+        }
+    }
+
+    if (ctx->recv_blocked) {
+        if (rtos_osal_semaphore_get(&ctx->recv_sem, timeout) == RTOS_OSAL_SUCCESS) {
+            ctx->recv_blocked = 0;
+        } else {
+            ctx->rx_underrun_count++;
+        }
+    }
+
+    return !ctx->recv_blocked;
+}
+
 __attribute__((fptrgroup("rtos_i2s_rx_fptr_grp")))
 static size_t i2s_local_rx(rtos_i2s_t *ctx,
                            int32_t *i2s_sample_buf,
@@ -230,22 +259,7 @@ static size_t i2s_local_rx(rtos_i2s_t *ctx,
         return frames_recvd;
     }
 
-    if (!ctx->recv_blocked) {
-        size_t words_available = ctx->recv_buffer.total_written - ctx->recv_buffer.total_read;
-        if (words_remaining > words_available) {
-            ctx->recv_buffer.required_available_count = words_remaining;
-            ctx->recv_blocked = 1;
-        }
-    }
-
-    if (ctx->recv_blocked) {
-        rtos_printf("recv get\n");
-        if (rtos_osal_semaphore_get(&ctx->recv_sem, timeout) == RTOS_OSAL_SUCCESS) {
-            ctx->recv_blocked = 0;
-        }
-    }
-
-    if (!ctx->recv_blocked) {
+    if (i2s_recv_wait(ctx, words_remaining, timeout)) {
         while (words_remaining) {
             size_t words_to_copy = MIN(words_remaining, ctx->recv_buffer.buf_size - ctx->recv_buffer.read_index);
             memcpy(sample_buf_ptr, &ctx->recv_buffer.buf[ctx->recv_buffer.read_index], words_to_copy * sizeof(int32_t));
@@ -268,6 +282,70 @@ static size_t i2s_local_rx(rtos_i2s_t *ctx,
     return frames_recvd;
 }
 
+size_t rtos_i2s_rx_acquire(
+        rtos_i2s_t *ctx,
+        int32_t **i2s_sample_buf,
+        unsigned timeout)
+{
+    size_t words_available;
+    size_t words_contiguous;
+
+    xassert(ctx->num_in > 0);
+
+    if (!i2s_recv_wait(ctx, MIN(ctx->recv_watermark * (2 * ctx->num_in), ctx->recv_buffer.buf_size), timeout)) {
+        return 0;
+    }
+
+    RTOS_MEMORY_BARRIER();
+
+    /*
+     * The buffer holds a whole number of frames, so a frame never
+     * straddles its end.
+     */
+    words_available = ctx->recv_buffer.total_written - ctx->recv_buffer.total_read;
+    words_contiguous = MIN(words_available, ctx->recv_buffer.buf_size - ctx->recv_buffer.read_index);
+
+    *i2s_sample_buf = &ctx->recv_buffer.buf[ctx->recv_buffer.read_index];
+
+    return words_contiguous / (2 * ctx->num_in);
+}
+
+void rtos_i2s_rx_release(
+        rtos_i2s_t *ctx,
+        size_t frame_count)
+{
+    size_t words = frame_count * (2 * ctx->num_in);
+
+    xassert(words <= ctx->recv_buffer.total_written - ctx->recv_buffer.total_read);
+    xassert(words <= ctx->recv_buffer.buf_size - ctx->recv_buffer.read_index);
+
+    ctx->recv_buffer.read_index += words;
+    if (ctx->recv_buffer.read_index >= ctx->recv_buffer.buf_size) {
+        ctx->recv_buffer.read_index = 0;
+    }
+
+    /* The frames must be finished with before the I2S thread may overwrite them */
+    RTOS_MEMORY_BARRIER();
+    ctx->recv_buffer.total_read += words;
+}
+
+void rtos_i2s_rx_watermark_set(
+        rtos_i2s_t *ctx,
+        size_t frame_count)
+{
+    xassert(frame_count > 0);
+    ctx->recv_watermark = frame_count;
+}
+
+void rtos_i2s_stats_get(
+        rtos_i2s_t *ctx,
+        rtos_i2s_stats_t *stats)
+{
+    stats->rx_overrun_count = ctx->rx_overrun_count;
+    stats->rx_underrun_count = ctx->rx_underrun_count;
+    stats->tx_underrun_count = ctx->tx_underrun_count;
+}
+
 __attribute__((fptrgroup("rtos_i2s_tx_fptr_grp")))
 static size_t i2s_local_tx(rtos_i2s_t *ctx,
                            int32_t *i2s_sample_buf,
@@ -334,6 +412,10 @@ void rtos_i2s_start(
     i2s_ctx->mode = mode;
     i2s_ctx->isr_cmd = 0;
 
+    /* Blocks are copied in and out of the buffers without wrapping */
+    xassert(recv_buffer_size % i2s_ctx->frames_per_block == 0);
+    xassert(send_buffer_size % i2s_ctx->frames_per_block == 0);
+
     memset(&i2s_ctx->recv_buffer, 0, sizeof(i2s_ctx->send_buffer));
     if (i2s_ctx->num_in > 0) {
         i2s_ctx->recv_buffer.buf_size = recv_buffer_size * (2 * i2s_ctx->num_in);
@@ -363,6 +445,10 @@ void rtos_i2s_start(
     if (i2s_ctx->rpc_config != NULL && i2s_ctx->rpc_config->rpc_host_start != NULL) {
         i2s_ctx->rpc_config->rpc_host_start(i2s_ctx->rpc_config);
     }
+
+    if (i2s_ctx->stream != NULL) {
+        rtos_driver_stream_host_start(i2s_ctx->stream);
+    }
 }
 
 static void rtos_i2s_init(
@@ -396,8 +482,14 @@ static void rtos_i2s_init(
     ctx->c_i2s_isr = s_chan_alloc();
 
     ctx->rpc_config = NULL;
+    ctx->stream = NULL;
     ctx->rx = i2s_local_rx;
     ctx->tx = i2s_local_tx;
+    ctx->frames_per_block = 1;
+    ctx->recv_watermark = 1;
+    ctx->rx_overrun_count = 0;
+    ctx->rx_underrun_count = 0;
+    ctx->tx_underrun_count = 0;
 
     triggerable_setup_interrupt_callback(ctx->c_i2s_isr.end_b, ctx, RTOS_INTERRUPT_CALLBACK(rtos_i2s_isr));
 
@@ -41,6 +41,25 @@ static size_t i2s_remote_rx(
     return ret;
 }
 
+__attribute__((fptrgroup("rtos_i2s_rx_fptr_grp")))
+static size_t i2s_stream_rx(
+        rtos_i2s_t *ctx,
+        int32_t *i2s_sample_buf,
+        size_t frame_count,
+        unsigned timeout)
+{
+    return rtos_driver_stream_rx(ctx->stream, i2s_sample_buf, frame_count, timeout);
+}
+
+__attribute__((fptrgroup("rtos_driver_stream_source_fptr_grp")))
+static size_t i2s_stream_source(
+        void *driver_ctx,
+        int32_t *buf,
+        size_t frame_count)
+{
+    return rtos_i2s_rx(driver_ctx, buf, frame_count, RTOS_OSAL_WAIT_FOREVER);
+}
+
 __attribute__((fptrgroup("rtos_i2s_tx_fptr_grp")))
 static size_t i2s_remote_tx(
         rtos_i2s_t *ctx,
@@ -205,12 +224,47 @@ void rtos_i2s_rpc_config(
     }
 }
 
+void rtos_i2s_rpc_stream_config(
+        rtos_i2s_t *i2s_ctx,
+        rtos_driver_stream_t *stream,
+        unsigned intertile_port,
+        size_t block_frames,
+        size_t block_count,
+        unsigned task_priority)
+{
+    rtos_driver_rpc_t *rpc_config = i2s_ctx->rpc_config;
+    rtos_intertile_address_t address;
+
+    xassert(i2s_ctx->num_in > 0);
+
+    if (rpc_config->remote_client_count == 0) {
+        /* This is a client */
+        address.intertile_ctx = rpc_config->host_address.intertile_ctx;
+        address.port = intertile_port;
+        rtos_driver_stream_client_init(
+                stream, &address, 2 * i2s_ctx->num_in,
+                block_frames, block_count, task_priority);
+        i2s_ctx->rx = i2s_stream_rx;
+    } else {
+        /* The stream goes to the first client */
+        address.intertile_ctx = rpc_config->client_address[0].intertile_ctx;
+        address.port = intertile_port;
+        rtos_driver_stream_host_init(
+                stream, &address,
+                i2s_stream_source, i2s_ctx, 2 * i2s_ctx->num_in,
+                block_frames, task_priority);
+    }
+
+    i2s_ctx->stream = stream;
+}
+
 void rtos_i2s_rpc_client_init(
         rtos_i2s_t *i2s_ctx,
         rtos_driver_rpc_t *rpc_config,
         rtos_intertile_t *host_intertile_ctx)
 {
     i2s_ctx->rpc_config = rpc_config;
+    i2s_ctx->stream = NULL;
     i2s_ctx->rx = i2s_remote_rx;
     i2s_ctx->tx = i2s_remote_tx;
     rpc_config->rpc_host_start = NULL;
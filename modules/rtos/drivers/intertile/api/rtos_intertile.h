@@ -3,7 +3,14 @@
 
 /**
  * Facilitates channel communication between tiles.
- * Essentially a thin wrapper around a streaming channel.
+ * Essentially a thin wrapper around one or more streaming channels,
+ * called lanes.
+ *
+ * Messages to ports configured for fragmentation are split into chunks
+ * of at most RTOS_INTERTILE_FRAGMENT_SIZE bytes, and the fragments of
+ * messages to different ports take turns on their lane. A large message
+ * therefore only delays a message to another port by one fragment.
+ * Priority ports are given their lane ahead of the next fragment.
  *
  * Recommend limiting to one per tile pair. There should be at
  * least one more RTOS core usable by all tasks that use these
@@ -29,18 +36,112 @@
 #include "rtos/osal/api/rtos_osal.h"
 
 /**
- * Struct representing an RTOS intertile driver instance.
+ * The maximum number of lanes that an intertile driver instance may use.
+ */
+#ifndef RTOS_INTERTILE_MAX_LANES
+#define RTOS_INTERTILE_MAX_LANES 4
+#endif
+
+/**
+ * The largest fragment, in bytes, sent to a fragmented port before
+ * the lane is given to another port.
+ */
+#ifndef RTOS_INTERTILE_FRAGMENT_SIZE
+#define RTOS_INTERTILE_FRAGMENT_SIZE 1024
+#endif
+
+/**
+ * The number of ports available on each intertile driver instance.
+ * Limited by the number of bits available in an event group.
+ */
+#define RTOS_INTERTILE_MAX_PORTS 24
+
+/**
+ * Port configuration flag. Messages to this port are sent on their lane
+ * ahead of messages to non-priority ports that are waiting to be sent.
+ */
+#define RTOS_INTERTILE_PORT_PRIORITY  0x01
+
+/**
+ * Port configuration flag. Messages to this port that are larger than
+ * RTOS_INTERTILE_FRAGMENT_SIZE are sent as multiple fragments, allowing
+ * messages to other ports on the same lane to be sent in between them.
+ * This only applies to messages sent with rtos_intertile_tx(); messages
+ * streamed with rtos_intertile_tx_len() are never fragmented.
+ */
+#define RTOS_INTERTILE_PORT_FRAGMENT  0x02
+
+/**
+ * Returned by rtos_intertile_rx() in place of a length when a message was
+ * dropped because the port's receive buffer pool had no free buffer. This
+ * can't be mistaken for a timeout or a zero length message, which both
+ * return 0.
+ */
+#define RTOS_INTERTILE_RX_DROPPED ((size_t) -1)
+
+/**
+ * Receive buffer pool statistics.
+ */
+typedef struct {
+    unsigned rx_count;       /**< Messages received into the pool */
+    unsigned in_use;         /**< Buffers currently held by the application */
+    unsigned max_in_use;     /**< The most buffers ever held at once */
+    unsigned drop_count;     /**< Messages dropped because every buffer was held */
+    unsigned oversize_count; /**< Messages too large for a pool buffer, received into the heap */
+} rtos_intertile_rx_pool_stats_t;
+
+/**
+ * Struct representing a receive buffer pool registered on a port.
+ *
+ * The members in this struct should not be accessed directly.
+ */
+typedef struct {
+    uint8_t *buffers;
+    size_t buffer_size;
+    int buffer_count;
+    volatile uint32_t free_mask;
+    rtos_osal_semaphore_t free_count;
+    rtos_intertile_rx_pool_stats_t stats;
+} rtos_intertile_rx_pool_t;
+
+typedef struct rtos_intertile_struct rtos_intertile_t;
+
+/**
+ * Struct representing a single lane of an RTOS intertile driver instance.
  *
  * The members in this struct should not be accessed directly.
  */
 typedef struct {
     chanend_t c;
+    rtos_intertile_t *ctx;
+    volatile int busy;
+    volatile unsigned tx_waiting;
+    volatile unsigned priority_waiting;
+    rtos_osal_semaphore_t tx_turn;
+    rtos_osal_semaphore_t priority_turn;
+} rtos_intertile_lane_t;
+
+/**
+ * Struct representing an RTOS intertile driver instance.
+ *
+ * The members in this struct should not be accessed directly.
+ */
+struct rtos_intertile_struct {
+    chanend_t c; /* The channel end of lane 0 */
 
     size_t tx_len;
+    uint8_t tx_port;
     size_t rx_len;
-    rtos_osal_mutex_t lock;
     rtos_osal_event_group_t event_group;
-} rtos_intertile_t;
+    rtos_osal_event_group_t tx_port_group;
+
+    int lane_count;
+    rtos_intertile_lane_t lanes[RTOS_INTERTILE_MAX_LANES];
+    uint8_t tx_port_lane[RTOS_INTERTILE_MAX_PORTS];
+    volatile uint8_t rx_port_lane[RTOS_INTERTILE_MAX_PORTS];
+    uint32_t port_flags[RTOS_INTERTILE_MAX_PORTS];
+    rtos_intertile_rx_pool_t *rx_pool[RTOS_INTERTILE_MAX_PORTS];
+};
 
 /**
  * Struct to hold an address to a remote function, consisting
@@ -60,10 +161,33 @@ typedef struct {
  * @{
  */
 
+/**
+ * Begins transmitting a message to an intertile link. The message is then
+ * sent with one or more calls to rtos_intertile_tx_data(). Lane 0 is held
+ * until all \p len bytes have been sent, so the port must be on lane 0
+ * and the message is never fragmented. If the port is configured with
+ * RTOS_INTERTILE_PORT_FRAGMENT then this first waits for any fragmented
+ * message to it from another thread to finish.
+ *
+ * \param ctx  A pointer to the intertile driver instance to use.
+ * \param port The number of the port to send the message to.
+ * \param len  The total number of bytes in the message.
+ */
 void rtos_intertile_tx_len(
         rtos_intertile_t *ctx,
         uint8_t port,
         size_t len);
+
+/**
+ * Transmits part of a message begun with rtos_intertile_tx_len().
+ *
+ * \param ctx  A pointer to the intertile driver instance to use.
+ * \param data A pointer to the data to transmit.
+ * \param len  The number of bytes to transmit. This is limited to the
+ *             number of bytes that remain in the message.
+ *
+ * \returns the number of bytes transmitted.
+ */
 size_t rtos_intertile_tx_data(
         rtos_intertile_t *ctx,
         void *data,
@@ -78,6 +202,10 @@ size_t rtos_intertile_tx_data(
  *             this data.
  * \param msg  A pointer to the data buffer to transmit.
  * \param len  The number of bytes from the buffer to transmit.
+ *
+ * \note If the port is configured with RTOS_INTERTILE_PORT_FRAGMENT then
+ * messages larger than RTOS_INTERTILE_FRAGMENT_SIZE are sent in fragments.
+ * Messages from different threads to the same port are never interleaved.
  */
 void rtos_intertile_tx(
         rtos_intertile_t *ctx,
@@ -85,10 +213,37 @@ void rtos_intertile_tx(
         void *msg,
         size_t len);
 
+/**
+ * Begins receiving a message from an intertile link. The message is then
+ * received with one or more calls to rtos_intertile_rx_data(), which must
+ * together receive all of it.
+ *
+ * \note Only one message may be received this way at a time on an intertile
+ * driver instance. The message must arrive on lane 0 and must not have been
+ * fragmented.
+ *
+ * \param ctx     A pointer to the intertile driver instance to use.
+ * \param port    The number of the port to listen for a message on.
+ * \param timeout The amount of time to wait before a message becomes
+ *                available.
+ *
+ * \returns the total number of bytes in the message, or 0 on timeout.
+ */
 size_t rtos_intertile_rx_len(
         rtos_intertile_t *ctx,
         uint8_t port,
         unsigned timeout);
+
+/**
+ * Receives part of a message begun with rtos_intertile_rx_len().
+ *
+ * \param ctx  A pointer to the intertile driver instance to use.
+ * \param data A pointer to the buffer to receive into.
+ * \param len  The number of bytes to receive. This is limited to the
+ *             number of bytes that remain in the message.
+ *
+ * \returns the number of bytes received.
+ */
 size_t rtos_intertile_rx_data(
         rtos_intertile_t *ctx,
         void *data,
@@ -98,7 +253,8 @@ size_t rtos_intertile_rx_data(
  * Receives data from an intertile link.
  *
  * \note the buffer returned via \p msg must be freed by the
- * application using rtos_osal_free().
+ * application using rtos_osal_free(), or with rtos_intertile_rx_release()
+ * if a receive buffer pool is registered on the port.
  *
  * \param ctx     A pointer to the intertile driver instance to use.
  * \param port    The number of the port to listen for data on. Only
@@ -110,12 +266,16 @@ size_t rtos_intertile_rx_data(
  *                it is possible for a resource exception to occur.
  * \param msg     A pointer to the received data is written to this
  *                pointer variable. This buffer is obtained from the
- *                heap and must be freed by the application using
- *                rtos_osal_free().
+ *                port's receive buffer pool if it has one, otherwise
+ *                from the heap.
  * \param timeout The amount of time to wait before data become
  *                available.
  *
- * \returns the number of bytes received.
+ * \returns the number of bytes received, 0 on timeout, or
+ * RTOS_INTERTILE_RX_DROPPED, with a NULL buffer, if the message was dropped
+ * because the port's receive buffer pool had no free buffer. Each drop is
+ * also counted in the pool's \p drop_count, see
+ * rtos_intertile_rx_pool_stats_get().
  */
 size_t rtos_intertile_rx(
         rtos_intertile_t *ctx,
@@ -123,6 +283,127 @@ size_t rtos_intertile_rx(
         void **msg,
         unsigned timeout);
 
+/**
+ * Receives data from an intertile link directly into a buffer provided by
+ * the caller. Nothing is allocated from the heap.
+ *
+ * If the message is larger than the buffer then the buffer is filled and the
+ * rest of the message is discarded. This is indicated by a return value that
+ * is larger than \p buf_size.
+ *
+ * \param ctx      A pointer to the intertile driver instance to use.
+ * \param port     The number of the port to listen for data on. The same
+ *                 restrictions apply as for rtos_intertile_rx().
+ * \param buf      The buffer to receive the data into.
+ * \param buf_size The size of \p buf in bytes.
+ * \param timeout  The amount of time to wait before data become
+ *                 available.
+ *
+ * \returns the length of the message, which may be larger than \p buf_size,
+ * or 0 on timeout.
+ */
+size_t rtos_intertile_rx_buf(
+        rtos_intertile_t *ctx,
+        uint8_t port,
+        void *buf,
+        size_t buf_size,
+        unsigned timeout);
+
+/**
+ * Releases a buffer returned by rtos_intertile_rx(). If the buffer belongs to
+ * the port's receive buffer pool then it is returned to the pool, otherwise it
+ * is freed with rtos_osal_free().
+ *
+ * \param ctx  A pointer to the intertile driver instance to use.
+ * \param port The number of the port the buffer was received on.
+ * \param msg  The buffer to release.
+ */
+void rtos_intertile_rx_release(
+        rtos_intertile_t *ctx,
+        uint8_t port,
+        void *msg);
+
+/**
+ * Registers a pool of fixed size receive buffers on a port. Messages received
+ * on the port with rtos_intertile_rx() are then written into a buffer from
+ * the pool rather than one allocated from the heap, and are given back to the
+ * pool with rtos_intertile_rx_release().
+ *
+ * When every buffer is held by the application, a message received on the port
+ * is dropped rather than holding up the lane until one is released, and
+ * rtos_intertile_rx() returns RTOS_INTERTILE_RX_DROPPED with a NULL buffer.
+ * Messages that are too large
+ * for a pool buffer are received into the heap.
+ *
+ * \param ctx          A pointer to the intertile driver instance to use.
+ * \param port         The number of the port to register the pool on.
+ * \param pool         A pointer to the pool instance to initialize.
+ * \param buffers      Memory for the buffers, at least \p buffer_size * \p buffer_count
+ *                     bytes.
+ * \param buffer_size  The size of each buffer in bytes.
+ * \param buffer_count The number of buffers, up to 32.
+ */
+void rtos_intertile_rx_pool_init(
+        rtos_intertile_t *ctx,
+        uint8_t port,
+        rtos_intertile_rx_pool_t *pool,
+        void *buffers,
+        size_t buffer_size,
+        int buffer_count);
+
+/**
+ * Removes the receive buffer pool from a port. All of its buffers must have been
+ * released.
+ *
+ * \param ctx  A pointer to the intertile driver instance to use.
+ * \param port The number of the port to remove the pool from.
+ */
+void rtos_intertile_rx_pool_deinit(
+        rtos_intertile_t *ctx,
+        uint8_t port);
+
+/**
+ * Gets the statistics of the receive buffer pool on a port. A \p max_in_use equal
+ * to the number of buffers, or a non-zero \p drop_count, shows that the
+ * application is not releasing buffers as fast as messages arrive.
+ *
+ * \param ctx   A pointer to the intertile driver instance to use.
+ * \param port  The number of the port with the pool.
+ * \param stats The statistics are written here.
+ */
+void rtos_intertile_rx_pool_stats_get(
+        rtos_intertile_t *ctx,
+        uint8_t port,
+        rtos_intertile_rx_pool_stats_t *stats);
+
+/**
+ * Configures how messages sent to a port are transmitted. This only affects
+ * messages sent from this tile, and must not be called while a message is
+ * being sent to the port. By default all ports are on lane 0 with no flags set.
+ *
+ * Ports on lanes other than 0 may only be sent to with rtos_intertile_tx() and
+ * received from with rtos_intertile_rx() or rtos_intertile_rx_buf(). Ports that
+ * are configured with RTOS_INTERTILE_PORT_FRAGMENT must be received from with
+ * one of those two functions.
+ *
+ * The streaming functions, rtos_intertile_tx_len() and rtos_intertile_rx_len(),
+ * keep the state of a single message per driver instance, so they are
+ * restricted to lane 0 and can't fragment. The RPC drivers and device control
+ * use them, so their ports must stay on lane 0, and a large transfer on one of
+ * them holds lane 0 until it is complete.
+ *
+ * \param ctx   A pointer to the intertile driver instance to use.
+ * \param port  The number of the port to configure.
+ * \param lane  The lane that messages to this port are sent on.
+ * \param flags A bitwise OR of RTOS_INTERTILE_PORT_PRIORITY and
+ *              RTOS_INTERTILE_PORT_FRAGMENT, or 0.
+ */
+void rtos_intertile_port_config(
+        rtos_intertile_t *ctx,
+        uint8_t port,
+        int lane,
+        uint32_t flags);
+
 /**@}*/
 
 /**
@@ -156,6 +437,21 @@ void rtos_intertile_init(
         rtos_intertile_t *intertile_ctx,
         chanend_t c);
 
+/**
+ * Initializes an RTOS intertile driver instance with multiple lanes. This is the same
+ * as rtos_intertile_init() except that a streaming channel is established for each lane.
+ * Both tiles must use the same number of lanes.
+ *
+ * \param intertile_ctx A pointer to the intertile driver instance to initialize.
+ * \param c             A channel end that is already allocated and connected to channel
+ *                      end on the tile with which to establish an intertile link.
+ * \param lane_count    The number of lanes to establish, up to RTOS_INTERTILE_MAX_LANES.
+ */
+void rtos_intertile_lanes_init(
+        rtos_intertile_t *intertile_ctx,
+        chanend_t c,
+        int lane_count);
+
 /**@}*/
 
 #endif /* RTOS_INTERTILE_H_ */
@@ -1,6 +1,8 @@
 // Copyright 2020-2021 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
+#include <string.h>
+
 #include <xcore/triggerable.h>
 #include <xcore/assert.h>
 #include <xcore/interrupt.h>
@@ -9,14 +11,30 @@
 
 #include "rtos/drivers/intertile/api/rtos_intertile.h"
 
+/*
+ * Each fragment is sent as the port byte, a header word holding the
+ * fragment length, and the fragment data. The first fragment of a
+ * message also carries the total length of the message after the
+ * header word.
+ */
+#define FIRST_FRAGMENT  0x80000000
+#define FRAGMENT_LEN    0x7FFFFFFF
+
+#define ALL_PORTS       ((1 << RTOS_INTERTILE_MAX_PORTS) - 1)
+
 DEFINE_RTOS_INTERRUPT_CALLBACK(rtos_intertile_isr, arg)
 {
-    rtos_intertile_t *ctx = arg;
+    rtos_intertile_lane_t *lane = arg;
+    rtos_intertile_t *ctx = lane->ctx;
     uint8_t port;
 
-    triggerable_disable_trigger(ctx->c);
+    triggerable_disable_trigger(lane->c);
+
+    port = s_chan_in_byte(lane->c);
+    xassert(port < RTOS_INTERTILE_MAX_PORTS);
 
-    port = s_chan_in_byte(ctx->c);
+    /* The rest of the fragment is read from this lane by the receiving task */
+    ctx->rx_port_lane[port] = lane - ctx->lanes;
 
     /* wake up the task waiting to receive on this port */
     if (rtos_osal_event_group_set_bits(&ctx->event_group, (1 << port)) !=
@@ -26,27 +44,144 @@ DEFINE_RTOS_INTERRUPT_CALLBACK(rtos_intertile_isr, arg)
     }
 }
 
+/*
+ * A sender that finds the lane busy waits on one of its turn semaphores.
+ * The lane is handed directly to the next waiter when it is released, so
+ * it stays busy throughout and the releasing thread cannot take it back
+ * before the waiter runs.
+ */
+static void lane_lock_get(rtos_intertile_t *ctx,
+                          rtos_intertile_lane_t *lane,
+                          uint8_t port)
+{
+    const int priority = ctx->port_flags[port] & RTOS_INTERTILE_PORT_PRIORITY;
+    int state;
+
+    state = rtos_osal_critical_enter();
+    if (!lane->busy) {
+        lane->busy = 1;
+        rtos_osal_critical_exit(state);
+        return;
+    }
+    if (priority) {
+        lane->priority_waiting++;
+    } else {
+        lane->tx_waiting++;
+    }
+    rtos_osal_critical_exit(state);
+
+    rtos_osal_semaphore_get(priority ? &lane->priority_turn : &lane->tx_turn,
+                            RTOS_OSAL_WAIT_FOREVER);
+}
+
+static void lane_lock_put(rtos_intertile_lane_t *lane)
+{
+    rtos_osal_semaphore_t *turn = NULL;
+    int state;
+
+    /* Priority senders have the lane ahead of any other waiting sender */
+    state = rtos_osal_critical_enter();
+    if (lane->priority_waiting > 0) {
+        lane->priority_waiting--;
+        turn = &lane->priority_turn;
+    } else if (lane->tx_waiting > 0) {
+        lane->tx_waiting--;
+        turn = &lane->tx_turn;
+    } else {
+        lane->busy = 0;
+    }
+    rtos_osal_critical_exit(state);
+
+    if (turn != NULL) {
+        rtos_osal_semaphore_put(turn);
+    }
+}
+
+static void fragment_header_tx(chanend_t c, uint8_t port, size_t fragment_len,
+                               size_t total_len, int first)
+{
+    s_chan_out_byte(c, port); //to the ISR
+    if (first) {
+        s_chan_out_word(c, FIRST_FRAGMENT | fragment_len);
+        s_chan_out_word(c, total_len);
+    } else {
+        s_chan_out_word(c, fragment_len);
+    }
+}
+
+/*
+ * Reads the header of the next fragment on a lane. Returns the fragment
+ * length, and the total message length if this is the first fragment.
+ */
+static size_t fragment_header_rx(chanend_t c, size_t *total_len, int *first)
+{
+    uint32_t header = s_chan_in_word(c);
+
+    *first = (header & FIRST_FRAGMENT) != 0;
+    if (*first) {
+        *total_len = s_chan_in_word(c);
+    }
+
+    return header & FRAGMENT_LEN;
+}
+
+/*
+ * Releases lane 0, and the port if it was taken, at the end of a message
+ * begun with rtos_intertile_tx_len().
+ */
+static void tx_stream_end(rtos_intertile_t *ctx, rtos_intertile_lane_t *lane)
+{
+    const uint8_t port = ctx->tx_port;
+
+    lane_lock_put(lane);
+
+    if (ctx->port_flags[port] & RTOS_INTERTILE_PORT_FRAGMENT) {
+        rtos_osal_event_group_set_bits(&ctx->tx_port_group, (1 << port));
+    }
+}
+
 void rtos_intertile_tx_len(rtos_intertile_t *ctx, uint8_t port, size_t len)
 {
-    rtos_osal_mutex_get(&ctx->lock, RTOS_OSAL_PORT_WAIT_FOREVER);
+    rtos_intertile_lane_t *lane = &ctx->lanes[0];
+    uint32_t flags;
+
+    xassert(port < RTOS_INTERTILE_MAX_PORTS);
+    xassert(ctx->tx_port_lane[port] == 0);
+
+    /*
+     * Fragmented messages release the lane between fragments, so take the
+     * port to stop this message being sent in the middle of one of them.
+     */
+    if (ctx->port_flags[port] & RTOS_INTERTILE_PORT_FRAGMENT) {
+        rtos_osal_event_group_get_bits(&ctx->tx_port_group, (1 << port),
+                                       RTOS_OSAL_AND_CLEAR, &flags,
+                                       RTOS_OSAL_WAIT_FOREVER);
+    }
+
+    lane_lock_get(ctx, lane, port);
 
     xassert(ctx->tx_len == 0);
 
     ctx->tx_len = len;
-    s_chan_out_byte(ctx->c, port); //to the ISR
-    s_chan_out_word(ctx->c, len);
+    ctx->tx_port = port;
+    fragment_header_tx(lane->c, port, len, len, 1);
+
+    if (len == 0) {
+        tx_stream_end(ctx, lane);
+    }
 }
 
 size_t rtos_intertile_tx_data(rtos_intertile_t *ctx, void *data, size_t len)
 {
+    rtos_intertile_lane_t *lane = &ctx->lanes[0];
     size_t tx_len = len <= ctx->tx_len ? len : ctx->tx_len;
 
-    s_chan_out_buf_byte(ctx->c, data, tx_len);
+    s_chan_out_buf_byte(lane->c, data, tx_len);
 
     ctx->tx_len -= tx_len;
 
-    if (ctx->tx_len == 0) {
-        rtos_osal_mutex_put(&ctx->lock);
+    if (ctx->tx_len == 0 && tx_len > 0) {
+        tx_stream_end(ctx, lane);
     }
 
     return tx_len;
@@ -55,20 +190,59 @@ size_t rtos_intertile_tx_data(rtos_intertile_t *ctx, void *data, size_t len)
 void rtos_intertile_tx(rtos_intertile_t *ctx, uint8_t port, void *msg,
                        size_t len)
 {
-    rtos_osal_mutex_get(&ctx->lock, RTOS_OSAL_PORT_WAIT_FOREVER);
+    rtos_intertile_lane_t *lane;
+    uint8_t *data = msg;
+    size_t sent = 0;
+    size_t fragment_size;
+    uint32_t flags;
+
+    xassert(port < RTOS_INTERTILE_MAX_PORTS);
+    lane = &ctx->lanes[ctx->tx_port_lane[port]];
 
-    s_chan_out_byte(ctx->c, port); //to the ISR
-    s_chan_out_word(ctx->c, len);
-    s_chan_out_buf_byte(ctx->c, msg, len);
+    if (!(ctx->port_flags[port] & RTOS_INTERTILE_PORT_FRAGMENT)) {
+        lane_lock_get(ctx, lane, port);
+        fragment_header_tx(lane->c, port, len, len, 1);
+        s_chan_out_buf_byte(lane->c, data, len);
+        lane_lock_put(lane);
+        return;
+    }
 
-    rtos_osal_mutex_put(&ctx->lock);
+    /*
+     * The lane is released between fragments, so take the port to stop
+     * another thread's message to it from being interleaved with this one.
+     */
+    rtos_osal_event_group_get_bits(&ctx->tx_port_group, (1 << port),
+                                   RTOS_OSAL_AND_CLEAR, &flags,
+                                   RTOS_OSAL_WAIT_FOREVER);
+
+    do {
+        fragment_size = len - sent;
+        if (fragment_size > RTOS_INTERTILE_FRAGMENT_SIZE) {
+            fragment_size = RTOS_INTERTILE_FRAGMENT_SIZE;
+        }
+
+        lane_lock_get(ctx, lane, port);
+        fragment_header_tx(lane->c, port, fragment_size, len, sent == 0);
+        s_chan_out_buf_byte(lane->c, &data[sent], fragment_size);
+        lane_lock_put(lane);
+
+        sent += fragment_size;
+    } while (sent < len);
+
+    rtos_osal_event_group_set_bits(&ctx->tx_port_group, (1 << port));
 }
 
 size_t rtos_intertile_rx_len(rtos_intertile_t *ctx, uint8_t port,
                              unsigned timeout)
 {
+    rtos_intertile_lane_t *lane = &ctx->lanes[0];
     uint32_t flags;
     rtos_osal_status_t status;
+    size_t fragment_len;
+    size_t total_len = 0;
+    int first;
+
+    xassert(port < RTOS_INTERTILE_MAX_PORTS);
 
     status =
             rtos_osal_event_group_get_bits(&ctx->event_group, (1 << port),
@@ -76,7 +250,15 @@ size_t rtos_intertile_rx_len(rtos_intertile_t *ctx, uint8_t port,
 
     if (status == RTOS_OSAL_SUCCESS) {
         xassert(ctx->rx_len == 0);
-        ctx->rx_len = s_chan_in_word(ctx->c);
+        xassert(ctx->rx_port_lane[port] == 0);
+
+        fragment_len = fragment_header_rx(lane->c, &total_len, &first);
+        xassert(first && fragment_len == total_len);
+
+        ctx->rx_len = total_len;
+        if (total_len == 0) {
+            triggerable_enable_trigger(lane->c);
+        }
     }
 
     return ctx->rx_len;
@@ -84,52 +266,244 @@ size_t rtos_intertile_rx_len(rtos_intertile_t *ctx, uint8_t port,
 
 size_t rtos_intertile_rx_data(rtos_intertile_t *ctx, void *data, size_t len)
 {
+    rtos_intertile_lane_t *lane = &ctx->lanes[0];
     size_t rx_len = len <= ctx->rx_len ? len : ctx->rx_len;
 
-    s_chan_in_buf_byte(ctx->c, data, rx_len);
+    s_chan_in_buf_byte(lane->c, data, rx_len);
 
     ctx->rx_len -= rx_len;
 
-    if (ctx->rx_len == 0) {
-        triggerable_enable_trigger(ctx->c);
+    if (ctx->rx_len == 0 && rx_len > 0) {
+        triggerable_enable_trigger(lane->c);
     }
 
     return rx_len;
 }
 
-size_t rtos_intertile_rx(rtos_intertile_t *ctx, uint8_t port, void **msg,
-                         unsigned timeout)
+/*
+ * Takes a buffer for a message of len bytes from a pool. Returns NULL, and
+ * counts a drop, if every buffer is held by the application, as waiting for
+ * one to be released would hold up the messages to every other port on the
+ * lane.
+ */
+static void *rx_pool_get(rtos_intertile_rx_pool_t *pool, size_t len)
 {
-    uint32_t len = 0;
+    void *buf;
+    int state;
+    int i;
+
+    if (len > pool->buffer_size) {
+        pool->stats.oversize_count++;
+        buf = rtos_osal_malloc(len);
+        xassert(buf != NULL);
+        return buf;
+    }
+
+    if (rtos_osal_semaphore_get(&pool->free_count, RTOS_OSAL_NO_WAIT) != RTOS_OSAL_SUCCESS) {
+        pool->stats.drop_count++;
+        return NULL;
+    }
+
+    state = rtos_osal_critical_enter();
+    i = __builtin_ctz(pool->free_mask);
+    pool->free_mask &= ~(1 << i);
+    pool->stats.rx_count++;
+    pool->stats.in_use++;
+    if (pool->stats.in_use > pool->stats.max_in_use) {
+        pool->stats.max_in_use = pool->stats.in_use;
+    }
+    rtos_osal_critical_exit(state);
+
+    return pool->buffers + i * pool->buffer_size;
+}
+
+/*
+ * Receives a message into buf. If buf is NULL then the buffer is taken from
+ * the port's pool, or the heap, once the length of the message is known and
+ * is returned via msg. If the pool has no free buffer then the message is
+ * discarded, NULL is returned via msg and RTOS_INTERTILE_RX_DROPPED is
+ * returned.
+ */
+static size_t rx_message(rtos_intertile_t *ctx, uint8_t port, void **msg,
+                         uint8_t *buf, size_t buf_size, unsigned timeout)
+{
+    rtos_intertile_lane_t *lane;
+    size_t len = 0;
+    size_t received = 0;
+    size_t fragment_len;
+    size_t copy_len;
+    size_t discard_len;
+    uint8_t discard[32];
+    int first;
+    int dropped = 0;
     uint32_t flags;
     rtos_osal_status_t status;
 
-    *msg = NULL;
+    xassert(port < RTOS_INTERTILE_MAX_PORTS);
 
     status =
             rtos_osal_event_group_get_bits(&ctx->event_group, (1 << port),
                                            RTOS_OSAL_OR_CLEAR, &flags, timeout);
 
-    if (status == RTOS_OSAL_SUCCESS) {
-        len = s_chan_in_word(ctx->c);
+    if (status != RTOS_OSAL_SUCCESS) {
+        return 0;
+    }
 
-        *msg = rtos_osal_malloc(len);
-        xassert(*msg != NULL);
+    for (;;) {
+        lane = &ctx->lanes[ctx->rx_port_lane[port]];
+
+        fragment_len = fragment_header_rx(lane->c, &len, &first);
+        if (first) {
+            xassert(received == 0);
+            if (msg != NULL) {
+                if (ctx->rx_pool[port] != NULL) {
+                    buf = rx_pool_get(ctx->rx_pool[port], len);
+                    dropped = buf == NULL;
+                } else {
+                    buf = rtos_osal_malloc(len);
+                    xassert(buf != NULL);
+                }
+                buf_size = dropped ? 0 : len;
+                *msg = buf;
+            }
+        }
+        xassert(received + fragment_len <= len);
+
+        copy_len = 0;
+        if (received < buf_size) {
+            copy_len = buf_size - received;
+            if (copy_len > fragment_len) {
+                copy_len = fragment_len;
+            }
+            s_chan_in_buf_byte(lane->c, &buf[received], copy_len);
+        }
+
+        /* Discard whatever does not fit in the caller's buffer */
+        while (copy_len < fragment_len) {
+            discard_len = fragment_len - copy_len;
+            if (discard_len > sizeof(discard)) {
+                discard_len = sizeof(discard);
+            }
+            s_chan_in_buf_byte(lane->c, discard, discard_len);
+            copy_len += discard_len;
+        }
+        received += fragment_len;
+
+        /* Let other ports' fragments through before waiting for the next one */
+        triggerable_enable_trigger(lane->c);
+
+        if (received == len) {
+            break;
+        }
+
+        rtos_osal_event_group_get_bits(&ctx->event_group, (1 << port),
+                                       RTOS_OSAL_OR_CLEAR, &flags,
+                                       RTOS_OSAL_WAIT_FOREVER);
+    }
 
-        s_chan_in_buf_byte(ctx->c, *msg, len);
+    return dropped ? RTOS_INTERTILE_RX_DROPPED : len;
+}
 
-        triggerable_enable_trigger(ctx->c);
+size_t rtos_intertile_rx(rtos_intertile_t *ctx, uint8_t port, void **msg,
+                         unsigned timeout)
+{
+    *msg = NULL;
+
+    return rx_message(ctx, port, msg, NULL, 0, timeout);
+}
+
+size_t rtos_intertile_rx_buf(rtos_intertile_t *ctx, uint8_t port, void *buf,
+                             size_t buf_size, unsigned timeout)
+{
+    return rx_message(ctx, port, NULL, buf, buf_size, timeout);
+}
+
+void rtos_intertile_rx_release(rtos_intertile_t *ctx, uint8_t port, void *msg)
+{
+    rtos_intertile_rx_pool_t *pool;
+    uint8_t *buf = msg;
+    int state;
+    int i;
+
+    xassert(port < RTOS_INTERTILE_MAX_PORTS);
+    pool = ctx->rx_pool[port];
+
+    if (pool == NULL || buf < pool->buffers ||
+        buf >= pool->buffers + pool->buffer_count * pool->buffer_size) {
+        rtos_osal_free(msg);
+        return;
     }
 
-    return len;
+    i = (buf - pool->buffers) / pool->buffer_size;
+
+    state = rtos_osal_critical_enter();
+    xassert((pool->free_mask & (1 << i)) == 0);
+    pool->free_mask |= (1 << i);
+    pool->stats.in_use--;
+    rtos_osal_critical_exit(state);
+
+    rtos_osal_semaphore_put(&pool->free_count);
+}
+
+void rtos_intertile_rx_pool_init(rtos_intertile_t *ctx, uint8_t port,
+                                 rtos_intertile_rx_pool_t *pool, void *buffers,
+                                 size_t buffer_size, int buffer_count)
+{
+    xassert(port < RTOS_INTERTILE_MAX_PORTS);
+    xassert(buffer_count > 0 && buffer_count <= 32);
+    xassert(ctx->rx_pool[port] == NULL);
+
+    pool->buffers = buffers;
+    pool->buffer_size = buffer_size;
+    pool->buffer_count = buffer_count;
+    pool->free_mask = buffer_count == 32 ? 0xFFFFFFFF : (1 << buffer_count) - 1;
+    memset(&pool->stats, 0, sizeof(pool->stats));
+    rtos_osal_semaphore_create(&pool->free_count, "intertile_pool",
+                               buffer_count, buffer_count);
+
+    ctx->rx_pool[port] = pool;
+}
+
+void rtos_intertile_rx_pool_deinit(rtos_intertile_t *ctx, uint8_t port)
+{
+    rtos_intertile_rx_pool_t *pool;
+
+    xassert(port < RTOS_INTERTILE_MAX_PORTS);
+    pool = ctx->rx_pool[port];
+    xassert(pool != NULL && pool->stats.in_use == 0);
+
+    ctx->rx_pool[port] = NULL;
+    rtos_osal_semaphore_delete(&pool->free_count);
+}
+
+void rtos_intertile_rx_pool_stats_get(rtos_intertile_t *ctx, uint8_t port,
+                                      rtos_intertile_rx_pool_stats_t *stats)
+{
+    xassert(port < RTOS_INTERTILE_MAX_PORTS && ctx->rx_pool[port] != NULL);
+
+    *stats = ctx->rx_pool[port]->stats;
+}
+
+void rtos_intertile_port_config(rtos_intertile_t *ctx, uint8_t port, int lane,
+                                uint32_t flags)
+{
+    xassert(port < RTOS_INTERTILE_MAX_PORTS);
+    xassert(lane >= 0 && lane < ctx->lane_count);
+
+    ctx->tx_port_lane[port] = lane;
+    ctx->port_flags[port] = flags;
 }
 
 void rtos_intertile_start(rtos_intertile_t *intertile_ctx)
 {
-    triggerable_setup_interrupt_callback(
-            intertile_ctx->c, intertile_ctx,
-            RTOS_INTERRUPT_CALLBACK(rtos_intertile_isr));
-    triggerable_enable_trigger(intertile_ctx->c);
+    for (int i = 0; i < intertile_ctx->lane_count; i++) {
+        rtos_intertile_lane_t *lane = &intertile_ctx->lanes[i];
+
+        triggerable_setup_interrupt_callback(
+                lane->c, lane,
+                RTOS_INTERRUPT_CALLBACK(rtos_intertile_isr));
+        triggerable_enable_trigger(lane->c);
+    }
 }
 
 static chanend_t channel_establish(chanend_t remote_tile_chanend)
@@ -152,13 +526,42 @@ static chanend_t channel_establish(chanend_t remote_tile_chanend)
     return local_c;
 }
 
-void rtos_intertile_init(rtos_intertile_t *intertile_ctx, chanend_t c)
+void rtos_intertile_lanes_init(rtos_intertile_t *intertile_ctx, chanend_t c,
+                               int lane_count)
 {
-    intertile_ctx->c = channel_establish(c);
+    xassert(lane_count >= 1 && lane_count <= RTOS_INTERTILE_MAX_LANES);
+
+    for (int i = 0; i < lane_count; i++) {
+        rtos_intertile_lane_t *lane = &intertile_ctx->lanes[i];
+
+        lane->c = channel_establish(c);
+        lane->ctx = intertile_ctx;
+        lane->busy = 0;
+        lane->tx_waiting = 0;
+        lane->priority_waiting = 0;
+        rtos_osal_semaphore_create(&lane->tx_turn, "intertile_tx_turn", 1, 0);
+        rtos_osal_semaphore_create(&lane->priority_turn,
+                                   "intertile_priority_turn", 1, 0);
+    }
+
+    intertile_ctx->c = intertile_ctx->lanes[0].c;
+    intertile_ctx->lane_count = lane_count;
     intertile_ctx->tx_len = 0;
+    intertile_ctx->tx_port = 0;
     intertile_ctx->rx_len = 0;
-    rtos_osal_mutex_create(&intertile_ctx->lock, "intertile_mutex",
-                           RTOS_OSAL_NOT_RECURSIVE);
+    memset(intertile_ctx->tx_port_lane, 0, sizeof(intertile_ctx->tx_port_lane));
+    memset((void *) intertile_ctx->rx_port_lane, 0, sizeof(intertile_ctx->rx_port_lane));
+    memset(intertile_ctx->port_flags, 0, sizeof(intertile_ctx->port_flags));
+    memset(intertile_ctx->rx_pool, 0, sizeof(intertile_ctx->rx_pool));
+
     rtos_osal_event_group_create(&intertile_ctx->event_group,
                                  "intertile_group");
+    rtos_osal_event_group_create(&intertile_ctx->tx_port_group,
+                                 "intertile_tx_group");
+    rtos_osal_event_group_set_bits(&intertile_ctx->tx_port_group, ALL_PORTS);
+}
+
+void rtos_intertile_init(rtos_intertile_t *intertile_ctx, chanend_t c)
+{
+    rtos_intertile_lanes_init(intertile_ctx, c, 1);
 }
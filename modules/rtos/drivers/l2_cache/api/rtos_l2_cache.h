@@ -11,7 +11,10 @@
  * @{
  */
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <xcore/channel.h>
+#include <xcore/swmem_fill.h>
 
 #include "rtos/osal/api/rtos_osal.h"
 #include "l2_cache.h"
@@ -44,6 +47,66 @@
  */
 #define RTOS_L2_CACHE_BUFFER_WORDS_TWO_WAY L2_CACHE_BUFFER_WORDS_TWO_WAY(L2_CACHE_LINE_COUNT, L2_CACHE_LINE_SIZE_BYTES)
 
+/**
+ * The smallest line size that may be used with rtos_l2_cache_configured_init().
+ * This is the size of a software memory cache line fill.
+ */
+#define RTOS_L2_CACHE_LINE_SIZE_MIN (SWMEM_FILL_SIZE_WORDS * sizeof(uint32_t))
+
+/**
+ * The number of words of state that a configured cache keeps for each line.
+ */
+#define RTOS_L2_CACHE_LINE_STATE_WORDS 2
+
+/**
+ * Convenience macro that may be used to specify the size of the cache buffer
+ * for a cache created with rtos_l2_cache_configured_init(). This holds the
+ * lines themselves along with their tags.
+ *
+ * \param line_count The total number of lines in the cache.
+ * \param line_size  The size of each line in bytes.
+ */
+#define RTOS_L2_CACHE_BUFFER_WORDS(line_count, line_size) \
+    ((line_count) * ((line_size) / sizeof(uint32_t) + RTOS_L2_CACHE_LINE_STATE_WORDS))
+
+/**
+ * The geometry of a cache created with rtos_l2_cache_configured_init().
+ */
+typedef struct {
+    /**
+     * The number of ways in each set. 1 gives a direct mapped cache, and
+     * setting this to line_count gives a fully associative cache. Lines are
+     * replaced in least recently used order within each set.
+     */
+    unsigned ways;
+
+    /**
+     * The size of each line in bytes. This must be a power of two, and no
+     * smaller than RTOS_L2_CACHE_LINE_SIZE_MIN. All of a line is read on a
+     * miss, so larger lines read ahead further.
+     */
+    unsigned line_size;
+
+    /**
+     * The total number of lines in the cache. This divided by ways must be
+     * a power of two.
+     */
+    unsigned line_count;
+} rtos_l2_cache_config_t;
+
+/**
+ * Statistics for a cache created with rtos_l2_cache_configured_init().
+ * Each counts software memory fill requests, so accesses that hit in the
+ * hardware cache in front of the L2 cache are not counted.
+ */
+typedef struct {
+    unsigned hit_count;        /**< Fills from a line already in the cache */
+    unsigned miss_count;       /**< Fills that required a line to be read */
+    unsigned eviction_count;   /**< Misses that replaced a line in the cache */
+    unsigned uncached_count;   /**< Misses in sets with every way pinned, read without caching */
+    uint32_t miss_ticks;       /**< Reference clock ticks spent reading lines for misses */
+} rtos_l2_cache_stats_t;
+
 /**
  * Typedef to the RTOS l2 cache driver instance struct.
  */
@@ -62,6 +125,17 @@ struct rtos_l2_cache_struct {
     chanend_t c_start;
     chanend_t c_thread;
     void* cache_buffer;
+
+    /* Only used by caches created with rtos_l2_cache_configured_init() */
+    rtos_l2_cache_config_t config;
+    unsigned set_shift;
+    unsigned set_mask;
+    uint32_t *lines;
+    uint32_t *line_state;
+    uint32_t *uncached_line;
+    unsigned use_count;
+    bool started;
+    volatile rtos_l2_cache_stats_t stats;
 };
 
 /**
@@ -82,6 +156,72 @@ void rtos_l2_cache_init(
     uint32_t io_core_mask,
     void* cache_buffer);
 
+/**
+ * Initializes an l2 cache with a geometry chosen at runtime, in place of
+ * rtos_l2_cache_init(). The cache is implemented by this driver rather than
+ * by lib_l2_cache, and keeps statistics that may be read with
+ * rtos_l2_cache_stats_get().
+ *
+ * \param ctx          A pointer to the l2 cache driver instance to initialize.
+ * \param config       The geometry of the cache. This is copied.
+ * \param read_func    The function that reads lines from the backing memory.
+ * \param io_core_mask A bitmask of the cores that the cache thread may run on.
+ * \param cache_buffer A dword aligned buffer of
+ *                     RTOS_L2_CACHE_BUFFER_WORDS(config->line_count, config->line_size)
+ *                     words.
+ */
+void rtos_l2_cache_configured_init(
+    rtos_l2_cache_t* ctx,
+    const rtos_l2_cache_config_t* config,
+    l2_cache_swmem_read_fn read_func,
+    uint32_t io_core_mask,
+    void* cache_buffer);
+
+/**
+ * Pins the lines covering a region of software memory in a cache created
+ * with rtos_l2_cache_configured_init(), so that they are never evicted. The
+ * lines are read when the cache is started. This is intended for hot code
+ * or data that must not be slowed down by misses.
+ *
+ * Misses in a set where every way is pinned are read without being cached,
+ * so at most ways - 1 lines in each set should normally be pinned.
+ *
+ * \note This must be called before rtos_l2_cache_start().
+ *
+ * \param ctx   A pointer to the l2 cache driver instance.
+ * \param start A pointer to the start of the region, in software memory.
+ * \param size  The size of the region in bytes.
+ *
+ * \retval 0  if all the lines in the region were pinned.
+ * \retval -1 if a set has no more ways that can be pinned. Lines before
+ *            this are left pinned.
+ */
+int rtos_l2_cache_pin(
+    rtos_l2_cache_t* ctx,
+    const void* start,
+    size_t size);
+
+/**
+ * Gets the statistics of a cache created with rtos_l2_cache_configured_init().
+ * This may be called from any thread on the same tile while the cache is
+ * running. Each counter is read atomically, but they are not all read at
+ * the same instant.
+ *
+ * \param ctx   A pointer to the l2 cache driver instance.
+ * \param stats The statistics are written here.
+ */
+void rtos_l2_cache_stats_get(
+    rtos_l2_cache_t* ctx,
+    rtos_l2_cache_stats_t* stats);
+
+/**
+ * Resets the statistics of a cache created with rtos_l2_cache_configured_init().
+ * Counts made by the cache thread at the same time may be lost.
+ *
+ * \param ctx   A pointer to the l2 cache driver instance.
+ */
+void rtos_l2_cache_stats_reset(rtos_l2_cache_t* ctx);
+
 /**@}*/
 
 #endif /* RTOS_L2_CACHE_H_ */
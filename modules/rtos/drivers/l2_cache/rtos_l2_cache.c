@@ -1,7 +1,11 @@
 // Copyright 2021 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
+#include <string.h>
+
 #include <xcore/channel.h>
+#include <xcore/swmem_fill.h>
+#include <xcore/hwtimer.h>
 
 #include "rtos_interrupt.h"
 
@@ -9,6 +13,123 @@
 #include "rtos/drivers/l2_cache/api/rtos_l2_cache.h"
 #include "l2_cache.h"
 
+/*
+ * The state of each line in a configured cache is a tag word followed by
+ * the value of use_count when the line was last used. The tag word holds
+ * the software memory offset of the line, which is aligned to at least
+ * RTOS_L2_CACHE_LINE_SIZE_MIN, along with these flags.
+ */
+#define LINE_VALID  0x1
+#define LINE_PINNED 0x2
+#define LINE_FLAGS  (LINE_VALID | LINE_PINNED)
+
+#define LINE_TAG(ctx, way)      ((ctx)->line_state[(way) * RTOS_L2_CACHE_LINE_STATE_WORDS])
+#define LINE_LAST_USE(ctx, way) ((ctx)->line_state[(way) * RTOS_L2_CACHE_LINE_STATE_WORDS + 1])
+
+static uint32_t *line_data(rtos_l2_cache_t *ctx, unsigned line)
+{
+    return &ctx->lines[line * (ctx->config.line_size / sizeof(uint32_t))];
+}
+
+static void line_read(rtos_l2_cache_t *ctx, uint32_t *dst, unsigned offset)
+{
+    L2_CACHE_SWMEM_READ_FN l2_cache_swmem_read_fn read_func;
+    read_func = ctx->read_func;
+
+    read_func(dst, (const void *)(XS1_SWMEM_BASE + offset), ctx->config.line_size);
+}
+
+/*
+ * Returns the line of the cache that holds the line at a software memory
+ * offset, reading it first on a miss. The least recently used line in the
+ * set that is not pinned is replaced. If every line in the set is pinned
+ * then the line is read into a buffer that is not part of the cache.
+ */
+static uint32_t *line_get(rtos_l2_cache_t *ctx, unsigned offset)
+{
+    const unsigned ways = ctx->config.ways;
+    const unsigned first = ((offset >> ctx->set_shift) & ctx->set_mask) * ways;
+    unsigned victim = 0;
+    bool victim_found = false;
+    uint32_t start_time;
+    uint32_t *data;
+
+    for (unsigned line = first; line < first + ways; line++) {
+        uint32_t tag = LINE_TAG(ctx, line);
+
+        if ((tag & LINE_VALID) && (tag & ~LINE_FLAGS) == offset) {
+            LINE_LAST_USE(ctx, line) = ++ctx->use_count;
+            ctx->stats.hit_count++;
+            return line_data(ctx, line);
+        }
+
+        if (tag & LINE_PINNED) {
+            continue;
+        }
+        if (!victim_found ||
+            ((LINE_TAG(ctx, victim) & LINE_VALID) &&
+             (!(tag & LINE_VALID) ||
+              (int32_t)(LINE_LAST_USE(ctx, line) - LINE_LAST_USE(ctx, victim)) < 0))) {
+            victim = line;
+            victim_found = true;
+        }
+    }
+
+    ctx->stats.miss_count++;
+    start_time = get_reference_time();
+
+    if (victim_found) {
+        if (LINE_TAG(ctx, victim) & LINE_VALID) {
+            ctx->stats.eviction_count++;
+        }
+        data = line_data(ctx, victim);
+        line_read(ctx, data, offset);
+        LINE_TAG(ctx, victim) = offset | LINE_VALID;
+        LINE_LAST_USE(ctx, victim) = ++ctx->use_count;
+    } else {
+        ctx->stats.uncached_count++;
+        data = ctx->uncached_line;
+        line_read(ctx, data, offset);
+    }
+
+    ctx->stats.miss_ticks += get_reference_time() - start_time;
+
+    return data;
+}
+
+static void rtos_l2_cache_configured_thread(rtos_l2_cache_t *ctx)
+{
+    const unsigned line_mask = ctx->config.line_size - 1;
+    swmem_fill_t fill_res;
+
+    (void) s_chan_in_byte(ctx->c_thread);
+
+    rtos_printf("L2 Cache (%u way, %u lines of %u bytes) on core %d\n",
+                ctx->config.ways, ctx->config.line_count, ctx->config.line_size,
+                rtos_core_id_get());
+
+    /* Read in the pinned lines */
+    for (unsigned line = 0; line < ctx->config.line_count; line++) {
+        uint32_t tag = LINE_TAG(ctx, line);
+        if (tag & LINE_PINNED) {
+            line_read(ctx, line_data(ctx, line), tag & ~LINE_FLAGS);
+            LINE_TAG(ctx, line) = tag | LINE_VALID;
+        }
+    }
+
+    fill_res = swmem_fill_get();
+    xassert(fill_res != 0);
+
+    for (;;) {
+        fill_slot_t fill_slot = swmem_fill_in_address(fill_res);
+        unsigned offset = (unsigned)(fill_slot - XS1_SWMEM_BASE);
+        uint32_t *data = line_get(ctx, offset & ~line_mask);
+
+        swmem_fill_populate_from_buffer(fill_res, fill_slot,
+                                        &data[(offset & line_mask) / sizeof(uint32_t)]);
+    }
+}
+
 static void rtos_l2_cache_thread(rtos_l2_cache_t *ctx)
 {
     L2_CACHE_THREAD_FN_ATTR l2_cache_thread_fn thread_fn;
@@ -34,6 +155,8 @@ static void rtos_l2_cache_thread(rtos_l2_cache_t *ctx)
 
 void rtos_l2_cache_start(rtos_l2_cache_t *ctx)
 {
+    ctx->started = true;
+
     /* Tells the I/O thread to enter the l2 cache thread function */
     s_chan_out_byte(ctx->c_start, 0);
 }
@@ -71,3 +194,123 @@ void rtos_l2_cache_init(
     /* And ensure it only runs on one of the specified cores */
     rtos_osal_thread_core_exclusion_set(&ctx->hil_thread, ~io_core_mask);
 }
+
+void rtos_l2_cache_configured_init(
+    rtos_l2_cache_t* ctx,
+    const rtos_l2_cache_config_t* config,
+    l2_cache_swmem_read_fn read_func,
+    uint32_t io_core_mask,
+    void* cache_buffer)
+{
+    unsigned sets;
+
+    xassert(config->ways > 0 && config->line_count % config->ways == 0);
+    sets = config->line_count / config->ways;
+    xassert((sets & (sets - 1)) == 0);
+    xassert(config->line_size >= RTOS_L2_CACHE_LINE_SIZE_MIN &&
+            (config->line_size & (config->line_size - 1)) == 0);
+    xassert(((uintptr_t) cache_buffer & 0x7) == 0);
+
+    memset(ctx, 0, sizeof(rtos_l2_cache_t));
+
+    channel_t c_tmp = chan_alloc();
+    xassert(c_tmp.end_a != 0);
+
+    ctx->c_start = c_tmp.end_a;
+    ctx->c_thread = c_tmp.end_b;
+    ctx->cache_buffer = cache_buffer;
+    ctx->read_func = read_func;
+    ctx->config = *config;
+
+    ctx->set_shift = __builtin_ctz(config->line_size);
+    ctx->set_mask = sets - 1;
+    ctx->lines = cache_buffer;
+    ctx->line_state = &ctx->lines[config->line_count * (config->line_size / sizeof(uint32_t))];
+    memset(ctx->line_state, 0, config->line_count * RTOS_L2_CACHE_LINE_STATE_WORDS * sizeof(uint32_t));
+
+    /*
+     * Only needed when every way in a set is pinned, which is expected to
+     * be rare, so this is not part of the application's buffer.
+     */
+    ctx->uncached_line = rtos_osal_malloc(config->line_size);
+    xassert(ctx->uncached_line != NULL);
+
+    rtos_osal_thread_create(
+            &ctx->hil_thread,
+            "l2_cache_thread",
+            (rtos_osal_entry_function_t) rtos_l2_cache_configured_thread,
+            ctx,
+            RTOS_THREAD_STACK_SIZE(rtos_l2_cache_configured_thread),
+            RTOS_OSAL_HIGHEST_PRIORITY);
+
+    /* Ensure the L2 cache thread is never preempted */
+    rtos_osal_thread_preemption_disable(&ctx->hil_thread);
+    /* And ensure it only runs on one of the specified cores */
+    rtos_osal_thread_core_exclusion_set(&ctx->hil_thread, ~io_core_mask);
+}
+
+int rtos_l2_cache_pin(
+    rtos_l2_cache_t* ctx,
+    const void* start,
+    size_t size)
+{
+    const unsigned line_size = ctx->config.line_size;
+    unsigned offset;
+    unsigned end;
+
+    xassert(ctx->line_state != NULL);
+    xassert(!ctx->started);
+    xassert((uintptr_t) start >= XS1_SWMEM_BASE);
+
+    offset = ((uintptr_t) start - XS1_SWMEM_BASE) & ~(line_size - 1);
+    end = (uintptr_t) start - XS1_SWMEM_BASE + size;
+
+    for (; offset < end; offset += line_size) {
+        const unsigned first = ((offset >> ctx->set_shift) & ctx->set_mask) * ctx->config.ways;
+        const unsigned last = first + ctx->config.ways;
+        unsigned line;
+
+        /* The line may already be pinned by an earlier overlapping range */
+        for (line = first; line < last; line++) {
+            uint32_t tag = LINE_TAG(ctx, line);
+            if ((tag & LINE_PINNED) && (tag & ~LINE_FLAGS) == offset) {
+                break;
+            }
+        }
+        if (line < last) {
+            continue;
+        }
+
+        for (line = first; line < last; line++) {
+            if (!(LINE_TAG(ctx, line) & LINE_PINNED)) {
+                LINE_TAG(ctx, line) = offset | LINE_PINNED;
+                break;
+            }
+        }
+        if (line == last) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void rtos_l2_cache_stats_get(
+    rtos_l2_cache_t* ctx,
+    rtos_l2_cache_stats_t* stats)
+{
+    stats->hit_count = ctx->stats.hit_count;
+    stats->miss_count = ctx->stats.miss_count;
+    stats->eviction_count = ctx->stats.eviction_count;
+    stats->uncached_count = ctx->stats.uncached_count;
+    stats->miss_ticks = ctx->stats.miss_ticks;
+}
+
+void rtos_l2_cache_stats_reset(rtos_l2_cache_t* ctx)
+{
+    ctx->stats.hit_count = 0;
+    ctx->stats.miss_count = 0;
+    ctx->stats.eviction_count = 0;
+    ctx->stats.uncached_count = 0;
+    ctx->stats.miss_ticks = 0;
+}
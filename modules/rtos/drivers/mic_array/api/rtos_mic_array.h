@@ -18,6 +18,7 @@
 
 #include "rtos/osal/api/rtos_osal.h"
 #include "rtos/drivers/rpc/api/rtos_driver_rpc.h"
+#include "rtos/drivers/rpc/api/rtos_driver_stream.h"
 
 /**
  * The number of microphones in the mic array.
@@ -32,6 +33,14 @@
  */
 typedef struct rtos_mic_array_struct rtos_mic_array_t;
 
+/**
+ * Statistics kept by the mic array driver on the tile that owns it.
+ */
+typedef struct {
+    uint32_t overrun_count;  /**< Frames dropped by the driver because the input buffer was full */
+    uint32_t underrun_count; /**< Receives that timed out before the requested frames arrived */
+} rtos_mic_array_stats_t;
+
 /**
  * Struct representing an RTOS mic array driver instance.
  *
@@ -39,6 +48,7 @@ typedef struct rtos_mic_array_struct rtos_mic_array_t;
  */
 struct rtos_mic_array_struct {
     rtos_driver_rpc_t *rpc_config;
+    rtos_driver_stream_t *stream;
 
     __attribute__((fptrgroup("rtos_mic_array_rx_fptr_grp")))
     size_t (*rx)(rtos_mic_array_t *, int32_t sample_buf[][MIC_DUAL_NUM_CHANNELS + MIC_DUAL_NUM_REF_CHANNELS], size_t, unsigned);
@@ -56,6 +66,9 @@ struct rtos_mic_array_struct {
     rtos_osal_thread_t hil_thread;
     rtos_osal_semaphore_t recv_sem;
     int recv_blocked;
+    size_t recv_watermark;
+    volatile uint32_t overrun_count;
+    uint32_t underrun_count;
     struct {
         int32_t *buf;
         size_t buf_size;
@@ -104,6 +117,79 @@ inline size_t rtos_mic_array_rx(
 
 /**@}*/
 
+/**
+ * \addtogroup rtos_mic_array_driver_local rtos_mic_array_driver_local
+ *
+ * Functions for receiving frames directly out of the input buffer of an
+ * RTOS mic array driver instance, without copying them. These may only be
+ * called on the tile that owns the driver instance, after it has been
+ * started, and by the same single thread that calls rtos_mic_array_rx().
+ * @{
+ */
+
+/**
+ * Waits for frames to arrive in the input buffer and returns a pointer
+ * directly to the oldest of them. The frames remain in the buffer, and
+ * the same frames are returned by the next call, until they are released
+ * with rtos_mic_array_rx_release().
+ *
+ * This waits until at least the number of frames set by
+ * rtos_mic_array_rx_watermark_set() are available. Only the frames that
+ * are contiguous in the buffer are returned, so fewer than this may be
+ * returned when the buffer wraps. The remainder are returned by the next
+ * call once these have been released.
+ *
+ * \param ctx            A pointer to the mic array driver instance to use.
+ * \param sample_buf     Set to point to the first available frame.
+ * \param timeout        The amount of time to wait for the frames to arrive.
+ *
+ * \returns              The number of frames at \p sample_buf, or 0 if the
+ *                       frames did not arrive in time.
+ */
+size_t rtos_mic_array_rx_acquire(
+        rtos_mic_array_t *ctx,
+        int32_t (**sample_buf)[MIC_DUAL_NUM_CHANNELS + MIC_DUAL_NUM_REF_CHANNELS],
+        unsigned timeout);
+
+/**
+ * Releases frames returned by rtos_mic_array_rx_acquire(), freeing their
+ * space in the input buffer for the driver to write new frames into.
+ *
+ * \param ctx            A pointer to the mic array driver instance to use.
+ * \param frame_count    The number of frames to release. This may be fewer
+ *                       than were acquired, in which case the rest are
+ *                       returned again by the next acquire.
+ */
+void rtos_mic_array_rx_release(
+        rtos_mic_array_t *ctx,
+        size_t frame_count);
+
+/**
+ * Sets the number of frames that must be available in the input buffer
+ * before rtos_mic_array_rx_acquire() returns. This defaults to
+ * MIC_DUAL_FRAME_SIZE, the number of frames the decimator outputs at once.
+ *
+ * \param ctx            A pointer to the mic array driver instance to use.
+ * \param frame_count    The watermark in frames. This must be at least one.
+ *                       A watermark larger than the input buffer is treated
+ *                       as its size.
+ */
+void rtos_mic_array_rx_watermark_set(
+        rtos_mic_array_t *ctx,
+        size_t frame_count);
+
+/**
+ * Gets the overrun and underrun counts of a mic array driver instance.
+ *
+ * \param ctx            A pointer to the mic array driver instance to use.
+ * \param stats          The statistics are written here.
+ */
+void rtos_mic_array_stats_get(
+        rtos_mic_array_t *ctx,
+        rtos_mic_array_stats_t *stats);
+
+/**@}*/
+
 /**
  * Helper function to determine the mic array decimator's third stage coefficients
  * given the decimation factor.
@@ -197,7 +283,8 @@ inline int rtos_mic_array_decimation_factor(
  * \param buffer_size           The size in frames of the input buffer. Each frame is two samples
  *                              (one for each microphone) plus one sample per reference channel.
  *                              This must be at least MIC_DUAL_FRAME_SIZE. Samples are pulled out
- *                              of this buffer by the application by calling rtos_mic_array_rx().
+ *                              of this buffer by the application by calling rtos_mic_array_rx()
+ *                              or rtos_mic_array_rx_acquire().
  * \param interrupt_core_id     The ID of the core on which to enable the mic array interrupt.
  */
 void rtos_mic_array_start(
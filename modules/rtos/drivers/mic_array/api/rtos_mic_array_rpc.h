@@ -82,6 +82,63 @@ void rtos_mic_array_rpc_config(
         unsigned intertile_port,
         unsigned host_task_priority);
 
+/**
+ * Sets up a stream that pushes frames from a mic array driver instance on the
+ * host tile to a client tile, instead of the client requesting each read over
+ * RPC. This must be called by both the host tile and the client tile, after
+ * rtos_mic_array_rpc_config(), and on the host before rtos_mic_array_start().
+ *
+ * On the host, a thread reads \p block_frames frames at a time from the mic
+ * array and sends each block to the client, where it is received directly
+ * into a ring of \p block_count blocks. The client then reads from the ring
+ * with rtos_mic_array_rx(), with no round trip to the host. The client returns
+ * credits to the host as it empties blocks, and blocks that the host reads
+ * while the client's ring is full are dropped and counted. These are
+ * reported by rtos_mic_array_rpc_stream_stats_get().
+ *
+ * \note Only one client may be streamed to, which is the first client tile
+ * given to rtos_mic_array_rpc_host_init(). Once streaming, the host's stream
+ * thread is the only reader of the mic array on the host, so nothing else
+ * on the host may call rtos_mic_array_rx(), and other clients must not use RPC
+ * to read from it.
+ *
+ * \param mic_array_ctx  A pointer to the mic array driver instance to stream.
+ * \param stream         A pointer to a stream struct. This must have the same
+ *                       scope as \p mic_array_ctx.
+ * \param intertile_port The port number on the intertile channel to use for the
+ *                       stream. This must be different from the RPC port, must
+ *                       not be shared by any other functions, and must be the
+ *                       same on the host and the client.
+ * \param block_frames   The number of frames in each block sent by the host.
+ *                       This must be the same on the host and the client.
+ * \param block_count    The number of blocks in the client's ring. At least 2.
+ *                       Reads on the client may be up to one block less than the
+ *                       ring holds. Ignored by the host.
+ * \param task_priority  The priority of the stream's threads.
+ */
+void rtos_mic_array_rpc_stream_config(
+        rtos_mic_array_t *mic_array_ctx,
+        rtos_driver_stream_t *stream,
+        unsigned intertile_port,
+        size_t block_frames,
+        size_t block_count,
+        unsigned task_priority);
+
+/**
+ * Gets the statistics of a mic array stream on a client tile. A non-zero
+ * overrun count shows that the client is not reading frames as fast as
+ * the mic array produces them.
+ *
+ * \param mic_array_ctx A pointer to the mic array driver instance on the client.
+ * \param stats         The statistics are written here.
+ */
+inline void rtos_mic_array_rpc_stream_stats_get(
+        rtos_mic_array_t *mic_array_ctx,
+        rtos_driver_stream_stats_t *stats)
+{
+    rtos_driver_stream_stats_get(mic_array_ctx->stream, stats);
+}
+
 /**@}*/
 /**@}*/
 
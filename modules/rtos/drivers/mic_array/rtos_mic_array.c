@@ -14,6 +14,8 @@
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
+#define MIC_FRAME_WORDS (MIC_DUAL_NUM_CHANNELS + MIC_DUAL_NUM_REF_CHANNELS)
+
 static void mic_array_thread(rtos_mic_array_t *ctx)
 {
 #if MIC_DUAL_NUM_REF_CHANNELS > 0
@@ -40,7 +42,7 @@ static void mic_array_thread(rtos_mic_array_t *ctx)
 DEFINE_RTOS_INTERRUPT_CALLBACK(rtos_mic_array_isr, arg)
 {
     rtos_mic_array_t *ctx = arg;
-    size_t words_remaining = MIC_DUAL_FRAME_SIZE * (MIC_DUAL_NUM_CHANNELS + MIC_DUAL_NUM_REF_CHANNELS);
+    size_t words_remaining = MIC_DUAL_FRAME_SIZE * MIC_FRAME_WORDS;
     size_t words_available = ctx->recv_buffer.total_written - ctx->recv_buffer.total_read;
     size_t words_free = ctx->recv_buffer.buf_size - words_available;
     int32_t *mic_sample_block = (int32_t *) s_chan_in_word(ctx->c_2x_pdm_mic.end_b);
@@ -60,9 +62,9 @@ DEFINE_RTOS_INTERRUPT_CALLBACK(rtos_mic_array_isr, arg)
         }
 
         RTOS_MEMORY_BARRIER();
-        ctx->recv_buffer.total_written += MIC_DUAL_FRAME_SIZE * (MIC_DUAL_NUM_CHANNELS + MIC_DUAL_NUM_REF_CHANNELS);
+        ctx->recv_buffer.total_written += MIC_DUAL_FRAME_SIZE * MIC_FRAME_WORDS;
     } else {
-        rtos_printf("mic rx overrun\n");
+        ctx->overrun_count += MIC_DUAL_FRAME_SIZE;
     }
 
     if (ctx->recv_buffer.required_available_count > 0) {
@@ -75,26 +77,19 @@ DEFINE_RTOS_INTERRUPT_CALLBACK(rtos_mic_array_isr, arg)
     }
 }
 
-__attribute__((fptrgroup("rtos_mic_array_rx_fptr_grp")))
-static size_t mic_array_local_rx(
+/*
+ * Waits until at least the given number of words are available in the
+ * receive buffer. Returns non-zero if they are.
+ */
+static int mic_array_recv_wait(
         rtos_mic_array_t *ctx,
-        int32_t sample_buf[][MIC_DUAL_NUM_CHANNELS + MIC_DUAL_NUM_REF_CHANNELS],
-        size_t frame_count,
+        size_t words,
         unsigned timeout)
 {
-    size_t frames_recvd = 0;
-    size_t words_remaining = frame_count * (MIC_DUAL_NUM_CHANNELS + MIC_DUAL_NUM_REF_CHANNELS);
-    int32_t *sample_buf_ptr = (int32_t *) sample_buf;
-
-    xassert(words_remaining <= ctx->recv_buffer.buf_size);
-    if (words_remaining > ctx->recv_buffer.buf_size) {
-        return frames_recvd;
-    }
-
     if (!ctx->recv_blocked) {
         size_t words_available = ctx->recv_buffer.total_written - ctx->recv_buffer.total_read;
-        if (words_remaining > words_available) {
-            ctx->recv_buffer.required_available_count = words_remaining;
+        if (words > words_available) {
+            ctx->recv_buffer.required_available_count = words;
             ctx->recv_blocked = 1;
         }
     }
@@ -102,10 +97,31 @@ static size_t mic_array_local_rx(
     if (ctx->recv_blocked) {
         if (rtos_osal_semaphore_get(&ctx->recv_sem, timeout) == RTOS_OSAL_SUCCESS) {
             ctx->recv_blocked = 0;
+        } else {
+            ctx->underrun_count++;
         }
     }
 
-    if (!ctx->recv_blocked) {
+    return !ctx->recv_blocked;
+}
+
+__attribute__((fptrgroup("rtos_mic_array_rx_fptr_grp")))
+static size_t mic_array_local_rx(
+        rtos_mic_array_t *ctx,
+        int32_t sample_buf[][MIC_DUAL_NUM_CHANNELS + MIC_DUAL_NUM_REF_CHANNELS],
+        size_t frame_count,
+        unsigned timeout)
+{
+    size_t frames_recvd = 0;
+    size_t words_remaining = frame_count * MIC_FRAME_WORDS;
+    int32_t *sample_buf_ptr = (int32_t *) sample_buf;
+
+    xassert(words_remaining <= ctx->recv_buffer.buf_size);
+    if (words_remaining > ctx->recv_buffer.buf_size) {
+        return frames_recvd;
+    }
+
+    if (mic_array_recv_wait(ctx, words_remaining, timeout)) {
         while (words_remaining) {
             size_t words_to_copy = MIN(words_remaining, ctx->recv_buffer.buf_size - ctx->recv_buffer.read_index);
             memcpy(sample_buf_ptr, &ctx->recv_buffer.buf[ctx->recv_buffer.read_index], words_to_copy * sizeof(int32_t));
@@ -120,7 +136,7 @@ static size_t mic_array_local_rx(
         }
 
         RTOS_MEMORY_BARRIER();
-        ctx->recv_buffer.total_read += frame_count * (MIC_DUAL_NUM_CHANNELS + MIC_DUAL_NUM_REF_CHANNELS);
+        ctx->recv_buffer.total_read += frame_count * MIC_FRAME_WORDS;
 
         frames_recvd = frame_count;
     }
@@ -128,6 +144,67 @@ static size_t mic_array_local_rx(
     return frames_recvd;
 }
 
+size_t rtos_mic_array_rx_acquire(
+        rtos_mic_array_t *ctx,
+        int32_t (**sample_buf)[MIC_DUAL_NUM_CHANNELS + MIC_DUAL_NUM_REF_CHANNELS],
+        unsigned timeout)
+{
+    size_t words_available;
+    size_t words_contiguous;
+
+    if (!mic_array_recv_wait(ctx, MIN(ctx->recv_watermark * MIC_FRAME_WORDS, ctx->recv_buffer.buf_size), timeout)) {
+        return 0;
+    }
+
+    RTOS_MEMORY_BARRIER();
+
+    /*
+     * The buffer holds a whole number of frames, so a frame never
+     * straddles its end.
+     */
+    words_available = ctx->recv_buffer.total_written - ctx->recv_buffer.total_read;
+    words_contiguous = MIN(words_available, ctx->recv_buffer.buf_size - ctx->recv_buffer.read_index);
+
+    *sample_buf = (void *) &ctx->recv_buffer.buf[ctx->recv_buffer.read_index];
+
+    return words_contiguous / MIC_FRAME_WORDS;
+}
+
+void rtos_mic_array_rx_release(
+        rtos_mic_array_t *ctx,
+        size_t frame_count)
+{
+    size_t words = frame_count * MIC_FRAME_WORDS;
+
+    xassert(words <= ctx->recv_buffer.total_written - ctx->recv_buffer.total_read);
+    xassert(words <= ctx->recv_buffer.buf_size - ctx->recv_buffer.read_index);
+
+    ctx->recv_buffer.read_index += words;
+    if (ctx->recv_buffer.read_index >= ctx->recv_buffer.buf_size) {
+        ctx->recv_buffer.read_index = 0;
+    }
+
+    /* The frames must be finished with before the ISR may overwrite them */
+    RTOS_MEMORY_BARRIER();
+    ctx->recv_buffer.total_read += words;
+}
+
+void rtos_mic_array_rx_watermark_set(
+        rtos_mic_array_t *ctx,
+        size_t frame_count)
+{
+    xassert(frame_count > 0);
+    ctx->recv_watermark = frame_count;
+}
+
+void rtos_mic_array_stats_get(
+        rtos_mic_array_t *ctx,
+        rtos_mic_array_stats_t *stats)
+{
+    stats->overrun_count = ctx->overrun_count;
+    stats->underrun_count = ctx->underrun_count;
+}
+
 void rtos_mic_array_start(
         rtos_mic_array_t *mic_array_ctx,
         int decimation_factor,
@@ -140,7 +217,7 @@ void rtos_mic_array_start(
 
     xassert(buffer_size >= MIC_DUAL_FRAME_SIZE);
     memset(&mic_array_ctx->recv_buffer, 0, sizeof(mic_array_ctx->recv_buffer));
-    mic_array_ctx->recv_buffer.buf_size = buffer_size * (MIC_DUAL_NUM_CHANNELS + MIC_DUAL_NUM_REF_CHANNELS);
+    mic_array_ctx->recv_buffer.buf_size = buffer_size * MIC_FRAME_WORDS;
     mic_array_ctx->recv_buffer.buf = rtos_osal_malloc(mic_array_ctx->recv_buffer.buf_size * sizeof(int32_t));
     rtos_osal_semaphore_create(&mic_array_ctx->recv_sem, "mic_recv_sem", 1, 0);
 
@@ -163,6 +240,10 @@ void rtos_mic_array_start(
     if (mic_array_ctx->rpc_config != NULL && mic_array_ctx->rpc_config->rpc_host_start != NULL) {
         mic_array_ctx->rpc_config->rpc_host_start(mic_array_ctx->rpc_config);
     }
+
+    if (mic_array_ctx->stream != NULL) {
+        rtos_driver_stream_host_start(mic_array_ctx->stream);
+    }
 }
 
 static void mic_array_setup_sdr(
@@ -256,7 +337,11 @@ void rtos_mic_array_init(
     }
 
     mic_array_ctx->rpc_config = NULL;
+    mic_array_ctx->stream = NULL;
     mic_array_ctx->rx = mic_array_local_rx;
+    mic_array_ctx->recv_watermark = MIC_DUAL_FRAME_SIZE;
+    mic_array_ctx->overrun_count = 0;
+    mic_array_ctx->underrun_count = 0;
 
     triggerable_setup_interrupt_callback(mic_array_ctx->c_2x_pdm_mic.end_b, mic_array_ctx, RTOS_INTERRUPT_CALLBACK(rtos_mic_array_isr));
 
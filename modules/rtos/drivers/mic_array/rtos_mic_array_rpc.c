@@ -34,6 +34,29 @@ static size_t mic_array_remote_rx(
     return ret;
 }
 
+__attribute__((fptrgroup("rtos_mic_array_rx_fptr_grp")))
+static size_t mic_array_stream_rx(
+        rtos_mic_array_t *mic_array_ctx,
+        int32_t sample_buf[][MIC_DUAL_NUM_CHANNELS + MIC_DUAL_NUM_REF_CHANNELS],
+        size_t frame_count,
+        unsigned timeout)
+{
+    return rtos_driver_stream_rx(mic_array_ctx->stream, &sample_buf[0][0], frame_count, timeout);
+}
+
+__attribute__((fptrgroup("rtos_driver_stream_source_fptr_grp")))
+static size_t mic_array_stream_source(
+        void *driver_ctx,
+        int32_t *buf,
+        size_t frame_count)
+{
+    return rtos_mic_array_rx(
+            driver_ctx,
+            (int32_t (*)[MIC_DUAL_NUM_CHANNELS + MIC_DUAL_NUM_REF_CHANNELS]) buf,
+            frame_count,
+            RTOS_OSAL_WAIT_FOREVER);
+}
+
 static int mic_array_rx_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
 {
     int msg_length;
@@ -136,12 +159,47 @@ void rtos_mic_array_rpc_config(
     }
 }
 
+void rtos_mic_array_rpc_stream_config(
+        rtos_mic_array_t *mic_array_ctx,
+        rtos_driver_stream_t *stream,
+        unsigned intertile_port,
+        size_t block_frames,
+        size_t block_count,
+        unsigned task_priority)
+{
+    rtos_driver_rpc_t *rpc_config = mic_array_ctx->rpc_config;
+    rtos_intertile_address_t address;
+
+    if (rpc_config->remote_client_count == 0) {
+        /* This is a client */
+        address.intertile_ctx = rpc_config->host_address.intertile_ctx;
+        address.port = intertile_port;
+        rtos_driver_stream_client_init(
+                stream, &address,
+                MIC_DUAL_NUM_CHANNELS + MIC_DUAL_NUM_REF_CHANNELS,
+                block_frames, block_count, task_priority);
+        mic_array_ctx->rx = mic_array_stream_rx;
+    } else {
+        /* The stream goes to the first client */
+        address.intertile_ctx = rpc_config->client_address[0].intertile_ctx;
+        address.port = intertile_port;
+        rtos_driver_stream_host_init(
+                stream, &address,
+                mic_array_stream_source, mic_array_ctx,
+                MIC_DUAL_NUM_CHANNELS + MIC_DUAL_NUM_REF_CHANNELS,
+                block_frames, task_priority);
+    }
+
+    mic_array_ctx->stream = stream;
+}
+
 void rtos_mic_array_rpc_client_init(
         rtos_mic_array_t *mic_array_ctx,
         rtos_driver_rpc_t *rpc_config,
         rtos_intertile_t *host_intertile_ctx)
 {
     mic_array_ctx->rpc_config = rpc_config;
+    mic_array_ctx->stream = NULL;
     mic_array_ctx->rx = mic_array_remote_rx;
     rpc_config->rpc_host_start = NULL;
     rpc_config->remote_client_count = 0;
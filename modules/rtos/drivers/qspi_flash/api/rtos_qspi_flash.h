@@ -16,13 +16,68 @@
 #include "rtos/osal/api/rtos_osal.h"
 #include "rtos/drivers/rpc/api/rtos_driver_rpc.h"
 
+/**
+ * The maximum number of bytes read from the flash by the driver thread with
+ * interrupts masked. Larger reads are split into chunks of this size. At the
+ * default size interrupts may be masked for around a millisecond, so
+ * applications with latency sensitive ISRs, such as audio, may reduce it.
+ */
+#ifndef RTOS_QSPI_FLASH_READ_CHUNK_SIZE
 #define RTOS_QSPI_FLASH_READ_CHUNK_SIZE (24*1024)
+#endif
+
+/**
+ * The number of operations that may be queued for the driver thread.
+ */
+#ifndef RTOS_QSPI_FLASH_OP_QUEUE_LENGTH
+#define RTOS_QSPI_FLASH_OP_QUEUE_LENGTH 8
+#endif
+
+/**
+ * The maximum number of queued read requests that are coalesced into a
+ * single flash transaction.
+ */
+#ifndef RTOS_QSPI_FLASH_READ_COALESCE_MAX
+#define RTOS_QSPI_FLASH_READ_COALESCE_MAX 8
+#endif
 
 /**
  * Typedef to the RTOS QSPI flash driver instance struct.
  */
 typedef struct rtos_qspi_flash_struct rtos_qspi_flash_t;
 
+/**
+ * Typedef to the asynchronous read request struct.
+ */
+typedef struct rtos_qspi_flash_read_req_struct rtos_qspi_flash_read_req_t;
+
+/**
+ * Function pointer type for read request completion callbacks. These are
+ * called by the driver thread once the data has been read.
+ *
+ * \param req The request that has completed.
+ * \param arg The callback argument set in the request.
+ */
+typedef void (*rtos_qspi_flash_read_cb_t)(rtos_qspi_flash_read_req_t *req, void *arg);
+
+/**
+ * Struct representing an asynchronous read request. This is owned by the
+ * application and must remain valid until the request has completed.
+ */
+struct rtos_qspi_flash_read_req_struct {
+    uint8_t *data;           /**< The buffer to save the read data to */
+    unsigned address;        /**< The byte address in the flash to begin reading at */
+    size_t len;              /**< The number of bytes to read */
+
+    /** Called from the driver thread on completion. May be NULL. */
+    __attribute__((fptrgroup("rtos_qspi_flash_read_cb_fptr_grp")))
+    rtos_qspi_flash_read_cb_t callback;
+    void *callback_arg;      /**< The argument passed to \p callback */
+
+    /** Put on completion, after the callback returns. May be NULL. */
+    rtos_osal_semaphore_t *done;
+};
+
 /**
  * Struct representing an RTOS QSPI flash driver instance.
  *
@@ -49,6 +104,9 @@ struct rtos_qspi_flash_struct {
     qspi_flash_ctx_t ctx;
     size_t flash_size;
 
+    unsigned read_request_count;
+    unsigned read_transaction_count;
+
     unsigned op_task_priority;
     rtos_osal_thread_t op_task;
     rtos_osal_queue_t op_queue;
@@ -125,6 +183,42 @@ inline void rtos_qspi_flash_read(
     ctx->read(ctx, data, address, len);
 }
 
+/**
+ * Queues a read from the flash and returns without waiting for it. The
+ * request's callback is called and its semaphore is put, if they are set,
+ * from the driver thread once the data is in the buffer.
+ *
+ * Requests are performed in the order they are queued, along with any
+ * writes and erases. Consecutive requests for adjacent flash addresses into
+ * adjacent memory are coalesced into a single flash transaction, so a large
+ * read may be queued as several smaller requests that each complete, and
+ * may be used, as soon as possible.
+ *
+ * \note This may only be called on the tile that owns the driver instance.
+ *
+ * \param ctx A pointer to the QSPI flash driver instance to use.
+ * \param req The read request. This must not be modified until it completes.
+ */
+void rtos_qspi_flash_read_async(
+        rtos_qspi_flash_t *ctx,
+        rtos_qspi_flash_read_req_t *req);
+
+/**
+ * Gets the number of read requests completed by the driver thread, and the
+ * number of flash transactions used to perform them. The difference between
+ * the two is the number of requests that were coalesced.
+ *
+ * \note This may only be called on the tile that owns the driver instance.
+ *
+ * \param ctx               A pointer to the QSPI flash driver instance to query.
+ * \param request_count     The number of read requests is written here.
+ * \param transaction_count The number of flash transactions is written here.
+ */
+void rtos_qspi_flash_read_stats_get(
+        rtos_qspi_flash_t *ctx,
+        unsigned *request_count,
+        unsigned *transaction_count);
+
 /**
  * This is a lower level version of rtos_qspi_flash_read() that is safe
  * to call from within ISRs. If a task currently own the flash lock, or
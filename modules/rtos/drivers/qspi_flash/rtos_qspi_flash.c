@@ -293,19 +293,88 @@ typedef struct {
     uint8_t *data;
     unsigned address;
     size_t len;
+    rtos_qspi_flash_read_req_t *req;
     unsigned priority;
 } qspi_flash_op_req_t;
 
+static void read_complete(rtos_qspi_flash_read_req_t *req)
+{
+    /* The request may be reused by the application as soon as it is complete */
+    rtos_osal_semaphore_t *done = req->done;
+
+    if (req->callback != NULL) {
+        __attribute__((fptrgroup("rtos_qspi_flash_read_cb_fptr_grp")))
+        rtos_qspi_flash_read_cb_t callback = req->callback;
+        callback(req, req->callback_arg);
+    }
+    if (done != NULL) {
+        rtos_osal_semaphore_put(done);
+    }
+}
+
+/*
+ * Performs the read request in op, along with any read requests queued
+ * immediately after it that continue it in both the flash and in memory.
+ * If a request that cannot be coalesced is dequeued then it is left in
+ * op and true is returned, so that it is performed next.
+ */
+static bool read_coalesced_op(
+        rtos_qspi_flash_t *ctx,
+        qspi_flash_op_req_t *op)
+{
+    rtos_qspi_flash_read_req_t *reqs[RTOS_QSPI_FLASH_READ_COALESCE_MAX];
+    rtos_qspi_flash_read_req_t *req = op->req;
+    uint8_t *data = req->data;
+    unsigned address = req->address;
+    size_t len = req->len;
+    unsigned priority = op->priority;
+    int count = 1;
+    bool op_pending = false;
+
+    reqs[0] = req;
+
+    while (count < RTOS_QSPI_FLASH_READ_COALESCE_MAX &&
+           rtos_osal_queue_receive(&ctx->op_queue, op, RTOS_OSAL_NO_WAIT) == RTOS_OSAL_SUCCESS) {
+        req = op->req;
+        if (op->op != FLASH_OP_READ || req->address != address + len || req->data != data + len) {
+            op_pending = true;
+            break;
+        }
+
+        reqs[count++] = req;
+        len += req->len;
+        if (op->priority > priority) {
+            priority = op->priority;
+            rtos_osal_thread_priority_set(&ctx->op_task, priority);
+        }
+    }
+
+    read_op(ctx, data, address, len);
+
+    ctx->read_request_count += count;
+    ctx->read_transaction_count++;
+
+    for (int i = 0; i < count; i++) {
+        read_complete(reqs[i]);
+    }
+
+    return op_pending;
+}
+
 static void qspi_flash_op_thread(rtos_qspi_flash_t *ctx)
 {
     qspi_flash_op_req_t op;
+    bool op_pending = false;
     bool quad_enabled;
 
     quad_enabled = qspi_flash_quad_enable_write(&ctx->ctx, true);
     xassert(quad_enabled && "QE bit could not be set\n");
 
     for (;;) {
-        rtos_osal_queue_receive(&ctx->op_queue, &op, RTOS_OSAL_WAIT_FOREVER);
+        if (!op_pending) {
+            rtos_osal_queue_receive(&ctx->op_queue, &op, RTOS_OSAL_WAIT_FOREVER);
+        }
+        op_pending = false;
 
         /*
          * Inherit the priority of the task that requested this
@@ -315,8 +384,7 @@ static void qspi_flash_op_thread(rtos_qspi_flash_t *ctx)
 
         switch (op.op) {
         case FLASH_OP_READ:
-            read_op(ctx, op.data, op.address, op.len);
-            rtos_osal_semaphore_put(&ctx->data_ready);
+            op_pending = read_coalesced_op(ctx, &op);
             break;
         case FLASH_OP_WRITE:
             write_op(ctx, op.data, op.address, op.len);
@@ -393,16 +461,49 @@ static void qspi_flash_local_read(
         unsigned address,
         size_t len)
 {
-    qspi_flash_op_req_t op = {
-            .op = FLASH_OP_READ,
+    rtos_qspi_flash_read_req_t req = {
             .data = data,
             .address = address,
-            .len = len
+            .len = len,
+            .callback = NULL,
+            .done = &ctx->data_ready
+    };
+    qspi_flash_op_req_t op = {
+            .op = FLASH_OP_READ,
+            .req = &req
     };
 
+    /*
+     * Hold the mutex until the read completes so that data_ready
+     * can only be put for this request.
+     */
+    rtos_osal_mutex_get(&ctx->mutex, RTOS_OSAL_WAIT_FOREVER);
     request(ctx, &op);
-
     rtos_osal_semaphore_get(&ctx->data_ready, RTOS_OSAL_WAIT_FOREVER);
+    rtos_osal_mutex_put(&ctx->mutex);
+}
+
+void rtos_qspi_flash_read_async(
+        rtos_qspi_flash_t *ctx,
+        rtos_qspi_flash_read_req_t *req)
+{
+    qspi_flash_op_req_t op = {
+            .op = FLASH_OP_READ,
+            .req = req
+    };
+
+    xassert(ctx->read == qspi_flash_local_read);
+
+    request(ctx, &op);
+}
+
+void rtos_qspi_flash_read_stats_get(
+        rtos_qspi_flash_t *ctx,
+        unsigned *request_count,
+        unsigned *transaction_count)
+{
+    *request_count = ctx->read_request_count;
+    *transaction_count = ctx->read_transaction_count;
 }
 
 __attribute__((fptrgroup("rtos_qspi_flash_write_fptr_grp")))
@@ -444,7 +545,7 @@ void rtos_qspi_flash_start(
         unsigned priority)
 {
     rtos_osal_mutex_create(&ctx->mutex, "qspi_lock", RTOS_OSAL_RECURSIVE);
-    rtos_osal_queue_create(&ctx->op_queue, "qspi_req_queue", 2, sizeof(qspi_flash_op_req_t));
+    rtos_osal_queue_create(&ctx->op_queue, "qspi_req_queue", RTOS_QSPI_FLASH_OP_QUEUE_LENGTH, sizeof(qspi_flash_op_req_t));
     rtos_osal_semaphore_create(&ctx->data_ready, "qspi_dr_sem", 1, 0);
 
     ctx->op_task_priority = priority;
@@ -506,6 +607,9 @@ void rtos_qspi_flash_init(
     /* Verify that the page size is a power of two */
     xassert((qspi_flash_ctx->page_size_bytes != 0) && ((qspi_flash_ctx->page_size_bytes & (qspi_flash_ctx->page_size_bytes - 1)) == 0));
 
+    ctx->read_request_count = 0;
+    ctx->read_transaction_count = 0;
+
     ctx->rpc_config = NULL;
     ctx->read = qspi_flash_local_read;
     ctx->write = qspi_flash_local_write;
@@ -153,10 +153,8 @@ static void qspi_flash_remote_erase(
     rtos_osal_mutex_put(&ctx->mutex);
 }
 
-static int qspi_flash_lock_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void qspi_flash_lock_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_qspi_flash_t *ctx;
 
     rpc_request_unmarshall(
@@ -165,17 +163,13 @@ static int qspi_flash_lock_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
 
     rtos_qspi_flash_lock(ctx);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             ctx);
-
-    return msg_length;
 }
 
-static int qspi_flash_unlock_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void qspi_flash_unlock_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_qspi_flash_t *ctx;
 
     rpc_request_unmarshall(
@@ -184,17 +178,13 @@ static int qspi_flash_unlock_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
 
     rtos_qspi_flash_unlock(ctx);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             ctx);
-
-    return msg_length;
 }
 
-static int qspi_flash_read_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void qspi_flash_read_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_qspi_flash_t *ctx;
     uint8_t *data;
     unsigned address;
@@ -212,21 +202,17 @@ static int qspi_flash_read_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
 
     rtos_qspi_flash_read(ctx, data, address, len);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             ctx, data, address, len);
 
     if (len > 0) {
         rtos_osal_free(data);
     }
-
-    return msg_length;
 }
 
-static int qspi_flash_write_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void qspi_flash_write_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_qspi_flash_t *ctx;
     uint8_t *data;
     unsigned address;
@@ -238,17 +224,13 @@ static int qspi_flash_write_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
 
     rtos_qspi_flash_write(ctx, data, address, len);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             ctx, data, address, len);
-
-    return msg_length;
 }
 
-static int qspi_flash_erase_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void qspi_flash_erase_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_qspi_flash_t *ctx;
     unsigned address;
     size_t len;
@@ -259,51 +241,44 @@ static int qspi_flash_erase_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
 
     rtos_qspi_flash_erase(ctx, address, len);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             ctx, address, len);
-
-    return msg_length;
 }
 
 static void qspi_flash_rpc_thread(rtos_intertile_address_t *client_address)
 {
-    int msg_length;
     uint8_t *req_msg;
-    uint8_t *resp_msg;
     rpc_msg_t rpc_msg;
     rtos_intertile_t *intertile_ctx = client_address->intertile_ctx;
     uint8_t intertile_port = client_address->port;
 
     for (;;) {
         /* receive RPC request message from client */
-        msg_length = rtos_intertile_rx(intertile_ctx, intertile_port, (void **) &req_msg, RTOS_OSAL_WAIT_FOREVER);
+        rtos_intertile_rx(intertile_ctx, intertile_port, (void **) &req_msg, RTOS_OSAL_WAIT_FOREVER);
 
         rpc_request_parse(&rpc_msg, req_msg);
 
         switch (rpc_msg.fcode) {
         case fcode_lock:
-            msg_length = qspi_flash_lock_rpc_host(&rpc_msg, &resp_msg);
+            qspi_flash_lock_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_unlock:
-            msg_length = qspi_flash_unlock_rpc_host(&rpc_msg, &resp_msg);
+            qspi_flash_unlock_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_read:
-            msg_length = qspi_flash_read_rpc_host(&rpc_msg, &resp_msg);
+            qspi_flash_read_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_write:
-            msg_length = qspi_flash_write_rpc_host(&rpc_msg, &resp_msg);
+            qspi_flash_write_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_erase:
-            msg_length = qspi_flash_erase_rpc_host(&rpc_msg, &resp_msg);
+            qspi_flash_erase_rpc_host(&rpc_msg, client_address);
             break;
         }
 
+        /* the RPC response message has been sent to the client */
         rtos_osal_free(req_msg);
-
-        /* send RPC response message to client */
-        rtos_intertile_tx(intertile_ctx, intertile_port, resp_msg, msg_length);
-        rtos_osal_free(resp_msg);
     }
 }
 
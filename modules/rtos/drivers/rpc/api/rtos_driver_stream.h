@@ -0,0 +1,162 @@
+// Copyright 2022 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef RTOS_DRIVER_STREAM_H_
+#define RTOS_DRIVER_STREAM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "rtos/osal/api/rtos_osal.h"
+#include "rtos_intertile.h"
+
+/**
+ * Typedef to the RTOS driver stream struct.
+ */
+typedef struct rtos_driver_stream_struct rtos_driver_stream_t;
+
+/**
+ * Function pointer type for the function that a stream host calls to
+ * read each block of samples from the driver it streams. It must block
+ * until \p frame_count frames have been written to \p buf.
+ */
+typedef size_t (*rtos_driver_stream_source_t)(void *driver_ctx, int32_t *buf, size_t frame_count);
+
+/**
+ * Statistics kept by the client of a driver stream.
+ */
+typedef struct {
+    uint32_t block_count;   /**< Blocks received from the host */
+    uint32_t overrun_count; /**< Blocks the host dropped because the client's ring was full */
+    uint32_t max_fill;      /**< The most blocks that have been waiting in the ring at once */
+} rtos_driver_stream_stats_t;
+
+/**
+ * Header sent by the host ahead of the samples in each block.
+ */
+typedef struct {
+    uint32_t sequence;      /* Blocks read by the host, including those it dropped */
+    uint32_t overrun_count; /* Blocks dropped by the host so far */
+} rtos_driver_stream_header_t;
+
+/**
+ * Struct representing an RTOS driver stream.
+ *
+ * A stream pushes blocks of samples read from a driver on its host tile
+ * to a ring of blocks on a client tile, over its own intertile port,
+ * without the client having to request each one. The client returns
+ * credits to the host as it frees blocks in its ring, and the host only
+ * sends a block when it holds a credit. Blocks read while it has none are
+ * dropped and counted, so that a client that falls behind never stalls
+ * the host or the intertile link.
+ *
+ * This struct is intended for use by the RTOS drivers to implement their
+ * streaming support. The members in this struct should not be accessed
+ * directly by applications.
+ */
+struct rtos_driver_stream_struct {
+    rtos_intertile_address_t address;
+    size_t frame_words;
+    size_t block_frames;
+    size_t block_bytes;         /* Header and samples */
+    size_t block_count;
+    int32_t *blocks;
+    unsigned priority;
+
+    /* Host */
+    __attribute__((fptrgroup("rtos_driver_stream_source_fptr_grp")))
+    rtos_driver_stream_source_t source;
+    void *driver_ctx;
+    volatile uint32_t credits;
+    volatile int started;
+
+    /* Client */
+    volatile uint32_t total_written;
+    volatile uint32_t total_read;
+    size_t read_frame;          /* Frames already read from the oldest block */
+    uint32_t credits_pending;
+    volatile size_t required_frames;
+    rtos_osal_semaphore_t recv_sem;
+    rtos_driver_stream_stats_t stats;
+};
+
+/**
+ * Initializes the host end of a stream. The host does not begin to read from
+ * the driver until rtos_driver_stream_host_start() is called.
+ *
+ * \param stream          A pointer to the stream to initialize.
+ * \param client_address  The intertile instance and port to stream over.
+ *                        The port must not be used for anything else.
+ * \param source          The function that reads each block from the driver.
+ * \param driver_ctx      The driver instance passed to \p source.
+ * \param frame_words     The number of words in each sample frame.
+ * \param block_frames    The number of frames in each block. This must be
+ *                        the same on the host and the client.
+ * \param priority        The priority of the host's threads.
+ */
+void rtos_driver_stream_host_init(
+        rtos_driver_stream_t *stream,
+        const rtos_intertile_address_t *client_address,
+        rtos_driver_stream_source_t source,
+        void *driver_ctx,
+        size_t frame_words,
+        size_t block_frames,
+        unsigned priority);
+
+/**
+ * Starts the host's threads. This is called by the driver when it is started.
+ *
+ * \param stream A pointer to the stream to start.
+ */
+void rtos_driver_stream_host_start(
+        rtos_driver_stream_t *stream);
+
+/**
+ * Initializes the client end of a stream, allocates its ring and starts the
+ * thread that receives blocks into it. The host begins to send blocks once
+ * both ends have been started.
+ *
+ * \param stream          A pointer to the stream to initialize.
+ * \param host_address    The intertile instance and port to stream over.
+ * \param frame_words     The number of words in each sample frame.
+ * \param block_frames    The number of frames in each block.
+ * \param block_count     The number of blocks in the ring.
+ * \param priority        The priority of the receive thread.
+ */
+void rtos_driver_stream_client_init(
+        rtos_driver_stream_t *stream,
+        const rtos_intertile_address_t *host_address,
+        size_t frame_words,
+        size_t block_frames,
+        size_t block_count,
+        unsigned priority);
+
+/**
+ * Reads frames from the ring of a stream client. Only one thread may read
+ * from a stream.
+ *
+ * \param stream      A pointer to the stream client.
+ * \param buf         The buffer to copy the frames into.
+ * \param frame_count The number of frames to read. This may not be more than
+ *                    the ring holds.
+ * \param timeout     The amount of time to wait for the frames to arrive.
+ *
+ * \returns \p frame_count, or 0 if the frames did not arrive in time.
+ */
+size_t rtos_driver_stream_rx(
+        rtos_driver_stream_t *stream,
+        int32_t *buf,
+        size_t frame_count,
+        unsigned timeout);
+
+/**
+ * Gets the statistics of a stream client.
+ *
+ * \param stream A pointer to the stream client.
+ * \param stats  The statistics are written here.
+ */
+void rtos_driver_stream_stats_get(
+        rtos_driver_stream_t *stream,
+        rtos_driver_stream_stats_t *stats);
+
+#endif /* RTOS_DRIVER_STREAM_H_ */
@@ -11,6 +11,7 @@
 #define RTOS_RPC_H_
 
 #include <stdint.h>
+#include <stdarg.h>
 
 #include "rtos_intertile.h"
 
@@ -200,6 +201,35 @@ int rpc_response_marshall_va(uint8_t **msg, const rpc_msg_t *rpc_msg, va_list ap
  */
 int rpc_response_marshall(uint8_t **msg, const rpc_msg_t *rpc_msg, ...);
 
+/**
+ * Sends an RPC response message with a function's return value and any output buffer data back to the remote
+ * caller. This is the same as rpc_response_marshall_va() followed by rtos_intertile_tx(), except that no response
+ * message is built. Each output argument is streamed directly from \p ap to the intertile link.
+ *
+ * \param[in] intertile_ctx An intertile driver instance that has already been initialized and started, and is connected
+ *                          to the tile that called the function.
+ * \param[in] port          The intertile port to send the response to.
+ * \param[in] rpc_msg       A pointer to an rpc_msg_t struct that has already been filled in by rpc_request_parse().
+ * \param[in] ap            The arguments that were passed to the called function. They must be in the same order
+ *                          and match the parameters that were passed to the function. Note that these should be the
+ *                          arguments as passed to the function, not pointers to them.
+ */
+void rpc_response_send_va(rtos_intertile_t *intertile_ctx, uint8_t port, const rpc_msg_t *rpc_msg, va_list ap);
+
+/**
+ * This is the same as rpc_response_send_va(), except that it takes a variable number
+ * of arguments for the function arguments, rather than a va_list of them.
+ *
+ * \param[in] intertile_ctx An intertile driver instance that has already been initialized and started, and is connected
+ *                          to the tile that called the function.
+ * \param[in] port          The intertile port to send the response to.
+ * \param[in] rpc_msg       A pointer to an rpc_msg_t struct that has already been filled in by rpc_request_parse().
+ * \param[in] ...           The arguments that were passed to the called function. They must be in the same order
+ *                          and match the parameters that were passed to the function. Note that these should be the
+ *                          arguments as passed to the function, not pointers to them.
+ */
+void rpc_response_send(rtos_intertile_t *intertile_ctx, uint8_t port, const rpc_msg_t *rpc_msg, ...);
+
 /**
  * Parses a received RPC response message and fills in a provided rpc_msg_t struct. See also rpc_client_call_generic().
  *
@@ -240,6 +270,10 @@ void rpc_response_unmarshall(const rpc_msg_t *rpc_msg, const rpc_param_desc_t pa
  * This function may be used to call a remote function rather than the three separate functions rpc_request_marshall_va(),
  * rpc_response_parse(), and rpc_response_unmarshall_va(), as the sequence is generic enough to handle most remote functions.
  *
+ * No messages are allocated. The request header and input argument data are streamed directly from the caller's memory
+ * with rtos_intertile_tx_len() and rtos_intertile_tx_data(), and the response is received directly into the output
+ * arguments with rtos_intertile_rx_len() and rtos_intertile_rx_data().
+ *
  * \param[in] intertile_ctx An intertile driver instance that has already been initialized and started, and is connected
  *                          to the tile that hosts the remote function.
  * \param[in] port          The intertile port to send the request to, and listen for the response from.
@@ -0,0 +1,284 @@
+// Copyright 2022 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <string.h>
+#include <xcore/assert.h>
+
+#include "rtos_intertile.h"
+#include "rtos/osal/api/rtos_osal.h"
+#include "rtos/drivers/rpc/api/rtos_driver_stream.h"
+
+static int32_t *block_samples(rtos_driver_stream_t *stream, uint32_t index)
+{
+    uint8_t *block = (uint8_t *) stream->blocks + (index % stream->block_count) * stream->block_bytes;
+
+    return (int32_t *) (block + sizeof(rtos_driver_stream_header_t));
+}
+
+static void credits_tx(rtos_driver_stream_t *stream, uint32_t credits)
+{
+    rtos_intertile_tx(stream->address.intertile_ctx, stream->address.port, &credits, sizeof(credits));
+}
+
+static void credits_flush(rtos_driver_stream_t *stream)
+{
+    if (stream->credits_pending > 0) {
+        credits_tx(stream, stream->credits_pending);
+        stream->credits_pending = 0;
+    }
+}
+
+/*
+ * Reads blocks from the driver for as long as the stream runs, sending each
+ * one to the client if it has a credit for it and dropping it otherwise.
+ */
+static void stream_host_tx_thread(rtos_driver_stream_t *stream)
+{
+    rtos_driver_stream_header_t *header = (rtos_driver_stream_header_t *) stream->blocks;
+    int32_t *samples = block_samples(stream, 0);
+    uint32_t sequence = 0;
+    uint32_t overrun_count = 0;
+
+    for (;;) {
+        int send = 0;
+
+        stream->source(stream->driver_ctx, samples, stream->block_frames);
+
+        if (!stream->started) {
+            continue;
+        }
+
+        int state = rtos_osal_critical_enter();
+        if (stream->credits > 0) {
+            stream->credits--;
+            send = 1;
+        }
+        rtos_osal_critical_exit(state);
+
+        header->sequence = sequence++;
+        if (send) {
+            header->overrun_count = overrun_count;
+            rtos_intertile_tx(stream->address.intertile_ctx, stream->address.port, stream->blocks, stream->block_bytes);
+        } else {
+            overrun_count++;
+        }
+    }
+}
+
+/*
+ * Receives the credits that the client returns as it frees blocks.
+ */
+static void stream_host_credit_thread(rtos_driver_stream_t *stream)
+{
+    for (;;) {
+        uint32_t credits;
+        size_t len;
+
+        len = rtos_intertile_rx_buf(stream->address.intertile_ctx, stream->address.port, &credits, sizeof(credits), RTOS_OSAL_WAIT_FOREVER);
+        xassert(len == sizeof(credits));
+
+        int state = rtos_osal_critical_enter();
+        stream->credits += credits;
+        stream->started = 1;
+        rtos_osal_critical_exit(state);
+    }
+}
+
+/*
+ * Receives each block from the host straight into the next free block of
+ * the ring. The credits guarantee that there is always one free.
+ */
+static void stream_client_rx_thread(rtos_driver_stream_t *stream)
+{
+    credits_tx(stream, stream->block_count);
+
+    for (;;) {
+        int32_t *samples = block_samples(stream, stream->total_written);
+        rtos_driver_stream_header_t *header = (rtos_driver_stream_header_t *) samples - 1;
+        size_t len;
+
+        len = rtos_intertile_rx_buf(stream->address.intertile_ctx, stream->address.port, header, stream->block_bytes, RTOS_OSAL_WAIT_FOREVER);
+        xassert(len == stream->block_bytes);
+        xassert(stream->total_written - stream->total_read < stream->block_count);
+
+        RTOS_MEMORY_BARRIER();
+
+        int state = rtos_osal_critical_enter();
+        uint32_t fill = ++stream->total_written - stream->total_read;
+
+        stream->stats.block_count++;
+        stream->stats.overrun_count = header->overrun_count;
+        if (fill > stream->stats.max_fill) {
+            stream->stats.max_fill = fill;
+        }
+
+        if (stream->required_frames > 0 &&
+            fill * stream->block_frames - stream->read_frame >= stream->required_frames) {
+            stream->required_frames = 0;
+            rtos_osal_semaphore_put(&stream->recv_sem);
+        }
+        rtos_osal_critical_exit(state);
+    }
+}
+
+size_t rtos_driver_stream_rx(
+        rtos_driver_stream_t *stream,
+        int32_t *buf,
+        size_t frame_count,
+        unsigned timeout)
+{
+    size_t frames_remaining = frame_count;
+    size_t available;
+    int state;
+
+    /* The block being read from is not free, so cannot be refilled yet */
+    xassert(frame_count <= (stream->block_count - 1) * stream->block_frames);
+
+    state = rtos_osal_critical_enter();
+    available = (stream->total_written - stream->total_read) * stream->block_frames - stream->read_frame;
+    if (available < frame_count) {
+        stream->required_frames = frame_count;
+    }
+    rtos_osal_critical_exit(state);
+
+    if (available < frame_count) {
+        /*
+         * The host may have no credits left to send the missing frames with,
+         * so return every block already emptied before waiting for them.
+         */
+        credits_flush(stream);
+
+        if (rtos_osal_semaphore_get(&stream->recv_sem, timeout) != RTOS_OSAL_SUCCESS) {
+            state = rtos_osal_critical_enter();
+            if (stream->required_frames > 0) {
+                stream->required_frames = 0;
+                rtos_osal_critical_exit(state);
+                return 0;
+            }
+            rtos_osal_critical_exit(state);
+
+            /* The frames arrived just as the wait timed out */
+            rtos_osal_semaphore_get(&stream->recv_sem, RTOS_OSAL_NO_WAIT);
+        }
+    }
+
+    RTOS_MEMORY_BARRIER();
+
+    while (frames_remaining > 0) {
+        int32_t *samples = block_samples(stream, stream->total_read);
+        size_t frames = stream->block_frames - stream->read_frame;
+
+        if (frames > frames_remaining) {
+            frames = frames_remaining;
+        }
+
+        memcpy(buf, &samples[stream->read_frame * stream->frame_words], frames * stream->frame_words * sizeof(int32_t));
+        buf += frames * stream->frame_words;
+        frames_remaining -= frames;
+
+        stream->read_frame += frames;
+        if (stream->read_frame == stream->block_frames) {
+            stream->read_frame = 0;
+            RTOS_MEMORY_BARRIER();
+            stream->total_read++;
+            stream->credits_pending++;
+        }
+    }
+
+    /* Credits are returned in batches to keep the traffic back to the host down */
+    if (stream->credits_pending >= stream->block_count / 2) {
+        credits_flush(stream);
+    }
+
+    return frame_count;
+}
+
+void rtos_driver_stream_stats_get(
+        rtos_driver_stream_t *stream,
+        rtos_driver_stream_stats_t *stats)
+{
+    int state = rtos_osal_critical_enter();
+    *stats = stream->stats;
+    rtos_osal_critical_exit(state);
+}
+
+void rtos_driver_stream_host_start(
+        rtos_driver_stream_t *stream)
+{
+    rtos_osal_thread_create(
+            NULL,
+            "stream_host_tx",
+            (rtos_osal_entry_function_t) stream_host_tx_thread,
+            stream,
+            RTOS_THREAD_STACK_SIZE(stream_host_tx_thread),
+            stream->priority);
+
+    rtos_osal_thread_create(
+            NULL,
+            "stream_host_credit",
+            (rtos_osal_entry_function_t) stream_host_credit_thread,
+            stream,
+            RTOS_THREAD_STACK_SIZE(stream_host_credit_thread),
+            stream->priority);
+}
+
+static void stream_init(
+        rtos_driver_stream_t *stream,
+        const rtos_intertile_address_t *address,
+        size_t frame_words,
+        size_t block_frames,
+        size_t block_count,
+        unsigned priority)
+{
+    xassert(address->port >= 0);
+    xassert(frame_words > 0);
+    xassert(block_frames > 0);
+
+    memset(stream, 0, sizeof(rtos_driver_stream_t));
+    stream->address = *address;
+    stream->frame_words = frame_words;
+    stream->block_frames = block_frames;
+    stream->block_bytes = sizeof(rtos_driver_stream_header_t) + block_frames * frame_words * sizeof(int32_t);
+    stream->block_count = block_count;
+    stream->priority = priority;
+
+    stream->blocks = rtos_osal_malloc(block_count * stream->block_bytes);
+    xassert(stream->blocks != NULL);
+}
+
+void rtos_driver_stream_host_init(
+        rtos_driver_stream_t *stream,
+        const rtos_intertile_address_t *client_address,
+        rtos_driver_stream_source_t source,
+        void *driver_ctx,
+        size_t frame_words,
+        size_t block_frames,
+        unsigned priority)
+{
+    /* The host only needs the block that it is sending */
+    stream_init(stream, client_address, frame_words, block_frames, 1, priority);
+    stream->source = source;
+    stream->driver_ctx = driver_ctx;
+}
+
+void rtos_driver_stream_client_init(
+        rtos_driver_stream_t *stream,
+        const rtos_intertile_address_t *host_address,
+        size_t frame_words,
+        size_t block_frames,
+        size_t block_count,
+        unsigned priority)
+{
+    xassert(block_count >= 2);
+
+    stream_init(stream, host_address, frame_words, block_frames, block_count, priority);
+    rtos_osal_semaphore_create(&stream->recv_sem, "stream_sem", 1, 0);
+
+    rtos_osal_thread_create(
+            NULL,
+            "stream_client_rx",
+            (rtos_osal_entry_function_t) stream_client_rx_thread,
+            stream,
+            RTOS_THREAD_STACK_SIZE(stream_client_rx_thread),
+            stream->priority);
+}
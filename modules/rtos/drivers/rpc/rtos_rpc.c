@@ -10,13 +10,72 @@
 #include "rtos/osal/api/rtos_osal.h"
 #include "rtos/drivers/rpc/api/rtos_rpc.h"
 
-int rpc_request_marshall_va(uint8_t **msg, int fcode, const rpc_param_desc_t param_desc[], va_list ap)
+/*
+ * Storage for a by-value argument passed to rpc_response_marshall_va() or
+ * rpc_response_send_va(), so that it can be copied or sent like a buffer.
+ */
+typedef union {
+    int64_t arg64;
+    int32_t arg32;
+    int16_t arg16;
+    int8_t arg8;
+} rpc_arg_t;
+
+static void *response_arg_get(const rpc_param_desc_t *param_desc, rpc_arg_t *arg, va_list *ap)
+{
+    void *arg_ptr = NULL;
+
+    if (param_desc->ptr) {
+        arg_ptr = va_arg(*ap, void *);
+    } else {
+        switch (param_desc->length) {
+        case sizeof(int8_t):
+            arg->arg8 = va_arg(*ap, int32_t);
+            arg_ptr = &arg->arg8;
+            break;
+        case sizeof(int16_t):
+            arg->arg16 = va_arg(*ap, int32_t);
+            arg_ptr = &arg->arg16;
+            break;
+        case sizeof(int32_t):
+            arg->arg32 = va_arg(*ap, int32_t);
+            arg_ptr = &arg->arg32;
+            break;
+        case sizeof(int64_t):
+            arg->arg64 = va_arg(*ap, int64_t);
+            arg_ptr = &arg->arg64;
+            break;
+        default:
+            xassert(0);
+        }
+    }
+
+    return arg_ptr;
+}
+
+/*
+ * rtos_intertile_tx_data() and rtos_intertile_rx_data() release the link once
+ * the whole message has been transferred, so they must not be called again
+ * for trailing zero length parameters.
+ */
+static void rpc_tx_data(rtos_intertile_t *intertile_ctx, const void *data, size_t len)
+{
+    if (len > 0) {
+        rtos_intertile_tx_data(intertile_ctx, (void *) data, len);
+    }
+}
+
+static void rpc_rx_data(rtos_intertile_t *intertile_ctx, void *data, size_t len)
+{
+    if (len > 0) {
+        rtos_intertile_rx_data(intertile_ctx, data, len);
+    }
+}
+
+static int request_length_get(const rpc_param_desc_t param_desc[], int *param_count)
 {
-    int param_count;
     int param_total_length = 0;
     int i;
-    int msg_length;
-    uint8_t *msg_ptr;
 
     for (i = 0; param_desc[i].input || param_desc[i].output; i++) {
         if (param_desc[i].input) {
@@ -24,12 +83,37 @@ int rpc_request_marshall_va(uint8_t **msg, int fcode, const rpc_param_desc_t par
         }
     }
 
-    param_count = i;
+    *param_count = i;
 
-    msg_length = sizeof(int) +                             /* Space for the function code */
-                 sizeof(int) +                             /* Space for the parameter count */
-                 sizeof(rpc_param_desc_t) * param_count +  /* Space for each parameter descriptor */
-                 param_total_length;                       /* Space for the parameters themselves */
+    return sizeof(int) +                             /* Space for the function code */
+           sizeof(int) +                             /* Space for the parameter count */
+           sizeof(rpc_param_desc_t) * i +            /* Space for each parameter descriptor */
+           param_total_length;                       /* Space for the parameters themselves */
+}
+
+static int response_length_get(const rpc_param_desc_t param_desc[], int param_count)
+{
+    int param_total_length = 0;
+    int i;
+
+    for (i = 0; i < param_count; i++) {
+        if (param_desc[i].output) {
+            param_total_length += param_desc[i].length;
+        }
+    }
+
+    return sizeof(int) +                             /* Space for the function code */
+           param_total_length;                       /* Space for the parameters themselves */
+}
+
+int rpc_request_marshall_va(uint8_t **msg, int fcode, const rpc_param_desc_t param_desc[], va_list ap)
+{
+    int param_count;
+    int i;
+    int msg_length;
+    uint8_t *msg_ptr;
+
+    msg_length = request_length_get(param_desc, &param_count);
 
     *msg = rtos_osal_malloc(msg_length);
     msg_ptr = *msg;
@@ -123,19 +207,12 @@ void rpc_request_unmarshall(rpc_msg_t *rpc_msg, ...)
 
 int rpc_response_marshall_va(uint8_t **msg, const rpc_msg_t *rpc_msg, va_list ap)
 {
-    int param_total_length = 0;
+    va_list args;
     int i;
     int msg_length;
     uint8_t *msg_ptr;
 
-    for (i = 0; i < rpc_msg->param_count; i++) {
-        if (rpc_msg->param_desc[i].output) {
-            param_total_length += rpc_msg->param_desc[i].length;
-        }
-    }
-
-    msg_length = sizeof(int) +                             /* Space for the function code */
-                 param_total_length;                       /* Space for the parameters themselves */
+    msg_length = response_length_get(rpc_msg->param_desc, rpc_msg->param_count);
 
     *msg = rtos_osal_malloc(msg_length);
     msg_ptr = *msg;
@@ -143,42 +220,17 @@ int rpc_response_marshall_va(uint8_t **msg, const rpc_msg_t *rpc_msg, va_list ap
     memcpy(msg_ptr, &rpc_msg->fcode, sizeof(int));
     msg_ptr += sizeof(int);
 
+    va_copy(args, ap);
     for (i = 0; i < rpc_msg->param_count; i++) {
-        int64_t arg64;
-        void *arg_ptr;
-        int32_t arg32;
-        int16_t arg16;
-        int8_t arg8;
+        rpc_arg_t arg;
+        void *arg_ptr = response_arg_get(&rpc_msg->param_desc[i], &arg, &args);
 
-        if (rpc_msg->param_desc[i].ptr) {
-            arg_ptr = va_arg(ap, void *);
-        } else {
-            switch (rpc_msg->param_desc[i].length) {
-            case sizeof(int8_t):
-                arg8 = va_arg(ap, int32_t);
-                arg_ptr = &arg8;
-                break;
-            case sizeof(int16_t):
-                arg16 = va_arg(ap, int32_t);
-                arg_ptr = &arg16;
-                break;
-            case sizeof(int32_t):
-                arg32 = va_arg(ap, int32_t);
-                arg_ptr = &arg32;
-                break;
-            case sizeof(int64_t):
-                arg64 = va_arg(ap, int64_t);
-                arg_ptr = &arg64;
-                break;
-            default:
-                xassert(0);
-            }
-        }
         if (rpc_msg->param_desc[i].output) {
             memcpy(msg_ptr, arg_ptr, rpc_msg->param_desc[i].length);
             msg_ptr += rpc_msg->param_desc[i].length;
         }
     }
+    va_end(args);
 
     return msg_length;
 }
@@ -195,6 +247,36 @@ int rpc_response_marshall(uint8_t **msg, const rpc_msg_t *rpc_msg, ...)
     return msg_length;
 }
 
+void rpc_response_send_va(rtos_intertile_t *intertile_ctx, uint8_t port, const rpc_msg_t *rpc_msg, va_list ap)
+{
+    va_list args;
+    int i;
+
+    rtos_intertile_tx_len(intertile_ctx, port,
+                          response_length_get(rpc_msg->param_desc, rpc_msg->param_count));
+    rpc_tx_data(intertile_ctx, &rpc_msg->fcode, sizeof(int));
+
+    va_copy(args, ap);
+    for (i = 0; i < rpc_msg->param_count; i++) {
+        rpc_arg_t arg;
+        void *arg_ptr = response_arg_get(&rpc_msg->param_desc[i], &arg, &args);
+
+        if (rpc_msg->param_desc[i].output) {
+            rpc_tx_data(intertile_ctx, arg_ptr, rpc_msg->param_desc[i].length);
+        }
+    }
+    va_end(args);
+}
+
+void rpc_response_send(rtos_intertile_t *intertile_ctx, uint8_t port, const rpc_msg_t *rpc_msg, ...)
+{
+    va_list ap;
+
+    va_start(ap, rpc_msg);
+    rpc_response_send_va(intertile_ctx, port, rpc_msg, ap);
+    va_end(ap);
+}
+
 void rpc_response_parse(rpc_msg_t *rpc_msg, uint8_t *msg_buf)
 {
     rpc_msg->msg_buf = msg_buf;
@@ -230,42 +312,58 @@ void rpc_response_unmarshall(const rpc_msg_t *rpc_msg, const rpc_param_desc_t pa
 
 void rpc_client_call_generic(rtos_intertile_t *intertile_ctx, uint8_t port, int fcode, const rpc_param_desc_t param_desc[], ...)
 {
-    uint8_t *req_msg;
-    uint8_t *resp_msg;
-    rpc_msg_t rpc_msg;
+    int param_count;
     int msg_length;
+    int resp_fcode;
+    int i;
     va_list ap_init, ap;
 
     va_start(ap_init, param_desc);
 
+    /*
+     * Send the RPC request message to the host. The header and each input
+     * parameter are streamed straight from the caller's memory, so no request
+     * message is built.
+     */
+    msg_length = request_length_get(param_desc, &param_count);
+    rtos_intertile_tx_len(intertile_ctx, port, msg_length);
+    rpc_tx_data(intertile_ctx, &fcode, sizeof(int));
+    rpc_tx_data(intertile_ctx, &param_count, sizeof(int));
+    rpc_tx_data(intertile_ctx, param_desc, sizeof(rpc_param_desc_t) * param_count);
+
     va_copy(ap, ap_init);
-    msg_length = rpc_request_marshall_va(
-            &req_msg, fcode, param_desc,
-            ap);
-    va_end(ap);
+    for (i = 0; i < param_count; i++) {
+        void *arg_ptr = va_arg(ap, void *);
 
-    /* send RPC request message to host */
-    rtos_intertile_tx(intertile_ctx, port, req_msg, msg_length);
-    rtos_osal_free(req_msg);
+        if (param_desc[i].input) {
+            rpc_tx_data(intertile_ctx, arg_ptr, param_desc[i].length);
+        }
+    }
+    va_end(ap);
 
-    /* receive RPC response message from host */
-    msg_length = rtos_intertile_rx(intertile_ctx, port, (void **) &resp_msg, RTOS_OSAL_WAIT_FOREVER);
+    /*
+     * Receive the RPC response message from the host directly into the
+     * caller's output arguments.
+     */
+    msg_length = rtos_intertile_rx_len(intertile_ctx, port, RTOS_OSAL_WAIT_FOREVER);
     if (msg_length == 0) {
         /* TODO: What to do here? */
         xassert(0);
     }
+    xassert(msg_length == response_length_get(param_desc, param_count));
 
-    rpc_response_parse(&rpc_msg, resp_msg);
-
-    xassert(rpc_msg.fcode == fcode);
+    rpc_rx_data(intertile_ctx, &resp_fcode, sizeof(int));
+    xassert(resp_fcode == fcode);
 
     va_copy(ap, ap_init);
-    rpc_response_unmarshall_va(
-            &rpc_msg, param_desc,
-            ap);
-    va_end(ap);
+    for (i = 0; i < param_count; i++) {
+        void *arg_ptr = va_arg(ap, void *);
 
-    rtos_osal_free(resp_msg);
+        if (param_desc[i].output) {
+            rpc_rx_data(intertile_ctx, arg_ptr, param_desc[i].length);
+        }
+    }
+    va_end(ap);
 
     va_end(ap_init);
 }
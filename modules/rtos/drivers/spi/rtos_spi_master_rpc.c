@@ -104,10 +104,8 @@ static void spi_master_remote_transaction_end(
     rtos_osal_mutex_put(&bus_ctx->lock);
 }
 
-static int spi_transaction_start_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void spi_transaction_start_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_spi_master_device_t *dev_ctx;
 
     rpc_request_unmarshall(
@@ -116,17 +114,13 @@ static int spi_transaction_start_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg
 
     rtos_spi_master_transaction_start(dev_ctx);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             dev_ctx);
-
-    return msg_length;
 }
 
-static int spi_transfer_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void spi_transfer_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_spi_master_device_t *dev_ctx;
     uint8_t *data_out;
     uint8_t *data_in;
@@ -142,19 +136,15 @@ static int spi_transfer_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
 
     rtos_spi_master_transfer(dev_ctx, data_out, data_in, len);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             dev_ctx, data_out, data_in, len);
 
     rtos_osal_free(data_in);
-
-    return msg_length;
 }
 
-static int spi_delay_before_next_transfer_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void spi_delay_before_next_transfer_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_spi_master_device_t *dev_ctx;
     uint32_t delay_ticks;
 
@@ -164,17 +154,13 @@ static int spi_delay_before_next_transfer_rpc_host(rpc_msg_t *rpc_msg, uint8_t *
 
     rtos_spi_master_delay_before_next_transfer(dev_ctx, delay_ticks);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             dev_ctx, delay_ticks);
-
-    return msg_length;
 }
 
-static int spi_transaction_end_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
+static void spi_transaction_end_rpc_host(rpc_msg_t *rpc_msg, rtos_intertile_address_t *client_address)
 {
-    int msg_length;
-
     rtos_spi_master_device_t *dev_ctx;
 
     rpc_request_unmarshall(
@@ -183,48 +169,41 @@ static int spi_transaction_end_rpc_host(rpc_msg_t *rpc_msg, uint8_t **resp_msg)
 
     rtos_spi_master_transaction_end(dev_ctx);
 
-    msg_length = rpc_response_marshall(
-            resp_msg, rpc_msg,
+    rpc_response_send(
+            client_address->intertile_ctx, client_address->port, rpc_msg,
             dev_ctx);
-
-    return msg_length;
 }
 
 static void spi_master_rpc_thread(rtos_intertile_address_t *client_address)
 {
-    int msg_length;
     uint8_t *req_msg;
-    uint8_t *resp_msg;
     rpc_msg_t rpc_msg;
     rtos_intertile_t *intertile_ctx = client_address->intertile_ctx;
     uint8_t intertile_port = client_address->port;
 
     for (;;) {
         /* receive RPC request message from client */
-        msg_length = rtos_intertile_rx(intertile_ctx, intertile_port, (void **) &req_msg, RTOS_OSAL_WAIT_FOREVER);
+        rtos_intertile_rx(intertile_ctx, intertile_port, (void **) &req_msg, RTOS_OSAL_WAIT_FOREVER);
 
         rpc_request_parse(&rpc_msg, req_msg);
 
         switch (rpc_msg.fcode) {
         case fcode_transaction_start:
-            msg_length = spi_transaction_start_rpc_host(&rpc_msg, &resp_msg);
+            spi_transaction_start_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_transfer:
-            msg_length = spi_transfer_rpc_host(&rpc_msg, &resp_msg);
+            spi_transfer_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_delay_before_next_transfer:
-            msg_length = spi_delay_before_next_transfer_rpc_host(&rpc_msg, &resp_msg);
+            spi_delay_before_next_transfer_rpc_host(&rpc_msg, client_address);
             break;
         case fcode_transaction_end:
-            msg_length = spi_transaction_end_rpc_host(&rpc_msg, &resp_msg);
+            spi_transaction_end_rpc_host(&rpc_msg, client_address);
             break;
         }
 
+        /* the RPC response message has been sent to the client */
         rtos_osal_free(req_msg);
-
-        /* send RPC response message to client */
-        rtos_intertile_tx(intertile_ctx, intertile_port, resp_msg, msg_length);
-        rtos_osal_free(resp_msg);
     }
 }
 
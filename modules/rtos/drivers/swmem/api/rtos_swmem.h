@@ -5,6 +5,8 @@
 #define RTOS_SWMEM_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /**
  * \addtogroup rtos_swmem_driver rtos_swmem_driver
@@ -28,6 +30,55 @@
  */
 #define RTOS_SWMEM_WRITE_FLAG 0x02
 
+/**
+ * The number of sequential streams that the fill engine prefetches for at
+ * once. Each stream follows one run of consecutive cache line misses, so
+ * that, for example, code and the data it reads may both be prefetched.
+ * Set this or RTOS_SWMEM_PREFETCH_LINES to zero to disable prefetching.
+ * Prefetching is also disabled when the driver is initialized with the
+ * RTOS_SWMEM_WRITE_FLAG flag, since prefetched lines could be made stale by
+ * evictions.
+ */
+#ifndef RTOS_SWMEM_PREFETCH_STREAMS
+#define RTOS_SWMEM_PREFETCH_STREAMS 2
+#endif
+
+/**
+ * The number of cache lines that the fill engine reads ahead of each
+ * stream. Each line takes SWMEM_FILL_SIZE_WORDS words of RAM.
+ *
+ * The lines are read by the fill interrupt handler once the missed line
+ * has been filled, so the faulting thread is not held up, but the core
+ * that took the interrupt can run nothing else until up to this many
+ * lines have been read. This time is counted in the \p prefetch_ticks
+ * statistic.
+ */
+#ifndef RTOS_SWMEM_PREFETCH_LINES
+#define RTOS_SWMEM_PREFETCH_LINES 8
+#endif
+
+/**
+ * The number of regions of the software memory, in addition to the
+ * default region, that fill statistics may be kept for.
+ * See rtos_swmem_stats_region_add().
+ */
+#ifndef RTOS_SWMEM_STATS_REGION_COUNT
+#define RTOS_SWMEM_STATS_REGION_COUNT 4
+#endif
+
+/**
+ * Statistics for the cache line fills in a region of the software memory.
+ * Hits in the hardware cache do not reach the driver, so are not counted.
+ */
+typedef struct {
+    unsigned fill_count;          /**< Cache line misses */
+    unsigned prefetch_hit_count;  /**< Misses filled from a line that was already prefetched */
+    unsigned stall_count;         /**< Misses that waited for a read request */
+    unsigned prefetch_line_count; /**< Lines read ahead by the prefetcher */
+    uint32_t stall_ticks;         /**< Reference clock ticks spent waiting for read requests */
+    uint32_t prefetch_ticks;      /**< Reference clock ticks the fill interrupt handler spent reading ahead */
+} rtos_swmem_stats_t;
+
 /**
  * Services a software memory read request from within the software memory
  * fill interrupt handler. This function may be provided by the application
@@ -79,6 +130,26 @@ __attribute__((weak)) bool rtos_swmem_read_request_isr(unsigned offset, uint32_t
  */
 __attribute__((weak)) bool rtos_swmem_write_request_isr(unsigned offset, uint32_t dirty_mask, const uint32_t *buf);
 
+/**
+ * Services a software memory prefetch request from within the software memory
+ * fill interrupt handler. This function may optionally be provided by the
+ * application to read several consecutive cache lines at once, which is
+ * usually much quicker than reading them one at a time. If it is not provided
+ * then the prefetcher calls rtos_swmem_read_request_isr() once for each line.
+ * Prefetching is only done from within the interrupt handler, so one of these
+ * two functions must be provided for lines to be prefetched.
+ *
+ * \param offset The byte offset into the software memory of the first cache
+ *               line to read.
+ * \param buf    This function must fill this with \p lines times
+ *               SWMEM_FILL_SIZE_WORDS words of data.
+ * \param lines  The number of consecutive cache lines to read.
+ *
+ * \retval       true if all the lines were read.
+ * \retval       false if the lines could not be read now. They are not retried.
+ */
+__attribute__((weak)) bool rtos_swmem_prefetch_request_isr(unsigned offset, uint32_t *buf, size_t lines);
+
 /**
  * Services a software memory read request from within the software memory
  * RTOS thread. This function may be provided by the application when the
@@ -116,6 +187,34 @@ __attribute__((weak)) void rtos_swmem_read_request(unsigned offset, uint32_t *bu
  */
 __attribute__((weak)) void rtos_swmem_write_request(unsigned offset, uint32_t dirty_mask, const uint32_t *buf);
 
+/**
+ * Adds a region of the software memory to keep separate fill statistics for.
+ * Misses outside of all added regions are counted in region 0.
+ *
+ * \param start A pointer to the start of the region, in the software memory.
+ *              For example, the address of a function or array placed in a
+ *              .SwMem section.
+ * \param size  The size of the region in bytes.
+ *
+ * \returns     The index of the region to pass to rtos_swmem_stats_get(), or
+ *              -1 if RTOS_SWMEM_STATS_REGION_COUNT regions have already been added.
+ */
+int rtos_swmem_stats_region_add(const void *start, size_t size);
+
+/**
+ * Gets the fill statistics for a region of the software memory.
+ *
+ * \param region The index of the region, as returned by rtos_swmem_stats_region_add(),
+ *               or 0 for misses outside of all added regions.
+ * \param stats  The statistics are written here.
+ */
+void rtos_swmem_stats_get(int region, rtos_swmem_stats_t *stats);
+
+/**
+ * Resets the fill statistics for all regions to zero.
+ */
+void rtos_swmem_stats_reset(void);
+
 /**
  * Starts the RTOS software memory driver.
  *
@@ -1,9 +1,12 @@
 // Copyright 2021 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
+#include <string.h>
+
 #include <xcore/swmem_fill.h>
 #include <xcore/swmem_evict.h>
 #include <xcore/triggerable.h>
+#include <xcore/hwtimer.h>
 
 #include "rtos_interrupt.h"
 #include "rtos/drivers/swmem/api/rtos_swmem.h"
@@ -19,6 +22,8 @@ static uint32_t swmem_core_exclude_map;
 
 static uint32_t fill_buf[SWMEM_FILL_SIZE_WORDS];
 static fill_slot_t fill_slot;
+static unsigned fill_offset;
+static uint32_t fill_start_time;
 
 static uint32_t evict_buf[SWMEM_EVICT_SIZE_WORDS];
 static evict_slot_t evict_slot;
@@ -30,18 +35,229 @@ static evict_mask_t dirty_mask;
 // C runtime startup.  This value may be set by the bootloader
 static volatile unsigned int __swmem_address = SWMEM_ADDRESS_UNINITIALISED;
 
+#define LINE_BYTES (SWMEM_FILL_SIZE_WORDS * sizeof(uint32_t))
+
+/*
+ * Fill statistics. Region 0 counts misses outside of all added regions.
+ */
+typedef struct {
+    unsigned start;
+    unsigned end;
+} stats_region_t;
+
+static stats_region_t stats_regions[RTOS_SWMEM_STATS_REGION_COUNT + 1];
+static int stats_region_count = 1;
+static rtos_swmem_stats_t stats[RTOS_SWMEM_STATS_REGION_COUNT + 1];
+
+static rtos_swmem_stats_t *stats_for_offset(unsigned offset)
+{
+    for (int i = 1; i < stats_region_count; i++) {
+        if (offset >= stats_regions[i].start && offset < stats_regions[i].end) {
+            return &stats[i];
+        }
+    }
+
+    return &stats[0];
+}
+
+#define PREFETCH_ENABLED (RTOS_SWMEM_PREFETCH_STREAMS > 0 && RTOS_SWMEM_PREFETCH_LINES > 0)
+
+#if PREFETCH_ENABLED
+
+/*
+ * A stream holds the lines that follow a run of consecutive misses, in a
+ * ring buffer. The line at offset base is held in buf[head], and the lines
+ * after it follow on from there.
+ *
+ * The streams are only accessed by the fill ISR. The fill trigger is
+ * disabled while the swmem thread services a fill, and the thread does
+ * not prefetch, so they are never accessed concurrently.
+ */
+typedef struct {
+    uint32_t buf[RTOS_SWMEM_PREFETCH_LINES][SWMEM_FILL_SIZE_WORDS];
+    unsigned base;
+    unsigned count;
+    unsigned head;
+    unsigned last_used;
+} prefetch_stream_t;
+
+/*
+ * The most recent misses that did not hit a stream. A miss on the line
+ * after any of these starts a new stream, so that interleaved runs of
+ * misses are each detected.
+ */
+#define MISS_HISTORY_LENGTH (2 * RTOS_SWMEM_PREFETCH_STREAMS)
+
+static prefetch_stream_t prefetch_streams[RTOS_SWMEM_PREFETCH_STREAMS];
+static unsigned prefetch_use_count;
+static unsigned miss_history[MISS_HISTORY_LENGTH];
+static unsigned miss_history_next;
+static bool prefetch_enabled;
+
+/*
+ * Reads lines into a stream's buffer. Returns the number of lines read,
+ * which is less than requested if the application's handlers are unable to
+ * read now.
+ */
+static unsigned prefetch_read(unsigned offset, uint32_t *buf, unsigned lines)
+{
+    rtos_swmem_stats_t *prefetch_stats = stats_for_offset(offset);
+    uint32_t start_time = get_reference_time();
+    unsigned lines_read = 0;
+
+    if (rtos_swmem_prefetch_request_isr) {
+        if (rtos_swmem_prefetch_request_isr(offset, buf, lines)) {
+            lines_read = lines;
+        }
+    } else if (rtos_swmem_read_request_isr) {
+        while (lines_read < lines &&
+               rtos_swmem_read_request_isr(offset + lines_read * LINE_BYTES,
+                                           &buf[lines_read * SWMEM_FILL_SIZE_WORDS])) {
+            lines_read++;
+        }
+    }
+
+    prefetch_stats->prefetch_line_count += lines_read;
+    prefetch_stats->prefetch_ticks += get_reference_time() - start_time;
+
+    return lines_read;
+}
+
+/*
+ * Reads ahead to fill the free lines in a stream's buffer. This is at most
+ * two reads, as the free lines wrap around the end of the ring buffer.
+ */
+static void prefetch_stream_fill(prefetch_stream_t *stream)
+{
+    while (stream->count < RTOS_SWMEM_PREFETCH_LINES) {
+        unsigned tail = (stream->head + stream->count) % RTOS_SWMEM_PREFETCH_LINES;
+        unsigned lines = RTOS_SWMEM_PREFETCH_LINES - stream->count;
+        unsigned lines_read;
+
+        if (lines > RTOS_SWMEM_PREFETCH_LINES - tail) {
+            lines = RTOS_SWMEM_PREFETCH_LINES - tail;
+        }
+
+        lines_read = prefetch_read(stream->base + stream->count * LINE_BYTES,
+                                   stream->buf[tail], lines);
+        stream->count += lines_read;
+
+        if (lines_read < lines) {
+            break;
+        }
+    }
+}
+
+/*
+ * Fills the slot from a prefetched line if one of the streams holds it.
+ * The line, and any lines before it in the stream that were skipped over,
+ * are dropped from the stream, since the hardware cache now holds it.
+ */
+static prefetch_stream_t *prefetch_populate(unsigned offset)
+{
+    for (int i = 0; i < RTOS_SWMEM_PREFETCH_STREAMS; i++) {
+        prefetch_stream_t *stream = &prefetch_streams[i];
+
+        if (offset >= stream->base && offset < stream->base + stream->count * LINE_BYTES) {
+            unsigned index = (offset - stream->base) / LINE_BYTES;
+            unsigned line = (stream->head + index) % RTOS_SWMEM_PREFETCH_LINES;
+
+            swmem_fill_populate_from_buffer(swmem_fill_res, fill_slot,
+                                            stream->buf[line]);
+
+            stream->head = (line + 1) % RTOS_SWMEM_PREFETCH_LINES;
+            stream->count -= index + 1;
+            stream->base = offset + LINE_BYTES;
+
+            return stream;
+        }
+    }
+
+    return NULL;
+}
+
+static bool miss_history_check(unsigned offset)
+{
+    for (int i = 0; i < MISS_HISTORY_LENGTH; i++) {
+        if (miss_history[i] + LINE_BYTES == offset) {
+            return true;
+        }
+    }
+
+    miss_history[miss_history_next] = offset;
+    miss_history_next = (miss_history_next + 1) % MISS_HISTORY_LENGTH;
+
+    return false;
+}
+
+/*
+ * Called once a miss has been filled, after the faulting thread has been
+ * allowed to continue. A miss on the line after a recent miss starts a new
+ * stream in place of the least recently used one. A stream is topped up
+ * once half of its lines have been used, so that the lines are read a few
+ * at a time rather than one per miss.
+ */
+static void prefetch_advance(unsigned offset, prefetch_stream_t *stream)
+{
+    if (stream == NULL) {
+        if (!miss_history_check(offset)) {
+            return;
+        }
+
+        stream = &prefetch_streams[0];
+        for (int i = 1; i < RTOS_SWMEM_PREFETCH_STREAMS; i++) {
+            if (prefetch_streams[i].last_used < stream->last_used) {
+                stream = &prefetch_streams[i];
+            }
+        }
+
+        stream->base = offset + LINE_BYTES;
+        stream->count = 0;
+        stream->head = 0;
+    }
+
+    stream->last_used = ++prefetch_use_count;
+
+    if (stream->count <= RTOS_SWMEM_PREFETCH_LINES / 2) {
+        prefetch_stream_fill(stream);
+    }
+}
+
+#endif /* PREFETCH_ENABLED */
+
 DEFINE_RTOS_INTERRUPT_CALLBACK(sw_mem_fill_isr, arg)
 {
     bool handled = false;
+    bool deferred = false;
+    rtos_swmem_stats_t *fill_stats;
+#if PREFETCH_ENABLED
+    prefetch_stream_t *stream = NULL;
+#endif
+
     fill_slot = swmem_fill_in_address(swmem_fill_res);
+    fill_offset = (unsigned)(fill_slot - XS1_SWMEM_BASE + __swmem_address);
+    fill_start_time = get_reference_time();
+
+    fill_stats = stats_for_offset(fill_offset);
+    fill_stats->fill_count++;
+
+#if PREFETCH_ENABLED
+    if (prefetch_enabled) {
+        stream = prefetch_populate(fill_offset);
+        if (stream != NULL) {
+            fill_stats->prefetch_hit_count++;
+            handled = true;
+        }
+    }
+#endif
 
-    if (rtos_swmem_read_request_isr) {
-        handled = rtos_swmem_read_request_isr(
-                (unsigned)(fill_slot - XS1_SWMEM_BASE + __swmem_address),
-                fill_buf);
+    if (!handled && rtos_swmem_read_request_isr) {
+        handled = rtos_swmem_read_request_isr(fill_offset, fill_buf);
         if (handled) {
             swmem_fill_populate_from_buffer(swmem_fill_res, fill_slot,
                                             fill_buf);
+            fill_stats->stall_count++;
+            fill_stats->stall_ticks += get_reference_time() - fill_start_time;
         }
     }
 
@@ -56,9 +272,23 @@ DEFINE_RTOS_INTERRUPT_CALLBACK(sw_mem_fill_isr, arg)
         rtos_osal_event_group_set_bits(&swmem_event_group,
                                        RTOS_SWMEM_READ_FLAG);
         handled = true;
+        deferred = true;
     }
 
     xassert(handled);
+
+#if PREFETCH_ENABLED
+    /*
+     * The faulting thread has already been allowed to continue, so reading
+     * ahead here overlaps with it running the line that was just filled.
+     * This core is held in the ISR meanwhile, which prefetch_ticks counts.
+     */
+    if (prefetch_enabled && !deferred) {
+        prefetch_advance(fill_offset, stream);
+    }
+#else
+    (void) deferred;
+#endif
 }
 
 DEFINE_RTOS_INTERRUPT_CALLBACK(sw_mem_evict_isr, arg)
@@ -101,9 +331,9 @@ static void rtos_swmem_thread(void *arg)
         }
 
         if (flags & RTOS_SWMEM_READ_FLAG) {
-            rtos_swmem_read_request(
-                    (unsigned)(fill_slot - XS1_SWMEM_BASE + __swmem_address),
-                    fill_buf);
+            rtos_swmem_stats_t *fill_stats = stats_for_offset(fill_offset);
+
+            rtos_swmem_read_request(fill_offset, fill_buf);
 
             /*
              * Ensure that swmem_fill_populate_from_buffer() is called on the same
@@ -114,6 +344,9 @@ static void rtos_swmem_thread(void *arg)
             swmem_fill_populate_from_buffer(swmem_fill_res, fill_slot,
                                             fill_buf);
 
+            fill_stats->stall_count++;
+            fill_stats->stall_ticks += get_reference_time() - fill_start_time;
+
             /*
              * Allow this thread to run on any core once again
              */
@@ -131,9 +364,47 @@ static void rtos_swmem_thread(void *arg)
     }
 }
 
+int rtos_swmem_stats_region_add(const void *start, size_t size)
+{
+    int region;
+
+    xassert((uintptr_t)start >= XS1_SWMEM_BASE);
+
+    if (stats_region_count > RTOS_SWMEM_STATS_REGION_COUNT) {
+        return -1;
+    }
+
+    region = stats_region_count;
+    stats_regions[region].start = (unsigned)((uintptr_t)start - XS1_SWMEM_BASE + __swmem_address);
+    stats_regions[region].end = stats_regions[region].start + size;
+    memset(&stats[region], 0, sizeof(rtos_swmem_stats_t));
+
+    /* Only count the region once it is complete */
+    RTOS_MEMORY_BARRIER();
+    stats_region_count++;
+
+    return region;
+}
+
+void rtos_swmem_stats_get(int region, rtos_swmem_stats_t *region_stats)
+{
+    xassert(region >= 0 && region < stats_region_count);
+    *region_stats = stats[region];
+}
+
+void rtos_swmem_stats_reset(void)
+{
+    memset(stats, 0, sizeof(stats));
+}
+
 void rtos_swmem_start(unsigned priority)
 {
     if (!started) {
+#if PREFETCH_ENABLED
+        prefetch_enabled = swmem_evict_res == 0;
+        memset(miss_history, 0xff, sizeof(miss_history));
+#endif
+
         if (rtos_swmem_read_request || rtos_swmem_write_request) {
             rtos_osal_event_group_create(&swmem_event_group,
                                          "swmem_event_group");
@@ -3,7 +3,7 @@
 
 #include "FreeRTOS.h"
 
-#if ENABLE_RTOS_XSCOPE_TRACE == 1
+#if ENABLE_RTOS_XSCOPE_TRACE == 1 && xcoretraceconfigBINARY == 0
 #include <stdarg.h>
 #include <ctype.h>
 #include <string.h>
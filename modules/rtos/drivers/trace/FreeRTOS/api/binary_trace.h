@@ -0,0 +1,158 @@
+// Copyright 2022 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef BINARY_TRACE_H_
+#define BINARY_TRACE_H_
+
+/*
+ * Binary trace
+ *
+ * Each event is written as a fixed size record into a ring buffer owned by
+ * the core that it happens on. Only the owning core writes to its ring, with
+ * its interrupts masked, so writing a record takes no lock and is a few
+ * stores. A low priority task started by binary_trace_start() drains the
+ * rings to the host over xSCOPE in batches. When a ring is full, records
+ * are dropped and the number dropped is recorded once there is room again.
+ *
+ * The records are decoded on the host by
+ * tools/tracing/parsers/FreeRTOS/trace_freertos_binary.py
+ */
+
+/* The number of records in the ring of each core. Must be a power of 2. */
+#ifndef xcoretraceconfigBINARY_RING_RECORDS
+#define xcoretraceconfigBINARY_RING_RECORDS         256
+#endif
+
+/* The number of ticks that the drain task waits for when the rings are empty */
+#ifndef xcoretraceconfigBINARY_DRAIN_DELAY
+#define xcoretraceconfigBINARY_DRAIN_DELAY          1
+#endif
+
+/* Set to 1 to record queue, semaphore and mutex operations */
+#ifndef xcoretraceconfigBINARY_QUEUE_EVENTS
+#define xcoretraceconfigBINARY_QUEUE_EVENTS         1
+#endif
+
+/* Set to 1 to record dispatcher jobs */
+#ifndef xcoretraceconfigBINARY_DISPATCHER_EVENTS
+#define xcoretraceconfigBINARY_DISPATCHER_EVENTS    1
+#endif
+
+/* The first half word of every batch sent to the host */
+#define binarytraceBATCH_MAGIC      0xB17E
+
+/* The version of the record format, in the batch header */
+#define binarytraceVERSION          1
+
+/*
+ * Record event types. The meaning of the task, arg0 and arg1 fields of
+ * each is given alongside.
+ */
+#define binarytraceEVENT_TASK_CREATE            1   /* task, arg0 = priority */
+#define binarytraceEVENT_TASK_NAME              2   /* task, arg0:arg1 = next 8 bytes of the name */
+#define binarytraceEVENT_TASK_DELETE            3   /* task */
+#define binarytraceEVENT_TASK_SWITCHED_IN       4   /* task */
+#define binarytraceEVENT_TASK_SWITCHED_OUT      5   /* task */
+#define binarytraceEVENT_ISR_ENTER              6   /* arg0 = callback address */
+#define binarytraceEVENT_ISR_EXIT               7   /* arg0 = callback address */
+#define binarytraceEVENT_QUEUE_CREATE           8   /* task = queue type, arg0 = queue, arg1 = length */
+#define binarytraceEVENT_QUEUE_SEND             9   /* arg0 = queue, arg1 = messages waiting before */
+#define binarytraceEVENT_QUEUE_SEND_FAILED      10  /* arg0 = queue, arg1 = messages waiting */
+#define binarytraceEVENT_QUEUE_RECEIVE          11  /* arg0 = queue, arg1 = messages waiting before */
+#define binarytraceEVENT_QUEUE_RECEIVE_FAILED   12  /* arg0 = queue, arg1 = messages waiting */
+#define binarytraceEVENT_QUEUE_BLOCK_SEND       13  /* arg0 = queue, arg1 = messages waiting */
+#define binarytraceEVENT_QUEUE_BLOCK_RECEIVE    14  /* arg0 = queue, arg1 = messages waiting */
+#define binarytraceEVENT_JOB_START              15  /* arg0 = job, arg1 = function address */
+#define binarytraceEVENT_JOB_END                16  /* arg0 = job, arg1 = function address */
+#define binarytraceEVENT_DROPPED                17  /* arg0 = number of records dropped */
+
+#ifndef __ASSEMBLER__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A trace record, as it is sent to the host. Every batch sent starts with a
+ * binary_trace_batch_header_t, followed by count records. Both are little
+ * endian.
+ */
+typedef struct {
+	uint32_t timestamp;		/* Reference clock ticks */
+	uint8_t event;			/* One of binarytraceEVENT_* */
+	uint8_t core;			/* The RTOS core the event happened on */
+	uint16_t task;			/* The task number, for task events */
+	uint32_t arg0;
+	uint32_t arg1;
+} binary_trace_record_t;
+
+typedef struct {
+	uint16_t magic;			/* binarytraceBATCH_MAGIC */
+	uint8_t version;		/* binarytraceVERSION */
+	uint8_t tile;
+	uint16_t count;			/* The number of records that follow */
+	uint16_t reserved;
+} binary_trace_batch_header_t;
+
+/*
+ * Writes a record to the ring of the calling core. May be called from
+ * tasks and ISRs.
+ */
+void binary_trace_record( uint32_t event, uint32_t task, uint32_t arg0, uint32_t arg1 );
+
+/*
+ * Writes a task create record followed by the records holding its name.
+ */
+void binary_trace_task_create( uint32_t task, uint32_t priority, const char *name );
+
+/*
+ * Starts the task that drains the rings to the host. Records written
+ * before this is called are kept until it runs, up to the size of the
+ * rings.
+ *
+ * \param priority  The priority of the drain task. Records are dropped if
+ *                  it is starved for long enough for a ring to fill.
+ */
+void binary_trace_start( unsigned priority );
+
+/*
+ * Gets the number of records dropped so far by all cores because their
+ * ring was full.
+ */
+uint32_t binary_trace_dropped_get( void );
+
+#define traceTASK_CREATE( pxNewTCB )		binary_trace_task_create( ( pxNewTCB )->uxTCBNumber, ( pxNewTCB )->uxPriority, ( pxNewTCB )->pcTaskName )
+#define traceTASK_DELETE( pxTaskToDelete )	binary_trace_record( binarytraceEVENT_TASK_DELETE, ( pxTaskToDelete )->uxTCBNumber, 0, 0 )
+#define traceTASK_SWITCHED_IN()				binary_trace_record( binarytraceEVENT_TASK_SWITCHED_IN, pxCurrentTCB->uxTCBNumber, 0, 0 )
+#define traceTASK_SWITCHED_OUT()			binary_trace_record( binarytraceEVENT_TASK_SWITCHED_OUT, pxCurrentTCB->uxTCBNumber, 0, 0 )
+
+#if( xcoretraceconfigBINARY_QUEUE_EVENTS == 1 )
+#define binarytraceQUEUE( event, pxQueue )	binary_trace_record( ( event ), 0, ( uint32_t ) ( pxQueue ), ( pxQueue )->uxMessagesWaiting )
+
+#define traceQUEUE_CREATE( pxNewQueue )					binary_trace_record( binarytraceEVENT_QUEUE_CREATE, ( pxNewQueue )->ucQueueType, ( uint32_t ) ( pxNewQueue ), ( pxNewQueue )->uxLength )
+#define traceQUEUE_SEND( pxQueue )						binarytraceQUEUE( binarytraceEVENT_QUEUE_SEND, pxQueue )
+#define traceQUEUE_SEND_FROM_ISR( pxQueue )				binarytraceQUEUE( binarytraceEVENT_QUEUE_SEND, pxQueue )
+#define traceQUEUE_SEND_FAILED( pxQueue )				binarytraceQUEUE( binarytraceEVENT_QUEUE_SEND_FAILED, pxQueue )
+#define traceQUEUE_SEND_FROM_ISR_FAILED( pxQueue )		binarytraceQUEUE( binarytraceEVENT_QUEUE_SEND_FAILED, pxQueue )
+#define traceQUEUE_RECEIVE( pxQueue )					binarytraceQUEUE( binarytraceEVENT_QUEUE_RECEIVE, pxQueue )
+#define traceQUEUE_RECEIVE_FROM_ISR( pxQueue )			binarytraceQUEUE( binarytraceEVENT_QUEUE_RECEIVE, pxQueue )
+#define traceQUEUE_RECEIVE_FAILED( pxQueue )			binarytraceQUEUE( binarytraceEVENT_QUEUE_RECEIVE_FAILED, pxQueue )
+#define traceQUEUE_RECEIVE_FROM_ISR_FAILED( pxQueue )	binarytraceQUEUE( binarytraceEVENT_QUEUE_RECEIVE_FAILED, pxQueue )
+#define traceBLOCKING_ON_QUEUE_SEND( pxQueue )			binarytraceQUEUE( binarytraceEVENT_QUEUE_BLOCK_SEND, pxQueue )
+#define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue )		binarytraceQUEUE( binarytraceEVENT_QUEUE_BLOCK_RECEIVE, pxQueue )
+#endif /* xcoretraceconfigBINARY_QUEUE_EVENTS */
+
+#if( xcoretraceconfigBINARY_DISPATCHER_EVENTS == 1 )
+#define traceDISPATCH_JOB_START( job, function )	binary_trace_record( binarytraceEVENT_JOB_START, 0, ( uint32_t ) ( job ), ( uint32_t ) ( function ) )
+#define traceDISPATCH_JOB_END( job, function )		binary_trace_record( binarytraceEVENT_JOB_END, 0, ( uint32_t ) ( job ), ( uint32_t ) ( function ) )
+#endif /* xcoretraceconfigBINARY_DISPATCHER_EVENTS */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ASSEMBLER__ */
+
+#endif /* BINARY_TRACE_H_ */
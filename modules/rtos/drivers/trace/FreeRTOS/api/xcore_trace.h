@@ -22,8 +22,17 @@
 #define xcoretraceconfigXSCOPE_TRACE_RAW_BYTES          0
 #endif
 
+/* Set to 1 to record binary trace records instead of ASCII text */
+#ifndef xcoretraceconfigBINARY
+#define xcoretraceconfigBINARY                      0
+#endif
+
 #if( !( __XC__ ) )
+#if( xcoretraceconfigBINARY == 1 )
+#include "binary_trace.h"
+#else
 #include "ascii_trace.h"
+#endif
 #endif /* __XC__ */
 
 #endif /* ENABLE_RTOS_XSCOPE_TRACE */
@@ -0,0 +1,248 @@
+// Copyright 2022 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include "FreeRTOS.h"
+
+#if ENABLE_RTOS_XSCOPE_TRACE == 1 && xcoretraceconfigBINARY == 1
+#include <string.h>
+#include <xcore/hwtimer.h>
+
+#include "task.h"
+#include "rtos_support.h"
+
+#ifdef configNUM_CORES
+#define binarytraceCORE_COUNT		configNUM_CORES
+#define binarytraceGET_CORE_ID()	rtos_core_id_get()
+#else
+#define binarytraceCORE_COUNT		1
+#define binarytraceGET_CORE_ID()	0
+#endif
+
+#ifdef THIS_XCORE_TILE
+#define binarytraceGET_TILE_ID()	THIS_XCORE_TILE
+#else
+#define binarytraceGET_TILE_ID()	get_local_tile_id()
+#endif
+
+#if( ( xcoretraceconfigBINARY_RING_RECORDS & ( xcoretraceconfigBINARY_RING_RECORDS - 1 ) ) != 0 )
+#error xcoretraceconfigBINARY_RING_RECORDS must be a power of 2
+#endif
+
+#define RING_MASK		( xcoretraceconfigBINARY_RING_RECORDS - 1 )
+
+/* The most records that fit in one xSCOPE write after the batch header */
+#define BATCH_RECORDS	( ( xcoretraceconfigXSCOPE_TRACE_BUFFER - sizeof( binary_trace_batch_header_t ) ) / sizeof( binary_trace_record_t ) )
+
+typedef struct {
+	binary_trace_record_t records[ xcoretraceconfigBINARY_RING_RECORDS ];
+	volatile uint32_t head;		/* Only written by the owning core */
+	volatile uint32_t tail;		/* Only written by the drain task */
+	uint32_t dropped;			/* Dropped since the last dropped record was written */
+	uint32_t dropped_total;
+} binary_trace_ring_t;
+
+static binary_trace_ring_t rings[ binarytraceCORE_COUNT ];
+
+static struct {
+	binary_trace_batch_header_t header;
+	binary_trace_record_t records[ BATCH_RECORDS ];
+} batch;
+
+/*
+ * Writes one record at the head of a ring. The record is complete before
+ * the head is moved past it, so the drain task never reads a partly
+ * written record.
+ */
+static void ring_write( binary_trace_ring_t *ring,
+						uint32_t timestamp,
+						uint32_t core,
+						uint32_t event,
+						uint32_t task,
+						uint32_t arg0,
+						uint32_t arg1 )
+{
+	uint32_t head = ring->head;
+	binary_trace_record_t *record = &ring->records[ head & RING_MASK ];
+
+	record->timestamp = timestamp;
+	record->event = event;
+	record->core = core;
+	record->task = task;
+	record->arg0 = arg0;
+	record->arg1 = arg1;
+
+	RTOS_MEMORY_BARRIER();
+	ring->head = head + 1;
+}
+
+/*
+ * Makes sure that there is room for count records, writing a dropped record
+ * first if any have been dropped. Returns 0 and counts the records as
+ * dropped if there is not room.
+ */
+static int ring_reserve( binary_trace_ring_t *ring,
+						 uint32_t timestamp,
+						 uint32_t core,
+						 uint32_t count )
+{
+	uint32_t free = xcoretraceconfigBINARY_RING_RECORDS - ( ring->head - ring->tail );
+
+	if( ring->dropped > 0 )
+	{
+		if( free > count )
+		{
+			ring_write( ring, timestamp, core, binarytraceEVENT_DROPPED, 0, ring->dropped, 0 );
+			ring->dropped = 0;
+			return 1;
+		}
+	}
+	else if( free >= count )
+	{
+		return 1;
+	}
+
+	ring->dropped += count;
+	ring->dropped_total += count;
+	return 0;
+}
+
+void binary_trace_record( uint32_t event, uint32_t task, uint32_t arg0, uint32_t arg1 )
+{
+	uint32_t mask = rtos_interrupt_mask_all();
+	uint32_t core = binarytraceGET_CORE_ID();
+	binary_trace_ring_t *ring = &rings[ core ];
+	uint32_t timestamp = get_reference_time();
+
+	if( ring_reserve( ring, timestamp, core, 1 ) )
+	{
+		ring_write( ring, timestamp, core, event, task, arg0, arg1 );
+	}
+
+	rtos_interrupt_mask_set( mask );
+}
+
+void binary_trace_task_create( uint32_t task, uint32_t priority, const char *name )
+{
+	uint32_t mask = rtos_interrupt_mask_all();
+	uint32_t core = binarytraceGET_CORE_ID();
+	binary_trace_ring_t *ring = &rings[ core ];
+	uint32_t timestamp = get_reference_time();
+	size_t len = strnlen( name, configMAX_TASK_NAME_LEN );
+	uint32_t name_records = ( len + 8 ) / 8;
+
+	if( ring_reserve( ring, timestamp, core, 1 + name_records ) )
+	{
+		ring_write( ring, timestamp, core, binarytraceEVENT_TASK_CREATE, task, priority, 0 );
+
+		for( uint32_t i = 0; i < name_records; i++ )
+		{
+			uint32_t chunk[ 2 ] = { 0, 0 };
+			size_t chunk_len = len - i * 8 < 8 ? len - i * 8 : 8;
+
+			memcpy( chunk, name + i * 8, chunk_len );
+			ring_write( ring, timestamp, core, binarytraceEVENT_TASK_NAME, task, chunk[ 0 ], chunk[ 1 ] );
+		}
+	}
+
+	rtos_interrupt_mask_set( mask );
+}
+
+void rtos_trace_isr_enter( void *callback )
+{
+	binary_trace_record( binarytraceEVENT_ISR_ENTER, 0, ( uint32_t ) callback, 0 );
+}
+
+void rtos_trace_isr_exit( void *callback )
+{
+	binary_trace_record( binarytraceEVENT_ISR_EXIT, 0, ( uint32_t ) callback, 0 );
+}
+
+uint32_t binary_trace_dropped_get( void )
+{
+	uint32_t dropped = 0;
+
+	for( int i = 0; i < binarytraceCORE_COUNT; i++ )
+	{
+		dropped += rings[ i ].dropped_total;
+	}
+
+	return dropped;
+}
+
+/*
+ * Copies up to a batch of records out of a ring and sends them to the
+ * host. Returns the number of records sent.
+ */
+static uint32_t ring_drain( binary_trace_ring_t *ring )
+{
+	uint32_t tail = ring->tail;
+	uint32_t count = ring->head - tail;
+	uint32_t first;
+
+	if( count == 0 )
+	{
+		return 0;
+	}
+	if( count > BATCH_RECORDS )
+	{
+		count = BATCH_RECORDS;
+	}
+
+	/* The records may wrap around the end of the ring */
+	RTOS_MEMORY_BARRIER();
+	first = xcoretraceconfigBINARY_RING_RECORDS - ( tail & RING_MASK );
+	if( first > count )
+	{
+		first = count;
+	}
+	memcpy( &batch.records[ 0 ], &ring->records[ tail & RING_MASK ], first * sizeof( binary_trace_record_t ) );
+	memcpy( &batch.records[ first ], &ring->records[ 0 ], ( count - first ) * sizeof( binary_trace_record_t ) );
+	RTOS_MEMORY_BARRIER();
+	ring->tail = tail + count;
+
+	batch.header.count = count;
+	uint32_t ulState = portDISABLE_INTERRUPTS();
+	xscope_core_bytes( FREERTOS_TRACE,
+					   sizeof( binary_trace_batch_header_t ) + count * sizeof( binary_trace_record_t ),
+					   ( unsigned char * ) &batch );
+	portRESTORE_INTERRUPTS( ulState );
+
+	return count;
+}
+
+static void binary_trace_drain( void *arg )
+{
+	( void ) arg;
+
+	batch.header.magic = binarytraceBATCH_MAGIC;
+	batch.header.version = binarytraceVERSION;
+	batch.header.tile = binarytraceGET_TILE_ID();
+	batch.header.reserved = 0;
+
+	for( ;; )
+	{
+		uint32_t sent = 0;
+
+		for( int i = 0; i < binarytraceCORE_COUNT; i++ )
+		{
+			sent += ring_drain( &rings[ i ] );
+		}
+
+		if( sent == 0 )
+		{
+			vTaskDelay( xcoretraceconfigBINARY_DRAIN_DELAY );
+		}
+	}
+}
+
+void binary_trace_start( unsigned priority )
+{
+	xTaskCreate( binary_trace_drain,
+				 "binary_trace",
+				 RTOS_THREAD_STACK_SIZE( binary_trace_drain ),
+				 NULL,
+				 priority,
+				 NULL );
+}
+
+#endif /* ENABLE_RTOS_XSCOPE_TRACE == 1 && xcoretraceconfigBINARY == 1 */
@@ -91,6 +91,12 @@
  *  **The kernel stack is not re-entrant so kernel mode must not be masked
  *  from within an interrupt_callback_t**
  *
+ *  When RTOS_SUPPORT_TRACE_ISR is defined to 1, each call of the ordinary
+ *  function from the interrupt_callback_t is preceded by a call to
+ *  rtos_trace_isr_enter() and followed by a call to rtos_trace_isr_exit(),
+ *  both of which are passed its address. These do nothing unless they are
+ *  defined by a tracer.
+ *
  *  Example usage: \code
  *    DEFINE_RTOS_INTERRUPT_CALLBACK(myfunc, arg)
  *    {
@@ -61,7 +61,7 @@
     void _XCORE_INTERRUPT_CALLBACK(intrpt)(void);\
     void intrpt(void *data)
 
-#define _DEFINE_RTOS_INTERRUPT_CALLBACK_DEF(intrpt) \
+#define _DEFINE_RTOS_INTERRUPT_CALLBACK_DEF(intrpt, handler) \
     .weak _fptrgroup.rtos_isr.nstackwords.group; \
     .add_to_set _fptrgroup.rtos_isr.nstackwords.group, _XCORE_INTERRUPT_CALLBACK(intrpt).nstackwords, _XCORE_INTERRUPT_CALLBACK(intrpt); \
     .globl _XCORE_INTERRUPT_CALLBACK(intrpt); \
@@ -77,24 +77,55 @@
       /* will save the rest of the registers. */ \
       stw r1, sp[RTOS_SUPPORT_INTERRUPT_R1_STACK_OFFSET]; \
       stw r11, sp[RTOS_SUPPORT_INTERRUPT_R11_STACK_OFFSET]; \
-      ldap r11, intrpt; \
+      ldap r11, handler; \
       mov r1, r11; \
       ldap r11, rtos_interrupt_callback_common; \
       bau r11; \
     .cc_bottom _XCORE_INTERRUPT_CALLBACK(intrpt).function; \
-    .set   _XCORE_INTERRUPT_CALLBACK(intrpt).nstackwords, intrpt.nstackwords; \
+    .set   _XCORE_INTERRUPT_CALLBACK(intrpt).nstackwords, handler.nstackwords; \
     .globl _XCORE_INTERRUPT_CALLBACK(intrpt).nstackwords; \
-    .set   _XCORE_INTERRUPT_CALLBACK(intrpt).maxcores, 1 $M intrpt.maxcores; \
+    .set   _XCORE_INTERRUPT_CALLBACK(intrpt).maxcores, 1 $M handler.maxcores; \
     .globl _XCORE_INTERRUPT_CALLBACK(intrpt).maxcores; \
-    .set   _XCORE_INTERRUPT_CALLBACK(intrpt).maxtimers, 0 $M intrpt.maxtimers; \
+    .set   _XCORE_INTERRUPT_CALLBACK(intrpt).maxtimers, 0 $M handler.maxtimers; \
     .globl _XCORE_INTERRUPT_CALLBACK(intrpt).maxtimers; \
-    .set   _XCORE_INTERRUPT_CALLBACK(intrpt).maxchanends, 0 $M intrpt.maxchanends; \
+    .set   _XCORE_INTERRUPT_CALLBACK(intrpt).maxchanends, 0 $M handler.maxchanends; \
     .globl _XCORE_INTERRUPT_CALLBACK(intrpt).maxchanends; \
     .size  _XCORE_INTERRUPT_CALLBACK(intrpt), . - _XCORE_INTERRUPT_CALLBACK(intrpt); \
 
+#ifndef RTOS_SUPPORT_TRACE_ISR
+#define RTOS_SUPPORT_TRACE_ISR 0
+#endif
+
+#if RTOS_SUPPORT_TRACE_ISR
+
+void rtos_trace_isr_enter(void *callback);
+void rtos_trace_isr_exit(void *callback);
+
+#define _RTOS_TRACED_INTERRUPT_CALLBACK(intrpt) _rtos_traced_##intrpt
+
+/*
+ * The interrupt wrapper calls a function that brackets the callback
+ * with the trace hooks, rather than calling the callback directly.
+ */
 #define _DEFINE_RTOS_INTERRUPT_CALLBACK(intrpt, data) \
-    asm(RTOS_STRINGIFY(_DEFINE_RTOS_INTERRUPT_CALLBACK_DEF(intrpt))); \
+    asm(RTOS_STRINGIFY(_DEFINE_RTOS_INTERRUPT_CALLBACK_DEF(intrpt, _RTOS_TRACED_INTERRUPT_CALLBACK(intrpt)))); \
+    _DECLARE_RTOS_INTERRUPT_CALLBACK(intrpt, data); \
+    void _RTOS_TRACED_INTERRUPT_CALLBACK(intrpt)(void *data); \
+    void _RTOS_TRACED_INTERRUPT_CALLBACK(intrpt)(void *data) \
+    { \
+        rtos_trace_isr_enter((void *) intrpt); \
+        intrpt(data); \
+        rtos_trace_isr_exit((void *) intrpt); \
+    } \
+    void intrpt(void *data)
+
+#else
+
+#define _DEFINE_RTOS_INTERRUPT_CALLBACK(intrpt, data) \
+    asm(RTOS_STRINGIFY(_DEFINE_RTOS_INTERRUPT_CALLBACK_DEF(intrpt, intrpt))); \
     _DECLARE_RTOS_INTERRUPT_CALLBACK(intrpt, data)
 
+#endif /* RTOS_SUPPORT_TRACE_ISR */
+
 
 #endif /* RTOS_INTERRUPT_IMPL_H_ */
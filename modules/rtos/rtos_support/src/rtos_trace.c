@@ -0,0 +1,21 @@
+// Copyright 2022 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include "rtos_support.h"
+
+/*
+ * Default interrupt trace hooks, called from RTOS interrupt callbacks
+ * when RTOS_SUPPORT_TRACE_ISR is 1. A tracer may replace these.
+ */
+
+__attribute__((weak))
+void rtos_trace_isr_enter(void *callback)
+{
+    (void) callback;
+}
+
+__attribute__((weak))
+void rtos_trace_isr_exit(void *callback)
+{
+    (void) callback;
+}
@@ -0,0 +1,255 @@
+// Copyright 2022 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef AUDIO_PIPELINE_H_
+#define AUDIO_PIPELINE_H_
+
+/**
+ * \addtogroup audio_pipeline audio_pipeline
+ *
+ * The public API for the audio pipeline.
+ *
+ * An audio pipeline is a graph of stages, each run by its own thread, that
+ * frames of audio are passed along. The frames come from a fixed pool that
+ * is allocated when the pipeline is started, and are passed between stages
+ * by reference, so nothing is allocated or copied while it runs.
+ *
+ * A stage with no inputs is a source. It is given an empty frame from the
+ * pool to fill. Any other stage waits for a frame from each of its inputs
+ * and is given them all, in the order that the inputs were connected. The
+ * frame from its first input is then passed on to each of its outputs, and
+ * the frames from the other inputs are returned to the pool. A stage with
+ * no outputs is a sink, and returns the frame to the pool once it has
+ * processed it.
+ *
+ * When a stage has more than one output, the same frame is passed to each
+ * of them. A stage that modifies its first input frame must say so in its
+ * configuration, and is then given a copy of it when it is shared, so that
+ * the other branches are not affected.
+ *
+ * The time each stage takes to process a frame is kept in a histogram. So
+ * is the time from each frame leaving its source to it being returned to
+ * the pool by a sink, for each sink.
+ * @{
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "rtos_osal.h"
+
+#ifdef __xcore__
+#define AUDIO_PIPELINE_STAGE_ATTR __attribute__((fptrgroup("audio_pipeline_stage")))
+#else
+#define AUDIO_PIPELINE_STAGE_ATTR
+#endif
+
+/**
+ * The most stages that a pipeline may have.
+ */
+#ifndef AUDIO_PIPELINE_MAX_STAGES
+#define AUDIO_PIPELINE_MAX_STAGES 8
+#endif
+
+/**
+ * The most inputs, and the most outputs, that a stage may have.
+ */
+#ifndef AUDIO_PIPELINE_MAX_CONNECTIONS
+#define AUDIO_PIPELINE_MAX_CONNECTIONS 4
+#endif
+
+/**
+ * The number of bins in each histogram. The last bin counts every value
+ * too large for the others.
+ */
+#ifndef AUDIO_PIPELINE_HISTOGRAM_BINS
+#define AUDIO_PIPELINE_HISTOGRAM_BINS 16
+#endif
+
+/**
+ * The default depth of the queue on each stage input.
+ */
+#ifndef AUDIO_PIPELINE_QUEUE_DEPTH
+#define AUDIO_PIPELINE_QUEUE_DEPTH 2
+#endif
+
+/**
+ * A frame of audio.
+ */
+typedef struct {
+    void *data;             /**< The frame buffer, of the pipeline's frame size */
+    uint32_t timestamp;     /**< The reference time at which the source finished filling the frame */
+    uint32_t sequence;      /**< The number of frames produced by the source before this one */
+
+    /* Private */
+    volatile unsigned refs;
+} audio_pipeline_frame_t;
+
+/**
+ * The function run by a stage for each frame.
+ *
+ * \param frames  The frames to process. For a source this is one empty
+ *                frame. For any other stage it holds one frame from each
+ *                input.
+ * \param count   The number of frames.
+ * \param arg     The argument given in the stage's configuration.
+ *
+ * \returns 0 to pass frames[0] on. Anything else drops it, for example
+ *          when a source has no audio to fill it with.
+ */
+typedef int (*audio_pipeline_stage_fn_t)(audio_pipeline_frame_t *frames[], size_t count, void *arg);
+
+/**
+ * A histogram of times, in reference clock ticks.
+ */
+typedef struct {
+    uint32_t count;         /**< The number of times added */
+    uint32_t min_ticks;
+    uint32_t max_ticks;
+    uint64_t total_ticks;
+    uint32_t bins[AUDIO_PIPELINE_HISTOGRAM_BINS]; /**< Bin i counts times from i to i + 1 bin widths */
+} audio_pipeline_histogram_t;
+
+/**
+ * The configuration of a stage.
+ */
+typedef struct {
+    const char *name;                       /**< The name of the stage's thread */
+    AUDIO_PIPELINE_STAGE_ATTR audio_pipeline_stage_fn_t function;
+    void *arg;                              /**< Passed to the function */
+    unsigned priority;                      /**< The priority of the stage's thread */
+    uint32_t core_mask;                     /**< The cores the stage may run on, or 0 for any */
+    size_t queue_depth;                     /**< The depth of each input queue, or 0 for AUDIO_PIPELINE_QUEUE_DEPTH */
+    bool modifies_frame;                    /**< Set if the function writes to frames[0] */
+} audio_pipeline_stage_config_t;
+
+typedef struct audio_pipeline_struct audio_pipeline_t;
+
+/* Private */
+typedef struct {
+    audio_pipeline_t *pipeline;
+    audio_pipeline_stage_config_t config;
+    rtos_osal_thread_t thread;
+    rtos_osal_queue_t input_queues[AUDIO_PIPELINE_MAX_CONNECTIONS];
+    size_t input_count;
+    rtos_osal_queue_t *output_queues[AUDIO_PIPELINE_MAX_CONNECTIONS];
+    size_t output_count;
+    uint32_t sequence;
+    uint32_t dropped;
+    audio_pipeline_histogram_t process_time;
+    audio_pipeline_histogram_t latency;
+} audio_pipeline_stage_t;
+
+/**
+ * Struct representing an audio pipeline.
+ *
+ * The members in this struct should not be accessed directly.
+ */
+struct audio_pipeline_struct {
+    size_t frame_size;
+    size_t frame_count;
+    uint32_t bin_ticks;
+    uint8_t *frame_data;
+    audio_pipeline_frame_t *frames;
+    rtos_osal_queue_t free_frames;
+    rtos_osal_event_group_t start_group;
+    uint32_t pool_waits;
+    audio_pipeline_stage_t stages[AUDIO_PIPELINE_MAX_STAGES];
+    size_t stage_count;
+    bool started;
+};
+
+/**
+ * Initializes an audio pipeline. Stages are then added and connected, and
+ * the pipeline started with audio_pipeline_start().
+ *
+ * \param pipeline     A pointer to the pipeline to initialize.
+ * \param frame_size   The size in bytes of each frame buffer.
+ * \param frame_count  The number of frames in the pool. Enough are needed
+ *                     to fill every queue and to have one in every stage.
+ * \param bin_ticks    The width of each histogram bin, in reference clock
+ *                     ticks.
+ */
+void audio_pipeline_init(audio_pipeline_t *pipeline,
+                         size_t frame_size,
+                         size_t frame_count,
+                         uint32_t bin_ticks);
+
+/**
+ * Adds a stage to a pipeline that has not been started.
+ *
+ * \param pipeline  A pointer to the pipeline.
+ * \param config    The configuration of the stage. This is copied.
+ *
+ * \returns the index of the stage, which identifies it to the other
+ *          functions.
+ */
+int audio_pipeline_stage_add(audio_pipeline_t *pipeline,
+                             const audio_pipeline_stage_config_t *config);
+
+/**
+ * Connects the output of one stage to a new input of another, in a
+ * pipeline that has not been started. A stage's inputs are given to its
+ * function in the order that they are connected.
+ *
+ * \param pipeline  A pointer to the pipeline.
+ * \param from      The index of the stage that frames are passed from.
+ * \param to        The index of the stage that frames are passed to.
+ */
+void audio_pipeline_connect(audio_pipeline_t *pipeline,
+                            int from,
+                            int to);
+
+/**
+ * Allocates the frame pool and the queues, and starts a thread for each
+ * stage. Nothing else is allocated by the pipeline once this returns.
+ * No stage runs until every thread has been created and restricted to
+ * its stage's cores.
+ *
+ * \param pipeline  A pointer to the pipeline.
+ *
+ * \returns RTOS_OSAL_SUCCESS, or an error if any allocation failed. On
+ * error everything that had been allocated is freed and no stage runs.
+ */
+rtos_osal_status_t audio_pipeline_start(audio_pipeline_t *pipeline);
+
+/**
+ * Gets a copy of the processing time and latency histograms of a stage.
+ * The latency histogram is only filled in for sinks.
+ *
+ * \param pipeline      A pointer to the pipeline.
+ * \param stage         The index of the stage.
+ * \param process_time  Set to the histogram of the time the stage's
+ *                      function takes, which for a source includes any time
+ *                      it spends waiting for audio. May be NULL.
+ * \param latency       Set to the histogram of the time from each frame
+ *                      leaving its source to the sink being done with it.
+ *                      May be NULL.
+ * \param dropped       Set to the number of frames that the stage dropped.
+ *                      May be NULL.
+ */
+void audio_pipeline_stage_stats_get(audio_pipeline_t *pipeline,
+                                    int stage,
+                                    audio_pipeline_histogram_t *process_time,
+                                    audio_pipeline_histogram_t *latency,
+                                    uint32_t *dropped);
+
+/**
+ * Gets the number of times a source or a copy had to wait for a frame
+ * because the pool was empty.
+ *
+ * \param pipeline  A pointer to the pipeline.
+ */
+uint32_t audio_pipeline_pool_waits_get(audio_pipeline_t *pipeline);
+
+/**
+ * Clears the statistics of every stage.
+ *
+ * \param pipeline  A pointer to the pipeline.
+ */
+void audio_pipeline_stats_reset(audio_pipeline_t *pipeline);
+
+/**@}*/
+
+#endif /* AUDIO_PIPELINE_H_ */
@@ -0,0 +1,368 @@
+// Copyright 2022 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <string.h>
+#include <xcore/assert.h>
+#include <xcore/hwtimer.h>
+
+#include "audio_pipeline.h"
+
+/* Set in the start group once every stage thread may run */
+#define PIPELINE_STARTED 0x01
+
+static void histogram_add(audio_pipeline_histogram_t *histogram,
+                          uint32_t bin_ticks,
+                          uint32_t ticks)
+{
+    uint32_t bin = ticks / bin_ticks;
+
+    if (bin >= AUDIO_PIPELINE_HISTOGRAM_BINS) {
+        bin = AUDIO_PIPELINE_HISTOGRAM_BINS - 1;
+    }
+
+    if (histogram->count == 0 || ticks < histogram->min_ticks) {
+        histogram->min_ticks = ticks;
+    }
+    if (ticks > histogram->max_ticks) {
+        histogram->max_ticks = ticks;
+    }
+    histogram->count++;
+    histogram->total_ticks += ticks;
+    histogram->bins[bin]++;
+}
+
+static audio_pipeline_frame_t *frame_acquire(audio_pipeline_t *pipeline)
+{
+    audio_pipeline_frame_t *frame;
+
+    if (rtos_osal_queue_receive(&pipeline->free_frames, &frame, RTOS_OSAL_NO_WAIT) != RTOS_OSAL_SUCCESS) {
+        int state = rtos_osal_critical_enter();
+        pipeline->pool_waits++;
+        rtos_osal_critical_exit(state);
+
+        rtos_osal_queue_receive(&pipeline->free_frames, &frame, RTOS_OSAL_WAIT_FOREVER);
+    }
+    frame->refs = 1;
+
+    return frame;
+}
+
+/*
+ * Drops a reference to a frame, returning it to the pool when it was the
+ * last one.
+ */
+static void frame_release(audio_pipeline_t *pipeline,
+                          audio_pipeline_frame_t *frame)
+{
+    unsigned refs;
+    int state;
+
+    state = rtos_osal_critical_enter();
+    refs = --frame->refs;
+    rtos_osal_critical_exit(state);
+
+    if (refs == 0) {
+        rtos_osal_queue_send(&pipeline->free_frames, &frame, RTOS_OSAL_WAIT_FOREVER);
+    }
+}
+
+static void stage_thread(audio_pipeline_stage_t *stage)
+{
+    audio_pipeline_t *pipeline = stage->pipeline;
+    audio_pipeline_frame_t *frames[AUDIO_PIPELINE_MAX_CONNECTIONS];
+    size_t frame_count = stage->input_count > 0 ? stage->input_count : 1;
+    uint32_t flags;
+
+    /* Wait until every stage has been created and restricted to its cores */
+    rtos_osal_event_group_get_bits(&pipeline->start_group, PIPELINE_STARTED,
+                                   RTOS_OSAL_OR, &flags, RTOS_OSAL_WAIT_FOREVER);
+
+    for (;;) {
+        uint32_t start;
+        uint32_t end;
+        int ret;
+
+        if (stage->input_count == 0) {
+            frames[0] = frame_acquire(pipeline);
+        } else {
+            for (int i = 0; i < stage->input_count; i++) {
+                rtos_osal_queue_receive(&stage->input_queues[i], &frames[i], RTOS_OSAL_WAIT_FOREVER);
+            }
+        }
+
+        /*
+         * A frame passed to more than one stage is copied before being
+         * modified. Checking refs in a critical section also makes sure
+         * that any other stage that has released the frame is done with it.
+         */
+        if (stage->config.modifies_frame) {
+            int state = rtos_osal_critical_enter();
+            bool shared = frames[0]->refs > 1;
+            rtos_osal_critical_exit(state);
+
+            if (shared) {
+                audio_pipeline_frame_t *copy = frame_acquire(pipeline);
+
+                memcpy(copy->data, frames[0]->data, pipeline->frame_size);
+                copy->timestamp = frames[0]->timestamp;
+                copy->sequence = frames[0]->sequence;
+                frame_release(pipeline, frames[0]);
+                frames[0] = copy;
+            }
+        }
+
+        start = get_reference_time();
+        ret = stage->config.function(frames, frame_count, stage->config.arg);
+        end = get_reference_time();
+
+        if (stage->input_count == 0) {
+            frames[0]->timestamp = end;
+            frames[0]->sequence = stage->sequence++;
+        }
+
+        for (int i = 1; i < stage->input_count; i++) {
+            frame_release(pipeline, frames[i]);
+        }
+
+        int state = rtos_osal_critical_enter();
+        histogram_add(&stage->process_time, pipeline->bin_ticks, end - start);
+        if (ret != 0) {
+            stage->dropped++;
+        } else if (stage->output_count == 0) {
+            histogram_add(&stage->latency, pipeline->bin_ticks, end - frames[0]->timestamp);
+        } else {
+            frames[0]->refs += stage->output_count - 1;
+        }
+        rtos_osal_critical_exit(state);
+
+        if (ret != 0 || stage->output_count == 0) {
+            frame_release(pipeline, frames[0]);
+        } else {
+            for (int i = 0; i < stage->output_count; i++) {
+                rtos_osal_queue_send(stage->output_queues[i], &frames[0], RTOS_OSAL_WAIT_FOREVER);
+            }
+        }
+    }
+}
+
+void audio_pipeline_init(audio_pipeline_t *pipeline,
+                         size_t frame_size,
+                         size_t frame_count,
+                         uint32_t bin_ticks)
+{
+    xassert(frame_size > 0);
+    xassert(frame_count > 0);
+    xassert(bin_ticks > 0);
+
+    memset(pipeline, 0, sizeof(audio_pipeline_t));
+    pipeline->frame_size = frame_size;
+    pipeline->frame_count = frame_count;
+    pipeline->bin_ticks = bin_ticks;
+}
+
+int audio_pipeline_stage_add(audio_pipeline_t *pipeline,
+                             const audio_pipeline_stage_config_t *config)
+{
+    audio_pipeline_stage_t *stage;
+
+    xassert(!pipeline->started);
+    xassert(pipeline->stage_count < AUDIO_PIPELINE_MAX_STAGES);
+    xassert(config->function != NULL);
+
+    stage = &pipeline->stages[pipeline->stage_count];
+    stage->pipeline = pipeline;
+    stage->config = *config;
+    if (stage->config.queue_depth == 0) {
+        stage->config.queue_depth = AUDIO_PIPELINE_QUEUE_DEPTH;
+    }
+
+    return pipeline->stage_count++;
+}
+
+void audio_pipeline_connect(audio_pipeline_t *pipeline,
+                            int from,
+                            int to)
+{
+    audio_pipeline_stage_t *from_stage;
+    audio_pipeline_stage_t *to_stage;
+
+    xassert(!pipeline->started);
+    xassert(from >= 0 && from < pipeline->stage_count);
+    xassert(to >= 0 && to < pipeline->stage_count);
+    xassert(from != to);
+
+    from_stage = &pipeline->stages[from];
+    to_stage = &pipeline->stages[to];
+    xassert(from_stage->output_count < AUDIO_PIPELINE_MAX_CONNECTIONS);
+    xassert(to_stage->input_count < AUDIO_PIPELINE_MAX_CONNECTIONS);
+
+    from_stage->output_queues[from_stage->output_count++] = &to_stage->input_queues[to_stage->input_count++];
+}
+
+/*
+ * Undoes a failed audio_pipeline_start(). The start group and the first
+ * queue_count queues have been created, counting the pool followed by each
+ * stage's inputs in order, as have the first thread_count stage threads.
+ * None of the threads have passed the start group yet.
+ */
+static void pipeline_free(audio_pipeline_t *pipeline,
+                          int queue_count,
+                          int thread_count)
+{
+    for (int i = 0; i < thread_count; i++) {
+        rtos_osal_thread_delete(&pipeline->stages[i].thread);
+    }
+
+    if (queue_count > 0) {
+        rtos_osal_queue_delete(&pipeline->free_frames);
+        queue_count--;
+    }
+    for (int i = 0; i < pipeline->stage_count && queue_count > 0; i++) {
+        audio_pipeline_stage_t *stage = &pipeline->stages[i];
+
+        for (int j = 0; j < stage->input_count && queue_count > 0; j++, queue_count--) {
+            rtos_osal_queue_delete(&stage->input_queues[j]);
+        }
+    }
+
+    rtos_osal_event_group_delete(&pipeline->start_group);
+    rtos_osal_free(pipeline->frame_data);
+    rtos_osal_free(pipeline->frames);
+    pipeline->frame_data = NULL;
+    pipeline->frames = NULL;
+}
+
+rtos_osal_status_t audio_pipeline_start(audio_pipeline_t *pipeline)
+{
+    rtos_osal_status_t status;
+    int queue_count = 0;
+    /* Keeps every frame buffer double word aligned */
+    size_t stride = (pipeline->frame_size + 7) & ~7;
+
+    xassert(!pipeline->started);
+
+    pipeline->frame_data = rtos_osal_malloc(pipeline->frame_count * stride);
+    pipeline->frames = rtos_osal_malloc(pipeline->frame_count * sizeof(audio_pipeline_frame_t));
+    if (pipeline->frame_data == NULL || pipeline->frames == NULL) {
+        rtos_osal_free(pipeline->frame_data);
+        rtos_osal_free(pipeline->frames);
+        pipeline->frame_data = NULL;
+        pipeline->frames = NULL;
+        return RTOS_OSAL_ERROR;
+    }
+
+    status = rtos_osal_event_group_create(&pipeline->start_group, "ap_start");
+    if (status != RTOS_OSAL_SUCCESS) {
+        rtos_osal_free(pipeline->frame_data);
+        rtos_osal_free(pipeline->frames);
+        pipeline->frame_data = NULL;
+        pipeline->frames = NULL;
+        return status;
+    }
+
+    status = rtos_osal_queue_create(&pipeline->free_frames, "ap_pool", pipeline->frame_count, sizeof(audio_pipeline_frame_t *));
+    if (status != RTOS_OSAL_SUCCESS) {
+        pipeline_free(pipeline, queue_count, 0);
+        return status;
+    }
+    queue_count++;
+
+    for (int i = 0; i < pipeline->frame_count; i++) {
+        audio_pipeline_frame_t *frame = &pipeline->frames[i];
+
+        frame->data = &pipeline->frame_data[i * stride];
+        frame->timestamp = 0;
+        frame->sequence = 0;
+        frame->refs = 0;
+        rtos_osal_queue_send(&pipeline->free_frames, &frame, RTOS_OSAL_NO_WAIT);
+    }
+
+    for (int i = 0; i < pipeline->stage_count; i++) {
+        audio_pipeline_stage_t *stage = &pipeline->stages[i];
+
+        for (int j = 0; j < stage->input_count; j++) {
+            status = rtos_osal_queue_create(&stage->input_queues[j], "ap_stage", stage->config.queue_depth, sizeof(audio_pipeline_frame_t *));
+            if (status != RTOS_OSAL_SUCCESS) {
+                pipeline_free(pipeline, queue_count, 0);
+                return status;
+            }
+            queue_count++;
+        }
+    }
+
+    /*
+     * The threads wait on the start group, so each one is restricted to its
+     * cores before it processes anything, and they can still be deleted if
+     * a later one cannot be created.
+     */
+    for (int i = 0; i < pipeline->stage_count; i++) {
+        audio_pipeline_stage_t *stage = &pipeline->stages[i];
+
+        status = rtos_osal_thread_create(
+                &stage->thread,
+                (char *) stage->config.name,
+                (rtos_osal_entry_function_t) stage_thread,
+                stage,
+                RTOS_THREAD_STACK_SIZE(stage_thread),
+                stage->config.priority);
+        if (status != RTOS_OSAL_SUCCESS) {
+            pipeline_free(pipeline, queue_count, i);
+            return status;
+        }
+
+        if (stage->config.core_mask != 0) {
+            rtos_osal_thread_core_exclusion_set(&stage->thread, ~stage->config.core_mask);
+        }
+    }
+
+    pipeline->started = true;
+    rtos_osal_event_group_set_bits(&pipeline->start_group, PIPELINE_STARTED);
+
+    return RTOS_OSAL_SUCCESS;
+}
+
+void audio_pipeline_stage_stats_get(audio_pipeline_t *pipeline,
+                                    int stage,
+                                    audio_pipeline_histogram_t *process_time,
+                                    audio_pipeline_histogram_t *latency,
+                                    uint32_t *dropped)
+{
+    audio_pipeline_stage_t *s;
+    int state;
+
+    xassert(stage >= 0 && stage < pipeline->stage_count);
+    s = &pipeline->stages[stage];
+
+    state = rtos_osal_critical_enter();
+    if (process_time != NULL) {
+        *process_time = s->process_time;
+    }
+    if (latency != NULL) {
+        *latency = s->latency;
+    }
+    if (dropped != NULL) {
+        *dropped = s->dropped;
+    }
+    rtos_osal_critical_exit(state);
+}
+
+uint32_t audio_pipeline_pool_waits_get(audio_pipeline_t *pipeline)
+{
+    return pipeline->pool_waits;
+}
+
+void audio_pipeline_stats_reset(audio_pipeline_t *pipeline)
+{
+    int state = rtos_osal_critical_enter();
+
+    for (int i = 0; i < pipeline->stage_count; i++) {
+        audio_pipeline_stage_t *stage = &pipeline->stages[i];
+
+        memset(&stage->process_time, 0, sizeof(stage->process_time));
+        memset(&stage->latency, 0, sizeof(stage->latency));
+        stage->dropped = 0;
+    }
+    pipeline->pool_waits = 0;
+
+    rtos_osal_critical_exit(state);
+}
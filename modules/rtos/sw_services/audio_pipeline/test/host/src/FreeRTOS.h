@@ -0,0 +1,36 @@
+// Copyright 2022 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+
+#ifndef FREERTOS_H_
+#define FREERTOS_H_
+
+/*
+ * The parts of the FreeRTOS API that the audio pipeline tests use, on top of
+ * the host RTOS OSAL.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "rtos_osal.h"
+
+#define configMAX_PRIORITIES 32
+
+#define pdFALSE 0
+#define pdTRUE 1
+
+/* One tick is one millisecond, as in the host RTOS OSAL */
+#define pdMS_TO_TICKS(ms) (ms)
+
+#define debug_printf printf
+#define rtos_printf printf
+
+/* The notional heap that xPortGetFreeHeapSize() reports against */
+#define HOST_HEAP_SIZE (64 * 1024 * 1024)
+
+static inline size_t xPortGetFreeHeapSize(void) {
+  return HOST_HEAP_SIZE - rtos_osal_host_allocated_get();
+}
+
+#endif /* FREERTOS_H_ */
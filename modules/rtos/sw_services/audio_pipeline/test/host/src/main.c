@@ -0,0 +1,11 @@
+// Copyright 2022 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+
+#include "unity.h"
+#include "unity_fixture.h"
+
+static void RunAllTests(void) { RUN_TEST_GROUP(audio_pipeline); }
+
+int main(int argc, const char *argv[]) {
+  return UnityMain(argc, argv, RunAllTests);
+}
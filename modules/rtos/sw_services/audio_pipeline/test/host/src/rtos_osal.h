@@ -0,0 +1,88 @@
+// Copyright 2022 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+
+#ifndef RTOS_OSAL_H_
+#define RTOS_OSAL_H_
+
+/*
+ * The parts of the RTOS OSAL that the audio pipeline uses, implemented with
+ * POSIX threads so that it and its tests can be run on the host.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+typedef enum {
+    RTOS_OSAL_SUCCESS = 0,
+    RTOS_OSAL_ERROR = 1,
+    RTOS_OSAL_TIMEOUT = 2,
+} rtos_osal_status_t;
+
+#define RTOS_OSAL_NO_WAIT       0
+#define RTOS_OSAL_WAIT_FOREVER  0xFFFFFFFF
+
+#define RTOS_OSAL_OR            0
+#define RTOS_OSAL_OR_CLEAR      1
+#define RTOS_OSAL_AND           2
+#define RTOS_OSAL_AND_CLEAR     3
+
+#define RTOS_THREAD_STACK_SIZE(thread_entry) 0
+
+typedef void (*rtos_osal_entry_function_t)(void *);
+
+typedef struct rtos_osal_thread_struct {
+    pthread_t thread;
+} rtos_osal_thread_t;
+
+typedef struct rtos_osal_queue_struct {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    uint8_t *items;
+    size_t item_size;
+    size_t length;
+    size_t head;
+    size_t count;
+} rtos_osal_queue_t;
+
+typedef struct rtos_osal_event_group_struct {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    uint32_t bits;
+} rtos_osal_event_group_t;
+
+int rtos_osal_critical_enter(void);
+void rtos_osal_critical_exit(int state);
+
+void *rtos_osal_malloc(size_t size);
+void rtos_osal_free(void *ptr);
+
+/* The number of bytes allocated with rtos_osal_malloc() and not yet freed */
+size_t rtos_osal_host_allocated_get(void);
+
+rtos_osal_status_t rtos_osal_thread_create(
+        rtos_osal_thread_t *thread,
+        char *name,
+        rtos_osal_entry_function_t entry_function,
+        void *entry_input,
+        size_t stack_word_size,
+        unsigned int priority);
+rtos_osal_status_t rtos_osal_thread_core_exclusion_set(rtos_osal_thread_t *thread, uint32_t core_map);
+rtos_osal_status_t rtos_osal_thread_delete(rtos_osal_thread_t *thread);
+
+rtos_osal_status_t rtos_osal_queue_create(rtos_osal_queue_t *queue, char *name, size_t queue_length, size_t item_size);
+rtos_osal_status_t rtos_osal_queue_send(rtos_osal_queue_t *queue, const void *item, unsigned timeout);
+rtos_osal_status_t rtos_osal_queue_receive(rtos_osal_queue_t *queue, void *item, unsigned timeout);
+rtos_osal_status_t rtos_osal_queue_delete(rtos_osal_queue_t *queue);
+
+rtos_osal_status_t rtos_osal_event_group_create(rtos_osal_event_group_t *group, char *name);
+rtos_osal_status_t rtos_osal_event_group_set_bits(rtos_osal_event_group_t *group, uint32_t flags_to_set);
+rtos_osal_status_t rtos_osal_event_group_get_bits(
+        rtos_osal_event_group_t *group,
+        uint32_t requested,
+        unsigned get_option,
+        uint32_t *actual,
+        unsigned timeout);
+rtos_osal_status_t rtos_osal_event_group_delete(rtos_osal_event_group_t *group);
+
+#endif /* RTOS_OSAL_H_ */
@@ -0,0 +1,277 @@
+// Copyright 2022 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "rtos_osal.h"
+
+/* Timeouts are in RTOS ticks, which are taken to be 1 ms */
+#define TICKS_PER_SECOND 1000
+
+/* Keeps the memory returned by rtos_osal_malloc() aligned for any type */
+#define ALLOC_HEADER_SIZE 16
+
+static pthread_mutex_t critical_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t allocated;
+
+static struct timespec deadline_get(unsigned timeout) {
+  struct timespec deadline;
+
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += timeout / TICKS_PER_SECOND;
+  deadline.tv_nsec += (long)(timeout % TICKS_PER_SECOND) *
+                      (1000000000 / TICKS_PER_SECOND);
+  if (deadline.tv_nsec >= 1000000000) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+
+  return deadline;
+}
+
+// Waits on cond until it is signalled or timeout ticks have passed. Returns
+// false on timeout.
+static bool cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock,
+                      unsigned timeout, const struct timespec *deadline) {
+  if (timeout == RTOS_OSAL_NO_WAIT) {
+    return false;
+  }
+  if (timeout == RTOS_OSAL_WAIT_FOREVER) {
+    pthread_cond_wait(cond, lock);
+    return true;
+  }
+  return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+int rtos_osal_critical_enter(void) {
+  pthread_mutex_lock(&critical_lock);
+  return 0;
+}
+
+void rtos_osal_critical_exit(int state) {
+  (void)state;
+  pthread_mutex_unlock(&critical_lock);
+}
+
+void *rtos_osal_malloc(size_t size) {
+  uint8_t *block = malloc(ALLOC_HEADER_SIZE + size);
+
+  if (block == NULL) {
+    return NULL;
+  }
+
+  *(size_t *)block = size;
+  pthread_mutex_lock(&critical_lock);
+  allocated += size;
+  pthread_mutex_unlock(&critical_lock);
+
+  return block + ALLOC_HEADER_SIZE;
+}
+
+void rtos_osal_free(void *ptr) {
+  uint8_t *block;
+
+  if (ptr == NULL) {
+    return;
+  }
+
+  block = (uint8_t *)ptr - ALLOC_HEADER_SIZE;
+  pthread_mutex_lock(&critical_lock);
+  allocated -= *(size_t *)block;
+  pthread_mutex_unlock(&critical_lock);
+  free(block);
+}
+
+size_t rtos_osal_host_allocated_get(void) {
+  size_t bytes;
+
+  pthread_mutex_lock(&critical_lock);
+  bytes = allocated;
+  pthread_mutex_unlock(&critical_lock);
+
+  return bytes;
+}
+
+typedef struct {
+  rtos_osal_entry_function_t entry_function;
+  void *entry_input;
+} thread_start_t;
+
+static void *thread_entry(void *arg) {
+  thread_start_t start = *(thread_start_t *)arg;
+
+  free(arg);
+  start.entry_function(start.entry_input);
+
+  return NULL;
+}
+
+rtos_osal_status_t rtos_osal_thread_create(
+    rtos_osal_thread_t *thread, char *name,
+    rtos_osal_entry_function_t entry_function, void *entry_input,
+    size_t stack_word_size, unsigned int priority) {
+  thread_start_t *start = malloc(sizeof(thread_start_t));
+
+  (void)name;
+  (void)stack_word_size;
+  (void)priority;
+
+  if (start == NULL) {
+    return RTOS_OSAL_ERROR;
+  }
+  start->entry_function = entry_function;
+  start->entry_input = entry_input;
+
+  if (pthread_create(&thread->thread, NULL, thread_entry, start) != 0) {
+    free(start);
+    return RTOS_OSAL_ERROR;
+  }
+  pthread_detach(thread->thread);
+
+  return RTOS_OSAL_SUCCESS;
+}
+
+rtos_osal_status_t rtos_osal_thread_core_exclusion_set(
+    rtos_osal_thread_t *thread, uint32_t core_map) {
+  /* The host has no cores to restrict threads to */
+  (void)thread;
+  (void)core_map;
+
+  return RTOS_OSAL_SUCCESS;
+}
+
+rtos_osal_status_t rtos_osal_thread_delete(rtos_osal_thread_t *thread) {
+  return pthread_cancel(thread->thread) == 0 ? RTOS_OSAL_SUCCESS
+                                             : RTOS_OSAL_ERROR;
+}
+
+rtos_osal_status_t rtos_osal_queue_create(rtos_osal_queue_t *queue,
+                                          char *name, size_t queue_length,
+                                          size_t item_size) {
+  (void)name;
+
+  queue->items = rtos_osal_malloc(queue_length * item_size);
+  if (queue->items == NULL) {
+    return RTOS_OSAL_ERROR;
+  }
+  queue->item_size = item_size;
+  queue->length = queue_length;
+  queue->head = 0;
+  queue->count = 0;
+  pthread_mutex_init(&queue->lock, NULL);
+  pthread_cond_init(&queue->changed, NULL);
+
+  return RTOS_OSAL_SUCCESS;
+}
+
+rtos_osal_status_t rtos_osal_queue_send(rtos_osal_queue_t *queue,
+                                        const void *item, unsigned timeout) {
+  struct timespec deadline = deadline_get(timeout);
+  size_t tail;
+
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == queue->length) {
+    if (!cond_wait(&queue->changed, &queue->lock, timeout, &deadline)) {
+      pthread_mutex_unlock(&queue->lock);
+      return RTOS_OSAL_TIMEOUT;
+    }
+  }
+
+  tail = (queue->head + queue->count) % queue->length;
+  memcpy(&queue->items[tail * queue->item_size], item, queue->item_size);
+  queue->count++;
+  pthread_cond_broadcast(&queue->changed);
+  pthread_mutex_unlock(&queue->lock);
+
+  return RTOS_OSAL_SUCCESS;
+}
+
+rtos_osal_status_t rtos_osal_queue_receive(rtos_osal_queue_t *queue,
+                                           void *item, unsigned timeout) {
+  struct timespec deadline = deadline_get(timeout);
+
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == 0) {
+    if (!cond_wait(&queue->changed, &queue->lock, timeout, &deadline)) {
+      pthread_mutex_unlock(&queue->lock);
+      return RTOS_OSAL_TIMEOUT;
+    }
+  }
+
+  memcpy(item, &queue->items[queue->head * queue->item_size],
+         queue->item_size);
+  queue->head = (queue->head + 1) % queue->length;
+  queue->count--;
+  pthread_cond_broadcast(&queue->changed);
+  pthread_mutex_unlock(&queue->lock);
+
+  return RTOS_OSAL_SUCCESS;
+}
+
+rtos_osal_status_t rtos_osal_queue_delete(rtos_osal_queue_t *queue) {
+  pthread_cond_destroy(&queue->changed);
+  pthread_mutex_destroy(&queue->lock);
+  rtos_osal_free(queue->items);
+
+  return RTOS_OSAL_SUCCESS;
+}
+
+rtos_osal_status_t rtos_osal_event_group_create(rtos_osal_event_group_t *group,
+                                                char *name) {
+  (void)name;
+
+  group->bits = 0;
+  pthread_mutex_init(&group->lock, NULL);
+  pthread_cond_init(&group->changed, NULL);
+
+  return RTOS_OSAL_SUCCESS;
+}
+
+rtos_osal_status_t rtos_osal_event_group_set_bits(
+    rtos_osal_event_group_t *group, uint32_t flags_to_set) {
+  pthread_mutex_lock(&group->lock);
+  group->bits |= flags_to_set;
+  pthread_cond_broadcast(&group->changed);
+  pthread_mutex_unlock(&group->lock);
+
+  return RTOS_OSAL_SUCCESS;
+}
+
+rtos_osal_status_t rtos_osal_event_group_get_bits(
+    rtos_osal_event_group_t *group, uint32_t requested, unsigned get_option,
+    uint32_t *actual, unsigned timeout) {
+  struct timespec deadline = deadline_get(timeout);
+  bool all = get_option == RTOS_OSAL_AND || get_option == RTOS_OSAL_AND_CLEAR;
+  bool clear =
+      get_option == RTOS_OSAL_OR_CLEAR || get_option == RTOS_OSAL_AND_CLEAR;
+
+  pthread_mutex_lock(&group->lock);
+  while (all ? (group->bits & requested) != requested
+             : (group->bits & requested) == 0) {
+    if (!cond_wait(&group->changed, &group->lock, timeout, &deadline)) {
+      *actual = group->bits;
+      pthread_mutex_unlock(&group->lock);
+      return RTOS_OSAL_TIMEOUT;
+    }
+  }
+
+  *actual = group->bits;
+  if (clear) {
+    group->bits &= ~requested;
+  }
+  pthread_mutex_unlock(&group->lock);
+
+  return RTOS_OSAL_SUCCESS;
+}
+
+rtos_osal_status_t rtos_osal_event_group_delete(
+    rtos_osal_event_group_t *group) {
+  pthread_cond_destroy(&group->changed);
+  pthread_mutex_destroy(&group->lock);
+
+  return RTOS_OSAL_SUCCESS;
+}
@@ -0,0 +1,32 @@
+// Copyright 2022 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+
+#ifndef SEMPHR_H_
+#define SEMPHR_H_
+
+#include "FreeRTOS.h"
+
+/* A binary semaphore is an event group with a single bit */
+typedef rtos_osal_event_group_t *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+  SemaphoreHandle_t semaphore = rtos_osal_malloc(sizeof(*semaphore));
+
+  rtos_osal_event_group_create(semaphore, "semaphore");
+
+  return semaphore;
+}
+
+static inline int xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  return rtos_osal_event_group_set_bits(semaphore, 1) == RTOS_OSAL_SUCCESS;
+}
+
+static inline int xSemaphoreTake(SemaphoreHandle_t semaphore,
+                                 unsigned timeout) {
+  uint32_t flags;
+
+  return rtos_osal_event_group_get_bits(semaphore, 1, RTOS_OSAL_OR_CLEAR,
+                                        &flags, timeout) == RTOS_OSAL_SUCCESS;
+}
+
+#endif /* SEMPHR_H_ */
@@ -0,0 +1,29 @@
+// Copyright 2022 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+
+#ifndef TASK_H_
+#define TASK_H_
+
+#include <time.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+
+/* Only suspending the calling thread is supported */
+static inline void vTaskSuspend(void *task) {
+  (void)task;
+  for (;;) {
+    pause();
+  }
+}
+
+static inline void vTaskDelay(unsigned ticks) {
+  struct timespec delay = {
+      .tv_sec = ticks / 1000,
+      .tv_nsec = (long)(ticks % 1000) * 1000000,
+  };
+
+  nanosleep(&delay, NULL);
+}
+
+#endif /* TASK_H_ */
@@ -0,0 +1,19 @@
+// Copyright 2022 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+
+#ifndef XCORE_HWTIMER_H_
+#define XCORE_HWTIMER_H_
+
+#include <stdint.h>
+#include <time.h>
+
+/* The monotonic clock in ticks of the 100 MHz xcore reference clock */
+static inline uint32_t get_reference_time(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (uint32_t)((uint64_t)now.tv_sec * 100000000 + now.tv_nsec / 10);
+}
+
+#endif /* XCORE_HWTIMER_H_ */
@@ -0,0 +1,290 @@
+// Copyright 2022 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
+#include "audio_pipeline.h"
+#include "unity.h"
+#include "unity_fixture.h"
+
+#define STAGE_PRIORITY (configMAX_PRIORITIES - 2)
+
+#define FRAME_LENGTH 16
+#define FRAME_TOTAL 200
+#define FRAME_COUNT 8
+#define BIN_TICKS 1000
+
+typedef struct test_source {
+  int32_t first_sample;
+  int constant;
+  int drop_odd;
+  uint32_t produced;
+} test_source_t;
+
+typedef struct test_sink {
+  int32_t expected_offset;
+  uint32_t total;
+  volatile uint32_t received;
+  volatile uint32_t errors;
+  uint32_t next_sequence;
+  SemaphoreHandle_t done;
+} test_sink_t;
+
+// Fills each frame with a ramp starting at the frame number, or with
+// first_sample if the source is constant, and then stops once FRAME_TOTAL
+// frames have been produced.
+AUDIO_PIPELINE_STAGE_ATTR
+int test_source_fn(audio_pipeline_frame_t *frames[], size_t count, void *arg) {
+  test_source_t *source = (test_source_t *)arg;
+  int32_t *samples = frames[0]->data;
+  uint32_t n;
+
+  if (source->produced == FRAME_TOTAL) {
+    vTaskSuspend(NULL);
+  }
+
+  n = source->produced++;
+  for (int i = 0; i < FRAME_LENGTH; i++) {
+    samples[i] = source->first_sample + (source->constant ? 0 : n + i);
+  }
+
+  return source->drop_odd && (n & 1);
+}
+
+AUDIO_PIPELINE_STAGE_ATTR
+int test_add_one_fn(audio_pipeline_frame_t *frames[], size_t count, void *arg) {
+  int32_t *samples = frames[0]->data;
+
+  for (int i = 0; i < FRAME_LENGTH; i++) {
+    samples[i] += 1;
+  }
+
+  return 0;
+}
+
+// Sums the frames from every input into the first, after checking that
+// they all came from the same point in each source.
+AUDIO_PIPELINE_STAGE_ATTR
+int test_mix_fn(audio_pipeline_frame_t *frames[], size_t count, void *arg) {
+  volatile uint32_t *misaligned = (volatile uint32_t *)arg;
+  int32_t *out = frames[0]->data;
+
+  for (int j = 1; j < count; j++) {
+    int32_t *in = frames[j]->data;
+
+    if (frames[j]->sequence != frames[0]->sequence) {
+      (*misaligned)++;
+    }
+    for (int i = 0; i < FRAME_LENGTH; i++) {
+      out[i] += in[i];
+    }
+  }
+
+  return 0;
+}
+
+// Checks that each frame holds the source's ramp plus expected_offset, in
+// order.
+AUDIO_PIPELINE_STAGE_ATTR
+int test_sink_fn(audio_pipeline_frame_t *frames[], size_t count, void *arg) {
+  test_sink_t *sink = (test_sink_t *)arg;
+  int32_t *samples = frames[0]->data;
+  uint32_t n = frames[0]->sequence;
+
+  if (n < sink->next_sequence) {
+    sink->errors++;
+  }
+  sink->next_sequence = n + 1;
+
+  for (int i = 0; i < FRAME_LENGTH; i++) {
+    if (samples[i] != sink->expected_offset + (int32_t)(n + i)) {
+      sink->errors++;
+      break;
+    }
+  }
+
+  if (++sink->received == sink->total) {
+    xSemaphoreGive(sink->done);
+  }
+
+  return 0;
+}
+
+static int test_stage_add(audio_pipeline_t *pipeline, const char *name,
+                          audio_pipeline_stage_fn_t function, void *arg,
+                          bool modifies_frame) {
+  audio_pipeline_stage_config_t config = {
+      .name = name,
+      .function = function,
+      .arg = arg,
+      .priority = STAGE_PRIORITY,
+      .core_mask = 0,
+      .queue_depth = 0,
+      .modifies_frame = modifies_frame,
+  };
+
+  return audio_pipeline_stage_add(pipeline, &config);
+}
+
+static void test_sink_init(test_sink_t *sink, int32_t expected_offset,
+                           uint32_t total) {
+  memset(sink, 0, sizeof(test_sink_t));
+  sink->expected_offset = expected_offset;
+  sink->total = total;
+  sink->done = xSemaphoreCreateBinary();
+}
+
+static void test_sink_wait(test_sink_t *sink) {
+  TEST_ASSERT_EQUAL_INT(pdTRUE, xSemaphoreTake(sink->done, pdMS_TO_TICKS(5000)));
+  TEST_ASSERT_EQUAL_UINT32(sink->total, sink->received);
+  TEST_ASSERT_EQUAL_UINT32(0, sink->errors);
+}
+
+TEST_GROUP(audio_pipeline);
+
+TEST_SETUP(audio_pipeline) {}
+
+TEST_TEAR_DOWN(audio_pipeline) {}
+
+// The stages of each test are left blocked once it finishes, so every test
+// has its own pipeline, and everything that the stages use is static.
+
+TEST(audio_pipeline, test_linear) {
+  static audio_pipeline_t pipeline;
+  static test_source_t source = {0};
+  static test_sink_t sink;
+  audio_pipeline_histogram_t latency;
+  uint32_t total = 0;
+  int src, gain, snk;
+
+  test_sink_init(&sink, 1, FRAME_TOTAL);
+
+  audio_pipeline_init(&pipeline, FRAME_LENGTH * sizeof(int32_t), FRAME_COUNT,
+                      BIN_TICKS);
+  src = test_stage_add(&pipeline, "src", test_source_fn, &source, false);
+  gain = test_stage_add(&pipeline, "gain", test_add_one_fn, NULL, true);
+  snk = test_stage_add(&pipeline, "sink", test_sink_fn, &sink, false);
+  audio_pipeline_connect(&pipeline, src, gain);
+  audio_pipeline_connect(&pipeline, gain, snk);
+  TEST_ASSERT_EQUAL_INT(RTOS_OSAL_SUCCESS, audio_pipeline_start(&pipeline));
+
+  test_sink_wait(&sink);
+
+  // Give the sink time to record the latency of the last frame
+  vTaskDelay(pdMS_TO_TICKS(10));
+  audio_pipeline_stage_stats_get(&pipeline, snk, NULL, &latency, NULL);
+  TEST_ASSERT_EQUAL_UINT32(FRAME_TOTAL, latency.count);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(latency.max_ticks, latency.min_ticks);
+  for (int i = 0; i < AUDIO_PIPELINE_HISTOGRAM_BINS; i++) {
+    total += latency.bins[i];
+  }
+  TEST_ASSERT_EQUAL_UINT32(FRAME_TOTAL, total);
+}
+
+TEST(audio_pipeline, test_fan_out_copies_modified_frames) {
+  static audio_pipeline_t pipeline;
+  static test_source_t source = {0};
+  static test_sink_t modified_sink;
+  static test_sink_t unmodified_sink;
+  int src, gain, snk0, snk1;
+
+  test_sink_init(&modified_sink, 1, FRAME_TOTAL);
+  test_sink_init(&unmodified_sink, 0, FRAME_TOTAL);
+
+  audio_pipeline_init(&pipeline, FRAME_LENGTH * sizeof(int32_t), FRAME_COUNT,
+                      BIN_TICKS);
+  src = test_stage_add(&pipeline, "src", test_source_fn, &source, false);
+  gain = test_stage_add(&pipeline, "gain", test_add_one_fn, NULL, true);
+  snk0 = test_stage_add(&pipeline, "sink0", test_sink_fn, &modified_sink, false);
+  snk1 = test_stage_add(&pipeline, "sink1", test_sink_fn, &unmodified_sink, false);
+  audio_pipeline_connect(&pipeline, src, gain);
+  audio_pipeline_connect(&pipeline, src, snk1);
+  audio_pipeline_connect(&pipeline, gain, snk0);
+  TEST_ASSERT_EQUAL_INT(RTOS_OSAL_SUCCESS, audio_pipeline_start(&pipeline));
+
+  test_sink_wait(&modified_sink);
+  test_sink_wait(&unmodified_sink);
+}
+
+TEST(audio_pipeline, test_fan_in_aligns_sources) {
+  static audio_pipeline_t pipeline;
+  static test_source_t source0 = {0};
+  static test_source_t source1 = {.first_sample = 1000, .constant = 1};
+  static volatile uint32_t misaligned = 0;
+  static test_sink_t sink;
+  int src0, src1, mix, snk;
+
+  test_sink_init(&sink, 1000, FRAME_TOTAL);
+
+  audio_pipeline_init(&pipeline, FRAME_LENGTH * sizeof(int32_t), FRAME_COUNT,
+                      BIN_TICKS);
+  src0 = test_stage_add(&pipeline, "src0", test_source_fn, &source0, false);
+  src1 = test_stage_add(&pipeline, "src1", test_source_fn, &source1, false);
+  mix = test_stage_add(&pipeline, "mix", test_mix_fn, (void *)&misaligned, true);
+  snk = test_stage_add(&pipeline, "sink", test_sink_fn, &sink, false);
+  audio_pipeline_connect(&pipeline, src0, mix);
+  audio_pipeline_connect(&pipeline, src1, mix);
+  audio_pipeline_connect(&pipeline, mix, snk);
+  TEST_ASSERT_EQUAL_INT(RTOS_OSAL_SUCCESS, audio_pipeline_start(&pipeline));
+
+  test_sink_wait(&sink);
+  TEST_ASSERT_EQUAL_UINT32(0, misaligned);
+}
+
+TEST(audio_pipeline, test_dropped_frames) {
+  static audio_pipeline_t pipeline;
+  static test_source_t source = {.drop_odd = 1};
+  static test_sink_t sink;
+  uint32_t dropped;
+  int src, snk;
+
+  test_sink_init(&sink, 0, FRAME_TOTAL / 2);
+
+  audio_pipeline_init(&pipeline, FRAME_LENGTH * sizeof(int32_t), FRAME_COUNT,
+                      BIN_TICKS);
+  src = test_stage_add(&pipeline, "src", test_source_fn, &source, false);
+  snk = test_stage_add(&pipeline, "sink", test_sink_fn, &sink, false);
+  audio_pipeline_connect(&pipeline, src, snk);
+  TEST_ASSERT_EQUAL_INT(RTOS_OSAL_SUCCESS, audio_pipeline_start(&pipeline));
+
+  test_sink_wait(&sink);
+
+  // Give the source time to drop the last odd frame
+  vTaskDelay(pdMS_TO_TICKS(10));
+  audio_pipeline_stage_stats_get(&pipeline, src, NULL, NULL, &dropped);
+  TEST_ASSERT_EQUAL_UINT32(FRAME_TOTAL / 2, dropped);
+}
+
+TEST(audio_pipeline, test_no_allocation_after_start) {
+  static audio_pipeline_t pipeline;
+  static test_source_t source = {0};
+  static test_sink_t sink;
+  size_t heap_free;
+  int src, gain, snk;
+
+  test_sink_init(&sink, 1, FRAME_TOTAL);
+
+  audio_pipeline_init(&pipeline, FRAME_LENGTH * sizeof(int32_t), FRAME_COUNT,
+                      BIN_TICKS);
+  src = test_stage_add(&pipeline, "src", test_source_fn, &source, false);
+  gain = test_stage_add(&pipeline, "gain", test_add_one_fn, NULL, true);
+  snk = test_stage_add(&pipeline, "sink", test_sink_fn, &sink, false);
+  audio_pipeline_connect(&pipeline, src, gain);
+  audio_pipeline_connect(&pipeline, gain, snk);
+  TEST_ASSERT_EQUAL_INT(RTOS_OSAL_SUCCESS, audio_pipeline_start(&pipeline));
+  heap_free = xPortGetFreeHeapSize();
+
+  test_sink_wait(&sink);
+  TEST_ASSERT_EQUAL_UINT32(heap_free, xPortGetFreeHeapSize());
+}
+
+TEST_GROUP_RUNNER(audio_pipeline) {
+  RUN_TEST_CASE(audio_pipeline, test_linear);
+  RUN_TEST_CASE(audio_pipeline, test_fan_out_copies_modified_frames);
+  RUN_TEST_CASE(audio_pipeline, test_fan_in_aligns_sources);
+  RUN_TEST_CASE(audio_pipeline, test_dropped_frames);
+  RUN_TEST_CASE(audio_pipeline, test_no_allocation_after_start);
+}
@@ -18,11 +18,21 @@
 typedef enum {
     MRSW_READER_PREFERRED = 0,
     MRSW_WRITER_PREFERRED,
+    MRSW_SEQLOCK,
     MRSW_COUNT
 } mrsw_lock_type_t;
 
 #include "rtos_osal.h"
 
+/**
+ * The number of times that a seqlock reader retries a read that overlapped
+ * a write before it delays for a tick, to let a writer that has been
+ * preempted on the reader's core finish.
+ */
+#ifndef MRSW_SEQLOCK_SPIN_COUNT
+#define MRSW_SEQLOCK_SPIN_COUNT 100
+#endif
+
 /**
  * Struct representing an MRSW instance.
  *
@@ -57,6 +67,16 @@ typedef struct write_pref_mrsw_lock {
     uint32_t writer_active;
 } write_pref_mrsw_lock_t;
 
+/**
+ * Struct representing a sequence lock MRSW
+ *
+ * The members in this struct should not be accessed directly.
+ */
+typedef struct seq_mrsw_lock {
+    rtos_osal_mutex_t lock_writers;
+    volatile uint32_t sequence;
+} seq_mrsw_lock_t;
+
 /**
  * Create a MRSW lock
  *
@@ -90,6 +110,9 @@ rtos_osal_status_t mrsw_lock_delete(mrsw_lock_t *ctx);
 /**
  * Attempt to acquire a lock as a reader.
  *
+ * Readers of an MRSW_SEQLOCK lock never hold it, and must use
+ * mrsw_lock_read_begin() and mrsw_lock_read_retry() instead.
+ *
  * \param ctx     A pointer to the associated lock context
  * \param timeout A timeout before giving up
  *
@@ -113,6 +136,68 @@ rtos_osal_status_t mrsw_lock_reader_put(mrsw_lock_t *ctx);
 
 /**@}*/
 
+/**
+ * \addtogroup multiple_reader_single_writer_lock_seqlock multiple_reader_single_writer_lock_seqlock
+ *
+ * The functions for reading data guarded by an MRSW_SEQLOCK lock.
+ *
+ * A writer takes a seqlock with mrsw_lock_writer_get() like any other MRSW
+ * lock. Writers exclude each other with a mutex, and each one publishes a
+ * new version of the data by incrementing the lock's sequence count before
+ * and after it writes. Readers take no mutex and never enter a critical
+ * section. They read the sequence count, read the data, and then read the
+ * data again if a write overlapped it:
+ *
+ * \code
+ * uint32_t seq;
+ * do {
+ *     seq = mrsw_lock_read_begin(&lock);
+ *     local = shared;
+ * } while (mrsw_lock_read_retry(&lock, seq));
+ * \endcode
+ *
+ * A reader may therefore read data that is being written, and must not act
+ * on anything it has read, such as following a pointer, until
+ * mrsw_lock_read_retry() has returned 0. Reads are cheapest when writes are
+ * rare and the data is small enough to copy, such as a configuration table.
+ * Writers should not block while they hold the lock, as readers spin until
+ * the write completes.
+ * @{
+ */
+
+/**
+ * Begin a read of data guarded by a seqlock. This waits for any write in
+ * progress to complete.
+ *
+ * \param ctx     A pointer to the associated lock context
+ *
+ * \returns       The sequence count to pass to mrsw_lock_read_retry()
+ */
+uint32_t mrsw_lock_read_begin(mrsw_lock_t *ctx);
+
+/**
+ * End a read of data guarded by a seqlock.
+ *
+ * \param ctx      A pointer to the associated lock context
+ * \param sequence The sequence count returned by mrsw_lock_read_begin()
+ *
+ * \returns        0 if the data read is consistent
+ *                  1 if a write overlapped the read and it must be retried
+ */
+int mrsw_lock_read_retry(mrsw_lock_t *ctx, uint32_t sequence);
+
+/**
+ * Copy data guarded by a seqlock, retrying until the copy is consistent.
+ *
+ * \param ctx     A pointer to the associated lock context
+ * \param dst     The buffer to copy the data into
+ * \param src     The data guarded by the lock
+ * \param size    The number of bytes to copy
+ */
+void mrsw_lock_read_copy(mrsw_lock_t *ctx, void *dst, const void *src, size_t size);
+
+/**@}*/
+
 /**
  * \addtogroup multiple_reader_single_writer_lock_writer multiple_reader_single_writer_lock_writer
  *
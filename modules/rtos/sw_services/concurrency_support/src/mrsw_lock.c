@@ -3,8 +3,10 @@
 
 #define DEBUG_UNIT MRSW_LOCK
 
+#include <string.h>
 #include <xcore/assert.h>
 
+#include "rtos_support.h"
 #include "rtos/osal/api/rtos_osal.h"
 
 #include "rtos_printf.h"
@@ -67,6 +69,23 @@ rtos_osal_status_t mrsw_lock_create(mrsw_lock_t *ctx, char *name, mrsw_lock_type
             }
             break;
         }
+        case MRSW_SEQLOCK:
+        {
+            seq_mrsw_lock_t *lock = rtos_osal_malloc(sizeof(seq_mrsw_lock_t));
+            if (lock != NULL) {
+                if (rtos_osal_mutex_create(&lock->lock_writers, name, RTOS_OSAL_NOT_RECURSIVE) != RTOS_OSAL_SUCCESS) {
+                    rtos_osal_free(lock);
+                    retval = RTOS_OSAL_ERROR;
+                    break;
+                }
+                lock->sequence = 0;
+
+                ctx->lock_setup = lock;
+            } else {
+                retval = RTOS_OSAL_ERROR;
+            }
+            break;
+        }
         case MRSW_COUNT:
         default:
             retval = RTOS_OSAL_ERROR;
@@ -98,6 +117,13 @@ rtos_osal_status_t mrsw_lock_delete(mrsw_lock_t *ctx)
             rtos_osal_free(lock);
             break;
         }
+        case MRSW_SEQLOCK:
+        {
+            seq_mrsw_lock_t *lock = (seq_mrsw_lock_t*)ctx->lock_setup;
+            rtos_osal_mutex_delete(&lock->lock_writers);
+            rtos_osal_free(lock);
+            break;
+        }
         case MRSW_COUNT:
         default:
             retval = RTOS_OSAL_ERROR;
@@ -144,9 +170,7 @@ rtos_osal_status_t mrsw_lock_reader_get(mrsw_lock_t *ctx, unsigned timeout)
             write_pref_mrsw_lock_t *lock = (write_pref_mrsw_lock_t*)ctx->lock_setup;
             uint32_t tmp = 0;
             while(1) {
-                rtos_printf("read get global lock\n");
                 rtos_osal_mutex_get(&lock->lock_global, RTOS_OSAL_WAIT_FOREVER);
-                rtos_printf("read got global lock\n");
 
                 int state = rtos_osal_critical_enter();
                 if ((!lock->writer_active) && (lock->num_writers_waiting == 0)) {
@@ -158,9 +182,7 @@ rtos_osal_status_t mrsw_lock_reader_get(mrsw_lock_t *ctx, unsigned timeout)
                     rtos_osal_critical_exit(state);
                 }
 
-                rtos_printf("read get global lock 2\n");
                 rtos_osal_mutex_put(&lock->lock_global);
-                rtos_printf("read got global lock 2\n");
                 if (RTOS_OSAL_TIMEOUT == rtos_osal_event_group_get_bits(
                                                 &lock->cond,
                                                 MRSW_FLAG,    /* req */
@@ -168,20 +190,14 @@ rtos_osal_status_t mrsw_lock_reader_get(mrsw_lock_t *ctx, unsigned timeout)
                                                 &tmp,         /* actual */
                                                 timeout)) {
                     /* We are giving up on reading */
-                    rtos_printf("read get global lock 3\n");
-                    rtos_osal_mutex_get(&lock->lock_global, RTOS_OSAL_WAIT_FOREVER);
-                    rtos_printf("read got global lock 3\n");
-                    state = rtos_osal_critical_enter();
-                    {
-                        lock->num_readers_active -= 1;
-                    }
-                    rtos_osal_critical_exit(state);
-                    rtos_osal_mutex_put(&lock->lock_global);
+                    retval = RTOS_OSAL_TIMEOUT;
                     break;
                 }
             }
             break;
         }
+        case MRSW_SEQLOCK:
+            /* Seqlock readers never hold the lock */
         case MRSW_COUNT:
         default:
             retval = RTOS_OSAL_ERROR;
@@ -225,9 +241,7 @@ rtos_osal_status_t mrsw_lock_reader_put(mrsw_lock_t *ctx)
         case MRSW_WRITER_PREFERRED:
         {
             write_pref_mrsw_lock_t *lock = (write_pref_mrsw_lock_t*)ctx->lock_setup;
-            rtos_printf("read put get global lock\n");
             retval = rtos_osal_mutex_get(&lock->lock_global, RTOS_OSAL_PORT_WAIT_FOREVER);
-            rtos_printf("read put got global lock\n");
 
             if (retval != RTOS_OSAL_SUCCESS) {
                 break;
@@ -244,6 +258,8 @@ rtos_osal_status_t mrsw_lock_reader_put(mrsw_lock_t *ctx)
             }
             break;
         }
+        case MRSW_SEQLOCK:
+            /* Seqlock readers never hold the lock */
         case MRSW_COUNT:
         default:
             retval = RTOS_OSAL_ERROR;
@@ -253,6 +269,49 @@ rtos_osal_status_t mrsw_lock_reader_put(mrsw_lock_t *ctx)
     return retval;
 }
 
+/*
+ * Memory accesses by the threads on a tile are not reordered by the hardware,
+ * so seqlock reads and writes only need compiler barriers around them.
+ */
+uint32_t mrsw_lock_read_begin(mrsw_lock_t *ctx)
+{
+    seq_mrsw_lock_t *lock = (seq_mrsw_lock_t*)ctx->lock_setup;
+    uint32_t sequence;
+    int spins = 0;
+
+    xassert(ctx->type == MRSW_SEQLOCK);
+
+    while ((sequence = lock->sequence) & 1) {
+        if (++spins == MRSW_SEQLOCK_SPIN_COUNT) {
+            spins = 0;
+            rtos_osal_delay(1);
+        }
+    }
+    RTOS_MEMORY_BARRIER();
+
+    return sequence;
+}
+
+int mrsw_lock_read_retry(mrsw_lock_t *ctx, uint32_t sequence)
+{
+    seq_mrsw_lock_t *lock = (seq_mrsw_lock_t*)ctx->lock_setup;
+
+    xassert(ctx->type == MRSW_SEQLOCK);
+
+    RTOS_MEMORY_BARRIER();
+    return lock->sequence != sequence;
+}
+
+void mrsw_lock_read_copy(mrsw_lock_t *ctx, void *dst, const void *src, size_t size)
+{
+    uint32_t sequence;
+
+    do {
+        sequence = mrsw_lock_read_begin(ctx);
+        memcpy(dst, src, size);
+    } while (mrsw_lock_read_retry(ctx, sequence));
+}
+
 rtos_osal_status_t mrsw_lock_writer_get(mrsw_lock_t *ctx, unsigned timeout)
 {
     rtos_osal_status_t retval = RTOS_OSAL_SUCCESS;
@@ -269,51 +328,53 @@ rtos_osal_status_t mrsw_lock_writer_get(mrsw_lock_t *ctx, unsigned timeout)
         {
             write_pref_mrsw_lock_t *lock = (write_pref_mrsw_lock_t*)ctx->lock_setup;
             uint32_t tmp = 0;
-            rtos_printf("write get get global lock\n");
             rtos_osal_mutex_get(&lock->lock_global, RTOS_OSAL_WAIT_FOREVER);
-            rtos_printf("write get got global lock\n");
 
             int state = rtos_osal_critical_enter();
             lock->num_writers_waiting += 1;
-            rtos_printf("actives %d\n", lock->num_readers_active);
-            if ((lock->num_readers_active > 0) || (lock->writer_active)) {
+
+            /*
+             * The flag may have been left set by an earlier put, so the lock
+             * is checked again each time the flag is seen.
+             */
+            while ((lock->num_readers_active > 0) || (lock->writer_active)) {
                 rtos_osal_critical_exit(state);
                 rtos_osal_mutex_put(&lock->lock_global);
-                if (RTOS_OSAL_SUCCESS == rtos_osal_event_group_get_bits(
-                                                &lock->cond,
-                                                MRSW_FLAG,    /* req */
-                                                RTOS_OSAL_PORT_CLEAR,
-                                                &tmp,         /* actual */
-                                                timeout)) {
-                    rtos_printf("write get get global lock 2\n");
-                    rtos_osal_mutex_get(&lock->lock_global, RTOS_OSAL_WAIT_FOREVER);
-                    rtos_printf("write get got global lock 2\n");
-
-                    state = rtos_osal_critical_enter();
-                    {
-                        lock->num_writers_waiting -= 1;
-                        lock->writer_active = 1;
-                    }
-                    rtos_osal_critical_exit(state);
-                    rtos_osal_mutex_put(&lock->lock_global);
-                } else {
-                    /* We are giving up on writing */
-                    rtos_printf("write get get global lock 3\n");
-                    rtos_osal_mutex_get(&lock->lock_global, RTOS_OSAL_WAIT_FOREVER);
-                    rtos_printf("write get got global lock 3\n");
-
-                    state = rtos_osal_critical_enter();
-                    {
-                        lock->num_writers_waiting -= 1;
-                    }
-                    rtos_osal_critical_exit(state);
-                    rtos_osal_mutex_put(&lock->lock_global);
+                retval = rtos_osal_event_group_get_bits(
+                                &lock->cond,
+                                MRSW_FLAG,    /* req */
+                                RTOS_OSAL_PORT_CLEAR,
+                                &tmp,         /* actual */
+                                timeout);
+                rtos_osal_mutex_get(&lock->lock_global, RTOS_OSAL_WAIT_FOREVER);
+                state = rtos_osal_critical_enter();
+
+                if (retval != RTOS_OSAL_SUCCESS) {
+                    break;
                 }
-            } else {
-                lock->num_writers_waiting -= 1;
+            }
+
+            lock->num_writers_waiting -= 1;
+            if (retval == RTOS_OSAL_SUCCESS) {
                 lock->writer_active = 1;
                 rtos_osal_critical_exit(state);
-                rtos_osal_mutex_put(&lock->lock_global);
+            } else {
+                /* We are giving up on writing, so let in any readers waiting on us */
+                rtos_osal_critical_exit(state);
+                rtos_osal_event_group_set_bits(&lock->cond, MRSW_FLAG);
+            }
+            rtos_osal_mutex_put(&lock->lock_global);
+            break;
+        }
+        case MRSW_SEQLOCK:
+        {
+            seq_mrsw_lock_t *lock = (seq_mrsw_lock_t*)ctx->lock_setup;
+            retval = rtos_osal_mutex_get(&lock->lock_writers, timeout);
+
+            if (retval == RTOS_OSAL_SUCCESS) {
+                /* An odd count tells readers that a write is in progress */
+                lock->sequence++;
+                RTOS_MEMORY_BARRIER();
             }
             break;
         }
@@ -341,9 +402,7 @@ rtos_osal_status_t mrsw_lock_writer_put(mrsw_lock_t *ctx)
         case MRSW_WRITER_PREFERRED:
         {
             write_pref_mrsw_lock_t *lock = (write_pref_mrsw_lock_t*)ctx->lock_setup;
-            rtos_printf("write put get global lock\n");
             retval = rtos_osal_mutex_get(&lock->lock_global, RTOS_OSAL_PORT_WAIT_FOREVER);
-            rtos_printf("write put got global lock\n");
 
             if (retval != RTOS_OSAL_SUCCESS) {
                 break;
@@ -354,6 +413,17 @@ rtos_osal_status_t mrsw_lock_writer_put(mrsw_lock_t *ctx)
             }
             break;
         }
+        case MRSW_SEQLOCK:
+        {
+            seq_mrsw_lock_t *lock = (seq_mrsw_lock_t*)ctx->lock_setup;
+            xassert(lock->sequence & 1);
+
+            /* Publishes the new version to readers */
+            RTOS_MEMORY_BARRIER();
+            lock->sequence++;
+            retval = rtos_osal_mutex_put(&lock->lock_writers);
+            break;
+        }
         case MRSW_COUNT:
         default:
             retval = RTOS_OSAL_ERROR;
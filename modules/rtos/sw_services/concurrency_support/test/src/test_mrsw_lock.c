@@ -0,0 +1,215 @@
+// Copyright 2022 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
+#include "concurrency_support.h"
+#include "unity.h"
+#include "unity_fixture.h"
+
+#define THREAD_PRIORITY (configMAX_PRIORITIES - 2)
+
+#define TABLE_WORDS 32
+#define WRITER_CORE 1
+#define BENCHMARK_MAX_READERS 5
+#define BENCHMARK_RUN_MS 200
+
+typedef struct contention_test contention_test_t;
+
+typedef struct contention_reader {
+  contention_test_t *test;
+  volatile uint32_t reads;
+  volatile uint32_t torn_reads;
+} contention_reader_t;
+
+struct contention_test {
+  mrsw_lock_t lock;
+  mrsw_lock_type_t type;
+  uint32_t table[TABLE_WORDS];
+  contention_reader_t readers[BENCHMARK_MAX_READERS];
+  volatile int stop;
+  volatile uint32_t writes;
+  SemaphoreHandle_t done;
+};
+
+static const char *lock_type_names[MRSW_COUNT] = {
+    "reader_pref",
+    "writer_pref",
+    "seqlock",
+};
+
+// Copies the table for as long as the test runs, counting every copy in
+// which the words differ, as those overlapped a write.
+static void reader_thread(void *arg) {
+  contention_reader_t *reader = (contention_reader_t *)arg;
+  contention_test_t *test = reader->test;
+  uint32_t copy[TABLE_WORDS];
+
+  while (!test->stop) {
+    if (test->type == MRSW_SEQLOCK) {
+      mrsw_lock_read_copy(&test->lock, copy, test->table, sizeof(copy));
+    } else {
+      mrsw_lock_reader_get(&test->lock, RTOS_OSAL_WAIT_FOREVER);
+      memcpy(copy, test->table, sizeof(copy));
+      mrsw_lock_reader_put(&test->lock);
+    }
+
+    for (int i = 1; i < TABLE_WORDS; i++) {
+      if (copy[i] != copy[0]) {
+        reader->torn_reads++;
+        break;
+      }
+    }
+    reader->reads++;
+  }
+
+  xSemaphoreGive(test->done);
+  vTaskDelete(NULL);
+}
+
+// Writes a new version of the whole table once per tick, as a read-mostly
+// configuration table would be.
+static void writer_thread(void *arg) {
+  contention_test_t *test = (contention_test_t *)arg;
+  uint32_t version = 0;
+
+  while (!test->stop) {
+    mrsw_lock_writer_get(&test->lock, RTOS_OSAL_WAIT_FOREVER);
+    version++;
+    for (int i = 0; i < TABLE_WORDS; i++) {
+      ((volatile uint32_t *)test->table)[i] = version;
+    }
+    mrsw_lock_writer_put(&test->lock);
+    test->writes++;
+
+    vTaskDelay(1);
+  }
+
+  xSemaphoreGive(test->done);
+  vTaskDelete(NULL);
+}
+
+// Runs one writer and reader_count readers, each on its own core, against a
+// lock of the given type for run_ms, and returns the reads that completed.
+static uint32_t contention_run(contention_test_t *test, mrsw_lock_type_t type,
+                               int reader_count, uint32_t run_ms) {
+  TaskHandle_t handle;
+  uint32_t reads = 0;
+
+  memset(test, 0, sizeof(contention_test_t));
+  test->type = type;
+  test->done = xSemaphoreCreateCounting(reader_count + 1, 0);
+  TEST_ASSERT_EQUAL_INT(RTOS_OSAL_SUCCESS,
+                        mrsw_lock_create(&test->lock, "test_lock", type));
+
+  for (int i = 0; i < reader_count; i++) {
+    test->readers[i].test = test;
+    xTaskCreate(reader_thread, "reader", RTOS_THREAD_STACK_SIZE(reader_thread),
+                &test->readers[i], THREAD_PRIORITY, &handle);
+    vTaskCoreAffinitySet(handle, 1 << (WRITER_CORE + 1 + i));
+  }
+  xTaskCreate(writer_thread, "writer", RTOS_THREAD_STACK_SIZE(writer_thread),
+              test, THREAD_PRIORITY, &handle);
+  vTaskCoreAffinitySet(handle, 1 << WRITER_CORE);
+
+  vTaskDelay(pdMS_TO_TICKS(run_ms));
+  test->stop = 1;
+
+  for (int i = 0; i < reader_count + 1; i++) {
+    TEST_ASSERT_EQUAL_INT(pdTRUE,
+                          xSemaphoreTake(test->done, pdMS_TO_TICKS(1000)));
+  }
+
+  for (int i = 0; i < reader_count; i++) {
+    TEST_ASSERT_EQUAL_UINT32(0, test->readers[i].torn_reads);
+    reads += test->readers[i].reads;
+  }
+
+  mrsw_lock_delete(&test->lock);
+  vSemaphoreDelete(test->done);
+
+  return reads;
+}
+
+TEST_GROUP(mrsw_lock);
+
+TEST_SETUP(mrsw_lock) {}
+
+TEST_TEAR_DOWN(mrsw_lock) {}
+
+TEST(mrsw_lock, test_seqlock_write_forces_retry) {
+  mrsw_lock_t lock;
+  uint32_t sequence;
+
+  TEST_ASSERT_EQUAL_INT(RTOS_OSAL_SUCCESS,
+                        mrsw_lock_create(&lock, "test_lock", MRSW_SEQLOCK));
+
+  sequence = mrsw_lock_read_begin(&lock);
+  TEST_ASSERT_EQUAL_INT(0, mrsw_lock_read_retry(&lock, sequence));
+
+  sequence = mrsw_lock_read_begin(&lock);
+  TEST_ASSERT_EQUAL_INT(RTOS_OSAL_SUCCESS,
+                        mrsw_lock_writer_get(&lock, RTOS_OSAL_WAIT_FOREVER));
+  TEST_ASSERT_EQUAL_INT(RTOS_OSAL_SUCCESS, mrsw_lock_writer_put(&lock));
+  TEST_ASSERT_EQUAL_INT(1, mrsw_lock_read_retry(&lock, sequence));
+
+  sequence = mrsw_lock_read_begin(&lock);
+  TEST_ASSERT_EQUAL_INT(0, mrsw_lock_read_retry(&lock, sequence));
+
+  mrsw_lock_delete(&lock);
+}
+
+TEST(mrsw_lock, test_seqlock_writers_exclude_each_other) {
+  mrsw_lock_t lock;
+
+  TEST_ASSERT_EQUAL_INT(RTOS_OSAL_SUCCESS,
+                        mrsw_lock_create(&lock, "test_lock", MRSW_SEQLOCK));
+
+  TEST_ASSERT_EQUAL_INT(RTOS_OSAL_SUCCESS,
+                        mrsw_lock_writer_get(&lock, RTOS_OSAL_WAIT_FOREVER));
+  TEST_ASSERT_EQUAL_INT(RTOS_OSAL_TIMEOUT,
+                        mrsw_lock_writer_get(&lock, RTOS_OSAL_NO_WAIT));
+  TEST_ASSERT_EQUAL_INT(RTOS_OSAL_SUCCESS, mrsw_lock_writer_put(&lock));
+
+  // Readers never hold a seqlock
+  TEST_ASSERT_EQUAL_INT(RTOS_OSAL_ERROR,
+                        mrsw_lock_reader_get(&lock, RTOS_OSAL_NO_WAIT));
+
+  mrsw_lock_delete(&lock);
+}
+
+TEST(mrsw_lock, test_benchmark) {
+  static contention_test_t test;
+
+  rtos_printf("readers  %12s  %12s  %12s  (reads per ms)\n",
+              lock_type_names[MRSW_READER_PREFERRED],
+              lock_type_names[MRSW_WRITER_PREFERRED],
+              lock_type_names[MRSW_SEQLOCK]);
+  for (int readers = 1; readers <= BENCHMARK_MAX_READERS; readers++) {
+    uint32_t reads[MRSW_COUNT];
+    uint32_t writes[MRSW_COUNT];
+
+    for (int type = 0; type < MRSW_COUNT; type++) {
+      reads[type] = contention_run(&test, type, readers, BENCHMARK_RUN_MS);
+      writes[type] = test.writes;
+      TEST_ASSERT_GREATER_THAN_UINT32(0, reads[type]);
+    }
+
+    rtos_printf("%7d  %12u  %12u  %12u\n", readers,
+                reads[MRSW_READER_PREFERRED] / BENCHMARK_RUN_MS,
+                reads[MRSW_WRITER_PREFERRED] / BENCHMARK_RUN_MS,
+                reads[MRSW_SEQLOCK] / BENCHMARK_RUN_MS);
+    rtos_printf("%7s  %12u  %12u  %12u  (writes)\n", "",
+                writes[MRSW_READER_PREFERRED], writes[MRSW_WRITER_PREFERRED],
+                writes[MRSW_SEQLOCK]);
+  }
+}
+
+TEST_GROUP_RUNNER(mrsw_lock) {
+  RUN_TEST_CASE(mrsw_lock, test_seqlock_write_forces_retry);
+  RUN_TEST_CASE(mrsw_lock, test_seqlock_writers_exclude_each_other);
+  RUN_TEST_CASE(mrsw_lock, test_benchmark);
+}
@@ -33,7 +33,34 @@ dispatch_job_t *dispatch_job_create(dispatch_function_t function,
 void dispatch_job_init(dispatch_job_t *task, dispatch_function_t function,
                        void *argument);
 
-/** Run the task in the caller's thread
+/** Make a task depend on another task
+ *
+ * When both tasks are added to a dispatcher with dispatcher_graph_add, the
+ * task is not started until the dependency, and all of its other
+ * dependencies, have finished. A task may have at most
+ * DISPATCH_JOB_MAX_DEPENDENTS tasks depending on it. Dependencies are cleared
+ * by dispatch_job_init.
+ *
+ * \param task        Task object
+ * \param dependency  Task that must finish before this task starts
+ */
+void dispatch_job_dependency_add(dispatch_job_t *task,
+                                 dispatch_job_t *dependency);
+
+/** Set a callback to run when the task's function returns
+ *
+ * The callback runs in the same thread or ISR as the task, before any waiter
+ * is released and before any dependent task is started. The callback is
+ * cleared by dispatch_job_init.
+ *
+ * \param task      Task object
+ * \param callback  Function to call, signature must be <tt>void(void*)</tt>
+ * \param argument  Callback argument
+ */
+void dispatch_job_callback_set(dispatch_job_t *task,
+                               dispatch_function_t callback, void *argument);
+
+/** Run the task, and its callback, in the caller's thread
  *
  * \param task  Task object
  */
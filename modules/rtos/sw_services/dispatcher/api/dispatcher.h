@@ -39,6 +39,23 @@ void dispatcher_delete(dispatcher_t *dispatcher);
 void dispatcher_thread_init(dispatcher_t *dispatcher, size_t length,
                             size_t thread_count, size_t thread_priority);
 
+/** Initialize a dispatcher with work stealing thread workers
+ *
+ * Each worker owns a bounded ring of jobs and has an affinity for one core.
+ * Jobs are pushed to the least loaded ring, and idle workers steal jobs from
+ * other workers' rings. Each ring has its own lock, which avoids every
+ * submission and completion contending on the single queue used by
+ * dispatcher_thread_init. Adding a job blocks while every ring is full.
+ *
+ * \param dispatcher       Dispatcher object
+ * \param length           Maximum number of tasks in each worker's ring
+ * \param thread_count     Number of thread workers
+ * \param thread_priority  Priority for each thread worker.
+ */
+void dispatcher_thread_stealing_init(dispatcher_t *dispatcher, size_t length,
+                                     size_t thread_count,
+                                     size_t thread_priority);
+
 /** Initialize a dispatcher with ISR workers
  *
  * \param dispatcher  Dispatcher object
@@ -57,6 +74,23 @@ void dispatcher_isr_init(dispatcher_t *dispatcher, uint32_t corecore_map_mask);
  */
 void dispatcher_job_add(dispatcher_t *dispatcher, dispatch_job_t *job);
 
+/** Add a graph of jobs to the dispatcher.
+ *
+ * Dependencies between the jobs are declared beforehand with
+ * dispatch_job_dependency_add, and every job that another job in the graph
+ * depends on must be in the array. Jobs without dependencies are dispatched
+ * immediately. The others are dispatched by the workers as soon as their
+ * last dependency finishes, without a round trip through the caller's
+ * thread. A job whose dependencies are all met usually runs on the worker
+ * that finished the last of them.
+ *
+ * \param dispatcher  Dispatcher object
+ * \param jobs        Array of job objects
+ * \param count       Number of jobs in the array
+ */
+void dispatcher_graph_add(dispatcher_t *dispatcher, dispatch_job_t **jobs,
+                          size_t count);
+
 /** Add a group to the dispatcher.
  *
  * If the dispatcher is initialized with threads and the queue is full, this
@@ -69,7 +103,28 @@ void dispatcher_job_add(dispatcher_t *dispatcher, dispatch_job_t *job);
  */
 void dispatcher_group_add(dispatcher_t *dispatcher, dispatch_group_t *group);
 
+/** Create a job from the dispatcher's job pool.
+ *
+ * The pool is allocated by dispatcher_thread_init or dispatcher_isr_init so
+ * this function does not allocate memory unless the pool is exhausted, in
+ * which case the job is allocated from the heap. Release the job with
+ * dispatch_job_delete, which returns pooled jobs to the pool. Pooled jobs must
+ * be released before the dispatcher is deleted.
+ *
+ * \param dispatcher      Dispatcher object
+ * \param function        Function to perform, signature must be
+ * <tt>void(void*)</tt>
+ * \param argument        Function argument
+ *
+ * \return                Job object
+ */
+dispatch_job_t *dispatcher_job_create(dispatcher_t *dispatcher,
+                                      dispatch_function_t function,
+                                      void *argument);
+
 /** Creates a job and adds it to the dispatcher.
+ *
+ * The job is taken from the dispatcher's job pool, see dispatcher_job_create.
  *
  * If the dispatcher is initialized with threads and the queue is full, this
  * function will block in the callers thread until the function can be
@@ -87,7 +142,7 @@ dispatcher_function_add(dispatcher_t *dispatcher, dispatch_function_t function,
                         void *argument) {
   dispatch_job_t *job;
 
-  job = dispatch_job_create(function, argument);
+  job = dispatcher_job_create(dispatcher, function, argument);
   dispatcher_job_add(dispatcher, job);
 
   return job;
@@ -100,6 +155,19 @@ dispatcher_function_add(dispatcher_t *dispatcher, dispatch_function_t function,
  */
 void dispatcher_job_wait(dispatcher_t *dispatcher, dispatch_job_t *job);
 
+/** Wait synchronously in the caller's thread for all the jobs in a graph to
+ * finish executing
+ *
+ * To wait for the end of a pipeline, it is enough to call dispatcher_job_wait
+ * on its final job.
+ *
+ * \param dispatcher  Dispatcher object
+ * \param jobs        Array of job objects passed to dispatcher_graph_add
+ * \param count       Number of jobs in the array
+ */
+void dispatcher_graph_wait(dispatcher_t *dispatcher, dispatch_job_t **jobs,
+                           size_t count);
+
 /** Wait synchronously in the caller's thread for the group to finish executing
  *
  * \param dispatcher  Dispatcher object
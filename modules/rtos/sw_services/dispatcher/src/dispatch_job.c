@@ -12,6 +12,9 @@ dispatch_job_t *dispatch_job_create(dispatch_function_t function,
   dispatch_job_t *task;
   task = rtos_osal_malloc(sizeof(dispatch_job_t));
 
+  task->job_counter = NULL;
+  task->pool = NULL;
+  task->next = NULL;
   dispatch_job_init(task, function, argument);
 
   dispatcher_log("dispatch_job_create:  task=%u\n", (size_t)task);
@@ -25,7 +28,35 @@ void dispatch_job_init(dispatch_job_t *task, dispatch_function_t function,
 
   task->function = function;
   task->argument = argument;
+  task->callback = NULL;
+  task->callback_argument = NULL;
   task->event_counter = NULL;
+  task->dispatcher = NULL;
+  task->dependency_count = 0;
+  task->pending = 0;
+  task->dependent_count = 0;
+}
+
+void dispatch_job_dependency_add(dispatch_job_t *task,
+                                 dispatch_job_t *dependency) {
+  xassert(task);
+  xassert(dependency);
+  xassert(task != dependency);
+  xassert(dependency->dependent_count < DISPATCH_JOB_MAX_DEPENDENTS);
+
+  dispatcher_log("dispatch_job_dependency_add:  task=%u  dependency=%u\n",
+                 (size_t)task, (size_t)dependency);
+
+  dependency->dependents[dependency->dependent_count++] = task;
+  task->dependency_count++;
+}
+
+void dispatch_job_callback_set(dispatch_job_t *task,
+                               dispatch_function_t callback, void *argument) {
+  xassert(task);
+
+  task->callback = callback;
+  task->callback_argument = argument;
 }
 
 void dispatch_job_perform(dispatch_job_t *task) {
@@ -34,8 +65,17 @@ void dispatch_job_perform(dispatch_job_t *task) {
 
   dispatcher_log("dispatch_job_perform:  task=%u\n", (size_t)task);
 
+  // the callback may reuse the job, so it is traced as it was when started
+  DISPATCHER_JOB_ATTRIBUTE dispatch_function_t function = task->function;
+  traceDISPATCH_JOB_START(task, function);
+
   // call function in current thread
-  task->function(task->argument);
+  function(task->argument);
+
+  if (task->callback)
+    task->callback(task->callback_argument);
+
+  traceDISPATCH_JOB_END(task, function);
 }
 
 void dispatch_job_delete(dispatch_job_t *task) {
@@ -43,5 +83,13 @@ void dispatch_job_delete(dispatch_job_t *task) {
 
   dispatcher_log("dispatch_job_delete:  task=%u\n", (size_t)task);
 
+  if (task->pool) {
+    // pooled jobs, and their event counters, are recycled, never freed
+    job_pool_release(task->pool, task);
+    return;
+  }
+
+  if (task->job_counter)
+    event_counter_delete(task->job_counter);
   rtos_osal_free(task);
 }
@@ -8,15 +8,43 @@
 
 #include "dispatcher.h"
 #include "event_counter.h"
+#include "job_pool.h"
 
 // the following line can be used when debugging actions on the dispatch queue
 #define dispatcher_log(...) // rtos_printf(__VA_ARGS__)
 
+// trace hooks called before and after each job is performed, these may be
+// defined by the RTOS trace configuration
+#ifndef traceDISPATCH_JOB_START
+#define traceDISPATCH_JOB_START(job, function)
+#endif
+
+#ifndef traceDISPATCH_JOB_END
+#define traceDISPATCH_JOB_END(job, function)
+#endif
+
+// maximum number of jobs that can depend on a single job
+#ifndef DISPATCH_JOB_MAX_DEPENDENTS
+#define DISPATCH_JOB_MAX_DEPENDENTS (8)
+#endif
+
 struct dispatch_job_struct {
   DISPATCHER_JOB_ATTRIBUTE dispatch_function_t
       function;                   // the function to perform
   void *argument;                 // argument to pass to the function
+  DISPATCHER_JOB_ATTRIBUTE dispatch_function_t
+      callback;                   // completion callback, may be NULL
+  void *callback_argument;        // argument to pass to the callback
   event_counter_t *event_counter; // event counter used to wait
+  event_counter_t *job_counter;   // reusable counter owned by this job
+  job_pool_t *pool;               // pool that owns this job, NULL if heap
+  dispatch_job_t *next;           // next job in the pool's free list, or in
+                                  // a worker's list of ready continuations
+  dispatcher_t *dispatcher;       // dispatcher running the job's graph
+  size_t dependency_count;        // number of jobs this job depends on
+  volatile size_t pending;        // dependencies that have not finished
+  size_t dependent_count;         // number of jobs depending on this job
+  dispatch_job_t *dependents[DISPATCH_JOB_MAX_DEPENDENTS];
 };
 
 struct dispatch_group_struct {
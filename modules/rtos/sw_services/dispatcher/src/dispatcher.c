@@ -11,10 +11,88 @@
 #include "dispatcher.h"
 #include "dispatch_types.h"
 #include "event_counter.h"
+#include "job_pool.h"
 #include "rtos_interrupt.h"
 #include "rtos_osal.h"
+#include "work_stealing.h"
 #include "worker_types.h"
 
+//***********************
+//***********************
+//***********************
+// Job Execution
+//***********************
+//***********************
+//***********************
+
+static bool dispatcher_job_try_send(dispatcher_t *dispatcher,
+                                    dispatch_job_t *job);
+
+// Perform a job, then any of its dependents that it made ready. The first
+// ready dependent runs next in this worker as a continuation. Thread workers
+// hand the others to the dispatcher if there is room, ISR workers always run
+// them in place.
+static void dispatcher_job_execute(dispatch_job_t *job,
+                                   WorkerType worker_type) {
+  dispatch_job_t *head = job;
+  dispatch_job_t *tail = job;
+
+  job->next = NULL;
+
+  while (head) {
+    dispatch_job_t *ready[DISPATCH_JOB_MAX_DEPENDENTS];
+    size_t ready_count = 0;
+    dispatcher_t *dispatcher;
+    int state;
+
+    job = head;
+    head = job->next;
+    if (head == NULL)
+      tail = NULL;
+
+    dispatch_job_perform(job);
+
+    // the job may be deleted as soon as it is signalled, so its dependents
+    // are released first
+    dispatcher = job->dispatcher;
+    if (dispatcher && job->dependent_count > 0) {
+      if (worker_type == ThreadWorker) {
+        state = rtos_osal_critical_enter();
+      } else {
+        rtos_lock_acquire(0);
+      }
+      for (int i = 0; i < job->dependent_count; i++) {
+        dispatch_job_t *dependent = job->dependents[i];
+        if (--dependent->pending == 0)
+          ready[ready_count++] = dependent;
+      }
+      if (worker_type == ThreadWorker) {
+        rtos_osal_critical_exit(state);
+      } else {
+        rtos_lock_release(0);
+      }
+    }
+
+    // signal the event counter
+    event_counter_signal(job->event_counter, worker_type);
+
+    for (int i = 0; i < ready_count; i++) {
+      dispatch_job_t *dependent = ready[i];
+
+      if (i > 0 && worker_type == ThreadWorker &&
+          dispatcher_job_try_send(dispatcher, dependent))
+        continue;
+
+      dependent->next = NULL;
+      if (tail)
+        tail->next = dependent;
+      else
+        head = dependent;
+      tail = dependent;
+    }
+  }
+}
+
 //***********************
 //***********************
 //***********************
@@ -23,9 +101,13 @@
 //***********************
 //***********************
 
-#define GROUP_CHANNEL_WAIT 1
 #define MAX_CORE_COUNT (8)
 
+// number of pooled jobs allocated for each ISR worker
+#ifndef DISPATCHER_ISR_JOB_POOL_DEPTH
+#define DISPATCHER_ISR_JOB_POOL_DEPTH (4)
+#endif
+
 static inline void chanend_job_send(chanend_t src, chanend_t dst,
                                     dispatch_job_t *job) {
   chanend_set_dest(src, dst);
@@ -33,9 +115,15 @@ static inline void chanend_job_send(chanend_t src, chanend_t dst,
   chanend_out_control_token(src, XS1_CT_PAUSE);
 }
 
+typedef struct isr_worker_struct {
+  chanend_t chanend;           // chanend the worker receives jobs on
+  volatile size_t outstanding; // jobs sent to this worker but not finished
+} isr_worker_t;
+
 DEFINE_RTOS_INTERRUPT_CALLBACK(dispatcher_isr_worker, arg) {
   dispatch_job_t *job = NULL;
-  chanend_t *chanend = arg;
+  isr_worker_t *worker = arg;
+  chanend_t *chanend = &worker->chanend;
 
   job = (dispatch_job_t *)s_chan_in_word(*chanend);
 
@@ -45,14 +133,11 @@ DEFINE_RTOS_INTERRUPT_CALLBACK(dispatcher_isr_worker, arg) {
   //                xPortGetMinimumEverFreeHeapSize(), xPortGetFreeHeapSize());
 
   if (job) {
-    dispatch_job_perform(job);
+    dispatcher_job_execute(job, ISRWorker);
 
-    // signal the event counter
-    if (event_counter_signal(job->event_counter, ISRWorker)) {
-#if GROUP_CHANNEL_WAIT
-      chanend_out_end_token(*chanend);
-#endif
-    }
+    rtos_lock_acquire(0);
+    worker->outstanding--;
+    rtos_lock_release(0);
   } else {
     // a NULL job means it is time to free my chanend
     triggerable_disable_trigger(*chanend);
@@ -81,14 +166,32 @@ void dispatcher_thread_worker(void *param) {
                      (size_t)job,
                      get_reference_time() / PLATFORM_REFERENCE_MHZ);
 
-      dispatch_job_perform(job);
-
-      // signal the event counter
-      event_counter_signal(job->event_counter, ThreadWorker);
+      dispatcher_job_execute(job, ThreadWorker);
     }
   }
 }
 
+typedef struct stealing_worker_arg {
+  work_stealing_t *ws;
+  size_t index;
+} stealing_worker_arg_t;
+
+void dispatcher_stealing_worker(void *param) {
+  stealing_worker_arg_t *arg = (stealing_worker_arg_t *)param;
+  dispatch_job_t *job = NULL;
+
+  dispatcher_log("dispatcher_stealing_worker %d started\n", arg->index);
+
+  for (;;) {
+    job = work_stealing_pop(arg->ws, arg->index);
+    dispatcher_log("dispatcher_stealing_worker %d received job=%u  at=%u\n",
+                   arg->index, (size_t)job,
+                   get_reference_time() / PLATFORM_REFERENCE_MHZ);
+
+    dispatcher_job_execute(job, ThreadWorker);
+  }
+}
+
 //***********************
 //***********************
 //***********************
@@ -103,9 +206,15 @@ struct dispatcher_struct {
   // thread worker state
   rtos_osal_queue_t queue;
   rtos_osal_thread_t *threads;
+  // work stealing thread worker state, NULL when using the shared queue
+  work_stealing_t *ws;
+  stealing_worker_arg_t *ws_args;
   // isr worker state
   chanend_t chanend;
-  chanend_t *isr_chanends;
+  isr_worker_t *isr_workers;
+  size_t isr_next; // round-robin start point for ISR job placement
+  // jobs handed out by dispatcher_job_create
+  job_pool_t *job_pool;
 };
 
 dispatcher_t *dispatcher_create() {
@@ -115,8 +224,13 @@ dispatcher_t *dispatcher_create() {
 
   dispatcher->worker_count = 0;
   dispatcher->threads = NULL;
+  dispatcher->ws = NULL;
+  dispatcher->ws_args = NULL;
 
-  dispatcher->isr_chanends = NULL;
+  dispatcher->isr_workers = NULL;
+  dispatcher->isr_next = 0;
+
+  dispatcher->job_pool = NULL;
 
   dispatcher_log("dispatcher_create: %u\n", (size_t)dispatcher);
 
@@ -128,9 +242,17 @@ void dispatcher_delete(dispatcher_t *dispatcher) {
   xassert(dispatcher);
 
   if (dispatcher->worker_type == ThreadWorker) {
-    rtos_osal_queue_delete(&dispatcher->queue);
-    for (int i = 0; i < dispatcher->worker_count; i++) {
-      rtos_osal_thread_delete(&dispatcher->threads[i]);
+    if (dispatcher->ws) {
+      for (int i = 0; i < dispatcher->worker_count; i++) {
+        rtos_osal_thread_delete(&dispatcher->threads[i]);
+      }
+      work_stealing_delete(dispatcher->ws);
+      rtos_osal_free((void *)dispatcher->ws_args);
+    } else {
+      rtos_osal_queue_delete(&dispatcher->queue);
+      for (int i = 0; i < dispatcher->worker_count; i++) {
+        rtos_osal_thread_delete(&dispatcher->threads[i]);
+      }
     }
     rtos_osal_free((void *)dispatcher->threads);
   } else if (dispatcher->worker_type == ISRWorker) {
@@ -139,14 +261,18 @@ void dispatcher_delete(dispatcher_t *dispatcher) {
     // disable interrupts while dispatching jobs
     uint32_t mask = rtos_interrupt_mask_all();
     for (int i = 0; i < dispatcher->worker_count; i++) {
-      chanend_job_send(dispatcher->chanend, dispatcher->isr_chanends[i], NULL);
+      chanend_job_send(dispatcher->chanend, dispatcher->isr_workers[i].chanend,
+                       NULL);
     }
     // re-enable interupts
     rtos_interrupt_mask_set(mask);
     chanend_free(dispatcher->chanend);
-    rtos_osal_free((void *)dispatcher->isr_chanends);
+    rtos_osal_free((void *)dispatcher->isr_workers);
   }
 
+  if (dispatcher->job_pool)
+    job_pool_delete(dispatcher->job_pool);
+
   rtos_osal_free((void *)dispatcher);
 }
 
@@ -167,6 +293,11 @@ void dispatcher_thread_init(dispatcher_t *dispatcher, size_t length,
   rtos_osal_queue_create(&dispatcher->queue, "", length,
                          sizeof(dispatch_job_t *));
 
+  // allocate the job pool, enough for a full queue plus one job in flight on
+  // every worker
+  dispatcher->job_pool =
+      job_pool_create(length + thread_count, dispatcher->worker_type);
+
   // allocate threads
   dispatcher->threads =
       rtos_osal_malloc(sizeof(rtos_osal_thread_t) * dispatcher->worker_count);
@@ -180,6 +311,48 @@ void dispatcher_thread_init(dispatcher_t *dispatcher, size_t length,
   }
 }
 
+void dispatcher_thread_stealing_init(dispatcher_t *dispatcher, size_t length,
+                                     size_t thread_count,
+                                     size_t thread_priority) {
+  dispatcher_log("dispatcher_thread_stealing_init: %u   length=%d, "
+                 "thread_count=%d, thread_priority=%d\n",
+                 dispatcher, length, thread_count, thread_priority);
+  xassert(dispatcher);
+  xassert(length > 0);
+  xassert(thread_count > 0);
+  xassert(dispatcher->worker_type == UninitializedWorker);
+
+  dispatcher->worker_type = ThreadWorker;
+  dispatcher->worker_count = thread_count;
+
+  // allocate the per-worker job rings
+  dispatcher->ws = work_stealing_create(thread_count, length);
+
+  // allocate the job pool, enough for every ring to be full plus one job in
+  // flight on every worker
+  dispatcher->job_pool = job_pool_create((length + 1) * thread_count,
+                                         dispatcher->worker_type);
+
+  // allocate threads
+  dispatcher->threads =
+      rtos_osal_malloc(sizeof(rtos_osal_thread_t) * dispatcher->worker_count);
+  dispatcher->ws_args = rtos_osal_malloc(sizeof(stealing_worker_arg_t) *
+                                         dispatcher->worker_count);
+
+  // create workers, each one with an affinity for its own core
+  int core_count = rtos_core_count();
+  for (int i = 0; i < dispatcher->worker_count; i++) {
+    dispatcher->ws_args[i].ws = dispatcher->ws;
+    dispatcher->ws_args[i].index = i;
+    rtos_osal_thread_create(
+        &dispatcher->threads[i], "", dispatcher_stealing_worker,
+        (void *)&dispatcher->ws_args[i],
+        RTOS_THREAD_STACK_SIZE(dispatcher_stealing_worker), thread_priority);
+    rtos_osal_thread_core_exclusion_set(&dispatcher->threads[i],
+                                        ~(1 << (i % core_count)));
+  }
+}
+
 void dispatcher_isr_init(dispatcher_t *dispatcher, uint32_t core_map) {
   dispatcher_log("dispatcher_isr_init: %u   core_map=%d\n", dispatcher,
                  core_map);
@@ -207,10 +380,15 @@ void dispatcher_isr_init(dispatcher_t *dispatcher, uint32_t core_map) {
   }
   xassert(dispatcher->worker_count > 0);
 
-  // create the ISR's chanends
-  dispatcher->isr_chanends =
-      rtos_osal_malloc(sizeof(chanend_t) * dispatcher->worker_count);
-  xassert(dispatcher->isr_chanends);
+  // allocate the job pool
+  dispatcher->job_pool =
+      job_pool_create(DISPATCHER_ISR_JOB_POOL_DEPTH * dispatcher->worker_count,
+                      dispatcher->worker_type);
+
+  // create the ISR workers
+  dispatcher->isr_workers =
+      rtos_osal_malloc(sizeof(isr_worker_t) * dispatcher->worker_count);
+  xassert(dispatcher->isr_workers);
 
   // setup ISRs on core set bits in the core_map
   int index = 0;
@@ -221,18 +399,18 @@ void dispatcher_isr_init(dispatcher_t *dispatcher, uint32_t core_map) {
     pending &= ~(1 << core_id);
 
     // create ISR's chanend
-    dispatcher->isr_chanends[index] = chanend_alloc();
-    xassert(dispatcher->isr_chanends[index]);
-    chanend_set_dest(dispatcher->isr_chanends[index], dispatcher->chanend);
+    dispatcher->isr_workers[index].chanend = chanend_alloc();
+    xassert(dispatcher->isr_workers[index].chanend);
+    dispatcher->isr_workers[index].outstanding = 0;
 
     // set ISR on specified core id
     //   NOTE: rtos_osal_thread_core_exclusion_set switches this code's
     //   execution to the specified core id
     rtos_osal_thread_core_exclusion_set(NULL, ~(1 << core_id));
     triggerable_setup_interrupt_callback(
-        dispatcher->isr_chanends[index], &dispatcher->isr_chanends[index],
+        dispatcher->isr_workers[index].chanend, &dispatcher->isr_workers[index],
         RTOS_INTERRUPT_CALLBACK(dispatcher_isr_worker));
-    triggerable_enable_trigger(dispatcher->isr_chanends[index]);
+    triggerable_enable_trigger(dispatcher->isr_workers[index].chanend);
 
     index++;
   }
@@ -241,28 +419,138 @@ void dispatcher_isr_init(dispatcher_t *dispatcher, uint32_t core_map) {
   rtos_osal_thread_core_exclusion_set(NULL, core_exclude_map);
 }
 
-void dispatcher_job_add(dispatcher_t *dispatcher, dispatch_job_t *job) {
-  dispatcher_log("dispatcher_add_job: %u   job=%u  worker_type=%d\n",
-                 (size_t)dispatcher, (size_t)job, dispatcher->worker_type);
+// Send a job to the ISR worker with the fewest outstanding jobs, starting the
+// search at the next worker in round-robin order so ties are spread out.
+// Must be called with interrupts masked.
+static void dispatcher_isr_job_send(dispatcher_t *dispatcher,
+                                    dispatch_job_t *job) {
+  size_t target = dispatcher->isr_next;
+
+  rtos_lock_acquire(0);
+  for (int i = 1; i < dispatcher->worker_count; i++) {
+    size_t index = (dispatcher->isr_next + i) % dispatcher->worker_count;
+    if (dispatcher->isr_workers[index].outstanding <
+        dispatcher->isr_workers[target].outstanding)
+      target = index;
+  }
+  dispatcher->isr_workers[target].outstanding++;
+  rtos_lock_release(0);
+
+  dispatcher->isr_next = (target + 1) % dispatcher->worker_count;
+
+  dispatcher_log("dispatcher_isr_job_send: %u   job=%u  worker=%d\n",
+                 (size_t)dispatcher, (size_t)job, target);
+
+  chanend_job_send(dispatcher->chanend, dispatcher->isr_workers[target].chanend,
+                   job);
+}
+
+dispatch_job_t *dispatcher_job_create(dispatcher_t *dispatcher,
+                                      dispatch_function_t function,
+                                      void *argument) {
   xassert(dispatcher);
-  xassert(job);
   xassert(dispatcher->worker_type != UninitializedWorker);
+  dispatch_job_t *job;
 
-  job->event_counter = event_counter_create(1, dispatcher->worker_type);
+  job = job_pool_acquire(dispatcher->job_pool);
+  if (job) {
+    dispatch_job_init(job, function, argument);
+  } else {
+    // pool exhausted, fall back to the heap
+    job = dispatch_job_create(function, argument);
+  }
+
+  dispatcher_log("dispatcher_job_create: %u   job=%u\n", (size_t)dispatcher,
+                 (size_t)job);
 
+  return job;
+}
+
+// Set up the job's own event counter, it is created on first use and reused
+// after that
+static void dispatcher_job_prepare(dispatcher_t *dispatcher,
+                                   dispatch_job_t *job) {
+  if (job->job_counter &&
+      event_counter_worker_type_get(job->job_counter) !=
+          dispatcher->worker_type) {
+    event_counter_delete(job->job_counter);
+    job->job_counter = NULL;
+  }
+  if (job->job_counter == NULL)
+    job->job_counter = event_counter_create(1, dispatcher->worker_type);
+  event_counter_init(job->job_counter, 1);
+  job->event_counter = job->job_counter;
+  // dependents are only released for jobs added with dispatcher_graph_add
+  job->dispatcher = NULL;
+}
+
+static void dispatcher_job_send(dispatcher_t *dispatcher,
+                                dispatch_job_t *job) {
   if (dispatcher->worker_type == ThreadWorker) {
-    // send to queue
-    rtos_osal_queue_send(&dispatcher->queue, (void *)&job,
-                         RTOS_OSAL_WAIT_FOREVER);
+    if (dispatcher->ws) {
+      // push to a worker's ring
+      work_stealing_push(dispatcher->ws, job);
+    } else {
+      // send to queue
+      rtos_osal_queue_send(&dispatcher->queue, (void *)&job,
+                           RTOS_OSAL_WAIT_FOREVER);
+    }
   } else if (dispatcher->worker_type == ISRWorker) {
     // disable interrupts while dispatching jobs
     uint32_t mask = rtos_interrupt_mask_all();
-    chanend_job_send(dispatcher->chanend, dispatcher->isr_chanends[0], job);
+    dispatcher_isr_job_send(dispatcher, job);
     // re-enable interrupts
     rtos_interrupt_mask_set(mask);
   }
 }
 
+// Hand a job to a thread worker without blocking, used by the workers
+// themselves to start jobs whose dependencies have finished
+static bool dispatcher_job_try_send(dispatcher_t *dispatcher,
+                                    dispatch_job_t *job) {
+  xassert(dispatcher->worker_type == ThreadWorker);
+
+  if (dispatcher->ws)
+    return work_stealing_try_push(dispatcher->ws, job);
+
+  return rtos_osal_queue_send(&dispatcher->queue, (void *)&job,
+                              RTOS_OSAL_NO_WAIT) == RTOS_OSAL_SUCCESS;
+}
+
+void dispatcher_job_add(dispatcher_t *dispatcher, dispatch_job_t *job) {
+  dispatcher_log("dispatcher_add_job: %u   job=%u  worker_type=%d\n",
+                 (size_t)dispatcher, (size_t)job, dispatcher->worker_type);
+  xassert(dispatcher);
+  xassert(job);
+  xassert(dispatcher->worker_type != UninitializedWorker);
+
+  dispatcher_job_prepare(dispatcher, job);
+  dispatcher_job_send(dispatcher, job);
+}
+
+void dispatcher_graph_add(dispatcher_t *dispatcher, dispatch_job_t **jobs,
+                          size_t count) {
+  dispatcher_log("dispatcher_graph_add: %u   count=%d  worker_type=%d\n",
+                 (size_t)dispatcher, count, dispatcher->worker_type);
+  xassert(dispatcher);
+  xassert(jobs);
+  xassert(dispatcher->worker_type != UninitializedWorker);
+
+  // everything is set up before the first job is sent, a worker may release
+  // any job in the graph once the roots start running
+  for (int i = 0; i < count; i++) {
+    dispatcher_job_prepare(dispatcher, jobs[i]);
+    jobs[i]->dispatcher = dispatcher;
+    jobs[i]->pending = jobs[i]->dependency_count;
+  }
+
+  // send the roots, the workers send the rest as their dependencies finish
+  for (int i = 0; i < count; i++) {
+    if (jobs[i]->dependency_count == 0)
+      dispatcher_job_send(dispatcher, jobs[i]);
+  }
+}
+
 void dispatcher_group_add(dispatcher_t *dispatcher, dispatch_group_t *group) {
   dispatcher_log("dispatcher_group_add: %u   group=%u  worker_type=%d\n",
                  (size_t)dispatcher, (size_t)group, dispatcher->worker_type);
@@ -280,17 +568,22 @@ void dispatcher_group_add(dispatcher_t *dispatcher, dispatch_group_t *group) {
   if (dispatcher->worker_type == ThreadWorker) {
     for (int i = 0; i < group->count; i++) {
       group->jobs[i]->event_counter = group->event_counter;
-
-      rtos_osal_queue_send(&dispatcher->queue, (void *)&group->jobs[i],
-                           RTOS_OSAL_WAIT_FOREVER);
+      group->jobs[i]->dispatcher = NULL;
+
+      if (dispatcher->ws) {
+        work_stealing_push(dispatcher->ws, group->jobs[i]);
+      } else {
+        rtos_osal_queue_send(&dispatcher->queue, (void *)&group->jobs[i],
+                             RTOS_OSAL_WAIT_FOREVER);
+      }
     }
   } else if (dispatcher->worker_type == ISRWorker) {
     // disable interrupts while dispatching jobs
     uint32_t mask = rtos_interrupt_mask_all();
     for (int i = 0; i < group->count; i++) {
       group->jobs[i]->event_counter = group->event_counter;
-      chanend_job_send(dispatcher->chanend, dispatcher->isr_chanends[i],
-                       group->jobs[i]);
+      group->jobs[i]->dispatcher = NULL;
+      dispatcher_isr_job_send(dispatcher, group->jobs[i]);
     }
     // re-enable interrupts
     rtos_interrupt_mask_set(mask);
@@ -304,14 +597,20 @@ void dispatcher_job_wait(dispatcher_t *dispatcher, dispatch_job_t *job) {
   xassert(job);
   xassert(job->event_counter);
 
-  if (dispatcher->worker_type == ThreadWorker) {
-    event_counter_wait(job->event_counter, dispatcher->worker_type);
-  } else if (dispatcher->worker_type == ISRWorker) {
-#if GROUP_CHANNEL_WAIT
-    chanend_check_end_token(dispatcher->chanend);
-#else
-    event_counter_wait(job->event_counter, dispatcher->worker_type);
-#endif
+  // thread workers block on the job's semaphore, ISR workers spin on the
+  // job's own count so concurrent jobs are never confused with each other
+  event_counter_wait(job->event_counter, dispatcher->worker_type);
+}
+
+void dispatcher_graph_wait(dispatcher_t *dispatcher, dispatch_job_t **jobs,
+                           size_t count) {
+  dispatcher_log("dispatcher_graph_wait: %u   count=%d\n", (size_t)dispatcher,
+                 count);
+  xassert(dispatcher);
+  xassert(jobs);
+
+  for (int i = 0; i < count; i++) {
+    dispatcher_job_wait(dispatcher, jobs[i]);
   }
 }
 
@@ -326,13 +625,5 @@ void dispatcher_group_wait(dispatcher_t *dispatcher, dispatch_group_t *group) {
   // share the same event counter
   event_counter_t *counter = group->jobs[0]->event_counter;
   xassert(counter);
-  if (dispatcher->worker_type == ThreadWorker) {
-    event_counter_wait(counter, dispatcher->worker_type);
-  } else if (dispatcher->worker_type == ISRWorker) {
-#if GROUP_CHANNEL_WAIT
-    chanend_check_end_token(dispatcher->chanend);
-#else
-    event_counter_wait(counter, dispatcher->worker_type);
-#endif
-  }
+  event_counter_wait(counter, dispatcher->worker_type);
 }
@@ -10,12 +10,14 @@
 struct event_counter_struct {
   rtos_osal_semaphore_t *semaphore;
   volatile size_t count;
+  WorkerType worker_type;
 };
 
 event_counter_t *event_counter_create(size_t count, WorkerType worker_type) {
   event_counter_t *counter = rtos_osal_malloc(sizeof(event_counter_t));
 
   counter->semaphore = NULL;
+  counter->worker_type = worker_type;
 
   if (worker_type == ThreadWorker) {
     counter->semaphore = rtos_osal_malloc(sizeof(rtos_osal_semaphore_t));
@@ -30,6 +32,17 @@ void event_counter_init(event_counter_t *counter, size_t count) {
   xassert(counter);
 
   counter->count = count;
+
+  // counters are reused, so consume any signal left over from a previous use
+  // that was never waited on
+  if (counter->semaphore)
+    rtos_osal_semaphore_get(counter->semaphore, RTOS_OSAL_NO_WAIT);
+}
+
+WorkerType event_counter_worker_type_get(event_counter_t *counter) {
+  xassert(counter);
+
+  return counter->worker_type;
 }
 
 int event_counter_signal(event_counter_t *counter, WorkerType worker_type) {
@@ -15,6 +15,7 @@ extern "C" {
 
 event_counter_t *event_counter_create(size_t count, WorkerType worker_type);
 void event_counter_init(event_counter_t *counter, size_t count);
+WorkerType event_counter_worker_type_get(event_counter_t *counter);
 int event_counter_signal(event_counter_t *counter, WorkerType worker_type);
 void event_counter_wait(event_counter_t *counter, WorkerType worker_type);
 void event_counter_delete(event_counter_t *counter);
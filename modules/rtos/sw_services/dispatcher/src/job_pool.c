@@ -0,0 +1,96 @@
+// Copyright 2021 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+#include "job_pool.h"
+
+#include <xcore/assert.h>
+
+#include "rtos_osal.h"
+#include "dispatch_types.h"
+
+struct job_pool_struct {
+  size_t length;           // number of jobs owned by the pool
+  size_t available;        // number of jobs on the free list
+  dispatch_job_t *jobs;    // job storage, allocated once at create time
+  dispatch_job_t *free;    // head of the free list
+};
+
+job_pool_t *job_pool_create(size_t length, WorkerType worker_type) {
+  xassert(length > 0);
+  job_pool_t *pool;
+
+  pool = rtos_osal_malloc(sizeof(job_pool_t));
+  xassert(pool);
+
+  pool->length = length;
+  pool->available = length;
+  pool->jobs = rtos_osal_malloc(sizeof(dispatch_job_t) * length);
+  xassert(pool->jobs);
+  pool->free = NULL;
+
+  // every job gets its own event counter up front so dispatching one of
+  // these jobs never has to allocate
+  for (int i = (int)length - 1; i >= 0; i--) {
+    dispatch_job_t *job = &pool->jobs[i];
+
+    dispatch_job_init(job, NULL, NULL);
+    job->job_counter = event_counter_create(1, worker_type);
+    job->pool = pool;
+    job->next = pool->free;
+    pool->free = job;
+  }
+
+  dispatcher_log("job_pool_create: %u   length=%d\n", (size_t)pool, length);
+
+  return pool;
+}
+
+dispatch_job_t *job_pool_acquire(job_pool_t *pool) {
+  xassert(pool);
+  dispatch_job_t *job;
+
+  int state = rtos_osal_critical_enter();
+  job = pool->free;
+  if (job) {
+    pool->free = job->next;
+    pool->available--;
+    job->next = NULL;
+  }
+  rtos_osal_critical_exit(state);
+
+  dispatcher_log("job_pool_acquire: %u   job=%u\n", (size_t)pool,
+                 (size_t)job);
+
+  return job;
+}
+
+void job_pool_release(job_pool_t *pool, dispatch_job_t *job) {
+  xassert(pool);
+  xassert(job);
+  xassert(job->pool == pool);
+
+  dispatcher_log("job_pool_release: %u   job=%u\n", (size_t)pool,
+                 (size_t)job);
+
+  int state = rtos_osal_critical_enter();
+  job->next = pool->free;
+  pool->free = job;
+  pool->available++;
+  rtos_osal_critical_exit(state);
+}
+
+size_t job_pool_available_get(job_pool_t *pool) {
+  xassert(pool);
+  return pool->available;
+}
+
+void job_pool_delete(job_pool_t *pool) {
+  xassert(pool);
+
+  dispatcher_log("job_pool_delete: %u\n", (size_t)pool);
+
+  for (int i = 0; i < pool->length; i++) {
+    event_counter_delete(pool->jobs[i].job_counter);
+  }
+  rtos_osal_free(pool->jobs);
+  rtos_osal_free(pool);
+}
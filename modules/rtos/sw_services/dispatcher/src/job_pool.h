@@ -0,0 +1,27 @@
+// Copyright 2021 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+#ifndef DISPATCH_JOB_POOL_H_
+#define DISPATCH_JOB_POOL_H_
+
+#include <stddef.h>
+
+#include "dispatch_job.h"
+#include "worker_types.h"
+
+typedef struct job_pool_struct job_pool_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+job_pool_t *job_pool_create(size_t length, WorkerType worker_type);
+dispatch_job_t *job_pool_acquire(job_pool_t *pool);
+void job_pool_release(job_pool_t *pool, dispatch_job_t *job);
+size_t job_pool_available_get(job_pool_t *pool);
+void job_pool_delete(job_pool_t *pool);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // DISPATCH_JOB_POOL_H_
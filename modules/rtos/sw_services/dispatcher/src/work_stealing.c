@@ -0,0 +1,237 @@
+// Copyright 2021 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+#include "work_stealing.h"
+
+#include <xcore/assert.h>
+
+#include "rtos_osal.h"
+#include "dispatch_types.h"
+
+// Each worker owns a bounded ring of jobs. The owner takes jobs from the head
+// of its own ring, idle workers steal from the tail of other workers' rings.
+// Each ring has its own lock so that workers on different cores only contend
+// when they touch the same ring. A counting semaphore holds one count for each
+// free slot across all of the rings, so pushers block until a job is taken
+// rather than polling.
+
+typedef struct work_deque_struct {
+  dispatch_job_t **jobs;       // ring storage
+  size_t head;                 // index of the oldest job
+  volatile size_t count;       // number of jobs in the ring
+  volatile bool idle;          // set while the owner is waiting for work
+  rtos_osal_mutex_t lock;      // guards jobs, head and count
+  rtos_osal_semaphore_t ready; // given when the owner has work to look for
+} work_deque_t;
+
+struct work_stealing_struct {
+  size_t worker_count;         // number of rings
+  size_t length;               // capacity of each ring
+  volatile size_t next;        // round-robin start point for pushes
+  rtos_osal_semaphore_t space; // free slots across all of the rings
+  work_deque_t *deques;
+};
+
+work_stealing_t *work_stealing_create(size_t worker_count, size_t length) {
+  xassert(worker_count > 0);
+  xassert(length > 0);
+  work_stealing_t *ws;
+
+  ws = rtos_osal_malloc(sizeof(work_stealing_t));
+  xassert(ws);
+
+  ws->worker_count = worker_count;
+  ws->length = length;
+  ws->next = 0;
+  rtos_osal_semaphore_create(&ws->space, "ws_space", worker_count * length,
+                             worker_count * length);
+  ws->deques = rtos_osal_malloc(sizeof(work_deque_t) * worker_count);
+  xassert(ws->deques);
+
+  for (int i = 0; i < worker_count; i++) {
+    work_deque_t *deque = &ws->deques[i];
+
+    deque->jobs = rtos_osal_malloc(sizeof(dispatch_job_t *) * length);
+    xassert(deque->jobs);
+    deque->head = 0;
+    deque->count = 0;
+    deque->idle = false;
+    rtos_osal_mutex_create(&deque->lock, "ws_lock", RTOS_OSAL_NOT_RECURSIVE);
+    rtos_osal_semaphore_create(&deque->ready, "ws_ready", 1, 0);
+  }
+
+  dispatcher_log("work_stealing_create: %u   worker_count=%d, length=%d\n",
+                 (size_t)ws, worker_count, length);
+
+  return ws;
+}
+
+// Wakes one idle worker other than the given one so that it can steal work
+// that is waiting in the given worker's ring.
+static void work_stealing_wake_idle(work_stealing_t *ws, size_t worker) {
+  for (int i = 1; i < ws->worker_count; i++) {
+    int index = (worker + i) % ws->worker_count;
+
+    if (ws->deques[index].idle) {
+      rtos_osal_semaphore_put(&ws->deques[index].ready);
+      break;
+    }
+  }
+}
+
+// Pushes a job that a slot has already been taken from ws->space for. The
+// counts are read without the locks to pick a ring, so the chosen ring is
+// checked again once it is locked. The slot guarantees that some ring has
+// room.
+static void work_stealing_insert(work_stealing_t *ws, dispatch_job_t *job) {
+  int target = -1;
+  bool owner_idle = false;
+
+  while (target < 0) {
+    size_t start = ws->next;
+    int candidate = -1;
+
+    // prefer a ring whose owner is waiting for work, then the least loaded
+    // ring, starting from the round-robin position so that ties are spread
+    // across the workers
+    for (int i = 0; i < ws->worker_count; i++) {
+      int index = (start + i) % ws->worker_count;
+      size_t count = ws->deques[index].count;
+
+      if (count < ws->length && ws->deques[index].idle) {
+        candidate = index;
+        break;
+      }
+      if (count < ws->length &&
+          (candidate < 0 || count < ws->deques[candidate].count)) {
+        candidate = index;
+        if (count == 0)
+          break;
+      }
+    }
+    if (candidate < 0) {
+      // only seen when the unlocked counts are stale, give the workers that
+      // are taking jobs a chance to run rather than spinning
+      rtos_osal_delay(1);
+      continue;
+    }
+
+    work_deque_t *deque = &ws->deques[candidate];
+
+    rtos_osal_mutex_get(&deque->lock, RTOS_OSAL_WAIT_FOREVER);
+    if (deque->count < ws->length) {
+      deque->jobs[(deque->head + deque->count) % ws->length] = job;
+      deque->count++;
+      owner_idle = deque->idle;
+      target = candidate;
+    }
+    rtos_osal_mutex_put(&deque->lock);
+  }
+  ws->next = (target + 1) % ws->worker_count;
+
+  dispatcher_log("work_stealing_insert: %u   job=%u  worker=%d\n",
+                 (size_t)ws, (size_t)job, target);
+  rtos_osal_semaphore_put(&ws->deques[target].ready);
+
+  // the owner is busy with another job, so have an idle worker steal this one
+  // rather than leave it waiting behind that job
+  if (!owner_idle)
+    work_stealing_wake_idle(ws, target);
+}
+
+bool work_stealing_try_push(work_stealing_t *ws, dispatch_job_t *job) {
+  xassert(ws);
+  xassert(job);
+
+  if (rtos_osal_semaphore_get(&ws->space, RTOS_OSAL_NO_WAIT) !=
+      RTOS_OSAL_SUCCESS)
+    return false;
+
+  work_stealing_insert(ws, job);
+
+  return true;
+}
+
+void work_stealing_push(work_stealing_t *ws, dispatch_job_t *job) {
+  xassert(ws);
+  xassert(job);
+
+  // every ring may be full, wait for the workers to take a job
+  rtos_osal_semaphore_get(&ws->space, RTOS_OSAL_WAIT_FOREVER);
+  work_stealing_insert(ws, job);
+}
+
+dispatch_job_t *work_stealing_pop(work_stealing_t *ws, size_t worker) {
+  xassert(ws);
+  xassert(worker < ws->worker_count);
+  work_deque_t *own = &ws->deques[worker];
+
+  for (;;) {
+    dispatch_job_t *job = NULL;
+    bool left_behind = false;
+
+    if (own->count > 0) {
+      // take the oldest job from our own ring
+      rtos_osal_mutex_get(&own->lock, RTOS_OSAL_WAIT_FOREVER);
+      if (own->count > 0) {
+        job = own->jobs[own->head];
+        own->head = (own->head + 1) % ws->length;
+        own->count--;
+        left_behind = own->count > 0;
+      }
+      rtos_osal_mutex_put(&own->lock);
+    }
+
+    // steal the newest job from the first other worker that has any
+    for (int i = 1; job == NULL && i < ws->worker_count; i++) {
+      int index = (worker + i) % ws->worker_count;
+      work_deque_t *deque = &ws->deques[index];
+
+      if (deque->count == 0)
+        continue;
+
+      rtos_osal_mutex_get(&deque->lock, RTOS_OSAL_WAIT_FOREVER);
+      if (deque->count > 0) {
+        deque->count--;
+        job = deque->jobs[(deque->head + deque->count) % ws->length];
+      }
+      rtos_osal_mutex_put(&deque->lock);
+    }
+
+    if (job) {
+      own->idle = false;
+      rtos_osal_semaphore_put(&ws->space);
+      dispatcher_log("work_stealing_pop: %u   job=%u  worker=%d\n",
+                     (size_t)ws, (size_t)job, worker);
+      if (left_behind)
+        work_stealing_wake_idle(ws, worker);
+      return job;
+    }
+
+    // mark ourselves idle before looking once more, so that a worker that
+    // leaves work behind after our last look knows to wake us
+    if (!own->idle) {
+      own->idle = true;
+      continue;
+    }
+
+    // nothing to run or steal, sleep until a job is pushed to our ring or
+    // another worker asks for help
+    rtos_osal_semaphore_get(&own->ready, RTOS_OSAL_WAIT_FOREVER);
+    own->idle = false;
+  }
+}
+
+void work_stealing_delete(work_stealing_t *ws) {
+  xassert(ws);
+
+  dispatcher_log("work_stealing_delete: %u\n", (size_t)ws);
+
+  for (int i = 0; i < ws->worker_count; i++) {
+    rtos_osal_semaphore_delete(&ws->deques[i].ready);
+    rtos_osal_mutex_delete(&ws->deques[i].lock);
+    rtos_osal_free(ws->deques[i].jobs);
+  }
+  rtos_osal_semaphore_delete(&ws->space);
+  rtos_osal_free(ws->deques);
+  rtos_osal_free(ws);
+}
@@ -0,0 +1,27 @@
+// Copyright 2021 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+#ifndef DISPATCH_WORK_STEALING_H_
+#define DISPATCH_WORK_STEALING_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "dispatch_job.h"
+
+typedef struct work_stealing_struct work_stealing_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+work_stealing_t *work_stealing_create(size_t worker_count, size_t length);
+bool work_stealing_try_push(work_stealing_t *ws, dispatch_job_t *job);
+void work_stealing_push(work_stealing_t *ws, dispatch_job_t *job);
+dispatch_job_t *work_stealing_pop(work_stealing_t *ws, size_t worker);
+void work_stealing_delete(work_stealing_t *ws);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // DISPATCH_WORK_STEALING_H_
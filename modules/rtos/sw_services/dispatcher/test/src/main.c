@@ -18,6 +18,8 @@ static void RunTests(void *unused) {
   RUN_TEST_GROUP(dispatch_group);
   RUN_TEST_GROUP(threads_dispatcher);
   RUN_TEST_GROUP(isr_dispatcher);
+  RUN_TEST_GROUP(work_stealing_dispatcher);
+  RUN_TEST_GROUP(graph_dispatcher);
   UnityEnd();
   exit(Unity.TestFailures);
 }
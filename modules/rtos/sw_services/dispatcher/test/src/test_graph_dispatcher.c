@@ -0,0 +1,201 @@
+// Copyright 2021 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+#include "FreeRTOS.h"
+
+#include "dispatcher.h"
+#include "unity.h"
+#include "unity_fixture.h"
+
+#define QUEUE_THREAD_PRIORITY (configMAX_PRIORITIES - 2)
+
+#define FAN_OUT_COUNT 6
+
+typedef struct test_graph_node {
+  volatile int done;
+  volatile int in_order;
+  int dependency_count;
+  struct test_graph_node *dependencies[2];
+} test_graph_node_t;
+
+typedef struct test_callback_arg {
+  volatile int count[FAN_OUT_COUNT + 1];
+} test_callback_arg_t;
+
+DISPATCHER_JOB_ATTRIBUTE
+void do_graph_node_work(void *p) {
+  test_graph_node_t *node = (test_graph_node_t *)p;
+
+  // every dependency must have finished before this node starts
+  node->in_order = 1;
+  for (int i = 0; i < node->dependency_count; i++) {
+    if (!node->dependencies[i]->done)
+      node->in_order = 0;
+  }
+  node->done = 1;
+}
+
+DISPATCHER_JOB_ATTRIBUTE
+void do_graph_callback(void *p) {
+  volatile int *count = (volatile int *)p;
+  (*count)++;
+}
+
+static void test_node_init(test_graph_node_t *node, test_graph_node_t *dep0,
+                           test_graph_node_t *dep1) {
+  node->done = 0;
+  node->in_order = 0;
+  node->dependency_count = 0;
+  if (dep0)
+    node->dependencies[node->dependency_count++] = dep0;
+  if (dep1)
+    node->dependencies[node->dependency_count++] = dep1;
+}
+
+// A -> (B, C) -> D
+static void run_diamond(dispatcher_t *disp) {
+  test_graph_node_t nodes[4];
+  dispatch_job_t *jobs[4];
+  int callback_count = 0;
+
+  test_node_init(&nodes[0], NULL, NULL);
+  test_node_init(&nodes[1], &nodes[0], NULL);
+  test_node_init(&nodes[2], &nodes[0], NULL);
+  test_node_init(&nodes[3], &nodes[1], &nodes[2]);
+
+  for (int i = 0; i < 4; i++) {
+    jobs[i] = dispatcher_job_create(disp, do_graph_node_work, &nodes[i]);
+  }
+  dispatch_job_dependency_add(jobs[1], jobs[0]);
+  dispatch_job_dependency_add(jobs[2], jobs[0]);
+  dispatch_job_dependency_add(jobs[3], jobs[1]);
+  dispatch_job_dependency_add(jobs[3], jobs[2]);
+  dispatch_job_callback_set(jobs[3], do_graph_callback, &callback_count);
+
+  dispatcher_graph_add(disp, jobs, 4);
+  // waiting on the sink is enough
+  dispatcher_job_wait(disp, jobs[3]);
+
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL_INT(1, nodes[i].done);
+    TEST_ASSERT_EQUAL_INT(1, nodes[i].in_order);
+  }
+  TEST_ASSERT_EQUAL_INT(1, callback_count);
+
+  for (int i = 0; i < 4; i++) {
+    dispatch_job_delete(jobs[i]);
+  }
+}
+
+// A -> (B0, B1, ... Bn)
+static void run_fan_out(dispatcher_t *disp) {
+  test_graph_node_t nodes[FAN_OUT_COUNT + 1];
+  dispatch_job_t *jobs[FAN_OUT_COUNT + 1];
+  test_callback_arg_t callback_arg;
+
+  test_node_init(&nodes[0], NULL, NULL);
+  for (int i = 1; i <= FAN_OUT_COUNT; i++) {
+    test_node_init(&nodes[i], &nodes[0], NULL);
+  }
+
+  for (int i = 0; i <= FAN_OUT_COUNT; i++) {
+    callback_arg.count[i] = 0;
+    jobs[i] = dispatcher_job_create(disp, do_graph_node_work, &nodes[i]);
+    dispatch_job_callback_set(jobs[i], do_graph_callback,
+                              (void *)&callback_arg.count[i]);
+    if (i > 0)
+      dispatch_job_dependency_add(jobs[i], jobs[0]);
+  }
+
+  dispatcher_graph_add(disp, jobs, FAN_OUT_COUNT + 1);
+  dispatcher_graph_wait(disp, jobs, FAN_OUT_COUNT + 1);
+
+  for (int i = 0; i <= FAN_OUT_COUNT; i++) {
+    TEST_ASSERT_EQUAL_INT(1, nodes[i].done);
+    TEST_ASSERT_EQUAL_INT(1, nodes[i].in_order);
+    TEST_ASSERT_EQUAL_INT(1, callback_arg.count[i]);
+  }
+
+  for (int i = 0; i <= FAN_OUT_COUNT; i++) {
+    dispatch_job_delete(jobs[i]);
+  }
+}
+
+TEST_GROUP(graph_dispatcher);
+
+TEST_SETUP(graph_dispatcher) {}
+
+TEST_TEAR_DOWN(graph_dispatcher) {}
+
+TEST(graph_dispatcher, test_threads_diamond) {
+  dispatcher_t *disp;
+  const int kQueueLength = 10;
+  const int kThreadCount = 3;
+
+  disp = dispatcher_create();
+  dispatcher_thread_init(disp, kQueueLength, kThreadCount,
+                         QUEUE_THREAD_PRIORITY);
+
+  run_diamond(disp);
+
+  dispatcher_delete(disp);
+}
+
+TEST(graph_dispatcher, test_threads_fan_out) {
+  dispatcher_t *disp;
+  const int kQueueLength = 10;
+  const int kThreadCount = 3;
+
+  disp = dispatcher_create();
+  dispatcher_thread_init(disp, kQueueLength, kThreadCount,
+                         QUEUE_THREAD_PRIORITY);
+
+  run_fan_out(disp);
+
+  dispatcher_delete(disp);
+}
+
+TEST(graph_dispatcher, test_stealing_fan_out) {
+  dispatcher_t *disp;
+  const int kQueueLength = 2;
+  const int kThreadCount = 3;
+
+  disp = dispatcher_create();
+  dispatcher_thread_stealing_init(disp, kQueueLength, kThreadCount,
+                                  QUEUE_THREAD_PRIORITY);
+
+  run_fan_out(disp);
+
+  dispatcher_delete(disp);
+}
+
+TEST(graph_dispatcher, test_isr_diamond) {
+  dispatcher_t *disp;
+  const uint32_t kCoreMap = 0b00011100;
+
+  disp = dispatcher_create();
+  dispatcher_isr_init(disp, kCoreMap);
+
+  run_diamond(disp);
+
+  dispatcher_delete(disp);
+}
+
+TEST(graph_dispatcher, test_isr_fan_out) {
+  dispatcher_t *disp;
+  const uint32_t kCoreMap = 0b00011100;
+
+  disp = dispatcher_create();
+  dispatcher_isr_init(disp, kCoreMap);
+
+  run_fan_out(disp);
+
+  dispatcher_delete(disp);
+}
+
+TEST_GROUP_RUNNER(graph_dispatcher) {
+  RUN_TEST_CASE(graph_dispatcher, test_threads_diamond);
+  RUN_TEST_CASE(graph_dispatcher, test_threads_fan_out);
+  RUN_TEST_CASE(graph_dispatcher, test_stealing_fan_out);
+  RUN_TEST_CASE(graph_dispatcher, test_isr_diamond);
+  RUN_TEST_CASE(graph_dispatcher, test_isr_fan_out);
+}
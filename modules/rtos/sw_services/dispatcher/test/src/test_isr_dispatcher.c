@@ -35,6 +35,12 @@ void do_isr_parallel_work(void *p) {
     arg->count++;
 }
 
+DISPATCHER_JOB_ATTRIBUTE
+void do_isr_quick_work(void *p) {
+  int *count = (int *)p;
+  (*count)++;
+}
+
 TEST_GROUP(isr_dispatcher);
 
 TEST_SETUP(isr_dispatcher) {}
@@ -61,6 +67,37 @@ TEST(isr_dispatcher, test_wait_job) {
   dispatcher_delete(disp);
 }
 
+TEST(isr_dispatcher, test_wait_jobs) {
+  dispatcher_t *disp;
+  dispatch_job_t *jobs[3];
+  test_work_arg_t arg;
+  const uint32_t kCoreMap = 0b00111000;
+  const int kJobCount = 3;
+
+  arg.core_flags[3] = 0;
+  arg.core_flags[4] = 0;
+  arg.core_flags[5] = 0;
+
+  disp = dispatcher_create();
+  dispatcher_isr_init(disp, kCoreMap);
+
+  // independent jobs are spread across the ISR workers
+  for (int i = 0; i < kJobCount; i++) {
+    jobs[i] = dispatcher_function_add(disp, do_isr_standard_work, &arg);
+  }
+  // wait out of order, each wait is for that job only
+  for (int i = kJobCount - 1; i >= 0; i--) {
+    dispatcher_job_wait(disp, jobs[i]);
+    dispatch_job_delete(jobs[i]);
+  }
+
+  TEST_ASSERT_EQUAL_INT(1, arg.core_flags[3]);
+  TEST_ASSERT_EQUAL_INT(1, arg.core_flags[4]);
+  TEST_ASSERT_EQUAL_INT(1, arg.core_flags[5]);
+
+  dispatcher_delete(disp);
+}
+
 TEST(isr_dispatcher, test_wait_group) {
   dispatcher_t *disp;
   dispatch_group_t *group;
@@ -164,8 +201,36 @@ TEST(isr_dispatcher, test_parallel) {
   dispatcher_delete(disp);
 }
 
+TEST(isr_dispatcher, test_heap_usage) {
+  dispatcher_t *disp;
+  dispatch_job_t *job;
+  const uint32_t kCoreMap = 0b00000100;
+  const int kIterations = 1000000;
+  size_t free_heap_size;
+  int count = 0;
+
+  disp = dispatcher_create();
+  dispatcher_isr_init(disp, kCoreMap);
+
+  // all allocations happen in dispatcher_isr_init
+  free_heap_size = xPortGetFreeHeapSize();
+
+  for (int iter = 0; iter < kIterations; iter++) {
+    job = dispatcher_function_add(disp, do_isr_quick_work, &count);
+    dispatcher_job_wait(disp, job);
+    dispatch_job_delete(job);
+    TEST_ASSERT_EQUAL_INT(free_heap_size, xPortGetFreeHeapSize());
+  }
+
+  TEST_ASSERT_EQUAL_INT(kIterations, count);
+
+  dispatcher_delete(disp);
+}
+
 TEST_GROUP_RUNNER(isr_dispatcher) {
   RUN_TEST_CASE(isr_dispatcher, test_wait_job);
+  RUN_TEST_CASE(isr_dispatcher, test_wait_jobs);
   RUN_TEST_CASE(isr_dispatcher, test_wait_group);
   RUN_TEST_CASE(isr_dispatcher, test_parallel);
+  RUN_TEST_CASE(isr_dispatcher, test_heap_usage);
 }
\ No newline at end of file
@@ -63,6 +63,12 @@ void do_thread_extended_work(void *p) {
   xSemaphoreGive(mutex);
 }
 
+DISPATCHER_JOB_ATTRIBUTE
+void do_thread_quick_work(void *p) {
+  test_work_arg_t *arg = (test_work_arg_t *)p;
+  arg->count++;
+}
+
 DISPATCHER_JOB_ATTRIBUTE
 void do_thread_parallel_work(void *p) {
   // NOTE: the "volatile" is needed here or the compiler may optimize this away
@@ -314,10 +320,50 @@ TEST(threads_dispatcher, test_parallel) {
   dispatcher_delete(disp);
 }
 
+TEST(threads_dispatcher, test_heap_usage) {
+  dispatcher_t *disp;
+  dispatch_job_t *jobs[3];
+  test_work_arg_t args[3];
+  const int kQueueLength = 10;
+  const int kThreadCount = 3;
+  const int kIterations = 1000000;
+  size_t free_heap_size;
+
+  disp = dispatcher_create();
+  dispatcher_thread_init(disp, kQueueLength, kThreadCount,
+                         QUEUE_THREAD_PRIORITY);
+
+  for (int i = 0; i < kThreadCount; i++) {
+    args[i].count = 0;
+  }
+
+  // all allocations happen in dispatcher_thread_init
+  free_heap_size = xPortGetFreeHeapSize();
+
+  for (int iter = 0; iter < kIterations; iter += kThreadCount) {
+    for (int i = 0; i < kThreadCount; i++) {
+      jobs[i] = dispatcher_function_add(disp, do_thread_quick_work, &args[i]);
+    }
+    for (int i = 0; i < kThreadCount; i++) {
+      dispatcher_job_wait(disp, jobs[i]);
+      dispatch_job_delete(jobs[i]);
+    }
+    TEST_ASSERT_EQUAL_INT(free_heap_size, xPortGetFreeHeapSize());
+  }
+
+  for (int i = 0; i < kThreadCount; i++) {
+    TEST_ASSERT_EQUAL_INT((kIterations + kThreadCount - 1) / kThreadCount,
+                          args[i].count);
+  }
+
+  dispatcher_delete(disp);
+}
+
 TEST_GROUP_RUNNER(threads_dispatcher) {
   RUN_TEST_CASE(threads_dispatcher, test_wait_job);
   RUN_TEST_CASE(threads_dispatcher, test_wait_group);
   RUN_TEST_CASE(threads_dispatcher, test_mixed_durations1);
   RUN_TEST_CASE(threads_dispatcher, test_mixed_durations2);
   RUN_TEST_CASE(threads_dispatcher, test_parallel);
+  RUN_TEST_CASE(threads_dispatcher, test_heap_usage);
 }
\ No newline at end of file
@@ -0,0 +1,241 @@
+// Copyright 2021 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+#include <stdlib.h>
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
+#include "dispatcher.h"
+#include "unity.h"
+#include "unity_fixture.h"
+
+#define QUEUE_THREAD_PRIORITY (configMAX_PRIORITIES - 2)
+
+#define BENCHMARK_JOB_COUNT 256
+#define BENCHMARK_JOB_WORK 200
+#define BENCHMARK_MAX_WORKERS 8
+
+typedef struct test_work_arg {
+  int count;
+} test_work_arg_t;
+
+typedef struct test_benchmark_arg {
+  uint32_t submit_time;
+  uint32_t start_time;
+  int done;
+} test_benchmark_arg_t;
+
+static SemaphoreHandle_t mutex;
+
+static test_benchmark_arg_t benchmark_args[BENCHMARK_JOB_COUNT];
+static dispatch_job_t *benchmark_jobs[BENCHMARK_JOB_COUNT];
+static uint32_t benchmark_latencies[BENCHMARK_JOB_COUNT];
+
+DISPATCHER_JOB_ATTRIBUTE
+void do_stealing_standard_work(void *p) {
+  test_work_arg_t *arg = (test_work_arg_t *)p;
+
+  vTaskDelay(100 / portTICK_PERIOD_MS);
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  arg->count++;
+  xSemaphoreGive(mutex);
+}
+
+DISPATCHER_JOB_ATTRIBUTE
+void do_stealing_benchmark_work(void *p) {
+  test_benchmark_arg_t *arg = (test_benchmark_arg_t *)p;
+  // NOTE: the "volatile" is needed here or the compiler may optimize this away
+  volatile int count = 0;
+
+  arg->start_time = get_reference_time();
+  for (int i = 0; i < BENCHMARK_JOB_WORK; i++)
+    count++;
+  arg->done = 1;
+}
+
+static int compare_latency(const void *a, const void *b) {
+  uint32_t lhs = *(const uint32_t *)a;
+  uint32_t rhs = *(const uint32_t *)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+static void run_benchmark(int worker_count, int stealing,
+                          uint32_t *total_ticks, uint32_t *p99_ticks) {
+  const int kQueueLength = 16;
+  dispatcher_t *disp;
+  uint32_t start;
+
+  disp = dispatcher_create();
+  if (stealing)
+    dispatcher_thread_stealing_init(disp, kQueueLength, worker_count,
+                                    QUEUE_THREAD_PRIORITY);
+  else
+    dispatcher_thread_init(disp, kQueueLength, worker_count,
+                           QUEUE_THREAD_PRIORITY);
+
+  for (int i = 0; i < BENCHMARK_JOB_COUNT; i++) {
+    benchmark_args[i].done = 0;
+    dispatch_job_init(benchmark_jobs[i], do_stealing_benchmark_work,
+                      &benchmark_args[i]);
+  }
+
+  start = get_reference_time();
+  for (int i = 0; i < BENCHMARK_JOB_COUNT; i++) {
+    benchmark_args[i].submit_time = get_reference_time();
+    dispatcher_job_add(disp, benchmark_jobs[i]);
+  }
+  for (int i = 0; i < BENCHMARK_JOB_COUNT; i++) {
+    dispatcher_job_wait(disp, benchmark_jobs[i]);
+  }
+  *total_ticks = get_reference_time() - start;
+
+  for (int i = 0; i < BENCHMARK_JOB_COUNT; i++) {
+    TEST_ASSERT_EQUAL_INT(1, benchmark_args[i].done);
+    benchmark_latencies[i] =
+        benchmark_args[i].start_time - benchmark_args[i].submit_time;
+  }
+  qsort(benchmark_latencies, BENCHMARK_JOB_COUNT, sizeof(uint32_t),
+        compare_latency);
+  *p99_ticks = benchmark_latencies[(BENCHMARK_JOB_COUNT * 99) / 100];
+
+  dispatcher_delete(disp);
+}
+
+TEST_GROUP(work_stealing_dispatcher);
+
+TEST_SETUP(work_stealing_dispatcher) { mutex = xSemaphoreCreateMutex(); }
+
+TEST_TEAR_DOWN(work_stealing_dispatcher) { vSemaphoreDelete(mutex); }
+
+TEST(work_stealing_dispatcher, test_wait_job) {
+  dispatcher_t *disp;
+  dispatch_job_t *job;
+  test_work_arg_t arg;
+  const int kQueueLength = 4;
+  const int kThreadCount = 3;
+
+  disp = dispatcher_create();
+  dispatcher_thread_stealing_init(disp, kQueueLength, kThreadCount,
+                                  QUEUE_THREAD_PRIORITY);
+
+  arg.count = 0;
+
+  job = dispatcher_function_add(disp, do_stealing_standard_work, &arg);
+  dispatcher_job_wait(disp, job);
+
+  TEST_ASSERT_EQUAL_INT(1, arg.count);
+
+  dispatch_job_delete(job);
+  dispatcher_delete(disp);
+}
+
+TEST(work_stealing_dispatcher, test_wait_group) {
+  dispatcher_t *disp;
+  dispatch_group_t *group;
+  test_work_arg_t arg;
+  const int kQueueLength = 4;
+  const int kThreadCount = 3;
+  const int kGroupLength = 10;
+
+  disp = dispatcher_create();
+  dispatcher_thread_stealing_init(disp, kQueueLength, kThreadCount,
+                                  QUEUE_THREAD_PRIORITY);
+
+  group = dispatch_group_create(kGroupLength);
+
+  arg.count = 0;
+
+  // more jobs than workers so some of them have to be stolen
+  for (int i = 0; i < kGroupLength; i++) {
+    dispatch_group_function_add(group, do_stealing_standard_work, &arg);
+  }
+
+  dispatcher_group_add(disp, group);
+  dispatcher_group_wait(disp, group);
+
+  TEST_ASSERT_EQUAL_INT(kGroupLength, arg.count);
+
+  dispatch_job_t **jobs = dispatch_group_jobs_get(group);
+  for (int i = 0; i < kGroupLength; i++) {
+    dispatch_job_delete(jobs[i]);
+  }
+  dispatch_group_delete(group);
+  dispatcher_delete(disp);
+}
+
+TEST(work_stealing_dispatcher, test_idle_worker_takes_job) {
+  dispatcher_t *disp;
+  dispatch_job_t *slow_job, *fast_job, *job;
+  test_work_arg_t slow_arg;
+  test_benchmark_arg_t arg;
+  const int kQueueLength = 4;
+  const int kThreadCount = 2;
+
+  disp = dispatcher_create();
+  dispatcher_thread_stealing_init(disp, kQueueLength, kThreadCount,
+                                  QUEUE_THREAD_PRIORITY);
+
+  slow_arg.count = 0;
+  arg.done = 0;
+
+  // keep one worker busy and let the round-robin come back to its ring, the
+  // next job must be run by the idle worker rather than wait behind it
+  slow_job =
+      dispatcher_function_add(disp, do_stealing_standard_work, &slow_arg);
+  vTaskDelay(pdMS_TO_TICKS(10));
+  fast_job = dispatcher_function_add(disp, do_stealing_benchmark_work, &arg);
+  dispatcher_job_wait(disp, fast_job);
+  vTaskDelay(pdMS_TO_TICKS(10));
+
+  arg.done = 0;
+  arg.submit_time = get_reference_time();
+  job = dispatcher_function_add(disp, do_stealing_benchmark_work, &arg);
+  dispatcher_job_wait(disp, job);
+
+  TEST_ASSERT_EQUAL_INT(0, slow_arg.count);
+  TEST_ASSERT_LESS_THAN_UINT32(10000 * PLATFORM_REFERENCE_MHZ,
+                               arg.start_time - arg.submit_time);
+
+  dispatcher_job_wait(disp, slow_job);
+  TEST_ASSERT_EQUAL_INT(1, slow_arg.count);
+
+  dispatch_job_delete(slow_job);
+  dispatch_job_delete(fast_job);
+  dispatch_job_delete(job);
+  dispatcher_delete(disp);
+}
+
+TEST(work_stealing_dispatcher, test_benchmark) {
+  uint32_t queue_ticks, queue_p99;
+  uint32_t stealing_ticks, stealing_p99;
+
+  for (int i = 0; i < BENCHMARK_JOB_COUNT; i++) {
+    benchmark_jobs[i] = dispatch_job_create(NULL, NULL);
+  }
+
+  rtos_printf("workers  queue(us)  queue_p99(us)  stealing(us)  "
+              "stealing_p99(us)\n");
+  for (int workers = 1; workers <= BENCHMARK_MAX_WORKERS; workers++) {
+    run_benchmark(workers, 0, &queue_ticks, &queue_p99);
+    run_benchmark(workers, 1, &stealing_ticks, &stealing_p99);
+
+    rtos_printf("%7d  %9u  %13u  %12u  %16u\n", workers,
+                queue_ticks / PLATFORM_REFERENCE_MHZ,
+                queue_p99 / PLATFORM_REFERENCE_MHZ,
+                stealing_ticks / PLATFORM_REFERENCE_MHZ,
+                stealing_p99 / PLATFORM_REFERENCE_MHZ);
+  }
+
+  for (int i = 0; i < BENCHMARK_JOB_COUNT; i++) {
+    dispatch_job_delete(benchmark_jobs[i]);
+  }
+}
+
+TEST_GROUP_RUNNER(work_stealing_dispatcher) {
+  RUN_TEST_CASE(work_stealing_dispatcher, test_wait_job);
+  RUN_TEST_CASE(work_stealing_dispatcher, test_wait_group);
+  RUN_TEST_CASE(work_stealing_dispatcher, test_idle_worker_takes_job);
+  RUN_TEST_CASE(work_stealing_dispatcher, test_benchmark);
+}
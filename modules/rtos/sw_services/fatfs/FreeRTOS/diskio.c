@@ -7,18 +7,27 @@
 /* storage control modules to the FatFs module with a defined API.       */
 /*-----------------------------------------------------------------------*/
 
+#include <string.h>
+
 #include "ff.h"            /* Obtains integer types */
 #include "diskio.h"        /* Declarations of disk functions */
 
-#include "rtos/drivers/qspi_flash/api/rtos_qspi_flash.h"
+#include "fs_support.h"    /* Obtains the flash and FTL contexts */
 
-#ifndef QSPI_FLASH_FILESYSTEM_START_ADDRESS
-#define QSPI_FLASH_FILESYSTEM_START_ADDRESS 0x100000
+/*
+ * The number of sectors held in RAM by the sector cache. Single sector
+ * reads, which FatFS uses for the FAT and directories, are kept in the
+ * cache, and single sector writes are held in it until they are evicted
+ * or CTRL_SYNC is issued by f_sync() or f_close(). Set to 0 to disable.
+ */
+#ifndef QSPI_FLASH_FILESYSTEM_CACHE_SECTORS
+#define QSPI_FLASH_FILESYSTEM_CACHE_SECTORS 2
 #endif
 
-#ifndef QSPI_FLASH_SECTOR_SIZE
-#define QSPI_FLASH_SECTOR_SIZE 4096
-#endif
+/* Sectors are compared against the flash in chunks of this size before writing */
+#define SECTOR_COMPARE_CHUNK_SIZE 256
+
+#define SECTOR_ADDRESS(sector) (QSPI_FLASH_FILESYSTEM_START_ADDRESS + ((sector) * QSPI_FLASH_SECTOR_SIZE))
 
 static DSTATUS drive_status[FF_VOLUMES] = {
 #if FF_VOLUMES >= 10
@@ -54,6 +63,193 @@ static DSTATUS drive_status[FF_VOLUMES] = {
 
 };
 
+/*-----------------------------------------------------------------------*/
+/* Sector Cache                                                          */
+/*-----------------------------------------------------------------------*/
+
+/*
+ * Reads sectors from the FTL when it is enabled, otherwise straight from
+ * the flash.
+ */
+static DRESULT sector_read(
+    BYTE *buff,
+    LBA_t sector,
+    UINT count
+)
+{
+#if USE_FTL
+    return ftl_read(ff_ftl_ctx, buff, sector, count) == FTL_OK ? RES_OK : RES_ERROR;
+#else
+    extern rtos_qspi_flash_t *ff_qspi_flash_ctx;
+
+    rtos_qspi_flash_read(ff_qspi_flash_ctx, buff, SECTOR_ADDRESS(sector), count * QSPI_FLASH_SECTOR_SIZE);
+    return RES_OK;
+#endif
+}
+
+#if FF_FS_READONLY == 0
+#if USE_FTL
+/*
+ * The FTL writes each sector to a fresh page, so no erase is needed.
+ */
+static DRESULT sector_program(
+    LBA_t sector,
+    const BYTE *data
+)
+{
+    return ftl_write(ff_ftl_ctx, data, sector, 1) == FTL_OK ? RES_OK : RES_ERROR;
+}
+#else
+/*
+ * Writes a sector to the flash. The erase is skipped when the new data
+ * only clears bits that are set in the flash, which includes writing to
+ * an erased sector, and the write is skipped when the data is unchanged.
+ */
+static DRESULT sector_program(
+    LBA_t sector,
+    const BYTE *data
+)
+{
+    extern rtos_qspi_flash_t *ff_qspi_flash_ctx;
+    uint8_t flash_data[SECTOR_COMPARE_CHUNK_SIZE];
+    unsigned address = SECTOR_ADDRESS(sector);
+    int changed = 0;
+    int needs_erase = 0;
+
+    rtos_qspi_flash_lock(ff_qspi_flash_ctx);
+
+    for (int offset = 0; offset < QSPI_FLASH_SECTOR_SIZE && !needs_erase; offset += SECTOR_COMPARE_CHUNK_SIZE) {
+        rtos_qspi_flash_read(ff_qspi_flash_ctx, flash_data, address + offset, SECTOR_COMPARE_CHUNK_SIZE);
+        for (int i = 0; i < SECTOR_COMPARE_CHUNK_SIZE; i++) {
+            if (data[offset + i] != flash_data[i]) {
+                changed = 1;
+                if (data[offset + i] & ~flash_data[i]) {
+                    needs_erase = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (needs_erase) {
+        rtos_qspi_flash_erase(ff_qspi_flash_ctx, address, QSPI_FLASH_SECTOR_SIZE);
+    }
+    if (changed) {
+        rtos_qspi_flash_write(ff_qspi_flash_ctx, (uint8_t *) data, address, QSPI_FLASH_SECTOR_SIZE);
+    }
+
+    rtos_qspi_flash_unlock(ff_qspi_flash_ctx);
+
+    return RES_OK;
+}
+#endif /* USE_FTL */
+#endif /* FF_FS_READONLY == 0 */
+
+#if QSPI_FLASH_FILESYSTEM_CACHE_SECTORS > 0
+
+typedef struct {
+    LBA_t sector;
+    uint32_t last_use;
+    uint8_t valid;
+    uint8_t dirty;
+} sector_cache_entry_t;
+
+static sector_cache_entry_t sector_cache[QSPI_FLASH_FILESYSTEM_CACHE_SECTORS];
+static BYTE sector_cache_data[QSPI_FLASH_FILESYSTEM_CACHE_SECTORS][QSPI_FLASH_SECTOR_SIZE] __attribute__((aligned(4)));
+static uint32_t sector_cache_use_count;
+
+static int sector_cache_lookup(
+    LBA_t sector
+)
+{
+    for (int i = 0; i < QSPI_FLASH_FILESYSTEM_CACHE_SECTORS; i++) {
+        if (sector_cache[i].valid && sector_cache[i].sector == sector) {
+            sector_cache[i].last_use = ++sector_cache_use_count;
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * Writes an entry back if it is dirty. It is left dirty if the write fails.
+ */
+static DRESULT sector_cache_flush_entry(
+    int i
+)
+{
+#if FF_FS_READONLY == 0
+    if (sector_cache[i].valid && sector_cache[i].dirty) {
+        if (sector_program(sector_cache[i].sector, sector_cache_data[i]) != RES_OK) {
+            return RES_ERROR;
+        }
+        sector_cache[i].dirty = 0;
+    }
+#endif
+    return RES_OK;
+}
+
+/*
+ * Returns the cache entry for a sector, evicting the least recently
+ * used entry on a miss. The sector is read from the flash on a miss
+ * only if load is set. Returns -1 if the evicted entry could not be
+ * written back or the sector could not be read.
+ */
+static int sector_cache_get(
+    LBA_t sector,
+    int load
+)
+{
+    int victim = sector_cache_lookup(sector);
+
+    if (victim >= 0) {
+        return victim;
+    }
+
+    victim = 0;
+    for (int i = 0; i < QSPI_FLASH_FILESYSTEM_CACHE_SECTORS; i++) {
+        if (!sector_cache[i].valid) {
+            victim = i;
+            break;
+        }
+        if (sector_cache[i].last_use < sector_cache[victim].last_use) {
+            victim = i;
+        }
+    }
+
+    if (sector_cache_flush_entry(victim) != RES_OK) {
+        return -1;
+    }
+
+    sector_cache[victim].sector = sector;
+    sector_cache[victim].valid = 1;
+    sector_cache[victim].dirty = 0;
+    sector_cache[victim].last_use = ++sector_cache_use_count;
+
+    if (load && sector_read(sector_cache_data[victim], sector, 1) != RES_OK) {
+        sector_cache[victim].valid = 0;
+        return -1;
+    }
+
+    return victim;
+}
+
+static DRESULT sector_cache_sync(void)
+{
+    DRESULT res = RES_OK;
+
+    for (int i = 0; i < QSPI_FLASH_FILESYSTEM_CACHE_SECTORS; i++) {
+        if (sector_cache_flush_entry(i) != RES_OK) {
+            res = RES_ERROR;
+        }
+    }
+
+    return res;
+}
+
+#endif /* QSPI_FLASH_FILESYSTEM_CACHE_SECTORS > 0 */
+
 /*-----------------------------------------------------------------------*/
 /* Get Drive Status                                                      */
 /*-----------------------------------------------------------------------*/
@@ -87,6 +283,13 @@ DSTATUS disk_initialize (
     switch (pdrv) {
 #if FF_VOLUMES >= 1
     case 0:
+#if USE_FTL
+        if (ff_ftl_ctx == NULL) {
+            /* The FTL failed to mount */
+            stat = STA_NOINIT;
+            break;
+        }
+#endif
          if ((drive_status[pdrv] & STA_NOINIT )== STA_NOINIT) {
             drive_status[pdrv] &= ~STA_NOINIT;
         }
@@ -115,18 +318,38 @@ DRESULT disk_read (
     UINT count        /* Number of sectors to read */
 )
 {
-    extern rtos_qspi_flash_t *ff_qspi_flash_ctx;
     DRESULT res;
 
     switch (pdrv) {
 #if FF_VOLUMES >= 1
     case 0:
         if ((drive_status[pdrv] & ~STA_PROTECT) == 0) {
-            rtos_qspi_flash_read(
-                    ff_qspi_flash_ctx,
-                    buff,
-                    QSPI_FLASH_FILESYSTEM_START_ADDRESS + (sector * QSPI_FLASH_SECTOR_SIZE),
-                    count * QSPI_FLASH_SECTOR_SIZE);
+#if QSPI_FLASH_FILESYSTEM_CACHE_SECTORS > 0
+            if (count == 1) {
+                int i = sector_cache_get(sector, 1);
+                if (i < 0) {
+                    res = RES_ERROR;
+                    break;
+                }
+                memcpy(buff, sector_cache_data[i], QSPI_FLASH_SECTOR_SIZE);
+                res = RES_OK;
+                break;
+            }
+#endif
+            if (sector_read(buff, sector, count) != RES_OK) {
+                res = RES_ERROR;
+                break;
+            }
+#if QSPI_FLASH_FILESYSTEM_CACHE_SECTORS > 0
+            /* Sectors waiting in the cache are newer than the flash */
+            for (int i = 0; i < QSPI_FLASH_FILESYSTEM_CACHE_SECTORS; i++) {
+                if (sector_cache[i].valid && sector_cache[i].dirty &&
+                    sector_cache[i].sector >= sector && sector_cache[i].sector < sector + count) {
+                    memcpy(&buff[(sector_cache[i].sector - sector) * QSPI_FLASH_SECTOR_SIZE],
+                           sector_cache_data[i], QSPI_FLASH_SECTOR_SIZE);
+                }
+            }
+#endif
             res = RES_OK;
         } else if (drive_status[pdrv] & STA_NOINIT) {
             res = RES_NOTRDY;
@@ -159,25 +382,39 @@ DRESULT disk_write (
     UINT count            /* Number of sectors to write */
 )
 {
-    extern rtos_qspi_flash_t *ff_qspi_flash_ctx;
     DRESULT res;
 
     switch (pdrv) {
 #if FF_VOLUMES >= 1
     case 0:
         if (drive_status[pdrv] == 0) {
-            rtos_qspi_flash_lock(ff_qspi_flash_ctx);
-            rtos_qspi_flash_erase(
-                    ff_qspi_flash_ctx,
-                    QSPI_FLASH_FILESYSTEM_START_ADDRESS + ( sector * QSPI_FLASH_SECTOR_SIZE ),
-                    count * QSPI_FLASH_SECTOR_SIZE );
-            rtos_qspi_flash_write(
-                    ff_qspi_flash_ctx,
-                    (uint8_t *) buff,
-                    QSPI_FLASH_FILESYSTEM_START_ADDRESS + ( sector * QSPI_FLASH_SECTOR_SIZE ),
-                    count * QSPI_FLASH_SECTOR_SIZE );
-            rtos_qspi_flash_unlock(ff_qspi_flash_ctx);
             res = RES_OK;
+            for (UINT n = 0; n < count && res == RES_OK; n++) {
+                const BYTE *data = &buff[n * QSPI_FLASH_SECTOR_SIZE];
+#if QSPI_FLASH_FILESYSTEM_CACHE_SECTORS > 0
+                int i;
+
+                if (count == 1) {
+                    /* FAT, directory and partial file sectors wait in the cache */
+                    i = sector_cache_get(sector, 0);
+                    if (i < 0) {
+                        res = RES_ERROR;
+                        continue;
+                    }
+                    memcpy(sector_cache_data[i], data, QSPI_FLASH_SECTOR_SIZE);
+                    sector_cache[i].dirty = 1;
+                    continue;
+                }
+
+                /* Multiple sector file data is written through */
+                i = sector_cache_lookup(sector + n);
+                if (i >= 0) {
+                    memcpy(sector_cache_data[i], data, QSPI_FLASH_SECTOR_SIZE);
+                    sector_cache[i].dirty = 0;
+                }
+#endif
+                res = sector_program(sector + n, data);
+            }
         } else if (drive_status[pdrv] & STA_NOINIT) {
             res = RES_NOTRDY;
         } else if (drive_status[pdrv] & STA_PROTECT) {
@@ -209,7 +446,9 @@ DRESULT disk_ioctl (
     void *buff        /* Buffer to send/receive control data */
 )
 {
+#if !USE_FTL
     extern rtos_qspi_flash_t *ff_qspi_flash_ctx;
+#endif
     DRESULT res;
 
     switch (pdrv) {
@@ -222,12 +461,20 @@ DRESULT disk_ioctl (
                 if (drive_status[pdrv] & STA_PROTECT) {
                     res = RES_ERROR;
                 } else {
+#if QSPI_FLASH_FILESYSTEM_CACHE_SECTORS > 0
+                    res = sector_cache_sync();
+#else
                     res = RES_OK;
+#endif
                 }
                 break;
 
             case GET_SECTOR_COUNT:
+#if USE_FTL
+                *((LBA_t *) buff) = ftl_sector_count_get(ff_ftl_ctx);
+#else
                 *((LBA_t *) buff) = rtos_qspi_flash_size_get(ff_qspi_flash_ctx) / QSPI_FLASH_SECTOR_SIZE;
+#endif
                 res = RES_OK;
                 break;
 
@@ -242,6 +489,18 @@ DRESULT disk_ioctl (
                 break;
 
             case CTRL_TRIM:
+#if QSPI_FLASH_FILESYSTEM_CACHE_SECTORS > 0
+                /* Trimmed sectors no longer need to be written back */
+                for (int i = 0; i < QSPI_FLASH_FILESYSTEM_CACHE_SECTORS; i++) {
+                    if (sector_cache[i].sector >= ((LBA_t *) buff)[0] && sector_cache[i].sector <= ((LBA_t *) buff)[1]) {
+                        sector_cache[i].valid = 0;
+                    }
+                }
+#endif
+#if USE_FTL
+                /* Trimmed sectors are not copied by the FTL's garbage collection */
+                ftl_trim(ff_ftl_ctx, ((LBA_t *) buff)[0], ((LBA_t *) buff)[1] - ((LBA_t *) buff)[0] + 1);
+#endif
                 res = RES_OK;
                 break;
 
@@ -249,8 +508,6 @@ DRESULT disk_ioctl (
                 res = RES_PARERR;
                 break;
             }
-
-            res = RES_OK;
         } else if (drive_status[pdrv] & STA_NOINIT) {
             res = RES_NOTRDY;
         } else {
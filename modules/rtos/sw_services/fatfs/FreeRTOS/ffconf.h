@@ -268,8 +268,12 @@
 
 
 #ifndef FF_USE_TRIM
+#if USE_FTL
+#define FF_USE_TRIM		1
+#else
 #define FF_USE_TRIM		0
 #endif
+#endif
 /* This option switches support for ATA-TRIM. (0:Disable or 1:Enable)
 /  To enable Trim function, also CTRL_TRIM command should be implemented to the
 /  disk_ioctl() function. */
@@ -7,6 +7,11 @@
 
 rtos_qspi_flash_t *ff_qspi_flash_ctx;
 
+#if USE_FTL
+static ftl_t ff_ftl_ctx_s;
+ftl_t *ff_ftl_ctx;
+#endif
+
 #if RTOS_FREERTOS
 #include "FreeRTOS.h"
 
@@ -69,6 +74,14 @@ void rtos_fatfs_init( rtos_qspi_flash_t *qspi_flash_ctx )
 
     ff_qspi_flash_ctx = qspi_flash_ctx;
 
+#if USE_FTL
+    if( ftl_qspi_flash_init( &ff_ftl_ctx_s, qspi_flash_ctx, QSPI_FLASH_FILESYSTEM_START_ADDRESS,
+                             rtos_qspi_flash_size_get( qspi_flash_ctx ) - QSPI_FLASH_FILESYSTEM_START_ADDRESS ) == FTL_OK )
+    {
+        ff_ftl_ctx = &ff_ftl_ctx_s;
+    }
+#endif
+
 	if( f_mount( fs, "", 0 ) != FR_OK )
 	{
 		FS_SUP_FREE( fs );
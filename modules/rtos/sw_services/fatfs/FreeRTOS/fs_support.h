@@ -8,6 +8,28 @@
 
 #include "rtos/drivers/qspi_flash/api/rtos_qspi_flash.h"
 
+#if USE_FTL
+#include "ftl_qspi_flash.h"
+#endif
+
+#ifndef QSPI_FLASH_FILESYSTEM_START_ADDRESS
+#define QSPI_FLASH_FILESYSTEM_START_ADDRESS 0x100000
+#endif
+
+#ifndef QSPI_FLASH_SECTOR_SIZE
+#define QSPI_FLASH_SECTOR_SIZE 4096
+#endif
+
+#if USE_FTL
+/**
+ * The FTL that the filesystem sits on, from QSPI_FLASH_FILESYSTEM_START_ADDRESS
+ * to the end of the flash. It is mounted by rtos_fatfs_init() and is NULL
+ * until then, or if the mount failed. It may also be used by the USB mass
+ * storage flash disk to expose the same filesystem to a host.
+ */
+extern ftl_t *ff_ftl_ctx;
+#endif
+
 /**
  * Open a file
  *
@@ -21,7 +43,9 @@
 int rtos_ff_get_file(const char* filename, FIL* outfile, unsigned int* len );
 
 /**
- *  Initialize and mount file system
+ *  Initialize and mount file system. When USE_FTL is enabled the FTL
+ *  under the file system is mounted first, and formatted if the flash
+ *  is erased.
  *
  *  \param[in] qspi_flash_ctx The QSPI Flash driver context to be used
  *                            by the default implementations of the diskio
@@ -2,64 +2,244 @@
 // XMOS Public License: Version 1
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include "tinydir.h"
 #include "fatfs_ops.h"
+#include "file_reader.h"
+#include "directory_add.h"
 
-static int dir_recurse(tinydir_dir dir)
+#define DIR_ENTRY_SIZE 32
+
+/* Characters that are allowed in a short name, other than letters and digits */
+#define SFN_SPECIAL_CHARS "!#$%&'()-@^_`{}~"
+
+static tree_entry_t *tree_entry_add(tree_t *tree, tree_entry_type_t type, const char *path, const char *name)
+{
+    tree_entry_t *entry;
+
+    if (tree->count == tree->capacity) {
+        size_t capacity = tree->capacity > 0 ? tree->capacity * 2 : 256;
+        tree_entry_t *entries = realloc(tree->entries, capacity * sizeof(tree_entry_t));
+        if (entries == NULL) {
+            return NULL;
+        }
+        tree->entries = entries;
+        tree->capacity = capacity;
+    }
+
+    entry = &tree->entries[tree->count];
+    memset(entry, 0, sizeof(tree_entry_t));
+    entry->type = type;
+    if (path != NULL) {
+        entry->path = strdup(path);
+        entry->name = strdup(name);
+        if (entry->path == NULL || entry->name == NULL) {
+            free(entry->path);
+            free(entry->name);
+            return NULL;
+        }
+    }
+    tree->count++;
+
+    return entry;
+}
+
+static int sfn_part_valid(const char *s, size_t len, size_t max_len)
+{
+    int upper = 0;
+    int lower = 0;
+
+    if (len == 0 || len > max_len) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        char c = s[i];
+        if (c >= 'A' && c <= 'Z') {
+            upper = 1;
+        } else if (c >= 'a' && c <= 'z') {
+            lower = 1;
+        } else if (!(c >= '0' && c <= '9') && (c == '\0' || strchr(SFN_SPECIAL_CHARS, c) == NULL)) {
+            return 0;
+        }
+    }
+
+    /* FatFs can only record the case of a part when it is all one case */
+    return !(upper && lower);
+}
+
+/*
+ * Returns the number of directory entries a name takes up. A name that
+ * can be stored as a short name takes one entry. Any other name also
+ * takes a long name entry for each 13 UTF-16 characters.
+ */
+static size_t name_dir_slots(const char *name)
 {
+    const char *dot = strrchr(name, '.');
+    size_t units = 0;
+
+    if (dot == NULL) {
+        if (sfn_part_valid(name, strlen(name), 8)) {
+            return 1;
+        }
+    } else if (dot != name && strchr(name, '.') == dot) {
+        if (sfn_part_valid(name, dot - name, 8) && sfn_part_valid(dot + 1, strlen(dot + 1), 3)) {
+            return 1;
+        }
+    }
+
+    for (const unsigned char *p = (const unsigned char *) name; *p != '\0'; p++) {
+        if ((*p & 0xC0) != 0x80) {
+            /* Characters outside the BMP take a surrogate pair */
+            units += (*p >= 0xF0) ? 2 : 1;
+        }
+    }
+
+    return 1 + (units + 12) / 13;
+}
+
+static int file_size_get(const tinydir_file *file, uint64_t *size)
+{
+#if defined(_MSC_VER)
+    struct _stat64 s;
+    if (_stat64(file->path, &s) != 0) {
+        return -1;
+    }
+    *size = s.st_size;
+#else
+    *size = file->_s.st_size;
+#endif
+    return 0;
+}
+
+static int dir_scan(tree_t *tree, const char *dirname, size_t *dir_slots)
+{
+    tinydir_dir dir;
     int ret = 0;
 
-    while (dir.has_next) {
+    if (tinydir_open_sorted(&dir, dirname) != 0) {
+        fprintf(stderr, "Error opening directory %s\n", dirname);
+        return -1;
+    }
+
+    *dir_slots = 0;
+
+    for (size_t i = 0; i < dir.n_files && ret == 0; i++) {
         tinydir_file file;
-        if (tinydir_readfile(&dir, &file) != 0) {
-            return -1;
+        if (tinydir_readfile_n(&dir, &file, i) != 0) {
+            ret = -1;
+            break;
         }
 
         if (file.is_dir) {
             if (strcmp(file.name, ".") != 0 && strcmp(file.name, "..") != 0) {
-                tinydir_dir subdir;
-                if (tinydir_open(&subdir, file.path) != 0 ||
-                    fatfs_dir_enter(file.name) != 0       ||
-                    dir_recurse(subdir) != 0              ||
-                    fatfs_dir_up()) {
+                size_t enter = tree->count;
+                size_t slots;
+
+                if (tree_entry_add(tree, TREE_ENTRY_DIR_ENTER, file.path, file.name) == NULL ||
+                    dir_scan(tree, file.path, &slots) != 0                              ||
+                    tree_entry_add(tree, TREE_ENTRY_DIR_UP, NULL, NULL) == NULL) {
                     ret = -1;
                     break;
                 }
+                /* The entries may have moved while scanning the subdirectory */
+                tree->entries[enter].dir_slots = slots;
+                *dir_slots += name_dir_slots(file.name);
             }
 
         } else if (file.is_reg) {
-            FILE *fp = fopen(file.path, "rb");
-            if (fp == NULL) {
-                ret = -1;
-            }
+            tree_entry_t *entry = tree_entry_add(tree, TREE_ENTRY_FILE, file.path, file.name);
 
-            if (ret == 0) {
-                ret = fatfs_file_copy(file.name, fp);
-                fclose(fp);
-            }
-
-            if (ret != 0) {
+            if (entry == NULL || file_size_get(&file, &entry->size) != 0) {
+                fprintf(stderr, "Error reading file %s\n", file.path);
+                ret = -1;
                 break;
             }
+            *dir_slots += name_dir_slots(file.name);
+            tree->file_count++;
+            tree->file_bytes += entry->size;
         }
-
-        tinydir_next(&dir);
     }
 
+    tinydir_close(&dir);
+
     return ret;
 }
 
-int directory_add(const char *dirname)
+int directory_scan(const char *dirname, tree_t *tree)
 {
-    int ret;
-    tinydir_dir dir;
+    memset(tree, 0, sizeof(tree_t));
+    return dir_scan(tree, dirname, &tree->root_slots);
+}
+
+void directory_free(tree_t *tree)
+{
+    for (size_t i = 0; i < tree->count; i++) {
+        free(tree->entries[i].path);
+        free(tree->entries[i].name);
+    }
+    free(tree->entries);
+    memset(tree, 0, sizeof(tree_t));
+}
+
+uint64_t directory_clusters_needed(const tree_t *tree, size_t cluster_size)
+{
+    uint64_t clusters = 0;
+
+    for (size_t i = 0; i < tree->count; i++) {
+        const tree_entry_t *entry = &tree->entries[i];
 
-    if ((ret = tinydir_open(&dir, dirname)) == 0) {
-        ret = dir_recurse(dir);
-    } else {
-        fprintf(stderr, "Error opening specified directory %s\n", dirname);
+        if (entry->type == TREE_ENTRY_FILE) {
+            clusters += (entry->size + cluster_size - 1) / cluster_size;
+        } else if (entry->type == TREE_ENTRY_DIR_ENTER) {
+            /* Subdirectories also hold the dot and dot dot entries */
+            clusters += ((2 + entry->dir_slots) * DIR_ENTRY_SIZE + cluster_size - 1) / cluster_size;
+        }
+    }
+
+    return clusters;
+}
+
+int directory_add(const tree_t *tree, int jobs)
+{
+    int ret = 0;
+
+    if (file_reader_start(tree, jobs) != 0) {
+        fprintf(stderr, "Failed to start the file readers\n");
+        return -1;
     }
 
+    for (size_t i = 0; i < tree->count && ret == 0; i++) {
+        const tree_entry_t *entry = &tree->entries[i];
+
+        switch (entry->type) {
+        case TREE_ENTRY_DIR_ENTER:
+            ret = fatfs_dir_enter(entry->name);
+            break;
+
+        case TREE_ENTRY_DIR_UP:
+            ret = fatfs_dir_up();
+            break;
+
+        case TREE_ENTRY_FILE: {
+            void *data;
+            size_t size;
+
+            if (file_reader_get(i, &data, &size) != 0) {
+                fprintf(stderr, "Error reading file %s\n", entry->path);
+                ret = -1;
+            } else {
+                ret = fatfs_file_write(entry->name, data, size);
+            }
+            file_reader_release(i);
+            break;
+        }
+        }
+    }
+
+    file_reader_stop();
+
     return ret;
 }
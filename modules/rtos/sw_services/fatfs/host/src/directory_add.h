@@ -4,8 +4,46 @@
 #ifndef DIRECTORY_ADD_H_
 #define DIRECTORY_ADD_H_
 
+#include <stddef.h>
+#include <stdint.h>
 
-int directory_add(const char *dirname);
+typedef enum {
+    TREE_ENTRY_FILE,
+    TREE_ENTRY_DIR_ENTER,
+    TREE_ENTRY_DIR_UP,
+} tree_entry_type_t;
+
+/*
+ * One step of the walk through the input directory. Each directory appears
+ * as an enter entry followed by its contents and an up entry.
+ */
+typedef struct {
+    tree_entry_type_t type;
+    char *path;         /* Host path of the file or directory */
+    char *name;         /* Name in the image */
+    uint64_t size;      /* File size in bytes */
+    size_t dir_slots;   /* Directory entries used by the contents of a directory */
+} tree_entry_t;
+
+typedef struct {
+    tree_entry_t *entries;
+    size_t count;
+    size_t capacity;
+    size_t root_slots;  /* Directory entries used by the contents of the root */
+    size_t file_count;
+    uint64_t file_bytes;
+} tree_t;
+
+int directory_scan(const char *dirname, tree_t *tree);
+void directory_free(tree_t *tree);
+
+/*
+ * Returns the number of clusters needed to hold the files and the
+ * subdirectories, not counting the root directory.
+ */
+uint64_t directory_clusters_needed(const tree_t *tree, size_t cluster_size);
+
+int directory_add(const tree_t *tree, int jobs);
 
 
 #endif /* DIRECTORY_ADD_H_ */
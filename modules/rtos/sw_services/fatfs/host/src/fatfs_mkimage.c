@@ -2,28 +2,116 @@
 // XMOS Public License: Version 1
 
 #include <stdio.h>
+#include <stdint.h>
 #include <ff.h>
 #include "argtable/argtable3.h"
 #include "fatfs_ops.h"
+#include "ramdisk.h"
 #include "directory_add.h"
+#include "file_reader.h"
 
-#define VERSION "1.0-RC1"
+#define VERSION "1.1"
 
 #define IMAGE_SIZE_DEFAULT          1024*1024
 #define SECTOR_SIZE_DEFAULT         4096
 #define SECTORS_PER_CLUSTER_DEFAULT 1
 
+#define DIR_ENTRY_SIZE              32
+#define ROOT_ENTRIES_DEFAULT        512
+#define ROOT_ENTRIES_MAX            32768
+#define FAT12_CLUSTERS_MAX          0xFF5
+#define FAT16_CLUSTERS_MAX          0xFFF5
+
+/* The most volume sizes that are tried when finding the smallest that fits */
+#define AUTO_SIZE_ATTEMPTS_MAX      65536
+
 size_t image_size_g;
 size_t image_sector_size_g;
 
+/*
+ * Returns the number of root directory entries for a FAT12/16 volume,
+ * enough to hold the root of the tree. A FAT32 root directory is held in
+ * clusters instead, so it can grow past this.
+ */
+static unsigned root_entries_get(const tree_t *tree, size_t sector_size)
+{
+    size_t per_sector = sector_size / DIR_ENTRY_SIZE;
+    size_t entries = ((tree->root_slots + per_sector - 1) / per_sector) * per_sector;
+
+    if (entries < ROOT_ENTRIES_DEFAULT) {
+        entries = ROOT_ENTRIES_DEFAULT;
+    } else if (entries > ROOT_ENTRIES_MAX) {
+        entries = ROOT_ENTRIES_MAX;
+    }
+
+    return entries;
+}
+
+/*
+ * Finds the smallest image that the tree fits in. This starts from a lower
+ * bound on the size and creates a volume at each cluster size step above
+ * it until one has enough free clusters. The free cluster count does not
+ * always grow with the volume size, as f_mkfs() fails for some sizes near
+ * the FAT12/16 boundary, so each size is tried in turn.
+ */
+static int image_size_fit(const tree_t *tree, size_t cluster_size, unsigned root_entries)
+{
+    const size_t ss = image_sector_size_g;
+    const uint64_t needed = directory_clusters_needed(tree, cluster_size);
+    const uint64_t root_clusters = (tree->root_slots * DIR_ENTRY_SIZE + cluster_size - 1) / cluster_size;
+    uint64_t clusters = needed;
+    uint64_t sectors;
+
+    /* A FAT12/16 root directory cannot hold this many entries */
+    if (tree->root_slots > ROOT_ENTRIES_MAX && clusters <= FAT16_CLUSTERS_MAX) {
+        clusters = FAT16_CLUSTERS_MAX + 1;
+    }
+
+    if (clusters > FAT16_CLUSTERS_MAX) {
+        clusters += root_clusters > 0 ? root_clusters : 1;
+        sectors = 32 + (clusters * 4 + 8 + ss - 1) / ss;
+    } else if (clusters > FAT12_CLUSTERS_MAX) {
+        sectors = 1 + (clusters * 2 + 4 + ss - 1) / ss + (root_entries * DIR_ENTRY_SIZE) / ss;
+    } else {
+        sectors = 1 + ((clusters * 3 + 1) / 2 + 3 + ss - 1) / ss + (root_entries * DIR_ENTRY_SIZE) / ss;
+    }
+    sectors += clusters * (cluster_size / ss);
+
+    for (int i = 0; i < AUTO_SIZE_ATTEMPTS_MAX; i++) {
+        size_t free_clusters;
+        int fat32;
+
+        if (sectors * ss > SIZE_MAX || sectors > UINT32_MAX) {
+            break;
+        }
+        image_size_g = sectors * ss;
+
+        if (fatfs_probe(cluster_size, root_entries, &free_clusters, &fat32) == 0) {
+            /* The first cluster of a FAT32 root directory is already in use */
+            uint64_t fat32_root = (fat32 && root_clusters > 1) ? root_clusters - 1 : 0;
+
+            if (free_clusters >= needed + fat32_root && (fat32 || tree->root_slots <= root_entries)) {
+                return 0;
+            }
+        }
+
+        sectors += cluster_size / ss;
+    }
+
+    fprintf(stderr, "Failed to find an image size that fits the input directory\n");
+    return -1;
+}
+
 int main(int argc, char **argv)
 {
     int ret = 0;
-    void *image;
-    size_t image_size_actual;
+    tree_t tree;
+    size_t cluster_size;
+    unsigned root_entries;
+    int jobs;
 
-    struct arg_lit *help, *version;
-    struct arg_int *image_size, *sector_size, *sectors_per_cluster;
+    struct arg_lit *help, *version, *auto_size;
+    struct arg_int *image_size, *sector_size, *sectors_per_cluster, *jobs_arg;
     struct arg_file *output_file, *input_dir;
     struct arg_end *end;
 
@@ -35,8 +123,10 @@ int main(int argc, char **argv)
         input_dir   = arg_file1("i", "input", "<directory>", "The name of the input directory to create the file system from."),
 
         image_size = arg_int0("s", "image_size", "<n>", "The size in bytes of the file system image. Default is 1048576."),
+        auto_size = arg_lit0(NULL, "auto_size", "Make the file system image the smallest size that holds the input directory."),
         sector_size = arg_int0("S", "sector_size", "<n>", "The size in bytes of the file system's sectors. Default is 4096."),
         sectors_per_cluster = arg_int0("c", "sectors_per_cluster", "<n>", "The number of sectors per cluster. Must be a power of 2. Default is 1."),
+        jobs_arg = arg_int0("j", "jobs", "<n>", "The number of threads that read input files. Default is the number of CPUs."),
 
         end = arg_end(8),
     };
@@ -49,7 +139,7 @@ int main(int argc, char **argv)
         arg_print_syntax(stdout, argtable, "\n\n");
         printf("FAT file system image creation tool\n\n");
         printf("This tool creates a FAT filesystem image that is populated with the contents\n");
-        printf("of the specified directory. All filenames must be in 8.3 format.\n\n");
+        printf("of the specified directory. Long filenames are supported.\n\n");
         arg_print_glossary_gnu(stdout, argtable);
         return 0;
     }
@@ -65,6 +155,11 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    if (image_size->count > 0 && auto_size->count > 0) {
+        fprintf(stderr, "Only one of --image_size and --auto_size may be given\n");
+        return 1;
+    }
+
     if (image_size->count > 0) {
         if (image_size->ival[0] > 0) {
             image_size_g = image_size->ival[0];
@@ -92,30 +187,61 @@ int main(int argc, char **argv)
         sectors_per_cluster->ival[0] = SECTORS_PER_CLUSTER_DEFAULT;
     }
 
-    image = fatfs_init(&image_size_actual, sectors_per_cluster->ival[0] * image_sector_size_g);
+    if (jobs_arg->count > 0) {
+        if (jobs_arg->ival[0] > 0) {
+            jobs = jobs_arg->ival[0];
+        } else {
+            fprintf(stderr, "Number of jobs must be greater than zero\n");
+            return 1;
+        }
+    } else {
+        jobs = file_reader_default_jobs();
+    }
+
+    cluster_size = sectors_per_cluster->ival[0] * image_sector_size_g;
+
+    if (directory_scan(input_dir->filename[0], &tree) != 0) {
+        directory_free(&tree);
+        fprintf(stderr, "Failed to create filesystem image %s\n", output_file->filename[0]);
+        return 1;
+    }
+
+    root_entries = root_entries_get(&tree, image_sector_size_g);
+
+    if (auto_size->count > 0 && image_size_fit(&tree, cluster_size, root_entries) != 0) {
+        ret = 1;
+    }
 
-    if (image != NULL && directory_add(input_dir->filename[0]) == 0) {
-        FILE *outfile;
-        outfile = fopen(output_file->filename[0], "wb");
-        if (outfile != NULL) {
-            if (fwrite(image, sizeof(BYTE), image_size_actual, outfile) != image_size_actual) {
+    if (ret == 0) {
+        /*
+         * The image is built in place in a mapping of the output file, so it
+         * never has to be held in memory in full or copied out afterwards.
+         */
+        if (RAM_disk_file_initialize(output_file->filename[0], image_size_g, image_sector_size_g) != 0) {
+            fprintf(stderr, "Failed to open file %s for writing\n", output_file->filename[0]);
+            ret = 1;
+        } else {
+            if (fatfs_init(cluster_size, root_entries) != 0 || directory_add(&tree, jobs) != 0) {
+                ret = 1;
+            }
+            if (fatfs_deinit() != 0) {
                 fprintf(stderr, "Failed to write filesystem to file %s\n", output_file->filename[0]);
                 ret = 1;
             }
-            fclose(outfile);
-        } else {
-            fprintf(stderr, "Failed to open file %s for writing\n", output_file->filename[0]);
-            ret = 1;
+            if (ret != 0) {
+                remove(output_file->filename[0]);
+            }
         }
-    } else {
-        ret = 1;
     }
 
     if (ret == 0) {
-        printf("Filesystem image %s successfully populated with contents of directory %s\n", output_file->filename[0], input_dir->filename[0]);
+        printf("Filesystem image %s (%zu bytes) successfully populated with %zu files from directory %s\n",
+               output_file->filename[0], image_size_g, tree.file_count, input_dir->filename[0]);
     } else {
         fprintf(stderr, "Failed to create filesystem image %s\n", output_file->filename[0]);
     }
 
+    directory_free(&tree);
+
     return ret;
 }
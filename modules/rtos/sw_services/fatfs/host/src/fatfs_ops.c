@@ -30,7 +30,7 @@ static char *fatfs_error_str[] = {
         [FR_INVALID_PARAMETER] =   "Given parameter is invalid",
 };
 
-void *fatfs_init(size_t *image_size, size_t cluster_size)
+static FRESULT fatfs_format_mount(size_t cluster_size, unsigned root_entries)
 {
     BYTE mkfs_work[8*FF_MAX_SS];
 
@@ -38,27 +38,59 @@ void *fatfs_init(size_t *image_size, size_t cluster_size)
             .fmt = FM_FAT | FM_FAT32 | FM_SFD,
             .n_fat = 1,
             .align = 0, /* default */
-            .n_root = 0, /* default */
+            .n_root = root_entries, /* 0 for the default */
             .au_size = cluster_size
     };
 
     FRESULT res;
     res = f_mkfs("", &mkfs_params, mkfs_work, sizeof(mkfs_work));
-    if (res != FR_OK) {
+    if (res == FR_OK) {
+        res = f_mount(&fs, "", 1);
+    }
+
+    return res;
+}
+
+int fatfs_init(size_t cluster_size, unsigned root_entries)
+{
+    FRESULT res;
+
+    res = fatfs_format_mount(cluster_size, root_entries);
+    if (res == FR_MKFS_ABORTED) {
         fprintf(stderr, "Failed to create FAT volume: %s.\nAdjust volume size or cluster size.\n", fatfs_error_str[res]);
-        return NULL;
+        return -1;
+    } else if (res != FR_OK) {
+        fprintf(stderr, "Failed to create and mount FAT volume: %s.\n", fatfs_error_str[res]);
+        return -1;
     }
 
-    res = f_mount(&fs, "", 1);
-    if (res != FR_OK) {
-        fprintf(stderr, "Failed to mount FAT volume: %s.\n", fatfs_error_str[res]);
-        return NULL;
+    return 0;
+}
+
+int fatfs_deinit(void)
+{
+    f_unmount("");
+    return RAM_disk_deinitialize();
+}
+
+int fatfs_probe(size_t cluster_size, unsigned root_entries, size_t *free_clusters, int *fat32)
+{
+    FATFS *fs_ptr;
+    DWORD nclst = 0;
+    int ret = -1;
+
+    if (fatfs_format_mount(cluster_size, root_entries) == FR_OK &&
+        f_getfree("", &nclst, &fs_ptr) == FR_OK) {
+        *free_clusters = nclst;
+        *fat32 = fs_ptr->fs_type == FS_FAT32;
+        ret = 0;
     }
+    fatfs_deinit();
 
-    return RAM_disk_raw(image_size);
+    return ret;
 }
 
-int fatfs_dir_enter(char *name)
+int fatfs_dir_enter(const char *name)
 {
     FRESULT res;
 
@@ -83,27 +115,31 @@ int fatfs_dir_up(void)
     }
 }
 
-int fatfs_file_copy(char *name, FILE *fp)
+int fatfs_file_write(const char *name, const void *data, size_t size)
 {
-    BYTE data[1024];
-    size_t bytes_read;
+    /* f_write() takes a UINT count */
+    const size_t max_write = 0x40000000;
+    const BYTE *p = data;
     FIL fil;
     FRESULT res;
     int ret = 0;
 
     if ((res = f_open(&fil, name, FA_CREATE_ALWAYS | FA_WRITE)) == FR_OK) {
 
-        while ((bytes_read = fread(data, 1, sizeof(data), fp)) > 0) {
+        while (size > 0) {
+            UINT btw = size < max_write ? size : max_write;
             UINT bw;
-            if ((res = f_write(&fil, data, bytes_read, &bw)) != FR_OK) {
+            if ((res = f_write(&fil, p, btw, &bw)) != FR_OK) {
                 fprintf(stderr, "Failed to write data to file %s: %s.\n", name, fatfs_error_str[res]);
                 ret = -1;
                 break;
-            } else if (bytes_read != bw) {
+            } else if (btw != bw) {
                 fprintf(stderr, "Failed to write all data to file %s. Image size too small?\n", name);
                 ret = -1;
                 break;
             }
+            p += bw;
+            size -= bw;
         }
 
         if ((res = f_close(&fil)) != FR_OK) {
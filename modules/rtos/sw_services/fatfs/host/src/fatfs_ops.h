@@ -6,10 +6,19 @@
 
 #include <stdio.h>
 
-void *fatfs_init(size_t *image_size, size_t cluster_size);
-int fatfs_dir_enter(char *name);
+int fatfs_init(size_t cluster_size, unsigned root_entries);
+int fatfs_deinit(void);
+
+/*
+ * Creates a volume on the disk without reporting errors, gets the number
+ * of free clusters in it and whether it is FAT32, then frees the disk.
+ * Returns non-zero if a volume cannot be created with this disk size and
+ * cluster size.
+ */
+int fatfs_probe(size_t cluster_size, unsigned root_entries, size_t *free_clusters, int *fat32);
+int fatfs_dir_enter(const char *name);
 int fatfs_dir_up(void);
-int fatfs_file_copy(char *name, FILE *fp);
+int fatfs_file_write(const char *name, const void *data, size_t size);
 
 
 #endif /* FATFS_OPS_H_ */
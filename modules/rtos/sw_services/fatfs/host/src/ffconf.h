@@ -125,7 +125,7 @@
 
 
 #ifndef FF_USE_LFN
-#define FF_USE_LFN		0
+#define FF_USE_LFN		1
 #endif
 #ifndef FF_MAX_LFN
 #define FF_MAX_LFN		255
@@ -149,7 +149,7 @@
 
 
 #ifndef FF_LFN_UNICODE
-#define FF_LFN_UNICODE	0
+#define FF_LFN_UNICODE	2
 #endif
 /* This option switches the character encoding on the API when LFN is enabled.
 /
@@ -0,0 +1,266 @@
+// Copyright 2022 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#include "file_reader.h"
+
+#define MAX_JOBS 64
+
+typedef enum {
+    FILE_PENDING,
+    FILE_READY,
+    FILE_FAILED,
+} file_state_t;
+
+typedef struct {
+    void *data;
+    size_t size;
+    file_state_t state;
+} file_slot_t;
+
+static const tree_t *reader_tree;
+static file_slot_t *slots;
+
+/*
+ * Reads a whole file into a newly allocated buffer. The size from the
+ * scan is only used to size the buffer, so a file that has since shrunk
+ * is read as it is now.
+ */
+static int file_read(const tree_entry_t *entry, void **data, size_t *size)
+{
+    FILE *fp;
+    size_t bytes_read;
+
+    *data = NULL;
+    *size = 0;
+
+    if (entry->size > (uint64_t) (size_t) -1) {
+        return -1;
+    }
+    fp = fopen(entry->path, "rb");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    /* Allocate at least one byte so that empty files are not a failure */
+    *data = malloc(entry->size > 0 ? (size_t) entry->size : 1);
+    if (*data == NULL) {
+        fclose(fp);
+        return -1;
+    }
+
+    bytes_read = fread(*data, 1, (size_t) entry->size, fp);
+    if (ferror(fp)) {
+        free(*data);
+        *data = NULL;
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    *size = bytes_read;
+    return 0;
+}
+
+#if defined(_WIN32)
+
+int file_reader_default_jobs(void)
+{
+    return 1;
+}
+
+int file_reader_start(const tree_t *tree, int jobs)
+{
+    (void) jobs;
+
+    reader_tree = tree;
+    slots = calloc(tree->count > 0 ? tree->count : 1, sizeof(file_slot_t));
+
+    return slots != NULL ? 0 : -1;
+}
+
+int file_reader_get(size_t index, void **data, size_t *size)
+{
+    file_slot_t *slot = &slots[index];
+
+    slot->state = file_read(&reader_tree->entries[index], &slot->data, &slot->size) == 0 ? FILE_READY : FILE_FAILED;
+    *data = slot->data;
+    *size = slot->size;
+
+    return slot->state == FILE_READY ? 0 : -1;
+}
+
+void file_reader_release(size_t index)
+{
+    free(slots[index].data);
+    slots[index].data = NULL;
+}
+
+void file_reader_stop(void)
+{
+    free(slots);
+    slots = NULL;
+}
+
+#else /* _WIN32 */
+
+static pthread_t threads[MAX_JOBS];
+static int thread_count;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ready_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t space_cond = PTHREAD_COND_INITIALIZER;
+
+static size_t next_index;   /* The next entry for a reader to take */
+static uint64_t buffered;   /* Bytes taken by readers and not yet released */
+static int stopping;
+
+int file_reader_default_jobs(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (cpus < 1) {
+        return 1;
+    }
+    return cpus < MAX_JOBS ? (int) cpus : MAX_JOBS;
+}
+
+static void *reader_thread(void *arg)
+{
+    (void) arg;
+
+    pthread_mutex_lock(&lock);
+
+    for (;;) {
+        const tree_entry_t *entry;
+        size_t index;
+        void *data;
+        size_t size;
+        int ret;
+
+        while (next_index < reader_tree->count &&
+               reader_tree->entries[next_index].type != TREE_ENTRY_FILE) {
+            next_index++;
+        }
+        if (next_index == reader_tree->count || stopping) {
+            break;
+        }
+
+        /*
+         * Files are taken in tree order, and each waits until there is room
+         * for it. So every file before one that is being read has been taken
+         * already, and the writer is never left waiting on a file that
+         * cannot be read until a later one is released.
+         */
+        entry = &reader_tree->entries[next_index];
+        if (buffered > 0 && buffered + entry->size > FILE_READER_MAX_BUFFERED) {
+            pthread_cond_wait(&space_cond, &lock);
+            continue;
+        }
+        index = next_index++;
+        buffered += entry->size;
+
+        pthread_mutex_unlock(&lock);
+        ret = file_read(entry, &data, &size);
+        pthread_mutex_lock(&lock);
+
+        slots[index].data = data;
+        slots[index].size = size;
+        slots[index].state = ret == 0 ? FILE_READY : FILE_FAILED;
+        pthread_cond_broadcast(&ready_cond);
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    return NULL;
+}
+
+int file_reader_start(const tree_t *tree, int jobs)
+{
+    reader_tree = tree;
+    next_index = 0;
+    buffered = 0;
+    stopping = 0;
+    thread_count = 0;
+
+    slots = calloc(tree->count > 0 ? tree->count : 1, sizeof(file_slot_t));
+    if (slots == NULL) {
+        return -1;
+    }
+
+    if (jobs < 1) {
+        jobs = 1;
+    } else if (jobs > MAX_JOBS) {
+        jobs = MAX_JOBS;
+    }
+
+    for (int i = 0; i < jobs; i++) {
+        if (pthread_create(&threads[i], NULL, reader_thread, NULL) != 0) {
+            break;
+        }
+        thread_count++;
+    }
+
+    if (thread_count == 0) {
+        free(slots);
+        slots = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+int file_reader_get(size_t index, void **data, size_t *size)
+{
+    file_slot_t *slot = &slots[index];
+
+    pthread_mutex_lock(&lock);
+    while (slot->state == FILE_PENDING) {
+        pthread_cond_wait(&ready_cond, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+
+    *data = slot->data;
+    *size = slot->size;
+
+    return slot->state == FILE_READY ? 0 : -1;
+}
+
+void file_reader_release(size_t index)
+{
+    file_slot_t *slot = &slots[index];
+
+    pthread_mutex_lock(&lock);
+    free(slot->data);
+    slot->data = NULL;
+    buffered -= reader_tree->entries[index].size;
+    pthread_cond_broadcast(&space_cond);
+    pthread_mutex_unlock(&lock);
+}
+
+void file_reader_stop(void)
+{
+    pthread_mutex_lock(&lock);
+    stopping = 1;
+    pthread_cond_broadcast(&space_cond);
+    pthread_mutex_unlock(&lock);
+
+    for (int i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    thread_count = 0;
+
+    /* Free anything read ahead of a failure */
+    for (size_t i = 0; i < reader_tree->count; i++) {
+        free(slots[i].data);
+    }
+    free(slots);
+    slots = NULL;
+}
+
+#endif /* _WIN32 */
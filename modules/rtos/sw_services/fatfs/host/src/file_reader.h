@@ -0,0 +1,40 @@
+// Copyright 2022 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+
+#ifndef FILE_READER_H_
+#define FILE_READER_H_
+
+#include <stddef.h>
+#include "directory_add.h"
+
+/*
+ * The most file data held in memory at once by the readers. A file larger
+ * than this is only read once every file before it has been released.
+ */
+#define FILE_READER_MAX_BUFFERED (256 * 1024 * 1024)
+
+/*
+ * Starts reading the files in a tree ahead of them being written to the
+ * image, with jobs threads, in tree order. On Windows the files are read
+ * on demand by file_reader_get() instead.
+ */
+int file_reader_start(const tree_t *tree, int jobs);
+
+/*
+ * Waits for the file at an index in the tree to be read, and gets its
+ * contents. Returns non-zero if the file could not be read.
+ * file_reader_release() must be called for every index that is got, in
+ * tree order, whether or not this succeeds.
+ */
+int file_reader_get(size_t index, void **data, size_t *size);
+void file_reader_release(size_t index);
+
+void file_reader_stop(void);
+
+/*
+ * Gets the default number of reader threads, from the number of CPUs.
+ */
+int file_reader_default_jobs(void);
+
+
+#endif /* FILE_READER_H_ */
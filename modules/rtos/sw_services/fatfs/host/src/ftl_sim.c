@@ -0,0 +1,663 @@
+// Copyright 2022 XMOS LIMITED. This Software is subject to the terms of the
+// XMOS Public License: Version 1
+
+/*
+ * Host simulator for the flash translation layer. The FTL runs unmodified
+ * on a RAM disk that behaves like NOR flash: erases set bytes to 0xFF and
+ * programs may only clear bits. Random or FatFS-like sector writes are made
+ * through the FTL, every sector is checked against what was last written to
+ * it, and the write amplification and per-block erase counts are reported.
+ *
+ * Power failures may be injected. The flash operation that the power fails
+ * in is left half done, the FTL is remounted, and every sector must then
+ * hold either its old or its new contents.
+ *
+ * The simulator can also convert a raw FAT image, such as one made by
+ * fatfs_mkimage, into an FTL image to be written to the flash.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <math.h>
+#include "argtable/argtable3.h"
+#include "ramdisk.h"
+#include "ftl.h"
+
+#define VERSION "1.0"
+
+#define FLASH_SIZE_DEFAULT      (4 * 1024 * 1024)
+#define PAGE_SIZE_DEFAULT       4096
+#define BLOCK_SIZE_DEFAULT      65536
+#define SPARE_BLOCKS_DEFAULT    6
+#define WRITES_DEFAULT          1000000
+#define FILL_DEFAULT            75
+#define HISTOGRAM_BUCKETS       10
+
+/* The FAT-like workload keeps this share of the sectors for the FAT and directories */
+#define FAT_HOT_PERCENT         2
+#define FAT_MAX_FILE_SECTORS    64
+#define FAT_MAX_FILES           4096
+
+typedef enum {
+    WORKLOAD_RANDOM,
+    WORKLOAD_FAT,
+} workload_t;
+
+typedef struct {
+    uint32_t start;
+    uint32_t count;
+} sim_file_t;
+
+static uint8_t *flash;
+static size_t flash_size;
+static unsigned block_size;
+static uint32_t *block_erases;
+
+static long ops_until_power_fail = -1;
+static jmp_buf power_fail_jmp;
+static unsigned long bad_program_count;
+
+static ftl_t ftl_ctx;
+static uint32_t *sector_version;
+static uint32_t *sector_writes;
+static uint32_t next_version = 1;
+static uint8_t *write_buf;
+static uint8_t *read_buf;
+
+/* The sector being written or trimmed when the power failed */
+static int64_t inflight_sector = -1;
+static uint32_t inflight_version;
+
+/*-----------------------------------------------------------------------*/
+/* Simulated NOR flash                                                   */
+/*-----------------------------------------------------------------------*/
+
+static int power_fail_now(void)
+{
+    return ops_until_power_fail > 0 && --ops_until_power_fail == 0;
+}
+
+static void sim_read(void *flash_ctx, uint8_t *data, unsigned address, size_t len)
+{
+    (void)flash_ctx;
+
+    memcpy(data, flash + address, len);
+}
+
+static void sim_program(void *flash_ctx, const uint8_t *data, unsigned address, size_t len)
+{
+    int fail = power_fail_now();
+
+    (void)flash_ctx;
+
+    if (fail) {
+        len /= 2;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] & ~flash[address + i]) {
+            bad_program_count++;
+        }
+        flash[address + i] &= data[i];
+    }
+    if (fail) {
+        longjmp(power_fail_jmp, 1);
+    }
+}
+
+static void sim_erase(void *flash_ctx, unsigned address, size_t len)
+{
+    int fail = power_fail_now();
+
+    (void)flash_ctx;
+
+    for (size_t i = address / block_size; i < (address + len) / block_size; i++) {
+        block_erases[i]++;
+    }
+    memset(flash + address, 0xFF, fail ? len / 2 : len);
+    if (fail) {
+        longjmp(power_fail_jmp, 1);
+    }
+}
+
+static const ftl_flash_ops_t sim_ops = {
+    .read = sim_read,
+    .program = sim_program,
+    .erase = sim_erase,
+};
+
+/*-----------------------------------------------------------------------*/
+/* Sector contents                                                       */
+/*-----------------------------------------------------------------------*/
+
+static void sector_fill(uint8_t *buf, uint32_t sector, uint32_t version)
+{
+    unsigned sector_size = ftl_sector_size_get(&ftl_ctx);
+
+    if (version == 0) {
+        memset(buf, 0xFF, sector_size);
+        return;
+    }
+    memset(buf, (uint8_t) (sector * 31 + version), sector_size);
+    memcpy(buf, &sector, sizeof(sector));
+    memcpy(buf + sizeof(sector), &version, sizeof(version));
+    memcpy(buf + sector_size - sizeof(version), &version, sizeof(version));
+}
+
+static int sector_check(uint32_t sector)
+{
+    unsigned sector_size = ftl_sector_size_get(&ftl_ctx);
+
+    ftl_read(&ftl_ctx, read_buf, sector, 1);
+    sector_fill(write_buf, sector, sector_version[sector]);
+
+    if (memcmp(read_buf, write_buf, sector_size) == 0) {
+        return 0;
+    }
+
+    /* The sector in flight when the power failed may hold either version */
+    if (sector == inflight_sector) {
+        sector_fill(write_buf, sector, inflight_version);
+        if (memcmp(read_buf, write_buf, sector_size) == 0) {
+            sector_version[sector] = inflight_version;
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "Sector %u does not hold version %u\n", sector, sector_version[sector]);
+    return -1;
+}
+
+static int sector_check_all(void)
+{
+    int errors = 0;
+
+    for (uint32_t i = 0; i < ftl_sector_count_get(&ftl_ctx); i++) {
+        errors += sector_check(i) != 0;
+    }
+    inflight_sector = -1;
+
+    return errors;
+}
+
+static void sector_write(uint32_t sector)
+{
+    int ret;
+
+    inflight_sector = sector;
+    inflight_version = next_version++;
+    sector_fill(write_buf, sector, inflight_version);
+
+    ret = ftl_write(&ftl_ctx, write_buf, sector, 1);
+    if (ret != FTL_OK) {
+        fprintf(stderr, "Write to sector %u failed with %d\n", sector, ret);
+        exit(1);
+    }
+
+    sector_version[sector] = inflight_version;
+    sector_writes[sector]++;
+    inflight_sector = -1;
+}
+
+static void sector_trim(uint32_t sector, uint32_t count)
+{
+    for (uint32_t i = sector; i < sector + count; i++) {
+        inflight_sector = i;
+        inflight_version = 0;
+        ftl_trim(&ftl_ctx, i, 1);
+        sector_version[i] = 0;
+    }
+    inflight_sector = -1;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Workloads                                                             */
+/*-----------------------------------------------------------------------*/
+
+typedef struct {
+    uint32_t hot_count;
+    uint32_t data_count;
+    uint32_t used_count;
+    uint32_t used_limit;
+    uint32_t cursor;
+    uint8_t *used;
+    sim_file_t files[FAT_MAX_FILES];
+    unsigned file_count;
+} fat_state_t;
+
+static fat_state_t fat;
+
+/* The FAT sector holding the entry for a data sector, with 32 bit entries */
+static void fat_update(uint32_t data_sector)
+{
+    uint32_t entries_per_sector = ftl_sector_size_get(&ftl_ctx) / sizeof(uint32_t);
+
+    sector_write(1 + (data_sector / entries_per_sector) % (fat.hot_count - 1));
+}
+
+static void fat_dir_update(void)
+{
+    sector_write(0);
+}
+
+/*
+ * Writes a new file. Clusters are allocated first fit from where the last
+ * allocation ended, as FatFS does, and the FAT is written every 8 sectors
+ * and when the file is closed.
+ */
+static void fat_file_create(void)
+{
+    sim_file_t *file = &fat.files[fat.file_count];
+    uint32_t count = 1 + rand() % FAT_MAX_FILE_SECTORS;
+    uint32_t written = 0;
+
+    if (count > fat.data_count - fat.used_count) {
+        count = fat.data_count - fat.used_count;
+    }
+
+    file->start = fat.cursor;
+    while (written < count) {
+        if (!fat.used[fat.cursor]) {
+            fat.used[fat.cursor] = 1;
+            fat.used_count++;
+            sector_write(fat.hot_count + fat.cursor);
+            if (++written % 8 == 0) {
+                fat_update(fat.cursor);
+            }
+        }
+        fat.cursor = (fat.cursor + 1) % fat.data_count;
+    }
+    file->count = count;
+    fat.file_count++;
+
+    fat_update(file->start);
+    fat_dir_update();
+}
+
+/* Deletes a file, trimming its clusters as FatFS does with FF_USE_TRIM */
+static void fat_file_delete(void)
+{
+    unsigned index = rand() % fat.file_count;
+    sim_file_t *file = &fat.files[index];
+    uint32_t remaining = file->count;
+    uint32_t i = file->start;
+
+    /* A delete cut short by a power failure may have freed some clusters already */
+    for (uint32_t n = 0; remaining > 0 && n < fat.data_count; n++) {
+        if (fat.used[i]) {
+            fat.used[i] = 0;
+            fat.used_count--;
+            remaining--;
+            sector_trim(fat.hot_count + i, 1);
+            if (remaining % 8 == 0) {
+                fat_update(i);
+            }
+        }
+        i = (i + 1) % fat.data_count;
+    }
+    fat_dir_update();
+
+    fat.files[index] = fat.files[--fat.file_count];
+}
+
+/*
+ * Files are tracked by their first cluster and length only, so a file that
+ * was allocated around other files frees the first clusters it finds. The
+ * set of used clusters stays correct, which is all that matters here.
+ */
+static void fat_init(unsigned fill_percent)
+{
+    uint32_t sector_count = ftl_sector_count_get(&ftl_ctx);
+
+    fat.hot_count = sector_count * FAT_HOT_PERCENT / 100;
+    if (fat.hot_count < 2) {
+        fat.hot_count = 2;
+    }
+    fat.data_count = sector_count - fat.hot_count;
+    fat.used_limit = fat.data_count * fill_percent / 100;
+    fat.used = calloc(fat.data_count, 1);
+    fat.used_count = 0;
+    fat.cursor = 0;
+    fat.file_count = 0;
+}
+
+static void workload_step(workload_t workload, unsigned fill_percent)
+{
+    if (workload == WORKLOAD_RANDOM) {
+        uint32_t span = ftl_sector_count_get(&ftl_ctx) * fill_percent / 100;
+
+        sector_write(((uint32_t) rand() << 16 ^ rand()) % span);
+    } else if (fat.file_count > 0 &&
+               (fat.file_count == FAT_MAX_FILES || fat.used_count > fat.used_limit)) {
+        fat_file_delete();
+    } else {
+        fat_file_create();
+    }
+}
+
+static uint32_t host_writes_get(void)
+{
+    ftl_stats_t stats;
+
+    ftl_stats_get(&ftl_ctx, &stats);
+    return stats.host_writes;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Reports                                                               */
+/*-----------------------------------------------------------------------*/
+
+static void report(unsigned block_count, const char *erase_counts_file)
+{
+    ftl_stats_t stats;
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+    double mean = 0;
+    double variance = 0;
+    uint32_t max_sector_writes = 0;
+    unsigned histogram[HISTOGRAM_BUCKETS] = {0};
+
+    ftl_stats_get(&ftl_ctx, &stats);
+
+    for (unsigned i = 0; i < block_count; i++) {
+        min = block_erases[i] < min ? block_erases[i] : min;
+        max = block_erases[i] > max ? block_erases[i] : max;
+        mean += block_erases[i];
+    }
+    mean /= block_count;
+    for (unsigned i = 0; i < block_count; i++) {
+        variance += (block_erases[i] - mean) * (block_erases[i] - mean);
+        histogram[(uint64_t) (block_erases[i] - min) * HISTOGRAM_BUCKETS / (max - min + 1)]++;
+    }
+    variance /= block_count;
+    for (uint32_t i = 0; i < ftl_sector_count_get(&ftl_ctx); i++) {
+        max_sector_writes = sector_writes[i] > max_sector_writes ? sector_writes[i] : max_sector_writes;
+    }
+
+    printf("Host sector writes:         %u\n", stats.host_writes);
+    printf("Flash page writes:          %u\n", stats.page_writes);
+    printf("Garbage collections:        %u (%u for wear levelling)\n", stats.gc_count, stats.wear_level_count);
+    printf("Pages moved by collection:  %u\n", stats.gc_page_moves);
+    printf("Write amplification:        %.3f\n",
+           stats.host_writes > 0 ? (double) stats.page_writes / stats.host_writes : 0.0);
+    printf("Block erases:               min %u, mean %.1f, max %u, std dev %.1f\n", min, mean, max, sqrt(variance));
+    printf("Most writes to one sector:  %u (the erase count without the FTL)\n", max_sector_writes);
+    printf("Erase count histogram:\n");
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        uint32_t low = min + (uint64_t) i * (max - min + 1) / HISTOGRAM_BUCKETS;
+        uint32_t high = min + (uint64_t) (i + 1) * (max - min + 1) / HISTOGRAM_BUCKETS;
+
+        if (high > low) {
+            printf("  %8u - %-8u %u\n", low, high - 1, histogram[i]);
+        }
+    }
+
+    if (erase_counts_file != NULL) {
+        FILE *f = fopen(erase_counts_file, "w");
+
+        if (f == NULL) {
+            fprintf(stderr, "Could not open %s\n", erase_counts_file);
+            return;
+        }
+        fprintf(f, "block,erase_count\n");
+        for (unsigned i = 0; i < block_count; i++) {
+            fprintf(f, "%u,%u\n", i, block_erases[i]);
+        }
+        fclose(f);
+    }
+}
+
+/*-----------------------------------------------------------------------*/
+/* Image conversion                                                      */
+/*-----------------------------------------------------------------------*/
+
+static int image_convert(const char *input, const char *output)
+{
+    unsigned sector_size = ftl_sector_size_get(&ftl_ctx);
+    FILE *in;
+    FILE *out;
+    uint32_t sector = 0;
+    size_t len;
+    int ret = 0;
+
+    in = fopen(input, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "Could not open %s\n", input);
+        return 1;
+    }
+
+    while ((len = fread(write_buf, 1, sector_size, in)) > 0) {
+        int erased = 1;
+
+        if (sector >= ftl_sector_count_get(&ftl_ctx)) {
+            fprintf(stderr, "%s is larger than the %u sectors in the FTL\n", input, ftl_sector_count_get(&ftl_ctx));
+            ret = 1;
+            break;
+        }
+        memset(write_buf + len, 0xFF, sector_size - len);
+        for (unsigned i = 0; i < sector_size; i++) {
+            if (write_buf[i] != 0xFF) {
+                erased = 0;
+                break;
+            }
+        }
+        /* Erased sectors read back the same without taking a page */
+        if (!erased) {
+            ftl_write(&ftl_ctx, write_buf, sector, 1);
+        }
+        sector++;
+    }
+    fclose(in);
+
+    if (ret == 0) {
+        out = fopen(output, "wb");
+        if (out == NULL || fwrite(flash, 1, flash_size, out) != flash_size) {
+            fprintf(stderr, "Could not write %s\n", output);
+            ret = 1;
+        }
+        if (out != NULL) {
+            fclose(out);
+        }
+    }
+
+    if (ret == 0) {
+        printf("Wrote %u of %u sectors to %s\n", sector, ftl_sector_count_get(&ftl_ctx), output);
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Main                                                                  */
+/*-----------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    struct arg_lit *help, *version;
+    struct arg_int *size_arg, *page_size_arg, *block_size_arg, *spare_arg;
+    struct arg_int *writes_arg, *fill_arg, *power_fail_arg, *seed_arg;
+    struct arg_str *workload_arg;
+    struct arg_file *input_file, *output_file, *erase_counts_file;
+    struct arg_end *end;
+
+    void *argtable[] = {
+        help    = arg_lit0("h", "help", "Display this help and exit."),
+        version = arg_lit0(NULL, "version", "Display version info and exit."),
+
+        size_arg = arg_int0("s", "size", "<n>", "The size in bytes of the flash region. Default is 4194304."),
+        page_size_arg = arg_int0("S", "sector_size", "<n>", "The size in bytes of the logical sectors. Default is 4096."),
+        block_size_arg = arg_int0("b", "block_size", "<n>", "The size in bytes of the erase blocks. Default is 65536."),
+        spare_arg = arg_int0(NULL, "spare_blocks", "<n>", "The number of blocks held back from the logical sectors. Default is 6."),
+
+        workload_arg = arg_str0("w", "workload", "<random|fat>", "Uniformly random sector writes, or files written and deleted through a FAT. Default is fat."),
+        writes_arg = arg_int0("n", "writes", "<n>", "The number of sector writes to simulate. Default is 1000000."),
+        fill_arg = arg_int0(NULL, "fill", "<percent>", "The share of the logical sectors in use. Default is 75."),
+        power_fail_arg = arg_int0(NULL, "power_fail", "<n>", "Fail the power at random, on average every n flash operations."),
+        seed_arg = arg_int0(NULL, "seed", "<n>", "The random number seed. Default is 1."),
+        erase_counts_file = arg_file0(NULL, "erase_counts", "<file>", "Write the erase count of every block to a CSV file."),
+
+        input_file = arg_file0("i", "input", "<file>", "Convert this raw FAT image into an FTL image instead of simulating."),
+        output_file = arg_file0("o", "output", "<file>", "The name of the FTL image file to write with --input."),
+
+        end = arg_end(8),
+    };
+
+    int nerrors;
+    workload_t workload = WORKLOAD_FAT;
+    unsigned page_size = PAGE_SIZE_DEFAULT;
+    unsigned spare_blocks = SPARE_BLOCKS_DEFAULT;
+    unsigned long writes = WRITES_DEFAULT;
+    unsigned fill_percent = FILL_DEFAULT;
+    long power_fail_interval = 0;
+    volatile unsigned long power_fail_count = 0;
+    volatile int errors = 0;
+    unsigned block_count;
+    int ret;
+
+    flash_size = FLASH_SIZE_DEFAULT;
+    block_size = BLOCK_SIZE_DEFAULT;
+
+    nerrors = arg_parse(argc, argv, argtable);
+
+    if (help->count > 0) {
+        printf("Usage: %s", argv[0]);
+        arg_print_syntax(stdout, argtable, "\n\n");
+        printf("Flash translation layer simulator\n\n");
+        printf("This tool runs the FTL on a simulated NOR flash and reports its write\n");
+        printf("amplification and the erase count of each block. It can also convert a raw\n");
+        printf("FAT image into an FTL image.\n\n");
+        arg_print_glossary_gnu(stdout, argtable);
+        return 0;
+    }
+
+    if (version->count > 0) {
+        printf("ftl_sim version %s\n", VERSION);
+        return 0;
+    }
+
+    if (nerrors > 0) {
+        arg_print_errors(stdout, end, argv[0]);
+        fprintf(stderr, "Try '%s --help' for more information.\n", argv[0]);
+        return 1;
+    }
+
+    if (size_arg->count > 0) {
+        flash_size = size_arg->ival[0];
+    }
+    if (page_size_arg->count > 0) {
+        page_size = page_size_arg->ival[0];
+    }
+    if (block_size_arg->count > 0) {
+        block_size = block_size_arg->ival[0];
+    }
+    if (spare_arg->count > 0) {
+        spare_blocks = spare_arg->ival[0];
+    }
+    if (writes_arg->count > 0) {
+        writes = writes_arg->ival[0];
+    }
+    if (fill_arg->count > 0) {
+        fill_percent = fill_arg->ival[0];
+        if (fill_percent < 1 || fill_percent > 100) {
+            fprintf(stderr, "Fill must be between 1 and 100 percent\n");
+            return 1;
+        }
+    }
+    if (power_fail_arg->count > 0) {
+        power_fail_interval = power_fail_arg->ival[0];
+    }
+    srand(seed_arg->count > 0 ? seed_arg->ival[0] : 1);
+    if (workload_arg->count > 0) {
+        if (strcmp(workload_arg->sval[0], "random") == 0) {
+            workload = WORKLOAD_RANDOM;
+        } else if (strcmp(workload_arg->sval[0], "fat") != 0) {
+            fprintf(stderr, "Unknown workload %s\n", workload_arg->sval[0]);
+            return 1;
+        }
+    }
+    if (input_file->count != output_file->count) {
+        fprintf(stderr, "--input and --output must be given together\n");
+        return 1;
+    }
+
+    if (block_size == 0 || RAM_disk_initialize(flash_size, block_size) != 0) {
+        fprintf(stderr, "Could not allocate the flash\n");
+        return 1;
+    }
+    flash = RAM_disk_raw(&flash_size);
+    memset(flash, 0xFF, flash_size);
+    block_count = flash_size / block_size;
+    block_erases = calloc(block_count, sizeof(uint32_t));
+
+    ret = ftl_init(&ftl_ctx, &sim_ops, NULL, 0, flash_size, page_size, block_size, spare_blocks);
+    if (ret != FTL_OK) {
+        fprintf(stderr, "FTL init failed with %d\n", ret);
+        return 1;
+    }
+    ret = ftl_mount(&ftl_ctx);
+    if (ret == FTL_ERR_BLANK) {
+        ret = ftl_format(&ftl_ctx);
+    }
+    if (ret != FTL_OK) {
+        fprintf(stderr, "FTL mount failed with %d\n", ret);
+        return 1;
+    }
+
+    write_buf = malloc(page_size);
+    read_buf = malloc(page_size);
+    sector_version = calloc(ftl_sector_count_get(&ftl_ctx), sizeof(uint32_t));
+    sector_writes = calloc(ftl_sector_count_get(&ftl_ctx), sizeof(uint32_t));
+
+    if (input_file->count > 0) {
+        return image_convert(input_file->filename[0], output_file->filename[0]);
+    }
+
+    printf("%u blocks of %u bytes, %u logical sectors of %u bytes, %u%% in use\n",
+           block_count, block_size, ftl_sector_count_get(&ftl_ctx), page_size, fill_percent);
+
+    if (workload == WORKLOAD_FAT) {
+        fat_init(fill_percent);
+    }
+
+    if (setjmp(power_fail_jmp) != 0) {
+        /* Power came back. The FTL state in RAM is lost, so start again from the flash */
+        power_fail_count++;
+        ops_until_power_fail = -1;
+        ret = ftl_mount(&ftl_ctx);
+        if (ret != FTL_OK) {
+            fprintf(stderr, "FTL mount after power failure %lu failed with %d\n", power_fail_count, ret);
+            return 1;
+        }
+        errors += sector_check_all();
+    }
+
+    while (host_writes_get() < writes && errors == 0) {
+        if (power_fail_interval > 0 && ops_until_power_fail < 0) {
+            ops_until_power_fail = 1 + rand() % (2 * power_fail_interval);
+        }
+        workload_step(workload, fill_percent);
+        if (rand() % 16 == 0) {
+            errors += sector_check(rand() % ftl_sector_count_get(&ftl_ctx));
+        }
+    }
+    ops_until_power_fail = -1;
+
+    errors += sector_check_all();
+
+    report(block_count, erase_counts_file->count > 0 ? erase_counts_file->filename[0] : NULL);
+    if (power_fail_interval > 0) {
+        printf("Power failures:             %lu\n", power_fail_count);
+    }
+
+    if (bad_program_count > 0) {
+        fprintf(stderr, "%lu bytes were programmed without being erased\n", bad_program_count);
+        errors++;
+    }
+    if (errors > 0) {
+        fprintf(stderr, "%d sectors did not read back correctly\n", errors);
+        return 1;
+    }
+
+    return 0;
+}
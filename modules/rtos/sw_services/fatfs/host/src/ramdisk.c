@@ -1,14 +1,31 @@
 // Copyright 2021 XMOS LIMITED. This Software is subject to the terms of the
 // XMOS Public License: Version 1
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 #include "ramdisk.h"
 
 static BYTE *ramdisk;
 static size_t ramdisk_size;
 static size_t ramdisk_sector_size;
 
+/* Set when the disk is a mapping of a file rather than allocated memory */
+static int ramdisk_mapped;
+#if defined(_WIN32)
+static HANDLE ramdisk_file = INVALID_HANDLE_VALUE;
+static HANDLE ramdisk_mapping;
+#else
+static int ramdisk_fd = -1;
+#endif
+
 BYTE *RAM_disk_raw(size_t *size)
 {
     *size = ramdisk_size;
@@ -45,6 +62,103 @@ DSTATUS RAM_disk_initialize(size_t size,
     }
 }
 
+DSTATUS RAM_disk_file_initialize(const char *path,
+                                 size_t size,
+                                 size_t sector_size)
+{
+    if (ramdisk != NULL) {
+        return STA_NOINIT;
+    }
+
+    ramdisk_size = ((size + (sector_size - 1)) / sector_size) * sector_size;
+
+    /*
+     * The file is created at its full size before it is mapped. Sectors
+     * that are never written are not allocated on file systems that
+     * support sparse files, and read back as zeros either way.
+     */
+#if defined(_WIN32)
+    ramdisk_file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (ramdisk_file != INVALID_HANDLE_VALUE) {
+        ramdisk_mapping = CreateFileMappingA(ramdisk_file, NULL, PAGE_READWRITE,
+                                             (DWORD) ((uint64_t) ramdisk_size >> 32), (DWORD) ramdisk_size, NULL);
+        if (ramdisk_mapping != NULL) {
+            ramdisk = MapViewOfFile(ramdisk_mapping, FILE_MAP_WRITE, 0, 0, ramdisk_size);
+            if (ramdisk == NULL) {
+                CloseHandle(ramdisk_mapping);
+            }
+        }
+        if (ramdisk == NULL) {
+            CloseHandle(ramdisk_file);
+            ramdisk_file = INVALID_HANDLE_VALUE;
+        }
+    }
+#else
+    ramdisk_fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (ramdisk_fd >= 0) {
+        if (ftruncate(ramdisk_fd, ramdisk_size) == 0) {
+            void *p = mmap(NULL, ramdisk_size, PROT_READ | PROT_WRITE, MAP_SHARED, ramdisk_fd, 0);
+            if (p != MAP_FAILED) {
+                ramdisk = p;
+            }
+        }
+        if (ramdisk == NULL) {
+            close(ramdisk_fd);
+            ramdisk_fd = -1;
+        }
+    }
+#endif
+
+    if (ramdisk != NULL) {
+        ramdisk_sector_size = sector_size;
+        ramdisk_mapped = 1;
+        return 0;
+    } else {
+        ramdisk_size = 0;
+        return STA_NOINIT;
+    }
+}
+
+int RAM_disk_deinitialize(void)
+{
+    int ret = 0;
+
+    if (ramdisk == NULL) {
+        return 0;
+    }
+
+    if (ramdisk_mapped) {
+#if defined(_WIN32)
+        if (!FlushViewOfFile(ramdisk, 0) || !UnmapViewOfFile(ramdisk)) {
+            ret = -1;
+        }
+        CloseHandle(ramdisk_mapping);
+        if (!FlushFileBuffers(ramdisk_file)) {
+            ret = -1;
+        }
+        CloseHandle(ramdisk_file);
+        ramdisk_file = INVALID_HANDLE_VALUE;
+#else
+        if (msync(ramdisk, ramdisk_size, MS_SYNC) != 0 || munmap(ramdisk, ramdisk_size) != 0) {
+            ret = -1;
+        }
+        if (close(ramdisk_fd) != 0) {
+            ret = -1;
+        }
+        ramdisk_fd = -1;
+#endif
+        ramdisk_mapped = 0;
+    } else {
+        free(ramdisk);
+    }
+
+    ramdisk = NULL;
+    ramdisk_size = 0;
+    ramdisk_sector_size = 0;
+
+    return ret;
+}
+
 DRESULT RAM_disk_read(BYTE *buff,     /* Data buffer to store read data */
                       LBA_t sector,   /* Start sector in LBA */
                       UINT count)     /* Number of sectors to read */
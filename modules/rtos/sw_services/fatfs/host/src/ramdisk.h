@@ -15,6 +15,21 @@ DSTATUS RAM_disk_status(void);
 DSTATUS RAM_disk_initialize(size_t size,
                             size_t sector_size);
 
+/*
+ * Initializes the disk as a memory mapping of a file, which is created or
+ * truncated to the disk size. The file holds the disk image once
+ * RAM_disk_deinitialize() has returned.
+ */
+DSTATUS RAM_disk_file_initialize(const char *path,
+                                 size_t size,
+                                 size_t sector_size);
+
+/*
+ * Frees the disk, or writes back and unmaps it if it is mapped to a file.
+ * Returns non-zero if the file could not be written.
+ */
+int RAM_disk_deinitialize(void);
+
 DRESULT RAM_disk_read(BYTE *buff,
                       LBA_t sector,
                       UINT count);
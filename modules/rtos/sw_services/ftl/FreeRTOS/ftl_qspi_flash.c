@@ -0,0 +1,72 @@
+// Copyright 2022 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#define DEBUG_UNIT FTL
+
+#include "rtos_osal.h"
+#include "ftl_qspi_flash.h"
+
+__attribute__((fptrgroup("ftl_flash_read_fptr_grp")))
+static void ftl_qspi_flash_read(void *flash_ctx, uint8_t *data, unsigned address, size_t len)
+{
+    rtos_qspi_flash_read(flash_ctx, data, address, len);
+}
+
+__attribute__((fptrgroup("ftl_flash_program_fptr_grp")))
+static void ftl_qspi_flash_program(void *flash_ctx, const uint8_t *data, unsigned address, size_t len)
+{
+    rtos_qspi_flash_write(flash_ctx, data, address, len);
+}
+
+__attribute__((fptrgroup("ftl_flash_erase_fptr_grp")))
+static void ftl_qspi_flash_erase(void *flash_ctx, unsigned address, size_t len)
+{
+    rtos_qspi_flash_erase(flash_ctx, address, len);
+}
+
+__attribute__((fptrgroup("ftl_flash_lock_fptr_grp")))
+static void ftl_qspi_flash_lock(void *flash_ctx)
+{
+    rtos_qspi_flash_lock(flash_ctx);
+}
+
+__attribute__((fptrgroup("ftl_flash_unlock_fptr_grp")))
+static void ftl_qspi_flash_unlock(void *flash_ctx)
+{
+    rtos_qspi_flash_unlock(flash_ctx);
+}
+
+static const ftl_flash_ops_t ftl_qspi_flash_ops = {
+    .read = ftl_qspi_flash_read,
+    .program = ftl_qspi_flash_program,
+    .erase = ftl_qspi_flash_erase,
+    .lock = ftl_qspi_flash_lock,
+    .unlock = ftl_qspi_flash_unlock,
+};
+
+int ftl_qspi_flash_init(ftl_t *ctx,
+                        rtos_qspi_flash_t *qspi_flash_ctx,
+                        unsigned base_address,
+                        size_t size)
+{
+    int ret;
+
+    ret = ftl_init(ctx, &ftl_qspi_flash_ops, qspi_flash_ctx, base_address, size,
+                   FTL_QSPI_FLASH_PAGE_SIZE, FTL_QSPI_FLASH_BLOCK_SIZE, FTL_QSPI_FLASH_SPARE_BLOCKS);
+    if (ret != FTL_OK) {
+        rtos_printf("FTL init failed with %d\n", ret);
+        return ret;
+    }
+
+    ret = ftl_mount(ctx);
+    if (ret == FTL_ERR_BLANK) {
+        rtos_printf("Formatting FTL at 0x%x\n", base_address);
+        ret = ftl_format(ctx);
+    }
+    if (ret != FTL_OK) {
+        rtos_printf("FTL mount failed with %d\n", ret);
+        ftl_deinit(ctx);
+    }
+
+    return ret;
+}
@@ -0,0 +1,295 @@
+// Copyright 2022 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef FTL_H_
+#define FTL_H_
+
+/**
+ * \addtogroup ftl ftl
+ *
+ * The public API for the wear-levelling flash translation layer.
+ *
+ * The FTL presents a flash region as an array of logical sectors. Every
+ * sector write goes to a previously erased page, so rewriting the same
+ * logical sector, as FatFS does with the FAT and directory sectors, spreads
+ * the erases across the whole region instead of wearing out one flash sector.
+ *
+ * The region is divided into erase blocks. The first page of each block holds
+ * a header with the block's erase count, followed by one entry per data page
+ * recording the logical sector stored in it. Entries are only ever programmed
+ * in place, clearing bits, so no metadata is rewritten. A sector write first
+ * programs the entry with the logical sector and a sequence number, then the
+ * data, then a commit marker in the entry, and finally marks the entry of the
+ * page it replaces as obsolete. The map from logical sectors to pages is
+ * rebuilt from these entries by ftl_mount(). A page that lost power before its
+ * commit marker was written is ignored, and if two committed copies of a
+ * sector are found the one with the higher sequence number wins, so a sector
+ * always reads back as either its old or its new contents after a power
+ * failure.
+ *
+ * When the free blocks run out, the garbage collector copies the live pages
+ * out of the block with the fewest of them and erases it. Free blocks are
+ * handed out least worn first, and when the erase counts drift more than
+ * FTL_WEAR_LEVEL_THRESHOLD apart the least worn block is collected instead,
+ * moving the static data held in it onto a more worn block.
+ *
+ * The FTL is plain C with no RTOS dependencies, so that the same code can be
+ * run on the host. The flash is accessed through an ftl_flash_ops_t.
+ * @{
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __xcore__
+#define FTL_FPTRGROUP(name) __attribute__((fptrgroup(name)))
+#else
+#define FTL_FPTRGROUP(name)
+#endif
+
+/**
+ * The erase count difference between the most and least worn blocks
+ * above which garbage collection moves static data off the least worn block.
+ */
+#ifndef FTL_WEAR_LEVEL_THRESHOLD
+#define FTL_WEAR_LEVEL_THRESHOLD 16
+#endif
+
+#define FTL_OK              0  /**< The operation succeeded */
+#define FTL_ERR_PARAM      -1  /**< An argument is out of range */
+#define FTL_ERR_NO_MEMORY  -2  /**< The FTL state could not be allocated */
+#define FTL_ERR_BLANK      -3  /**< The region is erased and must be formatted */
+#define FTL_ERR_NO_FORMAT  -4  /**< The region does not hold an FTL */
+#define FTL_ERR_GEOMETRY   -5  /**< The region holds an FTL with a different geometry */
+#define FTL_ERR_FULL       -6  /**< Garbage collection could not free a block */
+
+/**
+ * The flash operations used by the FTL. Addresses are absolute flash
+ * addresses. program() must only clear bits, as NOR flash does, and
+ * erase() must set every byte in the range to 0xFF. lock() and unlock()
+ * may be NULL if the FTL is only used by one thread.
+ */
+typedef struct {
+    FTL_FPTRGROUP("ftl_flash_read_fptr_grp")
+    void (*read)(void *flash_ctx, uint8_t *data, unsigned address, size_t len);
+
+    FTL_FPTRGROUP("ftl_flash_program_fptr_grp")
+    void (*program)(void *flash_ctx, const uint8_t *data, unsigned address, size_t len);
+
+    FTL_FPTRGROUP("ftl_flash_erase_fptr_grp")
+    void (*erase)(void *flash_ctx, unsigned address, size_t len);
+
+    FTL_FPTRGROUP("ftl_flash_lock_fptr_grp")
+    void (*lock)(void *flash_ctx);
+
+    FTL_FPTRGROUP("ftl_flash_unlock_fptr_grp")
+    void (*unlock)(void *flash_ctx);
+} ftl_flash_ops_t;
+
+/**
+ * Wear statistics, as returned by ftl_stats_get().
+ */
+typedef struct {
+    uint32_t host_writes;      /**< Logical sectors written by the user */
+    uint32_t page_writes;      /**< Data pages programmed, including garbage collection */
+    uint32_t gc_count;         /**< Blocks reclaimed by garbage collection */
+    uint32_t gc_page_moves;    /**< Live pages copied by garbage collection */
+    uint32_t wear_level_count; /**< Collections made to move static data */
+    uint32_t erase_count_min;  /**< Erase count of the least worn block */
+    uint32_t erase_count_max;  /**< Erase count of the most worn block */
+    uint64_t erase_count_total;/**< Erase counts of all blocks added together */
+} ftl_stats_t;
+
+typedef struct {
+    uint32_t erase_count;
+    uint16_t valid_count;
+    uint8_t state;
+    uint8_t next_page;
+} ftl_block_t;
+
+/**
+ * Struct representing an FTL instance.
+ *
+ * The members in this struct should not be accessed directly.
+ */
+typedef struct {
+    const ftl_flash_ops_t *ops;
+    void *flash_ctx;
+    unsigned base_address;
+    unsigned page_size;
+    unsigned block_size;
+    unsigned pages_per_block;
+    unsigned block_count;
+    unsigned spare_blocks;
+    uint32_t sector_count;
+    uint32_t sequence;
+    int mounted;
+
+    uint16_t *map;
+    ftl_block_t *blocks;
+    uint8_t *meta_buf;
+    uint8_t *page_buf;
+    unsigned free_count;
+    unsigned host_block;
+    unsigned gc_block;
+
+    ftl_stats_t stats;
+} ftl_t;
+
+/**
+ * Initializes an FTL instance over a flash region. This allocates the
+ * sector map and buffers but does not access the flash. ftl_mount()
+ * must be called before the FTL may be used.
+ *
+ * \param ctx          A pointer to the FTL context to initialize.
+ * \param ops          The flash operations. Must remain valid while the FTL is in use.
+ * \param flash_ctx    Passed to each of the flash operations.
+ * \param base_address The flash address of the region. Must be block aligned.
+ * \param size         The size in bytes of the region.
+ * \param page_size    The size of a logical sector. Must be at least 512 bytes and
+ *                     a multiple of the flash's smallest erasable unit.
+ * \param block_size   The size of an erase block. Must be a multiple of page_size
+ *                     of at least 4 pages. There may be no more than page_size / 16
+ *                     pages per block, and no more than 255.
+ * \param spare_blocks The number of blocks not exposed as logical sectors. Must be
+ *                     at least 4. More spare blocks lower the write amplification.
+ *
+ * \retval FTL_OK            on success.
+ * \retval FTL_ERR_PARAM     if the geometry is not supported.
+ * \retval FTL_ERR_NO_MEMORY if the sector map could not be allocated.
+ */
+int ftl_init(ftl_t *ctx,
+             const ftl_flash_ops_t *ops,
+             void *flash_ctx,
+             unsigned base_address,
+             size_t size,
+             unsigned page_size,
+             unsigned block_size,
+             unsigned spare_blocks);
+
+/**
+ * Frees the memory allocated by ftl_init().
+ *
+ * \param ctx A pointer to the FTL context.
+ */
+void ftl_deinit(ftl_t *ctx);
+
+/**
+ * Erases every block in the region and writes a fresh header to each.
+ * All logical sectors read back as 0xFF afterwards. The erase counts are
+ * carried over from the previous mount if there was one.
+ *
+ * \param ctx A pointer to the FTL context.
+ *
+ * \retval FTL_OK on success.
+ */
+int ftl_format(ftl_t *ctx);
+
+/**
+ * Rebuilds the sector map from the metadata held in the flash. Blocks
+ * whose header was interrupted by a power failure are erased.
+ *
+ * \param ctx A pointer to the FTL context.
+ *
+ * \retval FTL_OK            on success.
+ * \retval FTL_ERR_BLANK     if the region is erased. ftl_format() may be called.
+ * \retval FTL_ERR_NO_FORMAT if the region holds something other than an FTL.
+ * \retval FTL_ERR_GEOMETRY  if the region holds an FTL with a different geometry.
+ */
+int ftl_mount(ftl_t *ctx);
+
+/**
+ * Reads logical sectors. Sectors that have never been written, or have
+ * been trimmed, read back as 0xFF.
+ *
+ * \param ctx    A pointer to the FTL context.
+ * \param data   The buffer to read the sectors into.
+ * \param sector The first logical sector to read.
+ * \param count  The number of sectors to read.
+ *
+ * \retval FTL_OK        on success.
+ * \retval FTL_ERR_PARAM if the sectors are out of range.
+ */
+int ftl_read(ftl_t *ctx, uint8_t *data, uint32_t sector, uint32_t count);
+
+/**
+ * Reads part of one logical sector.
+ *
+ * \param ctx    A pointer to the FTL context.
+ * \param data   The buffer to read into.
+ * \param sector The logical sector to read.
+ * \param offset The offset in bytes into the sector to start reading from.
+ * \param len    The number of bytes to read. offset + len must not be more
+ *               than the sector size.
+ *
+ * \retval FTL_OK        on success.
+ * \retval FTL_ERR_PARAM if the sector or byte range is out of range.
+ */
+int ftl_read_partial(ftl_t *ctx, uint8_t *data, uint32_t sector, unsigned offset, size_t len);
+
+/**
+ * Writes logical sectors.
+ *
+ * \param ctx    A pointer to the FTL context.
+ * \param data   The data to write.
+ * \param sector The first logical sector to write.
+ * \param count  The number of sectors to write.
+ *
+ * \retval FTL_OK        on success.
+ * \retval FTL_ERR_PARAM if the sectors are out of range.
+ * \retval FTL_ERR_FULL  if garbage collection could not make space.
+ */
+int ftl_write(ftl_t *ctx, const uint8_t *data, uint32_t sector, uint32_t count);
+
+/**
+ * Discards logical sectors that no longer hold useful data, so that
+ * garbage collection does not need to copy them.
+ *
+ * \param ctx    A pointer to the FTL context.
+ * \param sector The first logical sector to discard.
+ * \param count  The number of sectors to discard.
+ *
+ * \retval FTL_OK        on success.
+ * \retval FTL_ERR_PARAM if the sectors are out of range.
+ */
+int ftl_trim(ftl_t *ctx, uint32_t sector, uint32_t count);
+
+/**
+ * Gets the number of logical sectors.
+ *
+ * \param ctx A pointer to the FTL context.
+ *
+ * \returns the number of logical sectors.
+ */
+uint32_t ftl_sector_count_get(ftl_t *ctx);
+
+/**
+ * Gets the size of a logical sector.
+ *
+ * \param ctx A pointer to the FTL context.
+ *
+ * \returns the size in bytes of a logical sector.
+ */
+unsigned ftl_sector_size_get(ftl_t *ctx);
+
+/**
+ * Gets the wear statistics.
+ *
+ * \param ctx   A pointer to the FTL context.
+ * \param stats Populated with the statistics.
+ */
+void ftl_stats_get(ftl_t *ctx, ftl_stats_t *stats);
+
+/**
+ * Gets the number of times a block has been erased.
+ *
+ * \param ctx   A pointer to the FTL context.
+ * \param block The block number, less than the region size divided by the block size.
+ *
+ * \returns the erase count of the block.
+ */
+uint32_t ftl_block_erase_count_get(ftl_t *ctx, unsigned block);
+
+/**@}*/
+
+#endif /* FTL_H_ */
@@ -0,0 +1,51 @@
+// Copyright 2022 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#ifndef FTL_QSPI_FLASH_H_
+#define FTL_QSPI_FLASH_H_
+
+#include "ftl.h"
+#include "rtos/drivers/qspi_flash/api/rtos_qspi_flash.h"
+
+/**
+ * \addtogroup ftl ftl
+ * @{
+ */
+
+/** The logical sector size used with the QSPI flash */
+#ifndef FTL_QSPI_FLASH_PAGE_SIZE
+#define FTL_QSPI_FLASH_PAGE_SIZE 4096
+#endif
+
+/** The erase block size used with the QSPI flash */
+#ifndef FTL_QSPI_FLASH_BLOCK_SIZE
+#define FTL_QSPI_FLASH_BLOCK_SIZE 65536
+#endif
+
+/** The number of blocks held back from the logical sectors */
+#ifndef FTL_QSPI_FLASH_SPARE_BLOCKS
+#define FTL_QSPI_FLASH_SPARE_BLOCKS 6
+#endif
+
+/**
+ * Initializes and mounts an FTL over a region of the QSPI flash. An
+ * erased region is formatted. Each FTL operation holds the QSPI flash lock,
+ * so the same FTL may be shared by several threads, such as FatFS and the
+ * USB mass storage class.
+ *
+ * \param ctx            A pointer to the FTL context to initialize.
+ * \param qspi_flash_ctx A pointer to the QSPI flash driver instance.
+ * \param base_address   The flash address of the region. Must be aligned to
+ *                       FTL_QSPI_FLASH_BLOCK_SIZE.
+ * \param size           The size in bytes of the region.
+ *
+ * \returns FTL_OK on success, or the error returned by ftl_init() or ftl_mount().
+ */
+int ftl_qspi_flash_init(ftl_t *ctx,
+                        rtos_qspi_flash_t *qspi_flash_ctx,
+                        unsigned base_address,
+                        size_t size);
+
+/**@}*/
+
+#endif /* FTL_QSPI_FLASH_H_ */
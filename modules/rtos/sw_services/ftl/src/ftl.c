@@ -0,0 +1,703 @@
+// Copyright 2022 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ftl.h"
+
+#if RTOS_FREERTOS
+#include "FreeRTOS.h"
+
+#define FTL_MALLOC          pvPortMalloc
+#define FTL_FREE            vPortFree
+#endif
+
+#ifndef FTL_MALLOC
+#define FTL_MALLOC          malloc
+#endif
+
+#ifndef FTL_FREE
+#define FTL_FREE            free
+#endif
+
+#define FTL_MAGIC           0x4C544658 /* "XFTL" */
+#define FTL_ERASED          0xFFFFFFFF
+#define FTL_UNMAPPED        0xFFFF
+#define FTL_NO_BLOCK        0xFFFFFFFF
+
+/*
+ * The metadata page of each block is an array of 16 byte slots. Slot 0
+ * holds the block header and slot i holds the entry for data page i.
+ */
+#define FTL_SLOT_SIZE       16
+
+#define HEADER_MAGIC        0
+#define HEADER_ERASE_COUNT  1
+#define HEADER_PAGE_SIZE    2
+#define HEADER_PAGES        3
+
+#define ENTRY_SECTOR        0
+#define ENTRY_SEQUENCE      1
+#define ENTRY_COMMITTED     2
+#define ENTRY_OBSOLETE      3
+
+enum {
+    BLOCK_FREE,     /* Erased with a header and no pages used */
+    BLOCK_ACTIVE,   /* Taking new pages */
+    BLOCK_CLOSED,   /* Holding data, no longer taking new pages */
+    BLOCK_INVALID,  /* Header missing or damaged, must be erased */
+};
+
+static const uint8_t zero_word[4] = {0};
+
+static void flash_lock(ftl_t *ctx)
+{
+    if (ctx->ops->lock != NULL) {
+        ctx->ops->lock(ctx->flash_ctx);
+    }
+}
+
+static void flash_unlock(ftl_t *ctx)
+{
+    if (ctx->ops->unlock != NULL) {
+        ctx->ops->unlock(ctx->flash_ctx);
+    }
+}
+
+static unsigned block_address(ftl_t *ctx, unsigned block)
+{
+    return ctx->base_address + block * ctx->block_size;
+}
+
+static unsigned page_address(ftl_t *ctx, unsigned page)
+{
+    return block_address(ctx, page / ctx->pages_per_block) + (page % ctx->pages_per_block) * ctx->page_size;
+}
+
+static unsigned slot_address(ftl_t *ctx, unsigned page)
+{
+    return block_address(ctx, page / ctx->pages_per_block) + (page % ctx->pages_per_block) * FTL_SLOT_SIZE;
+}
+
+static uint32_t slot_word(const uint8_t *slot, int word)
+{
+    uint32_t value;
+
+    memcpy(&value, slot + word * sizeof(uint32_t), sizeof(uint32_t));
+    return value;
+}
+
+static void entry_mark(ftl_t *ctx, unsigned page, int word)
+{
+    ctx->ops->program(ctx->flash_ctx, zero_word, slot_address(ctx, page) + word * sizeof(uint32_t), sizeof(zero_word));
+}
+
+/*
+ * Erases a block and writes its header. The magic number is programmed
+ * last so that a header interrupted by a power failure is not trusted.
+ */
+static void block_erase(ftl_t *ctx, unsigned block)
+{
+    ftl_block_t *b = &ctx->blocks[block];
+    uint32_t header[4];
+    unsigned address = block_address(ctx, block);
+
+    ctx->ops->erase(ctx->flash_ctx, address, ctx->block_size);
+    b->erase_count++;
+
+    header[HEADER_MAGIC] = FTL_MAGIC;
+    header[HEADER_ERASE_COUNT] = b->erase_count;
+    header[HEADER_PAGE_SIZE] = ctx->page_size;
+    header[HEADER_PAGES] = ctx->pages_per_block;
+    ctx->ops->program(ctx->flash_ctx, (const uint8_t *) &header[1], address + sizeof(uint32_t), 3 * sizeof(uint32_t));
+    ctx->ops->program(ctx->flash_ctx, (const uint8_t *) &header[0], address, sizeof(uint32_t));
+
+    b->state = BLOCK_FREE;
+    b->valid_count = 0;
+    b->next_page = 1;
+}
+
+/*
+ * Takes the least worn free block.
+ */
+static unsigned block_take_free(ftl_t *ctx)
+{
+    unsigned block = FTL_NO_BLOCK;
+
+    for (unsigned i = 0; i < ctx->block_count; i++) {
+        if (ctx->blocks[i].state == BLOCK_FREE &&
+            (block == FTL_NO_BLOCK || ctx->blocks[i].erase_count < ctx->blocks[block].erase_count)) {
+            block = i;
+        }
+    }
+
+    if (block != FTL_NO_BLOCK) {
+        ctx->blocks[block].state = BLOCK_ACTIVE;
+        ctx->free_count--;
+    }
+
+    return block;
+}
+
+static int gc_collect(ftl_t *ctx, int allow_wear_level);
+
+/*
+ * Returns the next page of the host or garbage collection active block,
+ * opening a new block when it is full. Host data and data moved by the
+ * garbage collector are kept in separate blocks, as moved data has already
+ * outlived the data around it and is likely to keep doing so.
+ */
+static unsigned page_allocate(ftl_t *ctx, int gc)
+{
+    unsigned *active = gc ? &ctx->gc_block : &ctx->host_block;
+
+    if (*active != FTL_NO_BLOCK && ctx->blocks[*active].next_page == ctx->pages_per_block) {
+        ctx->blocks[*active].state = BLOCK_CLOSED;
+        *active = FTL_NO_BLOCK;
+    }
+
+    if (*active == FTL_NO_BLOCK) {
+        if (!gc) {
+            /*
+             * Two free blocks are always kept for the garbage collector. The
+             * number of collections is bounded in case there is nothing left
+             * to reclaim.
+             */
+            for (unsigned i = 0; ctx->free_count < 3; i++) {
+                if (i == 2 * ctx->block_count || gc_collect(ctx, i == 0) != FTL_OK) {
+                    return FTL_NO_BLOCK;
+                }
+            }
+        }
+        *active = block_take_free(ctx);
+        if (*active == FTL_NO_BLOCK) {
+            return FTL_NO_BLOCK;
+        }
+    }
+
+    return *active * ctx->pages_per_block + ctx->blocks[*active].next_page++;
+}
+
+/*
+ * Writes one logical sector to a new page and maps it. The page it replaces
+ * is marked obsolete, except when the garbage collector is moving it out of
+ * a block that is about to be erased.
+ */
+static int page_write(ftl_t *ctx, uint32_t sector, const uint8_t *data, int gc)
+{
+    uint32_t entry[2];
+    unsigned page = page_allocate(ctx, gc);
+    unsigned old_page;
+
+    if (page == FTL_NO_BLOCK) {
+        return FTL_ERR_FULL;
+    }
+
+    /* Garbage collection may have just moved the sector */
+    old_page = ctx->map[sector];
+
+    entry[ENTRY_SECTOR] = sector;
+    entry[ENTRY_SEQUENCE] = ctx->sequence++;
+    ctx->ops->program(ctx->flash_ctx, (const uint8_t *) entry, slot_address(ctx, page), sizeof(entry));
+    ctx->ops->program(ctx->flash_ctx, data, page_address(ctx, page), ctx->page_size);
+    entry_mark(ctx, page, ENTRY_COMMITTED);
+
+    if (old_page != FTL_UNMAPPED) {
+        if (!gc) {
+            entry_mark(ctx, old_page, ENTRY_OBSOLETE);
+        }
+        ctx->blocks[old_page / ctx->pages_per_block].valid_count--;
+    }
+    ctx->map[sector] = page;
+    ctx->blocks[page / ctx->pages_per_block].valid_count++;
+    ctx->stats.page_writes++;
+
+    return FTL_OK;
+}
+
+/*
+ * Picks the closed block with the fewest live pages, preferring the less
+ * worn of equals. If the erase counts have drifted too far apart the least
+ * worn closed block is picked instead, as it is holding static data.
+ */
+static unsigned gc_victim_select(ftl_t *ctx, int allow_wear_level, int *wear_level)
+{
+    unsigned victim = FTL_NO_BLOCK;
+    unsigned coldest = FTL_NO_BLOCK;
+    uint32_t max_erase_count = 0;
+
+    for (unsigned i = 0; i < ctx->block_count; i++) {
+        ftl_block_t *b = &ctx->blocks[i];
+
+        if (b->erase_count > max_erase_count) {
+            max_erase_count = b->erase_count;
+        }
+        if (b->state != BLOCK_CLOSED) {
+            continue;
+        }
+        if (victim == FTL_NO_BLOCK || b->valid_count < ctx->blocks[victim].valid_count ||
+            (b->valid_count == ctx->blocks[victim].valid_count && b->erase_count < ctx->blocks[victim].erase_count)) {
+            victim = i;
+        }
+        if (coldest == FTL_NO_BLOCK || b->erase_count < ctx->blocks[coldest].erase_count) {
+            coldest = i;
+        }
+    }
+
+    *wear_level = 0;
+    if (allow_wear_level && coldest != FTL_NO_BLOCK && coldest != victim &&
+        max_erase_count - ctx->blocks[coldest].erase_count > FTL_WEAR_LEVEL_THRESHOLD) {
+        *wear_level = 1;
+        return coldest;
+    }
+
+    return victim;
+}
+
+/*
+ * Moves the live pages out of one closed block and erases it.
+ */
+static int gc_collect(ftl_t *ctx, int allow_wear_level)
+{
+    int wear_level;
+    unsigned victim;
+    unsigned space;
+    ftl_block_t *b;
+
+    /*
+     * Collections start with two free blocks, and a collection never needs
+     * more than one, so a power failure during one leaves a free block for
+     * the collection after the next mount. Static data is only moved when
+     * that margin is there.
+     */
+    victim = gc_victim_select(ctx, allow_wear_level && ctx->free_count >= 2, &wear_level);
+
+    if (victim == FTL_NO_BLOCK) {
+        return FTL_ERR_FULL;
+    }
+    b = &ctx->blocks[victim];
+    if (!wear_level && b->valid_count == ctx->pages_per_block - 1) {
+        /* Every block is full of live data, so nothing can be reclaimed */
+        return FTL_ERR_FULL;
+    }
+
+    space = ctx->free_count * (ctx->pages_per_block - 1);
+    if (ctx->gc_block != FTL_NO_BLOCK) {
+        space += ctx->pages_per_block - ctx->blocks[ctx->gc_block].next_page;
+    }
+    if (b->valid_count > space) {
+        return FTL_ERR_FULL;
+    }
+
+    if (b->valid_count > 0) {
+        ctx->ops->read(ctx->flash_ctx, ctx->meta_buf, block_address(ctx, victim), ctx->pages_per_block * FTL_SLOT_SIZE);
+
+        for (unsigned i = 1; i < b->next_page && b->valid_count > 0; i++) {
+            unsigned page = victim * ctx->pages_per_block + i;
+            uint32_t sector = slot_word(&ctx->meta_buf[i * FTL_SLOT_SIZE], ENTRY_SECTOR);
+            int ret;
+
+            if (sector >= ctx->sector_count || ctx->map[sector] != page) {
+                continue;
+            }
+            ctx->ops->read(ctx->flash_ctx, ctx->page_buf, page_address(ctx, page), ctx->page_size);
+            ret = page_write(ctx, sector, ctx->page_buf, 1);
+            if (ret != FTL_OK) {
+                return ret;
+            }
+            ctx->stats.gc_page_moves++;
+        }
+    }
+
+    block_erase(ctx, victim);
+    ctx->free_count++;
+    ctx->stats.gc_count++;
+    if (wear_level) {
+        ctx->stats.wear_level_count++;
+    }
+
+    return FTL_OK;
+}
+
+int ftl_init(ftl_t *ctx,
+             const ftl_flash_ops_t *ops,
+             void *flash_ctx,
+             unsigned base_address,
+             size_t size,
+             unsigned page_size,
+             unsigned block_size,
+             unsigned spare_blocks)
+{
+    memset(ctx, 0, sizeof(ftl_t));
+
+    if (page_size < 512 || block_size % page_size != 0 || spare_blocks < 4) {
+        return FTL_ERR_PARAM;
+    }
+
+    ctx->ops = ops;
+    ctx->flash_ctx = flash_ctx;
+    ctx->base_address = base_address;
+    ctx->page_size = page_size;
+    ctx->block_size = block_size;
+    ctx->pages_per_block = block_size / page_size;
+    ctx->block_count = size / block_size;
+    ctx->spare_blocks = spare_blocks;
+
+    if (ctx->pages_per_block < 4 || ctx->pages_per_block > 255 ||
+        ctx->pages_per_block * FTL_SLOT_SIZE > page_size ||
+        ctx->block_count <= spare_blocks ||
+        ctx->block_count * ctx->pages_per_block >= FTL_UNMAPPED) {
+        return FTL_ERR_PARAM;
+    }
+
+    ctx->sector_count = (ctx->block_count - spare_blocks) * (ctx->pages_per_block - 1);
+
+    ctx->map = FTL_MALLOC(ctx->sector_count * sizeof(uint16_t));
+    ctx->blocks = FTL_MALLOC(ctx->block_count * sizeof(ftl_block_t));
+    ctx->meta_buf = FTL_MALLOC(ctx->pages_per_block * FTL_SLOT_SIZE);
+    ctx->page_buf = FTL_MALLOC(page_size);
+
+    if (ctx->map == NULL || ctx->blocks == NULL || ctx->meta_buf == NULL || ctx->page_buf == NULL) {
+        ftl_deinit(ctx);
+        return FTL_ERR_NO_MEMORY;
+    }
+
+    memset(ctx->blocks, 0, ctx->block_count * sizeof(ftl_block_t));
+    ctx->host_block = FTL_NO_BLOCK;
+    ctx->gc_block = FTL_NO_BLOCK;
+
+    return FTL_OK;
+}
+
+void ftl_deinit(ftl_t *ctx)
+{
+    FTL_FREE(ctx->map);
+    FTL_FREE(ctx->blocks);
+    FTL_FREE(ctx->meta_buf);
+    FTL_FREE(ctx->page_buf);
+    ctx->map = NULL;
+    ctx->blocks = NULL;
+    ctx->meta_buf = NULL;
+    ctx->page_buf = NULL;
+    ctx->mounted = 0;
+}
+
+int ftl_format(ftl_t *ctx)
+{
+    flash_lock(ctx);
+
+    for (unsigned i = 0; i < ctx->block_count; i++) {
+        block_erase(ctx, i);
+    }
+    for (uint32_t i = 0; i < ctx->sector_count; i++) {
+        ctx->map[i] = FTL_UNMAPPED;
+    }
+
+    ctx->free_count = ctx->block_count;
+    ctx->host_block = FTL_NO_BLOCK;
+    ctx->gc_block = FTL_NO_BLOCK;
+    ctx->sequence = 0;
+    ctx->mounted = 1;
+
+    flash_unlock(ctx);
+
+    return FTL_OK;
+}
+
+/*
+ * Scans the entries of one block with a valid header. A page is in use once
+ * any word of its entry has been programmed, and is live once it has been
+ * committed and not made obsolete. Two live copies of a sector are only
+ * found when power failed between committing the new copy and marking the
+ * old one obsolete, so the older copy is marked obsolete now.
+ */
+static void mount_block_scan(ftl_t *ctx, unsigned block)
+{
+    ftl_block_t *b = &ctx->blocks[block];
+
+    for (unsigned i = 1; i < ctx->pages_per_block; i++) {
+        const uint8_t *slot = &ctx->meta_buf[i * FTL_SLOT_SIZE];
+        unsigned page = block * ctx->pages_per_block + i;
+        uint32_t sector = slot_word(slot, ENTRY_SECTOR);
+        uint32_t sequence = slot_word(slot, ENTRY_SEQUENCE);
+        unsigned old_page;
+
+        if (sector == FTL_ERASED && sequence == FTL_ERASED &&
+            slot_word(slot, ENTRY_COMMITTED) == FTL_ERASED && slot_word(slot, ENTRY_OBSOLETE) == FTL_ERASED) {
+            continue;
+        }
+        b->next_page = i + 1;
+
+        if (sequence != FTL_ERASED && sequence >= ctx->sequence) {
+            ctx->sequence = sequence + 1;
+        }
+        if (slot_word(slot, ENTRY_COMMITTED) == FTL_ERASED || slot_word(slot, ENTRY_OBSOLETE) != FTL_ERASED ||
+            sector >= ctx->sector_count) {
+            continue;
+        }
+
+        old_page = ctx->map[sector];
+        if (old_page != FTL_UNMAPPED) {
+            uint8_t old_slot[FTL_SLOT_SIZE];
+
+            ctx->ops->read(ctx->flash_ctx, old_slot, slot_address(ctx, old_page), FTL_SLOT_SIZE);
+            if (slot_word(old_slot, ENTRY_SEQUENCE) > sequence) {
+                entry_mark(ctx, page, ENTRY_OBSOLETE);
+                continue;
+            }
+            entry_mark(ctx, old_page, ENTRY_OBSOLETE);
+            ctx->blocks[old_page / ctx->pages_per_block].valid_count--;
+        }
+        ctx->map[sector] = page;
+        b->valid_count++;
+    }
+
+    if (b->next_page > 1) {
+        b->state = BLOCK_CLOSED;
+    }
+}
+
+/*
+ * Reopens the partially written block with the most pages left, so that
+ * a power failure during garbage collection does not strand the free pages
+ * of the block it was filling. The remaining entries are still erased, so
+ * they can be used as they are.
+ */
+static unsigned mount_block_reopen(ftl_t *ctx)
+{
+    unsigned block = FTL_NO_BLOCK;
+
+    for (unsigned i = 0; i < ctx->block_count; i++) {
+        ftl_block_t *b = &ctx->blocks[i];
+
+        if (b->state == BLOCK_CLOSED && b->next_page < ctx->pages_per_block &&
+            (block == FTL_NO_BLOCK || b->next_page < ctx->blocks[block].next_page)) {
+            block = i;
+        }
+    }
+
+    if (block != FTL_NO_BLOCK) {
+        ctx->blocks[block].state = BLOCK_ACTIVE;
+    }
+
+    return block;
+}
+
+int ftl_mount(ftl_t *ctx)
+{
+    unsigned valid_count = 0;
+    unsigned blank_count = 0;
+    uint32_t max_erase_count = 0;
+    int ret = FTL_OK;
+
+    flash_lock(ctx);
+
+    ctx->mounted = 0;
+    ctx->sequence = 0;
+    ctx->free_count = 0;
+    for (uint32_t i = 0; i < ctx->sector_count; i++) {
+        ctx->map[i] = FTL_UNMAPPED;
+    }
+
+    for (unsigned i = 0; i < ctx->block_count && ret == FTL_OK; i++) {
+        ftl_block_t *b = &ctx->blocks[i];
+        const uint8_t *header = ctx->meta_buf;
+
+        ctx->ops->read(ctx->flash_ctx, ctx->meta_buf, block_address(ctx, i), ctx->pages_per_block * FTL_SLOT_SIZE);
+
+        b->valid_count = 0;
+        b->next_page = 1;
+
+        if (slot_word(header, HEADER_MAGIC) != FTL_MAGIC) {
+            int blank = 1;
+
+            for (unsigned j = 0; j < ctx->pages_per_block * FTL_SLOT_SIZE; j++) {
+                if (ctx->meta_buf[j] != 0xFF) {
+                    blank = 0;
+                    break;
+                }
+            }
+            blank_count += blank;
+            b->state = BLOCK_INVALID;
+            continue;
+        }
+
+        if (slot_word(header, HEADER_PAGE_SIZE) != ctx->page_size ||
+            slot_word(header, HEADER_PAGES) != ctx->pages_per_block) {
+            ret = FTL_ERR_GEOMETRY;
+            break;
+        }
+
+        valid_count++;
+        b->state = BLOCK_FREE;
+        b->erase_count = slot_word(header, HEADER_ERASE_COUNT);
+        if (b->erase_count > max_erase_count) {
+            max_erase_count = b->erase_count;
+        }
+        mount_block_scan(ctx, i);
+    }
+
+    if (ret == FTL_OK && valid_count == 0) {
+        ret = blank_count == ctx->block_count ? FTL_ERR_BLANK : FTL_ERR_NO_FORMAT;
+        for (unsigned i = 0; i < ctx->block_count; i++) {
+            ctx->blocks[i].erase_count = 0;
+        }
+    }
+
+    if (ret == FTL_OK) {
+        for (unsigned i = 0; i < ctx->block_count; i++) {
+            ftl_block_t *b = &ctx->blocks[i];
+
+            if (b->state == BLOCK_INVALID) {
+                /* The erase count was lost with the header, assume the worst */
+                b->erase_count = max_erase_count;
+                block_erase(ctx, i);
+            }
+            if (b->state == BLOCK_FREE) {
+                ctx->free_count++;
+            }
+        }
+
+        ctx->gc_block = mount_block_reopen(ctx);
+        ctx->host_block = mount_block_reopen(ctx);
+        ctx->mounted = 1;
+    }
+
+    flash_unlock(ctx);
+
+    return ret;
+}
+
+int ftl_read(ftl_t *ctx, uint8_t *data, uint32_t sector, uint32_t count)
+{
+    if (!ctx->mounted || sector >= ctx->sector_count || count > ctx->sector_count - sector) {
+        return FTL_ERR_PARAM;
+    }
+
+    flash_lock(ctx);
+
+    while (count > 0) {
+        unsigned page = ctx->map[sector];
+        uint32_t run = 1;
+
+        if (page == FTL_UNMAPPED) {
+            memset(data, 0xFF, ctx->page_size);
+        } else {
+            /* Sectors written together usually sit in consecutive pages */
+            while (run < count && ctx->map[sector + run] == page + run &&
+                   (page + run) % ctx->pages_per_block != 0) {
+                run++;
+            }
+            ctx->ops->read(ctx->flash_ctx, data, page_address(ctx, page), run * ctx->page_size);
+        }
+
+        data += run * ctx->page_size;
+        sector += run;
+        count -= run;
+    }
+
+    flash_unlock(ctx);
+
+    return FTL_OK;
+}
+
+int ftl_read_partial(ftl_t *ctx, uint8_t *data, uint32_t sector, unsigned offset, size_t len)
+{
+    unsigned page;
+
+    if (!ctx->mounted || sector >= ctx->sector_count || offset > ctx->page_size || len > ctx->page_size - offset) {
+        return FTL_ERR_PARAM;
+    }
+
+    flash_lock(ctx);
+
+    page = ctx->map[sector];
+    if (page == FTL_UNMAPPED) {
+        memset(data, 0xFF, len);
+    } else {
+        ctx->ops->read(ctx->flash_ctx, data, page_address(ctx, page) + offset, len);
+    }
+
+    flash_unlock(ctx);
+
+    return FTL_OK;
+}
+
+int ftl_write(ftl_t *ctx, const uint8_t *data, uint32_t sector, uint32_t count)
+{
+    int ret = FTL_OK;
+
+    if (!ctx->mounted || sector >= ctx->sector_count || count > ctx->sector_count - sector) {
+        return FTL_ERR_PARAM;
+    }
+
+    flash_lock(ctx);
+
+    for (uint32_t i = 0; i < count && ret == FTL_OK; i++) {
+        ret = page_write(ctx, sector + i, data + i * ctx->page_size, 0);
+        ctx->stats.host_writes++;
+    }
+
+    flash_unlock(ctx);
+
+    return ret;
+}
+
+int ftl_trim(ftl_t *ctx, uint32_t sector, uint32_t count)
+{
+    if (!ctx->mounted || sector >= ctx->sector_count || count > ctx->sector_count - sector) {
+        return FTL_ERR_PARAM;
+    }
+
+    flash_lock(ctx);
+
+    for (uint32_t i = sector; i < sector + count; i++) {
+        unsigned page = ctx->map[i];
+
+        if (page != FTL_UNMAPPED) {
+            entry_mark(ctx, page, ENTRY_OBSOLETE);
+            ctx->blocks[page / ctx->pages_per_block].valid_count--;
+            ctx->map[i] = FTL_UNMAPPED;
+        }
+    }
+
+    flash_unlock(ctx);
+
+    return FTL_OK;
+}
+
+uint32_t ftl_sector_count_get(ftl_t *ctx)
+{
+    return ctx->sector_count;
+}
+
+unsigned ftl_sector_size_get(ftl_t *ctx)
+{
+    return ctx->page_size;
+}
+
+void ftl_stats_get(ftl_t *ctx, ftl_stats_t *stats)
+{
+    *stats = ctx->stats;
+
+    stats->erase_count_min = ctx->block_count > 0 ? ctx->blocks[0].erase_count : 0;
+    stats->erase_count_max = 0;
+    stats->erase_count_total = 0;
+    for (unsigned i = 0; i < ctx->block_count; i++) {
+        uint32_t erase_count = ctx->blocks[i].erase_count;
+
+        if (erase_count < stats->erase_count_min) {
+            stats->erase_count_min = erase_count;
+        }
+        if (erase_count > stats->erase_count_max) {
+            stats->erase_count_max = erase_count;
+        }
+        stats->erase_count_total += erase_count;
+    }
+}
+
+uint32_t ftl_block_erase_count_get(ftl_t *ctx, unsigned block)
+{
+    return block < ctx->block_count ? ctx->blocks[block].erase_count : 0;
+}
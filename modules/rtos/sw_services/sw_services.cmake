@@ -9,6 +9,7 @@ set(WIFI_MANAGER_DIR "${SW_SERVICES_DIR}/wifi_manager")
 set(DHCPD_DIR "${SW_SERVICES_DIR}/dhcpd")
 set(DEVICE_CONTROL_DIR "${SW_SERVICES_DIR}/device_control")
 set(FATFS_DIR "${SW_SERVICES_DIR}/fatfs")
+set(FTL_DIR "${SW_SERVICES_DIR}/ftl")
 set(HTTP_CORE_DIR "${SW_SERVICES_DIR}/http")
 set(HTTP_PARSER_DIR "${HTTP_CORE_DIR}/thirdparty/coreHTTP/source/dependency/3rdparty")
 set(JSON_PARSER_DIR "${SW_SERVICES_DIR}/json")
@@ -18,6 +19,7 @@ set(TLS_SUPPORT_DIR "${SW_SERVICES_DIR}/tls_support")
 set(TINYUSB_DIR "${SW_SERVICES_DIR}/usb")
 set(DISPATCHER_DIR "${SW_SERVICES_DIR}/dispatcher")
 set(CONCURRENCY_SUPPORT_DIR "${SW_SERVICES_DIR}/concurrency_support")
+set(AUDIO_PIPELINE_DIR "${SW_SERVICES_DIR}/audio_pipeline")
 
 #**********************
 # Options
@@ -26,6 +28,7 @@ option(USE_WIFI_MANAGER "Enable to use WiFi manager" FALSE)
 option(USE_DHCPD "Enable to use DHCP" FALSE)
 option(USE_DEVICE_CONTROL "Enable to use Device Control" FALSE)
 option(USE_FATFS "Enable to use FATFS filesystem" FALSE)
+option(USE_FTL "Enable to use the wear-levelling flash translation layer under FATFS and the flash disk" FALSE)
 option(USE_HTTP_CORE "Enable to use HTTP client and parser" FALSE)
 option(USE_HTTP_PARSER "Enable to use HTTP parser" FALSE)
 option(USE_JSON_PARSER "Enable to use JSON parser" FALSE)
@@ -37,6 +40,7 @@ option(USE_TINYUSB "Enable to use TinyUSB" FALSE)
 option(USE_DISK_MANAGER_TUSB "Enable to use RAM and Flash disk manager" FALSE)
 option(USE_DISPATCHER "Enable to use Dispatcher" FALSE)
 option(USE_CONCURRENCY_SUPPORT "Enable to use concurrency support" TRUE)
+option(USE_AUDIO_PIPELINE "Enable to use the audio pipeline" FALSE)
 
 #********************************
 # Gather wifi manager sources
@@ -146,6 +150,33 @@ if(${USE_${THIS_LIB}})
 endif()
 unset(THIS_LIB)
 
+#********************************
+# Gather FTL sources
+#********************************
+set(THIS_LIB FTL)
+if(${USE_${THIS_LIB}})
+	set(${THIS_LIB}_FLAGS "-Os")
+
+	file(GLOB_RECURSE ${THIS_LIB}_SOURCES "${${THIS_LIB}_DIR}/src/*.c")
+	if(USE_RTOS_QSPI_FLASH_DRIVER)
+		list(APPEND ${THIS_LIB}_SOURCES "${${THIS_LIB}_DIR}/${RTOS_CMAKE_RTOS}/ftl_qspi_flash.c")
+	endif()
+
+    if(${${THIS_LIB}_FLAGS})
+        set_source_files_properties(${${THIS_LIB}_SOURCES} PROPERTIES COMPILE_FLAGS ${${THIS_LIB}_FLAGS})
+    endif()
+
+	set(${THIS_LIB}_INCLUDES
+	    "${${THIS_LIB}_DIR}/api"
+	)
+
+    add_compile_definitions(
+        USE_FTL=1
+    )
+    message("${COLOR_GREEN}Gathering ${THIS_LIB}...${COLOR_RESET}")
+endif()
+unset(THIS_LIB)
+
 #********************************
 # Gather HTTP core sources
 #********************************
@@ -472,25 +503,53 @@ if(${USE_${THIS_LIB}})
 endif()
 unset(THIS_LIB)
 
+#********************************
+# Gather audio pipeline sources
+#********************************
+set(THIS_LIB AUDIO_PIPELINE)
+if(${USE_${THIS_LIB}})
+	set(${THIS_LIB}_FLAGS "-Os")
+
+	file(GLOB_RECURSE ${THIS_LIB}_SOURCES "${${THIS_LIB}_DIR}/src/*.c")
+
+    if(${${THIS_LIB}_FLAGS})
+       set_source_files_properties(${${THIS_LIB}_SOURCES} PROPERTIES COMPILE_FLAGS ${${THIS_LIB}_FLAGS})
+    endif()
+
+	set(${THIS_LIB}_INCLUDES
+	    "${${THIS_LIB}_DIR}/api"
+	)
+
+    add_compile_definitions(
+        USE_AUDIO_PIPELINE=1
+    )
+    message("${COLOR_GREEN}Gathering ${THIS_LIB}...${COLOR_RESET}")
+endif()
+unset(THIS_LIB)
+
 #**********************
 # set user variables
 #**********************
 set(SW_SERVICES_SOURCES
     ${DEVICE_CONTROL_SOURCES}
     ${FATFS_SOURCES}
+    ${FTL_SOURCES}
     ${JSON_PARSER_SOURCES}
     ${TINYUSB_SOURCES}
     ${DISPATCHER_SOURCES}
     ${CONCURRENCY_SUPPORT_SOURCES}
+    ${AUDIO_PIPELINE_SOURCES}
 )
 
 set(SW_SERVICES_INCLUDES
     ${DEVICE_CONTROL_INCLUDES}
     ${FATFS_INCLUDES}
+    ${FTL_INCLUDES}
     ${JSON_PARSER_INCLUDES}
     ${TINYUSB_INCLUDES}
     ${DISPATCHER_INCLUDES}
     ${CONCURRENCY_SUPPORT_INCLUDES}
+    ${AUDIO_PIPELINE_INCLUDES}
 )
 
 list(REMOVE_DUPLICATES SW_SERVICES_SOURCES)
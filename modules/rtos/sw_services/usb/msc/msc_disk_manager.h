@@ -96,6 +96,11 @@ int32_t ram_disk_read(disk_desc_t *disk_ctx, uint8_t *buffer, uint32_t lba, uint
 int32_t ram_disk_write(disk_desc_t *disk_ctx, const uint8_t *buffer, uint32_t lba, uint32_t offset, uint32_t bufsize);
 int32_t ram_disk_scsi_command(disk_desc_t *disk_ctx, uint8_t lun, uint8_t *buffer, const uint8_t *scsi_cmd, uint16_t bufsize);
 
+/*
+ * Callbacks for a flash disk written straight to the flash. The disk's
+ * args must point to the rtos_qspi_flash_t, and starting_addr is the flash
+ * address of its first block.
+ */
 bool qspi_flash_disk_init(disk_desc_t *disk_ctx);
 bool qspi_flash_disk_ready(disk_desc_t *disk_ctx);
 bool qspi_flash_disk_start_stop(disk_desc_t *disk_ctx, uint8_t power_condition, bool start, bool load_eject);
@@ -103,4 +108,37 @@ int32_t qspi_flash_disk_read(disk_desc_t *disk_ctx, uint8_t *buffer, uint32_t lb
 int32_t qspi_flash_disk_write(disk_desc_t *disk_ctx, const uint8_t *buffer, uint32_t lba, uint32_t offset, uint32_t bufsize);
 int32_t qspi_flash_disk_scsi_command(disk_desc_t *disk_ctx, uint8_t lun, uint8_t *buffer, const uint8_t *scsi_cmd, uint16_t bufsize);
 
+/**
+ * Flash disk write statistics, as returned by flash_disk_stats_get().
+ * The counts are for all flash disks together.
+ */
+typedef struct {
+    uint32_t write_bytes;     /**< Bytes written by the host */
+    uint32_t write_ticks;     /**< Reference clock ticks spent in the write callbacks */
+    uint32_t sector_programs; /**< Flash sectors written */
+    uint32_t sector_erases;   /**< Flash sectors erased */
+    uint32_t sector_fills;    /**< Partly written sectors completed from the flash */
+} flash_disk_stats_t;
+
+/*
+ * The flash disk write callbacks hold the sector being written in RAM
+ * until it is complete. This commits it early. It is called by the ready,
+ * start_stop and scsi_command callbacks, so only needs to be called by
+ * applications that replace those.
+ */
+void flash_disk_flush(disk_desc_t *disk_ctx);
+void flash_disk_stats_get(flash_disk_stats_t *stats);
+
+#if USE_FTL
+/*
+ * Read and write callbacks for a flash disk that sits on an FTL, for use
+ * with the other qspi_flash_disk callbacks. The disk's args must point to
+ * the ftl_t and it must not be larger than the FTL. The disk's blocks are
+ * the FTL's logical sectors, starting from sector 0, so starting_addr is
+ * not used. The FTL's region of the flash is set when it is initialized.
+ */
+int32_t ftl_flash_disk_read(disk_desc_t *disk_ctx, uint8_t *buffer, uint32_t lba, uint32_t offset, uint32_t bufsize);
+int32_t ftl_flash_disk_write(disk_desc_t *disk_ctx, const uint8_t *buffer, uint32_t lba, uint32_t offset, uint32_t bufsize);
+#endif
+
 #endif  // MSC_DISK_MANAGER_H_
@@ -4,16 +4,321 @@
 #define DEBUG_UNIT MSC_FLASHDISK
 
 #include <stdio.h>
+#include <xcore/hwtimer.h>
 
 #include "rtos_osal.h"
 #include "rtos/drivers/qspi_flash/api/rtos_qspi_flash.h"
 #include "msc_disk_manager.h"
 #include "tusb.h"
 
+#if USE_FTL
+#include "ftl.h"
+#endif
+
 #ifndef QSPI_FLASH_SECTOR_SIZE
 #define QSPI_FLASH_SECTOR_SIZE 4096
 #endif
 
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+/* Not all versions of TinyUSB define this */
+#ifndef SCSI_CMD_SYNCHRONIZE_CACHE_10
+#define SCSI_CMD_SYNCHRONIZE_CACHE_10 0x35
+#endif
+
+/* Sectors are compared against the flash in chunks of this size before writing */
+#define SECTOR_COMPARE_CHUNK_SIZE 256
+
+#define FLASH_DISK_NO_SECTOR 0xFFFFFFFF
+
+/*
+ * Write cache for one flash disk.
+ *
+ * Hosts write in blocks of the endpoint buffer size, so a flash sector is
+ * normally written by several consecutive callbacks. These are accumulated
+ * in buf, which holds the contents of one sector, and the sector is only
+ * committed to the flash once it is complete, when a write moves on to a
+ * different sector, or when the host synchronizes or polls the disk. The
+ * bytes from 0 to fill are valid. A write that leaves a gap after fill has
+ * the rest of the sector read from the flash first, and so does a commit
+ * of a sector that was not written to the end.
+ */
+typedef struct {
+    disk_desc_t *disk_ctx;
+    uint8_t *buf;
+    uint32_t sector_size;
+    uint32_t sector;
+    uint32_t fill;
+    bool dirty;
+    bool ftl;
+} flash_disk_cache_t;
+
+static flash_disk_cache_t flash_disk_caches[MSC_MAX_DISKS];
+static flash_disk_stats_t flash_disk_stats;
+
+static flash_disk_cache_t *flash_disk_cache_find(disk_desc_t *disk_ctx)
+{
+    for (int i = 0; i < MSC_MAX_DISKS; i++) {
+        if (flash_disk_caches[i].disk_ctx == disk_ctx) {
+            return &flash_disk_caches[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Returns the cache for a disk, setting one up on the first call for the
+ * disk. The sector buffer is allocated once and kept for the life of the
+ * disk.
+ */
+static flash_disk_cache_t *flash_disk_cache_get(disk_desc_t *disk_ctx, bool ftl)
+{
+    flash_disk_cache_t *cache = flash_disk_cache_find(disk_ctx);
+
+    if (cache == NULL) {
+        cache = flash_disk_cache_find(NULL);
+        if (cache == NULL) {
+            return NULL;
+        }
+#if USE_FTL
+        cache->sector_size = ftl ? ftl_sector_size_get((ftl_t*)disk_ctx->args) : QSPI_FLASH_SECTOR_SIZE;
+#else
+        cache->sector_size = QSPI_FLASH_SECTOR_SIZE;
+#endif
+        cache->buf = rtos_osal_malloc(sizeof(uint8_t) * cache->sector_size);
+        if (cache->buf == NULL) {
+            return NULL;
+        }
+        cache->disk_ctx = disk_ctx;
+        cache->sector = FLASH_DISK_NO_SECTOR;
+        cache->fill = 0;
+        cache->dirty = false;
+        cache->ftl = ftl;
+    }
+
+    return cache;
+}
+
+static unsigned flash_disk_sector_address(flash_disk_cache_t *cache, uint32_t sector)
+{
+    return (unsigned)(cache->disk_ctx->starting_addr + (sector * cache->sector_size));
+}
+
+/*
+ * Reads part of a sector from the flash, or from the FTL.
+ */
+static int flash_disk_sector_read(flash_disk_cache_t *cache, uint8_t *data, uint32_t sector, uint32_t offset, uint32_t len)
+{
+#if USE_FTL
+    if (cache->ftl) {
+        return ftl_read_partial((ftl_t*)cache->disk_ctx->args, data, sector, offset, len) == FTL_OK ? 0 : -1;
+    }
+#endif
+
+    rtos_qspi_flash_read(
+            (rtos_qspi_flash_t*)cache->disk_ctx->args,
+            data,
+            flash_disk_sector_address(cache, sector) + offset,
+            (size_t)len);
+    return 0;
+}
+
+/*
+ * Writes the whole cached sector. Writes through the FTL never need an
+ * erase. Writes to the flash skip the erase when the new data only clears
+ * bits that are set in the flash, and skip the write when the data is
+ * unchanged.
+ */
+static int flash_disk_sector_program(flash_disk_cache_t *cache)
+{
+    rtos_qspi_flash_t *flash_ctx;
+    uint8_t flash_data[SECTOR_COMPARE_CHUNK_SIZE];
+    unsigned address;
+    bool changed = false;
+    bool needs_erase = false;
+
+#if USE_FTL
+    if (cache->ftl) {
+        flash_disk_stats.sector_programs++;
+        return ftl_write((ftl_t*)cache->disk_ctx->args, cache->buf, cache->sector, 1) == FTL_OK ? 0 : -1;
+    }
+#endif
+
+    flash_ctx = (rtos_qspi_flash_t*)cache->disk_ctx->args;
+    address = flash_disk_sector_address(cache, cache->sector);
+
+    rtos_qspi_flash_lock(flash_ctx);
+    {
+        for (unsigned offset = 0; offset < cache->sector_size && !needs_erase; offset += SECTOR_COMPARE_CHUNK_SIZE) {
+            rtos_qspi_flash_read(flash_ctx, flash_data, address + offset, SECTOR_COMPARE_CHUNK_SIZE);
+            for (int i = 0; i < SECTOR_COMPARE_CHUNK_SIZE; i++) {
+                if (cache->buf[offset + i] != flash_data[i]) {
+                    changed = true;
+                    if (cache->buf[offset + i] & ~flash_data[i]) {
+                        needs_erase = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (needs_erase) {
+            rtos_qspi_flash_erase(flash_ctx, address, (size_t)cache->sector_size);
+            flash_disk_stats.sector_erases++;
+        }
+        if (changed) {
+            rtos_qspi_flash_write(flash_ctx, cache->buf, address, (size_t)cache->sector_size);
+            flash_disk_stats.sector_programs++;
+        }
+    }
+    rtos_qspi_flash_unlock(flash_ctx);
+
+    return 0;
+}
+
+/*
+ * Fills in the rest of the cached sector from the flash, so that all of
+ * it is valid.
+ */
+static int flash_disk_cache_complete(flash_disk_cache_t *cache)
+{
+    if (cache->fill < cache->sector_size) {
+        if (flash_disk_sector_read(cache, cache->buf + cache->fill, cache->sector, cache->fill, cache->sector_size - cache->fill) != 0) {
+            return -1;
+        }
+        cache->fill = cache->sector_size;
+        flash_disk_stats.sector_fills++;
+    }
+
+    return 0;
+}
+
+/*
+ * Commits the cached sector if it has been written to. The sector stays
+ * in the cache afterwards so that it can be read back from RAM.
+ */
+static int flash_disk_cache_flush(flash_disk_cache_t *cache)
+{
+    int ret = 0;
+
+    if (cache != NULL && cache->dirty) {
+        ret = flash_disk_cache_complete(cache);
+        if (ret == 0) {
+            ret = flash_disk_sector_program(cache);
+        }
+        if (ret != 0) {
+            /* The cached copy may not match the flash now, so drop it */
+            cache->sector = FLASH_DISK_NO_SECTOR;
+            cache->fill = 0;
+        }
+        cache->dirty = false;
+    }
+
+    return ret;
+}
+
+static int32_t flash_disk_read(disk_desc_t *disk_ctx, bool ftl, uint8_t *buffer, uint32_t lba, uint32_t offset, uint32_t bufsize)
+{
+    flash_disk_cache_t *cache = flash_disk_cache_get(disk_ctx, ftl);
+    uint64_t pos = ((uint64_t) lba * disk_ctx->block_size) + offset;
+    uint32_t remaining = bufsize;
+
+    if (cache == NULL) {
+        return -1;
+    }
+
+    while (remaining > 0) {
+        uint32_t sector = pos / cache->sector_size;
+        uint32_t sector_offset = pos % cache->sector_size;
+        uint32_t len = MIN(remaining, cache->sector_size - sector_offset);
+
+        if (cache->sector == sector && sector_offset + len <= cache->fill) {
+            memcpy(buffer, cache->buf + sector_offset, len);
+        } else if (flash_disk_sector_read(cache, buffer, sector, sector_offset, len) != 0) {
+            return -1;
+        } else if (cache->sector == sector && cache->fill > sector_offset) {
+            /* Part of the range is waiting in the cache to be written */
+            memcpy(buffer, cache->buf + sector_offset, cache->fill - sector_offset);
+        }
+
+        buffer += len;
+        remaining -= len;
+        pos += len;
+    }
+
+    return bufsize;
+}
+
+static int32_t flash_disk_write(disk_desc_t *disk_ctx, bool ftl, const uint8_t *buffer, uint32_t lba, uint32_t offset, uint32_t bufsize)
+{
+    flash_disk_cache_t *cache = flash_disk_cache_get(disk_ctx, ftl);
+    uint64_t pos = ((uint64_t) lba * disk_ctx->block_size) + offset;
+    uint32_t remaining = bufsize;
+    uint32_t start_time = get_reference_time();
+
+    if (cache == NULL) {
+        return -1;
+    }
+
+    while (remaining > 0) {
+        uint32_t sector = pos / cache->sector_size;
+        uint32_t sector_offset = pos % cache->sector_size;
+        uint32_t len = MIN(remaining, cache->sector_size - sector_offset);
+
+        if (cache->sector != sector) {
+            if (flash_disk_cache_flush(cache) != 0) {
+                return -1;
+            }
+            cache->sector = sector;
+            cache->fill = 0;
+        }
+
+        if (sector_offset > cache->fill) {
+            /* Not a sequential write, so the gap must come from the flash */
+            if (flash_disk_cache_complete(cache) != 0) {
+                cache->sector = FLASH_DISK_NO_SECTOR;
+                cache->fill = 0;
+                return -1;
+            }
+        }
+
+        memcpy(cache->buf + sector_offset, buffer, len);
+        cache->dirty = true;
+        if (sector_offset + len > cache->fill) {
+            cache->fill = sector_offset + len;
+        }
+
+        if (cache->fill == cache->sector_size) {
+            if (flash_disk_cache_flush(cache) != 0) {
+                return -1;
+            }
+        }
+
+        buffer += len;
+        remaining -= len;
+        pos += len;
+    }
+
+    flash_disk_stats.write_bytes += bufsize;
+    flash_disk_stats.write_ticks += get_reference_time() - start_time;
+
+    return bufsize;
+}
+
+void flash_disk_flush(disk_desc_t *disk_ctx)
+{
+    flash_disk_cache_flush(flash_disk_cache_find(disk_ctx));
+}
+
+void flash_disk_stats_get(flash_disk_stats_t *stats)
+{
+    *stats = flash_disk_stats;
+}
+
+
 __attribute__((fptrgroup("disk_init_fptr_grp"))) __attribute__((weak))
 bool qspi_flash_disk_init(disk_desc_t *disk_ctx)
 {
@@ -25,6 +330,13 @@ __attribute__((fptrgroup("disk_ready_fptr_grp"))) __attribute__((weak))
 bool qspi_flash_disk_ready(disk_desc_t *disk_ctx)
 {
     rtos_printf("flash_disk default ready callback\n");
+
+    /*
+     * Hosts poll with TEST UNIT READY while the disk is idle, so this is
+     * when the last sector of a write that did not end on a sector boundary
+     * is committed.
+     */
+    flash_disk_flush(disk_ctx);
     return true;
 }
 
@@ -32,60 +344,40 @@ __attribute__((fptrgroup("disk_start_stop_fptr_grp"))) __attribute__((weak))
 bool qspi_flash_disk_start_stop(disk_desc_t *disk_ctx, uint8_t power_condition, bool start, bool load_eject)
 {
     rtos_printf("flash_disk default start_stop callback\n");
+    flash_disk_flush(disk_ctx);
     return true;
 }
 
 __attribute__((fptrgroup("disk_read_fptr_grp"))) __attribute__((weak))
 int32_t qspi_flash_disk_read(disk_desc_t *disk_ctx, uint8_t *buffer, uint32_t lba, uint32_t offset, uint32_t bufsize)
 {
-    rtos_qspi_flash_t *flash_ctx = (rtos_qspi_flash_t*)disk_ctx->args;
-
     rtos_printf("flash_disk default read callback\n");
-    rtos_qspi_flash_read(
-        flash_ctx,
-        (uint8_t*)buffer,
-        (unsigned)(disk_ctx->starting_addr + (lba * disk_ctx->block_size) + offset),
-        (size_t)bufsize);
-    return bufsize;
+    return flash_disk_read(disk_ctx, false, buffer, lba, offset, bufsize);
 }
 
 __attribute__((fptrgroup("disk_write_fptr_grp"))) __attribute__((weak))
 int32_t qspi_flash_disk_write(disk_desc_t *disk_ctx, const uint8_t *buffer, uint32_t lba, uint32_t offset, uint32_t bufsize)
 {
-    rtos_qspi_flash_t *flash_ctx = (rtos_qspi_flash_t*)disk_ctx->args;
-
     rtos_printf("flash_disk default write callback adr: 0x%x, size: %u lba: %u offset: %u\n", disk_ctx->starting_addr + (lba * disk_ctx->block_size), bufsize, lba, offset);
+    return flash_disk_write(disk_ctx, false, buffer, lba, offset, bufsize);
+}
 
-    xassert(bufsize <= QSPI_FLASH_SECTOR_SIZE);
-
-    uint8_t *tmp_buf = rtos_osal_malloc( sizeof(uint8_t) * QSPI_FLASH_SECTOR_SIZE);
+#if USE_FTL
 
-    rtos_qspi_flash_lock(flash_ctx);
-    {
-        rtos_qspi_flash_read(
-                flash_ctx,
-                tmp_buf,
-                (unsigned)(disk_ctx->starting_addr + (lba * disk_ctx->block_size)),
-                (size_t)QSPI_FLASH_SECTOR_SIZE);
-
-        memcpy(tmp_buf + offset, buffer, bufsize);
-
-        rtos_qspi_flash_erase(
-                flash_ctx,
-                (unsigned)(disk_ctx->starting_addr + (lba * disk_ctx->block_size)),
-                (size_t)QSPI_FLASH_SECTOR_SIZE);
-        rtos_qspi_flash_write(
-                flash_ctx,
-                (uint8_t *) tmp_buf,
-                (unsigned)(disk_ctx->starting_addr + (lba * disk_ctx->block_size)),
-                (size_t)QSPI_FLASH_SECTOR_SIZE);
-        rtos_qspi_flash_unlock(flash_ctx);
-    }
-    rtos_osal_free(tmp_buf);
+__attribute__((fptrgroup("disk_read_fptr_grp"))) __attribute__((weak))
+int32_t ftl_flash_disk_read(disk_desc_t *disk_ctx, uint8_t *buffer, uint32_t lba, uint32_t offset, uint32_t bufsize)
+{
+    return flash_disk_read(disk_ctx, true, buffer, lba, offset, bufsize);
+}
 
-    return bufsize;
+__attribute__((fptrgroup("disk_write_fptr_grp"))) __attribute__((weak))
+int32_t ftl_flash_disk_write(disk_desc_t *disk_ctx, const uint8_t *buffer, uint32_t lba, uint32_t offset, uint32_t bufsize)
+{
+    return flash_disk_write(disk_ctx, true, buffer, lba, offset, bufsize);
 }
 
+#endif /* USE_FTL */
+
 __attribute__((fptrgroup("disk_scsi_command_fptr_grp"))) __attribute__((weak))
 int32_t qspi_flash_disk_scsi_command(disk_desc_t *disk_ctx, uint8_t lun, uint8_t *buffer, const uint8_t *scsi_cmd, uint16_t bufsize)
 {
@@ -99,6 +391,11 @@ int32_t qspi_flash_disk_scsi_command(disk_desc_t *disk_ctx, uint8_t lun, uint8_t
             resplen = 0;
         break;
 
+        case SCSI_CMD_SYNCHRONIZE_CACHE_10:
+            flash_disk_flush(disk_ctx);
+            resplen = 0;
+        break;
+
         default:
             // Set Sense = Invalid Command Operation
             tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x20, 0x00);
@@ -25,6 +25,23 @@
 #ifndef SEND_DELAY_INCREMENT
 #define SEND_DELAY_INCREMENT 5
 #endif
+#ifndef RECEIVE_DELAY_START
+#define RECEIVE_DELAY_START 5000
+#endif
+
+/* 0 for I2S, otherwise the number of TDM slots per frame */
+#ifndef TDM_SLOTS
+#define TDM_SLOTS 0
+#endif
+#ifndef FRAMES_PER_BLOCK
+#define FRAMES_PER_BLOCK 1
+#endif
+
+#if TDM_SLOTS
+#define SLOTS_PER_FRAME TDM_SLOTS
+#else
+#define SLOTS_PER_FRAME I2S_CHANS_PER_FRAME
+#endif
 
 #ifndef GENERATE_MCLK
 #define GENERATE_MCLK 0
@@ -48,13 +65,15 @@ port_t p_din [4] = {XS1_PORT_1I, XS1_PORT_1J, XS1_PORT_1K, XS1_PORT_1L};
 xclock_t mclk = XS1_CLKBLK_1;
 xclock_t bclk = XS1_CLKBLK_2;
 
-static volatile int receive_delay = 5000;
+static volatile int receive_delay = RECEIVE_DELAY_START;
 static volatile int send_delay = 0;
 
 void i2s_init(void *app_data, i2s_config_t *i2s_config)
 {
     i2s_config->mode = I2S_MODE_I2S;
-    i2s_config->mclk_bclk_ratio = (MASTER_CLOCK_FREQUENCY/SAMPLE_FREQUENCY)/64;
+    i2s_config->mclk_bclk_ratio = (MASTER_CLOCK_FREQUENCY/SAMPLE_FREQUENCY)/(32 * SLOTS_PER_FRAME);
+    i2s_config->tdm_slots = TDM_SLOTS;
+    i2s_config->frames_per_block = FRAMES_PER_BLOCK;
 }
 
 void i2s_send(void *app_data, size_t n, int32_t *send_data)
@@ -88,6 +107,11 @@ DECLARE_JOB(test_lr_period, (void));
 void test_lr_period() {
     const int ref_tick_per_sample = XS1_TIMER_HZ/SAMPLE_FREQUENCY;
     const int period = ref_tick_per_sample;
+    /*
+     * The callbacks have about one slot each to return, whatever the number
+     * of slots in each frame or frames in each block.
+     */
+    const int callback_period = (period * I2S_CHANS_PER_FRAME) / SLOTS_PER_FRAME;
 
     //set_core_fast_mode_on();
     SETSR(XS1_SR_QUEUE_MASK | XS1_SR_FAST_MASK);
@@ -117,7 +141,7 @@ void test_lr_period() {
         if (counter == N_CYCLES_AT_DELAY) {
             receive_delay += RECEIVE_DELAY_INCREMENT;
             send_delay += SEND_DELAY_INCREMENT;
-            if ((receive_delay + send_delay) > (period - OVERHEAD_TICKS)) {
+            if ((receive_delay + send_delay) > (callback_period - OVERHEAD_TICKS)) {
                 printf("PASS\n");
                 _Exit(0);
             }
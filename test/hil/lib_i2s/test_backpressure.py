@@ -36,9 +36,41 @@ def test_i2s_backpressure(build, nightly, capfd, request, sample_rate, num_chann
                                             ordered = True)
 
     build(directory = binary, 
-            env = {"SAMPLE_RATES":sample_rate, "CHANS":num_channels, "RX_TX_INCS":f"{receive_increment};{send_increment}"},
+            env = {"SAMPLE_RATES":sample_rate, "CHANS":num_channels, "RX_TX_INCS":f"{receive_increment};{send_increment}", "TDM_CONFIGS":""},
             bin_child = id_string)
 
     subprocess.run(("xsim", binary, "--plugin", "LoopbackPort.dll", "-port tile[0] XS1_PORT_1G 1 0 -port tile[0] XS1_PORT_1A 1 0"))
                     
     tester.run(capfd.readouterr().out)
+
+tdm_sample_rate_args = {"96kbps": 96000,
+                        "48kbps": 48000}
+
+tdm_config_args = {"8slots,1frame": (8, 1),
+                   "8slots,4frames": (8, 4),
+                   "4slots,2frames": (4, 2)}
+
+@pytest.mark.parametrize("sample_rate", tdm_sample_rate_args.values(), ids=tdm_sample_rate_args.keys())
+@pytest.mark.parametrize("num_channels", num_channels_args.values(), ids=num_channels_args.keys())
+@pytest.mark.parametrize(("slots", "frames"), tdm_config_args.values(), ids=tdm_config_args.keys())
+def test_i2s_tdm_backpressure(build, nightly, capfd, request, sample_rate, num_channels, slots, frames):
+    if (num_channels != 4) and not nightly:
+        pytest.skip("Only run 4 channel tests unless it is a nightly")
+
+    id_string = f"tdm_{slots}_{frames}_{sample_rate}_{num_channels}"
+
+    cwd = Path(request.fspath).parent
+
+    binary = f'{cwd}/backpressure_test/bin/{id_string}/backpressure_test_{id_string}.xe'
+
+    tester = px.testers.PytestComparisonTester(f'{cwd}/expected/backpressure_test.expect',
+                                            regexp = True,
+                                            ordered = True)
+
+    build(directory = binary,
+            env = {"SAMPLE_RATES":"", "TDM_SAMPLE_RATES":sample_rate, "CHANS":num_channels, "TDM_CONFIGS":f"{slots};{frames}"},
+            bin_child = id_string)
+
+    subprocess.run(("xsim", binary, "--plugin", "LoopbackPort.dll", "-port tile[0] XS1_PORT_1G 1 0 -port tile[0] XS1_PORT_1A 1 0"))
+
+    tester.run(capfd.readouterr().out)
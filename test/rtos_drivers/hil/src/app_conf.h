@@ -11,6 +11,14 @@
 #define INTERTILE_TEST_SYNC_PORT 11
 #define INTERTILE_TEST_SYNC_TASK_PRIORITY (configMAX_PRIORITIES-1)
 
+#define INTERTILE_LANE_COUNT 2
+#define INTERTILE_BENCH_BULK_PORT 17
+#define INTERTILE_BENCH_PING_PORT 18
+#define INTERTILE_BENCH_TASK_PRIORITY (configMAX_PRIORITIES/2)
+
+#define INTERTILE_STREAM_PORT 19
+#define INTERTILE_STREAM_TASK_PRIORITY (configMAX_PRIORITIES/2)
+
 #define I2C_MASTER_RPC_PORT 12
 #define I2C_MASTER_RPC_HOST_TASK_PRIORITY (configMAX_PRIORITIES/2)
 
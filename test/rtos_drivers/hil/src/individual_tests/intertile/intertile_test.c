@@ -46,6 +46,10 @@ static void register_intertile_tests(intertile_test_ctx_t *test_ctx)
 {
     register_fixed_len_tx_test(test_ctx);
     register_var_len_tx_test(test_ctx);
+    register_rpc_call_test(test_ctx);
+    register_lanes_bench_test(test_ctx);
+    register_rx_pool_test(test_ctx);
+    register_driver_stream_test(test_ctx);
 }
 
 static void intertile_init_tests(intertile_test_ctx_t *test_ctx, rtos_intertile_t *intertile_ctx)
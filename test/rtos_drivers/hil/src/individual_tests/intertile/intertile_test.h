@@ -8,7 +8,7 @@
 
 #define intertile_printf( FMT, ... )       module_printf("INTERTILE", FMT, ##__VA_ARGS__)
 
-#define INTERTILE_MAX_TESTS   2
+#define INTERTILE_MAX_TESTS   6
 
 #define INTERTILE_MAIN_TEST_ATTR      __attribute__((fptrgroup("rtos_test_intertile_main_test_fptr_grp")))
 
@@ -31,5 +31,9 @@ int intertile_device_tests(rtos_intertile_t *intertile_ctx, chanend_t c);
 /* Local Tests */
 void register_fixed_len_tx_test(intertile_test_ctx_t *test_ctx);
 void register_var_len_tx_test(intertile_test_ctx_t *test_ctx);
+void register_rpc_call_test(intertile_test_ctx_t *test_ctx);
+void register_lanes_bench_test(intertile_test_ctx_t *test_ctx);
+void register_rx_pool_test(intertile_test_ctx_t *test_ctx);
+void register_driver_stream_test(intertile_test_ctx_t *test_ctx);
 
 #endif /* INTERTILE_TEST_H_ */
@@ -0,0 +1,178 @@
+// Copyright 2022 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/* System headers */
+#include <platform.h>
+#include <xs1.h>
+
+/* FreeRTOS headers */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Library headers */
+#include "rtos/osal/api/rtos_osal.h"
+#include "rtos/drivers/intertile/api/rtos_intertile.h"
+#include "rtos/drivers/rpc/api/rtos_driver_stream.h"
+
+/* App headers */
+#include "app_conf.h"
+#include "individual_tests/intertile/intertile_test.h"
+
+static const char* test_name = "driver_stream_test";
+
+#define local_printf( FMT, ... )    intertile_printf("%s|" FMT, test_name, ##__VA_ARGS__)
+
+#define STREAM_HOST_TILE    1
+#define STREAM_CLIENT_TILE  0
+
+#define FRAME_WORDS     2
+#define BLOCK_FRAMES    8
+#define BLOCK_COUNT     6
+#define MAX_READ_FRAMES ((BLOCK_COUNT - 1) * BLOCK_FRAMES)
+
+/*
+ * The host stops producing blocks after this many, well after the client
+ * has finished reading.
+ */
+#define HOST_BLOCK_LIMIT    1000
+
+#define READ_ROUNDS     20
+
+/*
+ * A run of reads smaller than a block, each followed by a read of as much as
+ * the ring allows, leaves the client waiting with emptied blocks that it has
+ * not yet returned the credits for.
+ */
+static const size_t read_frames[] = {1, BLOCK_FRAMES, BLOCK_FRAMES, MAX_READ_FRAMES, 13, 3, MAX_READ_FRAMES, 7};
+
+static rtos_driver_stream_t stream;
+
+#if ON_TILE(STREAM_HOST_TILE)
+
+/*
+ * Fills each block with a ramp that continues across blocks, at about one
+ * block per millisecond.
+ */
+__attribute__((fptrgroup("rtos_driver_stream_source_fptr_grp")))
+static size_t ramp_source(void *driver_ctx, int32_t *buf, size_t frame_count)
+{
+    static int32_t next_sample;
+    static unsigned block_count;
+
+    if (++block_count > HOST_BLOCK_LIMIT) {
+        vTaskSuspend(NULL);
+    }
+    vTaskDelay(pdMS_TO_TICKS(1));
+
+    for (size_t i = 0; i < frame_count * FRAME_WORDS; i++) {
+        buf[i] = next_sample++;
+    }
+
+    return frame_count;
+}
+
+static int host_run(rtos_intertile_t *intertile_ctx)
+{
+    rtos_intertile_address_t address = {
+        .intertile_ctx = intertile_ctx,
+        .port = INTERTILE_STREAM_PORT,
+    };
+
+    rtos_driver_stream_host_init(&stream, &address, ramp_source, NULL,
+                                 FRAME_WORDS, BLOCK_FRAMES, INTERTILE_STREAM_TASK_PRIORITY);
+    rtos_driver_stream_host_start(&stream);
+
+    return 0;
+}
+
+#endif /* ON_TILE(STREAM_HOST_TILE) */
+
+#if ON_TILE(STREAM_CLIENT_TILE)
+
+static int client_run(rtos_intertile_t *intertile_ctx)
+{
+    rtos_intertile_address_t address = {
+        .intertile_ctx = intertile_ctx,
+        .port = INTERTILE_STREAM_PORT,
+    };
+    rtos_driver_stream_stats_t stats;
+    int32_t buf[MAX_READ_FRAMES * FRAME_WORDS];
+    int32_t expected = 0;
+    int first = 1;
+
+    rtos_driver_stream_client_init(&stream, &address, FRAME_WORDS, BLOCK_FRAMES,
+                                   BLOCK_COUNT, INTERTILE_STREAM_TASK_PRIORITY);
+
+    for (int round = 0; round < READ_ROUNDS; round++) {
+        for (int i = 0; i < sizeof(read_frames) / sizeof(read_frames[0]); i++) {
+            size_t num = rtos_driver_stream_rx(&stream, buf, read_frames[i], pdMS_TO_TICKS(100));
+
+            if (num != read_frames[i]) {
+                local_printf("Read %d of %u frames in round %d timed out", i, read_frames[i], round);
+                return -1;
+            }
+
+            /* Blocks read before the client started are skipped */
+            if (first) {
+                expected = buf[0];
+                first = 0;
+            }
+            for (size_t j = 0; j < num * FRAME_WORDS; j++) {
+                if (buf[j] != expected++) {
+                    local_printf("Read %d in round %d has sample %d, expected %d", i, round, buf[j], expected - 1);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    rtos_driver_stream_stats_get(&stream, &stats);
+    if (stats.overrun_count != 0) {
+        local_printf("The host dropped %u blocks", stats.overrun_count);
+        return -1;
+    }
+    local_printf("Received %u blocks, at most %u waiting", stats.block_count, stats.max_fill);
+
+    return 0;
+}
+
+#endif /* ON_TILE(STREAM_CLIENT_TILE) */
+
+INTERTILE_MAIN_TEST_ATTR
+static int main_test(intertile_test_ctx_t *ctx)
+{
+    int ret = 0;
+
+    local_printf("Start");
+
+    #if ON_TILE(STREAM_HOST_TILE)
+    {
+        ret = host_run(ctx->intertile_ctx);
+    }
+    #endif
+
+    #if ON_TILE(STREAM_CLIENT_TILE)
+    {
+        ret = client_run(ctx->intertile_ctx);
+    }
+    #endif
+
+    if (ret == 0) {
+        local_printf("Done");
+    }
+    return ret;
+}
+
+void register_driver_stream_test(intertile_test_ctx_t *test_ctx)
+{
+    uint32_t this_test_num = test_ctx->test_cnt;
+
+    local_printf("Register to test num %d", this_test_num);
+
+    test_ctx->name[this_test_num] = (char*)test_name;
+    test_ctx->main_test[this_test_num] = main_test;
+
+    test_ctx->test_cnt++;
+}
+
+#undef local_printf
@@ -0,0 +1,239 @@
+// Copyright 2021 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/* System headers */
+#include <platform.h>
+#include <xs1.h>
+#include <xcore/hwtimer.h>
+
+/* Library headers */
+#include "rtos/osal/api/rtos_osal.h"
+#include "rtos/drivers/intertile/api/rtos_intertile.h"
+
+/* App headers */
+#include "app_conf.h"
+#include "individual_tests/intertile/intertile_test.h"
+
+static const char* test_name = "lanes_bench_test";
+
+#define local_printf( FMT, ... )    intertile_printf("%s|" FMT, test_name, ##__VA_ARGS__)
+
+#define INTERTILE_TX_TILE 0
+#define INTERTILE_RX_TILE 1
+
+#define BENCH_BULK_LEN      (8 * 1024)
+#define BENCH_BULK_ITERS    8
+#define BENCH_PING_LEN      4
+#define BENCH_PING_ITERS    50
+
+typedef struct {
+    const char *name;
+    int bulk_lane;
+    uint32_t bulk_flags;
+    uint32_t ping_flags;
+} bench_config_t;
+
+/*
+ * The first configuration is the old single lane behaviour, where each ping
+ * may wait for a whole bulk message to be sent ahead of it.
+ */
+static const bench_config_t bench_configs[] = {
+    {"unfragmented", 0, 0, 0},
+    {"fragmented", 0, RTOS_INTERTILE_PORT_FRAGMENT, RTOS_INTERTILE_PORT_PRIORITY},
+#if INTERTILE_LANE_COUNT > 1
+    {"bulk lane", 1, RTOS_INTERTILE_PORT_FRAGMENT, RTOS_INTERTILE_PORT_PRIORITY},
+#endif
+};
+
+#define BENCH_CONFIG_COUNT (sizeof(bench_configs) / sizeof(bench_configs[0]))
+
+static uint8_t bulk_buf[BENCH_BULK_LEN];
+
+typedef struct {
+    rtos_intertile_t *intertile_ctx;
+    rtos_osal_semaphore_t done;
+    uint32_t ticks;
+    int errors;
+} bulk_thread_args_t;
+
+#if ON_TILE(INTERTILE_TX_TILE)
+
+static void bulk_tx_thread(void *arg)
+{
+    bulk_thread_args_t *args = arg;
+    uint32_t start = get_reference_time();
+
+    for (int i = 0; i < BENCH_BULK_ITERS; i++) {
+        bulk_buf[0] = i;
+        rtos_intertile_tx(args->intertile_ctx, INTERTILE_BENCH_BULK_PORT,
+                          bulk_buf, BENCH_BULK_LEN);
+    }
+
+    args->ticks = get_reference_time() - start;
+    rtos_osal_semaphore_put(&args->done);
+    rtos_osal_thread_delete(NULL);
+}
+
+static int ping_run(rtos_intertile_t *intertile_ctx, uint32_t *avg_ticks, uint32_t *max_ticks)
+{
+    uint32_t ping = 0;
+    uint32_t *pong;
+    uint32_t start;
+    uint32_t ticks;
+    uint32_t total = 0;
+    size_t len;
+    int ret = 0;
+
+    *max_ticks = 0;
+
+    for (int i = 0; i < BENCH_PING_ITERS; i++) {
+        ping = i;
+        start = get_reference_time();
+        rtos_intertile_tx(intertile_ctx, INTERTILE_BENCH_PING_PORT, &ping, BENCH_PING_LEN);
+        len = rtos_intertile_rx(intertile_ctx, INTERTILE_BENCH_PING_PORT, (void **) &pong, RTOS_OSAL_WAIT_FOREVER);
+        ticks = get_reference_time() - start;
+
+        /* Keep going on failure so that the other tile is not left waiting */
+        if (len != BENCH_PING_LEN || *pong != ping) {
+            local_printf("Ping %d failed", i);
+            ret = -1;
+        }
+        rtos_osal_free(pong);
+
+        total += ticks;
+        if (ticks > *max_ticks) {
+            *max_ticks = ticks;
+        }
+    }
+
+    *avg_ticks = total / BENCH_PING_ITERS;
+    return ret;
+}
+
+#endif /* ON_TILE(INTERTILE_TX_TILE) */
+
+#if ON_TILE(INTERTILE_RX_TILE)
+
+static void bulk_rx_thread(void *arg)
+{
+    bulk_thread_args_t *args = arg;
+    uint8_t *rx_buf;
+    size_t len;
+
+    args->errors = 0;
+
+    for (int i = 0; i < BENCH_BULK_ITERS; i++) {
+        len = rtos_intertile_rx(args->intertile_ctx, INTERTILE_BENCH_BULK_PORT,
+                                (void **) &rx_buf, RTOS_OSAL_WAIT_FOREVER);
+        if (len != BENCH_BULK_LEN || rx_buf[0] != (uint8_t) i) {
+            args->errors++;
+        } else {
+            for (int j = 1; j < BENCH_BULK_LEN; j++) {
+                if (rx_buf[j] != bulk_buf[j]) {
+                    args->errors++;
+                    break;
+                }
+            }
+        }
+        rtos_osal_free(rx_buf);
+    }
+
+    rtos_osal_semaphore_put(&args->done);
+    rtos_osal_thread_delete(NULL);
+}
+
+static void pong_run(rtos_intertile_t *intertile_ctx)
+{
+    uint8_t *ping;
+    size_t len;
+
+    for (int i = 0; i < BENCH_PING_ITERS; i++) {
+        len = rtos_intertile_rx(intertile_ctx, INTERTILE_BENCH_PING_PORT, (void **) &ping, RTOS_OSAL_WAIT_FOREVER);
+        rtos_intertile_tx(intertile_ctx, INTERTILE_BENCH_PING_PORT, ping, len);
+        rtos_osal_free(ping);
+    }
+}
+
+#endif /* ON_TILE(INTERTILE_RX_TILE) */
+
+INTERTILE_MAIN_TEST_ATTR
+static int main_test(intertile_test_ctx_t *ctx)
+{
+    static bulk_thread_args_t args;
+    int ret = 0;
+
+    local_printf("Start");
+
+    for (int i = 1; i < BENCH_BULK_LEN; i++) {
+        bulk_buf[i] = (uint8_t) (i * 7);
+    }
+
+    args.intertile_ctx = ctx->intertile_ctx;
+    rtos_osal_semaphore_create(&args.done, "bench_done", 1, 0);
+
+    for (int i = 0; i < BENCH_CONFIG_COUNT; i++) {
+        const bench_config_t *config = &bench_configs[i];
+
+        rtos_intertile_port_config(ctx->intertile_ctx, INTERTILE_BENCH_BULK_PORT,
+                                   config->bulk_lane, config->bulk_flags);
+        rtos_intertile_port_config(ctx->intertile_ctx, INTERTILE_BENCH_PING_PORT,
+                                   0, config->ping_flags);
+
+        #if ON_TILE(INTERTILE_TX_TILE)
+        {
+            uint32_t avg_ticks;
+            uint32_t max_ticks;
+
+            rtos_osal_thread_create(NULL, "bulk_tx", bulk_tx_thread, &args,
+                                    RTOS_THREAD_STACK_SIZE(bulk_tx_thread), INTERTILE_BENCH_TASK_PRIORITY);
+
+            if (ping_run(ctx->intertile_ctx, &avg_ticks, &max_ticks) != 0) {
+                ret = -1;
+            }
+            rtos_osal_semaphore_get(&args.done, RTOS_OSAL_WAIT_FOREVER);
+
+            local_printf("%s: bulk %u bytes in %u ticks, ping average %u ticks, max %u ticks",
+                         config->name, BENCH_BULK_LEN * BENCH_BULK_ITERS, args.ticks,
+                         avg_ticks, max_ticks);
+        }
+        #endif
+
+        #if ON_TILE(INTERTILE_RX_TILE)
+        {
+            rtos_osal_thread_create(NULL, "bulk_rx", bulk_rx_thread, &args,
+                                    RTOS_THREAD_STACK_SIZE(bulk_rx_thread), INTERTILE_BENCH_TASK_PRIORITY);
+
+            pong_run(ctx->intertile_ctx);
+            rtos_osal_semaphore_get(&args.done, RTOS_OSAL_WAIT_FOREVER);
+
+            if (args.errors != 0) {
+                local_printf("%s: %d bulk messages were corrupted", config->name, args.errors);
+                ret = -1;
+            }
+        }
+        #endif
+    }
+
+    rtos_intertile_port_config(ctx->intertile_ctx, INTERTILE_BENCH_BULK_PORT, 0, 0);
+    rtos_intertile_port_config(ctx->intertile_ctx, INTERTILE_BENCH_PING_PORT, 0, 0);
+    rtos_osal_semaphore_delete(&args.done);
+
+    if (ret == 0) {
+        local_printf("Done");
+    }
+    return ret;
+}
+
+void register_lanes_bench_test(intertile_test_ctx_t *test_ctx)
+{
+    uint32_t this_test_num = test_ctx->test_cnt;
+
+    local_printf("Register to test num %d", this_test_num);
+
+    test_ctx->name[this_test_num] = (char*)test_name;
+    test_ctx->main_test[this_test_num] = main_test;
+
+    test_ctx->test_cnt++;
+}
+
+#undef local_printf
@@ -0,0 +1,258 @@
+// Copyright 2021 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/* System headers */
+#include <platform.h>
+#include <xs1.h>
+#include <xcore/hwtimer.h>
+
+/* Library headers */
+#include "rtos/osal/api/rtos_osal.h"
+#include "rtos/drivers/intertile/api/rtos_intertile.h"
+#include "rtos/drivers/rpc/api/rtos_rpc.h"
+
+/* App headers */
+#include "app_conf.h"
+#include "individual_tests/intertile/intertile_test.h"
+
+static const char* test_name = "rpc_call_test";
+
+#define local_printf( FMT, ... )    intertile_printf("%s|" FMT, test_name, ##__VA_ARGS__)
+
+#define RPC_CLIENT_TILE 0
+#define RPC_HOST_TILE   1
+
+#define RPC_TEST_BUF_LEN      512
+#define RPC_TEST_BENCH_ITERS  100
+
+enum {
+    fcode_small,
+    fcode_large,
+    fcode_stop,
+};
+
+#if ON_TILE(RPC_HOST_TILE)
+
+static void host_small(rpc_msg_t *rpc_msg, rtos_intertile_t *intertile_ctx)
+{
+    int32_t a;
+    int32_t b;
+    int32_t ret;
+
+    rpc_request_unmarshall(
+            rpc_msg,
+            &a, &b, &ret);
+
+    ret = a + b;
+
+    rpc_response_send(
+            intertile_ctx, INTERTILE_RPC_PORT, rpc_msg,
+            a, b, ret);
+}
+
+static void host_large(rpc_msg_t *rpc_msg, rtos_intertile_t *intertile_ctx)
+{
+    static uint8_t out_buf[RPC_TEST_BUF_LEN];
+    uint8_t *in_buf;
+    uint8_t *inout_buf;
+    uint8_t *unused;
+    int32_t ret;
+
+    rpc_request_unmarshall(
+            rpc_msg,
+            &in_buf, &inout_buf, &unused, &ret);
+
+    ret = 0;
+    for (int i = 0; i < RPC_TEST_BUF_LEN; i++) {
+        out_buf[i] = in_buf[i] ^ 0xFF;
+        inout_buf[i] += 1;
+        ret += in_buf[i];
+    }
+
+    rpc_response_send(
+            intertile_ctx, INTERTILE_RPC_PORT, rpc_msg,
+            in_buf, inout_buf, out_buf, ret);
+}
+
+static int host_run(rtos_intertile_t *intertile_ctx)
+{
+    uint8_t *req_msg;
+    rpc_msg_t rpc_msg;
+
+    for (;;) {
+        rtos_intertile_rx(intertile_ctx, INTERTILE_RPC_PORT, (void **) &req_msg, RTOS_OSAL_WAIT_FOREVER);
+        rpc_request_parse(&rpc_msg, req_msg);
+
+        switch (rpc_msg.fcode) {
+        case fcode_small:
+            host_small(&rpc_msg, intertile_ctx);
+            break;
+        case fcode_large:
+            host_large(&rpc_msg, intertile_ctx);
+            break;
+        case fcode_stop:
+            rpc_response_send(intertile_ctx, INTERTILE_RPC_PORT, &rpc_msg);
+            rtos_osal_free(req_msg);
+            return 0;
+        default:
+            local_printf("Unexpected fcode %d", rpc_msg.fcode);
+            rtos_osal_free(req_msg);
+            return -1;
+        }
+
+        rtos_osal_free(req_msg);
+    }
+}
+
+#endif /* ON_TILE(RPC_HOST_TILE) */
+
+#if ON_TILE(RPC_CLIENT_TILE)
+
+static int32_t client_small(rtos_intertile_t *intertile_ctx, int32_t a, int32_t b)
+{
+    int32_t ret;
+
+    const rpc_param_desc_t rpc_param_desc[] = {
+            RPC_PARAM_TYPE(a),
+            RPC_PARAM_TYPE(b),
+            RPC_PARAM_RETURN(int32_t),
+            RPC_PARAM_LIST_END
+    };
+
+    rpc_client_call_generic(
+            intertile_ctx, INTERTILE_RPC_PORT, fcode_small, rpc_param_desc,
+            &a, &b, &ret);
+
+    return ret;
+}
+
+static int32_t client_large(rtos_intertile_t *intertile_ctx, const uint8_t *in_buf, uint8_t *inout_buf, uint8_t *out_buf)
+{
+    int32_t ret;
+
+    const rpc_param_desc_t rpc_param_desc[] = {
+            RPC_PARAM_IN_BUFFER(in_buf, RPC_TEST_BUF_LEN),
+            RPC_PARAM_INOUT_BUFFER(inout_buf, RPC_TEST_BUF_LEN),
+            RPC_PARAM_OUT_BUFFER(out_buf, RPC_TEST_BUF_LEN),
+            RPC_PARAM_RETURN(int32_t),
+            RPC_PARAM_LIST_END
+    };
+
+    rpc_client_call_generic(
+            intertile_ctx, INTERTILE_RPC_PORT, fcode_large, rpc_param_desc,
+            in_buf, inout_buf, out_buf, &ret);
+
+    return ret;
+}
+
+static int client_run(rtos_intertile_t *intertile_ctx)
+{
+    static uint8_t in_buf[RPC_TEST_BUF_LEN];
+    static uint8_t inout_buf[RPC_TEST_BUF_LEN];
+    static uint8_t out_buf[RPC_TEST_BUF_LEN];
+    int32_t expected = 0;
+    int32_t ret;
+    uint32_t start;
+    uint32_t small_ticks;
+    uint32_t large_ticks;
+    size_t free_heap;
+
+    const rpc_param_desc_t stop_param_desc[] = {
+            RPC_PARAM_LIST_END
+    };
+
+    for (int i = 0; i < RPC_TEST_BUF_LEN; i++) {
+        in_buf[i] = i;
+        inout_buf[i] = 2 * i;
+        expected += in_buf[i];
+    }
+
+    /* Check that each kind of parameter makes the round trip */
+    ret = client_small(intertile_ctx, 1234, -34);
+    if (ret != 1200) {
+        local_printf("Small call failed.  Got %d expected %d", ret, 1200);
+        return -1;
+    }
+
+    ret = client_large(intertile_ctx, in_buf, inout_buf, out_buf);
+    if (ret != expected) {
+        local_printf("Large call failed.  Got %d expected %d", ret, expected);
+        return -1;
+    }
+    for (int i = 0; i < RPC_TEST_BUF_LEN; i++) {
+        if (out_buf[i] != (uint8_t) (in_buf[i] ^ 0xFF) || inout_buf[i] != (uint8_t) (2 * i + 1)) {
+            local_printf("Large call failed at index %d", i);
+            return -1;
+        }
+    }
+
+    /* The client side must not touch the heap */
+    free_heap = xPortGetFreeHeapSize();
+
+    /* Per call latency */
+    start = get_reference_time();
+    for (int i = 0; i < RPC_TEST_BENCH_ITERS; i++) {
+        client_small(intertile_ctx, i, i);
+    }
+    small_ticks = (get_reference_time() - start) / RPC_TEST_BENCH_ITERS;
+
+    start = get_reference_time();
+    for (int i = 0; i < RPC_TEST_BENCH_ITERS; i++) {
+        client_large(intertile_ctx, in_buf, inout_buf, out_buf);
+    }
+    large_ticks = (get_reference_time() - start) / RPC_TEST_BENCH_ITERS;
+
+    if (xPortGetFreeHeapSize() != free_heap) {
+        local_printf("Client heap changed from %u to %u bytes", free_heap, xPortGetFreeHeapSize());
+        return -1;
+    }
+
+    local_printf("Small call latency %u ticks", small_ticks);
+    local_printf("Large call latency %u ticks for %u bytes each way", large_ticks, RPC_TEST_BUF_LEN);
+
+    rpc_client_call_generic(
+            intertile_ctx, INTERTILE_RPC_PORT, fcode_stop, stop_param_desc);
+
+    return 0;
+}
+
+#endif /* ON_TILE(RPC_CLIENT_TILE) */
+
+INTERTILE_MAIN_TEST_ATTR
+static int main_test(intertile_test_ctx_t *ctx)
+{
+    int ret = 0;
+
+    local_printf("Start");
+
+    #if ON_TILE(RPC_HOST_TILE)
+    {
+        ret = host_run(ctx->intertile_ctx);
+    }
+    #endif
+
+    #if ON_TILE(RPC_CLIENT_TILE)
+    {
+        ret = client_run(ctx->intertile_ctx);
+    }
+    #endif
+
+    if (ret == 0) {
+        local_printf("Done");
+    }
+    return ret;
+}
+
+void register_rpc_call_test(intertile_test_ctx_t *test_ctx)
+{
+    uint32_t this_test_num = test_ctx->test_cnt;
+
+    local_printf("Register to test num %d", this_test_num);
+
+    test_ctx->name[this_test_num] = (char*)test_name;
+    test_ctx->main_test[this_test_num] = main_test;
+
+    test_ctx->test_cnt++;
+}
+
+#undef local_printf
@@ -0,0 +1,212 @@
+// Copyright 2021 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/* System headers */
+#include <platform.h>
+#include <xs1.h>
+
+/* Library headers */
+#include "rtos/osal/api/rtos_osal.h"
+#include "rtos/drivers/intertile/api/rtos_intertile.h"
+
+/* App headers */
+#include "app_conf.h"
+#include "individual_tests/intertile/intertile_test.h"
+
+static const char* test_name = "rx_pool_test";
+
+#define local_printf( FMT, ... )    intertile_printf("%s|" FMT, test_name, ##__VA_ARGS__)
+
+#define INTERTILE_TX_TILE 0
+#define INTERTILE_RX_TILE 1
+
+#define POOL_BUFFER_SIZE    128
+#define POOL_BUFFER_COUNT   2
+
+#define SMALL_MSG_LEN       64
+#define SMALL_MSG_COUNT     4
+#define OVERSIZE_MSG_LEN    200
+#define TRUNCATED_MSG_LEN   100
+#define TRUNCATED_BUF_LEN   50
+
+static uint8_t test_msg[OVERSIZE_MSG_LEN];
+
+#if ON_TILE(INTERTILE_RX_TILE)
+
+static int msg_check(const uint8_t *buf, size_t len, uint8_t tag)
+{
+    if (buf[0] != tag) {
+        return -1;
+    }
+    for (size_t i = 1; i < len; i++) {
+        if (buf[i] != test_msg[i]) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int stats_check(rtos_intertile_t *intertile_ctx, unsigned rx_count,
+                       unsigned in_use, unsigned max_in_use, unsigned drop_count,
+                       unsigned oversize_count)
+{
+    rtos_intertile_rx_pool_stats_t stats;
+
+    rtos_intertile_rx_pool_stats_get(intertile_ctx, INTERTILE_RPC_PORT, &stats);
+
+    if (stats.rx_count != rx_count || stats.in_use != in_use ||
+        stats.max_in_use != max_in_use || stats.drop_count != drop_count ||
+        stats.oversize_count != oversize_count) {
+        local_printf("Unexpected pool stats: %u received, %u in use, %u max in use, %u dropped, %u oversize",
+                     stats.rx_count, stats.in_use, stats.max_in_use, stats.drop_count,
+                     stats.oversize_count);
+        return -1;
+    }
+    return 0;
+}
+
+static int rx_run(rtos_intertile_t *intertile_ctx)
+{
+    static rtos_intertile_rx_pool_t pool;
+    static uint8_t pool_buffers[POOL_BUFFER_COUNT][POOL_BUFFER_SIZE];
+    uint8_t *msg[SMALL_MSG_COUNT];
+    uint8_t truncated_buf[TRUNCATED_BUF_LEN];
+    size_t len;
+    int ret = 0;
+
+    rtos_intertile_rx_pool_init(intertile_ctx, INTERTILE_RPC_PORT, &pool,
+                                pool_buffers, POOL_BUFFER_SIZE, POOL_BUFFER_COUNT);
+
+    /* Hold every buffer in the pool at once */
+    for (int i = 0; i < POOL_BUFFER_COUNT; i++) {
+        len = rtos_intertile_rx(intertile_ctx, INTERTILE_RPC_PORT, (void **) &msg[i], RTOS_OSAL_WAIT_FOREVER);
+        if (len != SMALL_MSG_LEN || msg_check(msg[i], len, i) != 0 ||
+            (msg[i] != pool_buffers[0] && msg[i] != pool_buffers[1])) {
+            local_printf("Pooled message %d failed", i);
+            ret = -1;
+        }
+    }
+    if (stats_check(intertile_ctx, 2, 2, 2, 0, 0) != 0) {
+        ret = -1;
+    }
+
+    /* With every buffer held the next message is dropped */
+    len = rtos_intertile_rx(intertile_ctx, INTERTILE_RPC_PORT, (void **) &msg[2], RTOS_OSAL_WAIT_FOREVER);
+    if (len != RTOS_INTERTILE_RX_DROPPED || msg[2] != NULL) {
+        local_printf("Message to a full pool was not dropped");
+        ret = -1;
+    }
+    if (stats_check(intertile_ctx, 2, 2, 2, 1, 0) != 0) {
+        ret = -1;
+    }
+
+    for (int i = 0; i < POOL_BUFFER_COUNT; i++) {
+        rtos_intertile_rx_release(intertile_ctx, INTERTILE_RPC_PORT, msg[i]);
+    }
+
+    len = rtos_intertile_rx(intertile_ctx, INTERTILE_RPC_PORT, (void **) &msg[2], RTOS_OSAL_WAIT_FOREVER);
+    if (len != SMALL_MSG_LEN || msg_check(msg[2], len, 3) != 0) {
+        local_printf("Reused pool buffer failed");
+        ret = -1;
+    }
+    rtos_intertile_rx_release(intertile_ctx, INTERTILE_RPC_PORT, msg[2]);
+
+    /* Too large for the pool, so it comes from the heap */
+    len = rtos_intertile_rx(intertile_ctx, INTERTILE_RPC_PORT, (void **) &msg[0], RTOS_OSAL_WAIT_FOREVER);
+    if (len != OVERSIZE_MSG_LEN || msg_check(msg[0], len, 4) != 0) {
+        local_printf("Oversize message failed");
+        ret = -1;
+    }
+    rtos_intertile_rx_release(intertile_ctx, INTERTILE_RPC_PORT, msg[0]);
+
+    if (stats_check(intertile_ctx, 3, 0, 2, 1, 1) != 0) {
+        ret = -1;
+    }
+
+    rtos_intertile_rx_pool_deinit(intertile_ctx, INTERTILE_RPC_PORT);
+
+    /* The caller's buffer is filled and the rest of the message dropped */
+    len = rtos_intertile_rx_buf(intertile_ctx, INTERTILE_RPC_PORT, truncated_buf,
+                                sizeof(truncated_buf), RTOS_OSAL_WAIT_FOREVER);
+    if (len != TRUNCATED_MSG_LEN || msg_check(truncated_buf, sizeof(truncated_buf), 5) != 0) {
+        local_printf("Truncated receive failed.  Got %u expected %u", len, TRUNCATED_MSG_LEN);
+        ret = -1;
+    }
+
+    /* The link must still be in step after the truncated message */
+    len = rtos_intertile_rx_buf(intertile_ctx, INTERTILE_RPC_PORT, truncated_buf,
+                                sizeof(truncated_buf), RTOS_OSAL_WAIT_FOREVER);
+    if (len != SMALL_MSG_LEN - 32 || msg_check(truncated_buf, len, 6) != 0) {
+        local_printf("Receive after truncation failed");
+        ret = -1;
+    }
+
+    return ret;
+}
+
+#endif /* ON_TILE(INTERTILE_RX_TILE) */
+
+#if ON_TILE(INTERTILE_TX_TILE)
+
+static void tx_msg(rtos_intertile_t *intertile_ctx, uint8_t tag, size_t len)
+{
+    test_msg[0] = tag;
+    rtos_intertile_tx(intertile_ctx, INTERTILE_RPC_PORT, test_msg, len);
+}
+
+static int tx_run(rtos_intertile_t *intertile_ctx)
+{
+    for (int i = 0; i < SMALL_MSG_COUNT; i++) {
+        tx_msg(intertile_ctx, i, SMALL_MSG_LEN);
+    }
+    tx_msg(intertile_ctx, SMALL_MSG_COUNT, OVERSIZE_MSG_LEN);
+    tx_msg(intertile_ctx, SMALL_MSG_COUNT + 1, TRUNCATED_MSG_LEN);
+    tx_msg(intertile_ctx, SMALL_MSG_COUNT + 2, SMALL_MSG_LEN - 32);
+
+    return 0;
+}
+
+#endif /* ON_TILE(INTERTILE_TX_TILE) */
+
+INTERTILE_MAIN_TEST_ATTR
+static int main_test(intertile_test_ctx_t *ctx)
+{
+    int ret = 0;
+
+    local_printf("Start");
+
+    for (int i = 1; i < OVERSIZE_MSG_LEN; i++) {
+        test_msg[i] = i ^ 0x5A;
+    }
+
+    #if ON_TILE(INTERTILE_TX_TILE)
+    {
+        ret = tx_run(ctx->intertile_ctx);
+    }
+    #endif
+
+    #if ON_TILE(INTERTILE_RX_TILE)
+    {
+        ret = rx_run(ctx->intertile_ctx);
+    }
+    #endif
+
+    if (ret == 0) {
+        local_printf("Done");
+    }
+    return ret;
+}
+
+void register_rx_pool_test(intertile_test_ctx_t *test_ctx)
+{
+    uint32_t this_test_num = test_ctx->test_cnt;
+
+    local_printf("Register to test num %d", this_test_num);
+
+    test_ctx->name[this_test_num] = (char*)test_name;
+    test_ctx->main_test[this_test_num] = main_test;
+
+    test_ctx->test_cnt++;
+}
+
+#undef local_printf
@@ -0,0 +1,109 @@
+// Copyright 2022 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/* System headers */
+#include <platform.h>
+#include <xs1.h>
+#include <string.h>
+#include <xcore/hwtimer.h>
+
+/* FreeRTOS headers */
+#include "FreeRTOS.h"
+
+/* Library headers */
+#include "rtos/drivers/mic_array/api/rtos_mic_array.h"
+
+/* App headers */
+#include "app_conf.h"
+#include "individual_tests/mic_array/mic_array_test.h"
+
+#ifndef LIBXCORE_HWTIMER_HAS_REFERENCE_TIME
+#error This test requires reference time
+#endif
+
+static const char* test_name = "acquire_samples_test";
+
+#define local_printf( FMT, ... )    mic_array_printf("%s|" FMT, test_name, ##__VA_ARGS__)
+
+#define MIC_ARRAY_TILE 1
+
+#define EXPECTED_DURATION       MIC_ARRAY_TEST_AUDIO_SAMPLE_RATE * 100 * MIC_ARRAY_TEST_ITERS
+#define EXPECTED_DURATION_MAX   (EXPECTED_DURATION * 1.01)
+#define EXPECTED_DURATION_MIN   (EXPECTED_DURATION * 0.99)
+
+#define BUFFER_FRAMES           (2 * MIC_DUAL_FRAME_SIZE)
+
+MIC_ARRAY_MAIN_TEST_ATTR
+static int main_test(mic_array_test_ctx_t *ctx)
+{
+    local_printf("Start");
+
+    #if ON_TILE(MIC_ARRAY_TILE)
+    {
+        int32_t (*frames)[MIC_DUAL_NUM_CHANNELS + MIC_DUAL_NUM_REF_CHANNELS];
+        rtos_mic_array_stats_t start_stats;
+        rtos_mic_array_stats_t end_stats;
+        size_t total = 0;
+        size_t num;
+        uint32_t start;
+        uint32_t duration;
+
+        /* Discard whatever arrived while the previous tests ran */
+        for (int i = 0; i < 2; i++)
+        {
+            num = rtos_mic_array_rx_acquire(ctx->mic_array_ctx, &frames, portMAX_DELAY);
+            rtos_mic_array_rx_release(ctx->mic_array_ctx, num);
+        }
+
+        rtos_mic_array_stats_get(ctx->mic_array_ctx, &start_stats);
+        start = get_reference_time();
+
+        while (total < MIC_ARRAY_FRAME_LEN * MIC_ARRAY_TEST_ITERS)
+        {
+            num = rtos_mic_array_rx_acquire(ctx->mic_array_ctx, &frames, portMAX_DELAY);
+
+            if (num == 0 || num > BUFFER_FRAMES)
+            {
+                local_printf("Failed.  acquired %u frames", num);
+                return -1;
+            }
+
+            total += num;
+            rtos_mic_array_rx_release(ctx->mic_array_ctx, num);
+        }
+
+        duration = get_reference_time() - start;
+        rtos_mic_array_stats_get(ctx->mic_array_ctx, &end_stats);
+
+        if ((duration > EXPECTED_DURATION_MAX) || (duration < EXPECTED_DURATION_MIN))
+        {
+            local_printf("Failed.  duration was %u", duration);
+            return -1;
+        }
+
+        if (end_stats.overrun_count != start_stats.overrun_count)
+        {
+            local_printf("Failed.  %u frames overran", end_stats.overrun_count - start_stats.overrun_count);
+            return -1;
+        }
+        local_printf("Duration was %u", duration);
+    }
+    #endif
+
+    local_printf("Done");
+    return 0;
+}
+
+void register_acquire_samples_test(mic_array_test_ctx_t *test_ctx)
+{
+    uint32_t this_test_num = test_ctx->test_cnt;
+
+    local_printf("Register to test num %d", this_test_num);
+
+    test_ctx->name[this_test_num] = (char*)test_name;
+    test_ctx->main_test[this_test_num] = main_test;
+
+    test_ctx->test_cnt++;
+}
+
+#undef local_printf
@@ -65,6 +65,7 @@ static void start_mic_array_devices(mic_array_test_ctx_t *test_ctx)
 static void register_mic_array_tests(mic_array_test_ctx_t *test_ctx)
 {
     register_get_samples_test(test_ctx);
+    register_acquire_samples_test(test_ctx);
 
     register_rpc_get_samples_test(test_ctx);
 }
@@ -8,7 +8,7 @@
 
 #define mic_array_printf( FMT, ... )       module_printf("MIC_ARRAY", FMT, ##__VA_ARGS__)
 
-#define MIC_ARRAY_MAX_TESTS   2
+#define MIC_ARRAY_MAX_TESTS   3
 
 #define MIC_ARRAY_MAIN_TEST_ATTR __attribute__((fptrgroup("rtos_test_mic_array_main_test_fptr_grp")))
 
@@ -31,6 +31,7 @@ int mic_array_device_tests(rtos_mic_array_t *mic_array_ctx, chanend_t c);
 
 /* Local Tests */
 void register_get_samples_test(mic_array_test_ctx_t *test_ctx);
+void register_acquire_samples_test(mic_array_test_ctx_t *test_ctx);
 
 /* RPC Tests */
 void register_rpc_get_samples_test(mic_array_test_ctx_t *test_ctx);
@@ -0,0 +1,179 @@
+// Copyright 2021 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+/* System headers */
+#include <platform.h>
+#include <xs1.h>
+#include <string.h>
+
+/* Library headers */
+#include "rtos/osal/api/rtos_osal.h"
+#include "rtos/drivers/qspi_flash/api/rtos_qspi_flash.h"
+
+/* App headers */
+#include "app_conf.h"
+#include "individual_tests/qspi_flash/qspi_flash_test.h"
+
+static const char* test_name = "async_read_test";
+
+#define local_printf( FMT, ... )    qspi_flash_printf("%s|" FMT, test_name, ##__VA_ARGS__)
+
+#define QSPI_FLASH_TILE         0
+#define QSPI_FLASH_TEST_ADDR    0
+
+#define ASYNC_REQ_COUNT         4
+
+#if ON_TILE(QSPI_FLASH_TILE)
+
+static volatile int callback_count;
+
+__attribute__((fptrgroup("rtos_qspi_flash_read_cb_fptr_grp")))
+static void read_done(rtos_qspi_flash_read_req_t *req, void *arg)
+{
+    int *order = arg;
+
+    *order = callback_count++;
+}
+
+static int buf_check(const uint8_t *buf, size_t len)
+{
+    for (int i = 0; i < len; i++) {
+        if (buf[i] != (uint8_t) (i * 3)) {
+            local_printf("Failed. buf[%d]: Expected 0x%x got 0x%x", i, (uint8_t) (i * 3), buf[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Queues the requests, in reverse when reverse is set so that none
+ * of them can be coalesced, and waits for the last one.
+ */
+static int async_read(rtos_qspi_flash_t *ctx, uint8_t *buf, size_t len, int reverse)
+{
+    rtos_qspi_flash_read_req_t req[ASYNC_REQ_COUNT];
+    int order[ASYNC_REQ_COUNT];
+    rtos_osal_semaphore_t done;
+    size_t req_len = len / ASYNC_REQ_COUNT;
+
+    rtos_osal_semaphore_create(&done, "async_done", ASYNC_REQ_COUNT, 0);
+    memset(buf, 0, len);
+    callback_count = 0;
+
+    for (int i = 0; i < ASYNC_REQ_COUNT; i++) {
+        int j = reverse ? ASYNC_REQ_COUNT - 1 - i : i;
+
+        req[j].data = &buf[j * req_len];
+        req[j].address = QSPI_FLASH_TEST_ADDR + j * req_len;
+        req[j].len = req_len;
+        req[j].callback = read_done;
+        req[j].callback_arg = &order[j];
+        req[j].done = &done;
+        rtos_qspi_flash_read_async(ctx, &req[j]);
+    }
+
+    for (int i = 0; i < ASYNC_REQ_COUNT; i++) {
+        rtos_osal_semaphore_get(&done, RTOS_OSAL_WAIT_FOREVER);
+    }
+    rtos_osal_semaphore_delete(&done);
+
+    /* Requests must complete in the order they were queued */
+    for (int i = 0; i < ASYNC_REQ_COUNT; i++) {
+        int j = reverse ? ASYNC_REQ_COUNT - 1 - i : i;
+        if (order[j] != i) {
+            local_printf("Request %d completed out of order", j);
+            return -1;
+        }
+    }
+
+    return buf_check(buf, len);
+}
+#endif
+
+QSPI_FLASH_MAIN_TEST_ATTR
+static int main_test(qspi_flash_test_ctx_t *ctx)
+{
+    local_printf("Start");
+
+    #if ON_TILE(QSPI_FLASH_TILE)
+    {
+        size_t sector_size = rtos_qspi_flash_sector_size_get(ctx->qspi_flash_ctx);
+        unsigned requests_before;
+        unsigned transactions_before;
+        unsigned requests;
+        unsigned transactions;
+        uint8_t *buf;
+
+        buf = rtos_osal_malloc(sector_size);
+        if (buf == NULL) {
+            local_printf("Malloc Failed");
+            return -1;
+        }
+
+        for (int i = 0; i < sector_size; i++) {
+            buf[i] = i * 3;
+        }
+        rtos_qspi_flash_erase(ctx->qspi_flash_ctx, QSPI_FLASH_TEST_ADDR, sector_size);
+        rtos_qspi_flash_write(ctx->qspi_flash_ctx, buf, QSPI_FLASH_TEST_ADDR, sector_size);
+
+        rtos_qspi_flash_read_stats_get(ctx->qspi_flash_ctx, &requests_before, &transactions_before);
+
+        /*
+         * The write is performed by the driver's thread, so the reads are
+         * queued behind it and the adjacent ones must be coalesced.
+         */
+        local_printf("Adjacent requests");
+        if (async_read(ctx->qspi_flash_ctx, buf, sector_size, 0) != 0) {
+            rtos_osal_free(buf);
+            return -1;
+        }
+
+        rtos_qspi_flash_read_stats_get(ctx->qspi_flash_ctx, &requests, &transactions);
+        requests -= requests_before;
+        transactions -= transactions_before;
+        local_printf("%u requests in %u transactions", requests, transactions);
+        if (requests != ASYNC_REQ_COUNT || transactions >= requests) {
+            local_printf("Failed. Adjacent requests were not coalesced");
+            rtos_osal_free(buf);
+            return -1;
+        }
+
+        rtos_qspi_flash_read_stats_get(ctx->qspi_flash_ctx, &requests_before, &transactions_before);
+
+        local_printf("Reversed requests");
+        if (async_read(ctx->qspi_flash_ctx, buf, sector_size, 1) != 0) {
+            rtos_osal_free(buf);
+            return -1;
+        }
+
+        rtos_qspi_flash_read_stats_get(ctx->qspi_flash_ctx, &requests, &transactions);
+        requests -= requests_before;
+        transactions -= transactions_before;
+        if (requests != ASYNC_REQ_COUNT || transactions != requests) {
+            local_printf("Failed. %u reversed requests were read in %u transactions", requests, transactions);
+            rtos_osal_free(buf);
+            return -1;
+        }
+
+        rtos_osal_free(buf);
+    }
+    #endif
+
+    local_printf("Done");
+    return 0;
+}
+
+void register_async_read_test(qspi_flash_test_ctx_t *test_ctx)
+{
+    uint32_t this_test_num = test_ctx->test_cnt;
+
+    local_printf("Register to test num %d", this_test_num);
+
+    test_ctx->name[this_test_num] = (char*)test_name;
+    test_ctx->main_test[this_test_num] = main_test;
+
+    test_ctx->test_cnt++;
+}
+
+#undef local_printf
@@ -56,6 +56,7 @@ static void register_qspi_flash_tests(qspi_flash_test_ctx_t *test_ctx)
     register_check_params_test(test_ctx);
 
     register_read_write_read_test(test_ctx);
+    register_async_read_test(test_ctx);
 
     register_rpc_read_write_read_test(test_ctx);
 
@@ -0,0 +1,373 @@
+# Copyright 2022 XMOS LIMITED.
+# This Software is subject to the terms of the XMOS Public Licence: Version 1.
+import argparse
+import json
+import struct
+import sys
+
+# Decodes a trace recorded with xcoretraceconfigBINARY enabled. The records
+# are streamed through once, so long captures do not need to fit in memory.
+#
+# example run
+# python trace_freertos_binary.py tracefile.vcd -json=trace.json
+#
+# The JSON file can be opened in chrome://tracing or https://ui.perfetto.dev
+
+BATCH_MAGIC = 0xB17E
+VERSION = 1
+
+HEADER = struct.Struct("<HBBHH")
+RECORD = struct.Struct("<IBBHII")
+
+EVENT_TASK_CREATE = 1
+EVENT_TASK_NAME = 2
+EVENT_TASK_DELETE = 3
+EVENT_TASK_SWITCHED_IN = 4
+EVENT_TASK_SWITCHED_OUT = 5
+EVENT_ISR_ENTER = 6
+EVENT_ISR_EXIT = 7
+EVENT_QUEUE_CREATE = 8
+EVENT_QUEUE_SEND = 9
+EVENT_QUEUE_SEND_FAILED = 10
+EVENT_QUEUE_RECEIVE = 11
+EVENT_QUEUE_RECEIVE_FAILED = 12
+EVENT_QUEUE_BLOCK_SEND = 13
+EVENT_QUEUE_BLOCK_RECEIVE = 14
+EVENT_JOB_START = 15
+EVENT_JOB_END = 16
+EVENT_DROPPED = 17
+
+QUEUE_EVENT_NAMES = {
+    EVENT_QUEUE_SEND: "queue send",
+    EVENT_QUEUE_SEND_FAILED: "queue send failed",
+    EVENT_QUEUE_RECEIVE: "queue receive",
+    EVENT_QUEUE_RECEIVE_FAILED: "queue receive failed",
+    EVENT_QUEUE_BLOCK_SEND: "queue block on send",
+    EVENT_QUEUE_BLOCK_RECEIVE: "queue block on receive",
+}
+
+# ucQueueType values from queue.h
+QUEUE_TYPE_NAMES = ["queue", "mutex", "counting semaphore", "binary semaphore", "recursive mutex", "queue set"]
+
+
+def parse_arguments():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("trace_file", help="Input trace file")
+    parser.add_argument("-format", choices=["vcd", "raw"], default=None,
+                        help="Input format. Files ending in .vcd are read as VCD by default, others as raw batches")
+    parser.add_argument("-json", default=None, help="Chrome/Perfetto JSON output file")
+    parser.add_argument("-symbols", default=None,
+                        help="Symbol table used to name ISRs and jobs, as printed by nm or xobjdump -t")
+    parser.add_argument("-tick_rate", type=float, default=100e6, help="Reference clock rate in Hz")
+
+    args = parser.parse_args()
+
+    return args
+
+
+def vcd_payloads(f):
+    """Yields the payload of each xSCOPE record in a VCD file.
+
+    A record is a $comment holding its length, payload in hex and probe.
+    """
+    in_comment = False
+    expect_payload = False
+    for line in f:
+        if "$comment" not in line and not in_comment:
+            continue
+        for token in line.split():
+            if token == "$comment":
+                in_comment = True
+            elif token == "$end":
+                in_comment = False
+                expect_payload = False
+            elif in_comment and token[0] == "l" and token[1:].isdigit():
+                expect_payload = True
+            elif expect_payload:
+                expect_payload = False
+                try:
+                    yield bytes.fromhex(token)
+                except ValueError:
+                    pass
+
+
+def raw_payloads(f):
+    """Yields each batch from a file of batches written back to back."""
+    while True:
+        header = f.read(HEADER.size)
+        if len(header) < HEADER.size:
+            return
+        magic, version, tile, count, _ = HEADER.unpack(header)
+        if magic != BATCH_MAGIC:
+            raise ValueError("Bad batch header at offset {0}".format(f.tell() - HEADER.size))
+        records = f.read(count * RECORD.size)
+        yield header + records
+
+
+def load_symbols(path):
+    symbols = {}
+    with open(path, "r") as f:
+        for line in f:
+            tokens = line.split()
+            if len(tokens) < 2:
+                continue
+            try:
+                symbols[int(tokens[0], 16)] = tokens[-1]
+            except ValueError:
+                pass
+    return symbols
+
+
+class json_writer:
+    def __init__(self, path):
+        self.f = open(path, "w")
+        self.f.write('{"displayTimeUnit":"ns","traceEvents":[\n')
+        self.first = True
+
+    def event(self, ev):
+        if not self.first:
+            self.f.write(",\n")
+        self.first = False
+        self.f.write(json.dumps(ev, separators=(",", ":")))
+
+    def close(self):
+        self.f.write("\n]}\n")
+        self.f.close()
+
+
+class null_writer:
+    def event(self, ev):
+        pass
+
+    def close(self):
+        pass
+
+
+class core_state:
+    def __init__(self):
+        self.task = None        # Running task number
+        self.task_start = 0
+        self.task_isr_ticks = 0 # Time in ISRs since the task was switched in
+        self.isr = None         # (callback, start) of the ISR being handled
+        self.jobs = []          # (job, function, start) of the jobs running, innermost last
+
+
+class tile_state:
+    def __init__(self, tile):
+        self.tile = tile
+        self.first = None       # Earliest unwrapped timestamp
+        self.last = None        # Latest unwrapped timestamp
+        self.tasks = {}         # Task number to name
+        self.queues = {}        # Queue address to type name
+        self.cores = {}
+        self.busy = {}          # Task number to ticks run, excluding ISRs
+        self.isr_ticks = 0
+        self.dropped = 0
+        self.records = 0
+
+    def unwrap(self, timestamp):
+        """Extends a 32 bit timestamp, assuming it is within half the timer
+        range of the latest one seen on the tile."""
+        if self.last is None:
+            self.first = timestamp
+            self.last = timestamp
+            return timestamp
+        delta = ((timestamp - self.last + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+        t = self.last + delta
+        if t > self.last:
+            self.last = t
+        if t < self.first:
+            self.first = t
+        return t
+
+
+class decoder:
+    def __init__(self, writer, tick_rate, symbols):
+        self.writer = writer
+        self.us_per_tick = 1e6 / tick_rate
+        self.symbols = symbols
+        self.tiles = {}
+        self.batches = 0
+
+    def us(self, t):
+        return t * self.us_per_tick
+
+    def task_name(self, tile, task):
+        return tile.tasks.get(task, "task {0}".format(task))
+
+    def symbol(self, address):
+        return self.symbols.get(address, "0x{0:08x}".format(address))
+
+    def tile_get(self, tile_id):
+        tile = self.tiles.get(tile_id)
+        if tile is None:
+            tile = tile_state(tile_id)
+            self.tiles[tile_id] = tile
+            self.writer.event({"ph": "M", "name": "process_name", "pid": tile_id,
+                               "args": {"name": "tile {0}".format(tile_id)}})
+        return tile
+
+    def core_get(self, tile, core_id):
+        core = tile.cores.get(core_id)
+        if core is None:
+            core = core_state()
+            tile.cores[core_id] = core
+            self.writer.event({"ph": "M", "name": "thread_name", "pid": tile.tile, "tid": core_id,
+                               "args": {"name": "core {0}".format(core_id)}})
+        return core
+
+    def slice(self, tile, core_id, name, cat, start, end, args=None):
+        ev = {"ph": "X", "name": name, "cat": cat, "pid": tile.tile, "tid": core_id,
+              "ts": self.us(start), "dur": (end - start) * self.us_per_tick}
+        if args:
+            ev["args"] = args
+        self.writer.event(ev)
+
+    def instant(self, tile, core_id, name, cat, t, args):
+        self.writer.event({"ph": "i", "s": "t", "name": name, "cat": cat, "pid": tile.tile, "tid": core_id,
+                           "ts": self.us(t), "args": args})
+
+    def task_end(self, tile, core_id, core, t):
+        if core.task is None:
+            return
+        tile.busy[core.task] = tile.busy.get(core.task, 0) + (t - core.task_start) - core.task_isr_ticks
+        self.slice(tile, core_id, self.task_name(tile, core.task), "task", core.task_start, t, {"task": core.task})
+        core.task = None
+
+    def batch(self, payload):
+        if len(payload) < HEADER.size:
+            return
+        magic, version, tile_id, count, _ = HEADER.unpack_from(payload)
+        if magic != BATCH_MAGIC:
+            return
+        if version != VERSION:
+            raise ValueError("Unsupported trace version {0}".format(version))
+        self.batches += 1
+
+        tile = self.tile_get(tile_id)
+        count = min(count, (len(payload) - HEADER.size) // RECORD.size)
+        end = HEADER.size + count * RECORD.size
+        for record in RECORD.iter_unpack(payload[HEADER.size:end]):
+            self.record(tile, *record)
+
+    def record(self, tile, timestamp, event, core_id, task, arg0, arg1):
+        t = tile.unwrap(timestamp)
+        core = self.core_get(tile, core_id)
+        tile.records += 1
+
+        if event == EVENT_TASK_SWITCHED_IN:
+            # A dropped switch out leaves the previous task running
+            self.task_end(tile, core_id, core, t)
+            core.task = task
+            core.task_start = t
+            core.task_isr_ticks = 0
+
+        elif event == EVENT_TASK_SWITCHED_OUT:
+            if core.task == task:
+                self.task_end(tile, core_id, core, t)
+
+        elif event == EVENT_ISR_ENTER:
+            core.isr = (arg0, t)
+
+        elif event == EVENT_ISR_EXIT:
+            if core.isr is not None and core.isr[0] == arg0:
+                start = core.isr[1]
+                tile.isr_ticks += t - start
+                core.task_isr_ticks += t - start
+                self.slice(tile, core_id, self.symbol(arg0), "isr", start, t)
+            core.isr = None
+
+        elif event == EVENT_JOB_START:
+            core.jobs.append((arg0, arg1, t))
+
+        elif event == EVENT_JOB_END:
+            while core.jobs:
+                job, function, start = core.jobs.pop()
+                if job == arg0:
+                    self.slice(tile, core_id, self.symbol(function), "job", start, t, {"job": "0x{0:08x}".format(job)})
+                    break
+
+        elif event in QUEUE_EVENT_NAMES:
+            queue = "0x{0:08x}".format(arg0)
+            self.instant(tile, core_id, QUEUE_EVENT_NAMES[event], "queue", t,
+                         {"queue": queue, "type": tile.queues.get(arg0, "queue"), "waiting": arg1})
+
+        elif event == EVENT_TASK_CREATE:
+            tile.tasks[task] = ""
+            self.instant(tile, core_id, "task create", "task", t, {"task": task, "priority": arg0})
+
+        elif event == EVENT_TASK_NAME:
+            chunk = struct.pack("<II", arg0, arg1).split(b"\0", 1)[0]
+            tile.tasks[task] = tile.tasks.get(task, "") + chunk.decode("utf-8", "replace")
+
+        elif event == EVENT_TASK_DELETE:
+            self.instant(tile, core_id, "task delete", "task", t, {"task": task, "name": self.task_name(tile, task)})
+
+        elif event == EVENT_QUEUE_CREATE:
+            type_name = QUEUE_TYPE_NAMES[task] if task < len(QUEUE_TYPE_NAMES) else "queue"
+            tile.queues[arg0] = type_name
+            self.instant(tile, core_id, type_name + " create", "queue", t,
+                         {"queue": "0x{0:08x}".format(arg0), "length": arg1})
+
+        elif event == EVENT_DROPPED:
+            tile.dropped += arg0
+            self.instant(tile, core_id, "dropped {0} records".format(arg0), "trace", t, {"dropped": arg0})
+            # Whatever was missed may have ended an ISR or a job
+            core.isr = None
+            core.jobs = []
+
+    def finish(self):
+        """Ends the slices still open at the end of the capture."""
+        for tile in self.tiles.values():
+            for core_id, core in tile.cores.items():
+                self.task_end(tile, core_id, core, tile.last)
+
+    def summary(self):
+        for tile_id in sorted(self.tiles):
+            tile = self.tiles[tile_id]
+            span = tile.last - tile.first
+            capacity = span * len(tile.cores)
+            print("Tile {0}: {1:.3f} ms on {2} cores, {3} records, {4} dropped".format(
+                tile_id, span * self.us_per_tick / 1000, len(tile.cores), tile.records, tile.dropped))
+            if capacity == 0:
+                continue
+            print("    {0:<24} {1:>12} {2:>8}".format("Task", "Time (ms)", "CPU %"))
+            rows = [(self.task_name(tile, task), ticks) for task, ticks in tile.busy.items()]
+            rows.append(("(ISRs)", tile.isr_ticks))
+            for name, ticks in sorted(rows, key=lambda row: row[1], reverse=True):
+                print("    {0:<24} {1:>12.3f} {2:>8.2f}".format(
+                    name, ticks * self.us_per_tick / 1000, 100.0 * ticks / capacity))
+
+
+def main(trace_file, trace_format, json_file, symbols_file, tick_rate):
+    if trace_format is None:
+        trace_format = "vcd" if trace_file.lower().endswith(".vcd") else "raw"
+
+    symbols = load_symbols(symbols_file) if symbols_file else {}
+    writer = json_writer(json_file) if json_file else null_writer()
+    dec = decoder(writer, tick_rate, symbols)
+
+    if trace_format == "vcd":
+        with open(trace_file, "r") as f:
+            for payload in vcd_payloads(f):
+                dec.batch(payload)
+    else:
+        with open(trace_file, "rb") as f:
+            for payload in raw_payloads(f):
+                dec.batch(payload)
+
+    dec.finish()
+    writer.close()
+
+    if dec.batches == 0:
+        print("No binary trace records found", file=sys.stderr)
+        return 1
+
+    dec.summary()
+    return 0
+
+
+if __name__ == "__main__":
+    args = parse_arguments()
+
+    sys.exit(main(args.trace_file, args.format, args.json, args.symbols, args.tick_rate))